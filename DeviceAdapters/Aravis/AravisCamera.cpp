@@ -28,6 +28,7 @@
 */
 
 #include "AravisCamera.h"
+#include "PixelFormatConverter.h"
 
 #include <vector>
 #include <string>
@@ -44,10 +45,19 @@ std::vector<std::string> supportedPixelFormats = {
   "BayerRG10",
   "BayerRG12",
   "BayerRG16",
+  "Mono10p",
+  "Mono12p",
   "RGB8",
-  "BGR8"
+  "BGR8",
+  "YUV422_8",
+  "YUV422_8_UYVY",
+  "YUV422Packed",
+  "YUV422_YUYV_Packed"
 };
 
+// Stateless; picks the CPU's fastest kernels.
+const PixelFormatConverter converter;
+
 
 /*
  * Module functions.
@@ -82,22 +92,35 @@ MODULE_API void DeleteDevice(MM::Device* pDevice)
 }
 
 
-// RGB unpacker.
-void rgb_to_rgba(unsigned char *dest, unsigned char *source, size_t size)
+// Formats that MM uses as they are (all others are converted).
+static bool
+is_native_pixel_format (guint32 arvPixelFormat)
 {
-  size_t i;
-  size_t dOffset = 0;
-  size_t sOffset = 0;
-  
-  for (i = 0; i < size; i++){
-    memcpy(dest + dOffset, source + sOffset, 3);
-    //dest[dOffset + 3] = 0;
-    sOffset += 3;
-    dOffset += 4;
+  switch (arvPixelFormat) {
+  case ARV_PIXEL_FORMAT_MONO_10_P:
+  case ARV_PIXEL_FORMAT_MONO_12_P:
+  case ARV_PIXEL_FORMAT_RGB_8_PACKED:
+  case ARV_PIXEL_FORMAT_BGR_8_PACKED:
+  case ARV_PIXEL_FORMAT_YUV_422_PACKED:
+  case ARV_PIXEL_FORMAT_YUV_422_YUYV_PACKED:
+    return false;
+  default:
+    return true;
   }
 }
 
 
+// Returns a frame lent to the core to the stream.
+static void
+release_callback (void *context, const unsigned char *buf)
+{
+  ArvBuffer *arv_buffer = (ArvBuffer *) context;
+  AravisCamera *camera = (AravisCamera *) arv_buffer_get_user_data(arv_buffer);
+
+  camera->ArvPushBuffer(arv_buffer);
+}
+
+
 // Sequence acquisition callback.
 static void
 stream_callback (void *user_data, ArvStreamCallbackType type, ArvBuffer *arv_buffer)
@@ -126,6 +149,7 @@ AravisCamera::AravisCamera(const char *name) :
   arv_buffer(nullptr),
   arv_cam(nullptr),
   arv_cam_name(nullptr),
+  arv_pixel_format(0),
   arv_stream(nullptr),
   img_buffer(nullptr),
   pixel_type(nullptr)
@@ -144,10 +168,9 @@ AravisCamera::~AravisCamera()
 // These are in alphabetical order.
 void AravisCamera::AcquisitionCallback(ArvStreamCallbackType type, ArvBuffer *cb_arv_buffer)
 {
+  int ret;
   size_t size;
-  unsigned char *cb_arv_buffer_data;
-
-  Metadata md;
+  const unsigned char *cb_arv_buffer_data;
 
   if (!capturing){
     return;
@@ -161,57 +184,66 @@ void AravisCamera::AcquisitionCallback(ArvStreamCallbackType type, ArvBuffer *cb
     break;
   case ARV_STREAM_CALLBACK_TYPE_BUFFER_DONE:
 
-    // Copy buffer data.
     g_assert(cb_arv_buffer == arv_stream_pop_buffer(arv_stream));
     g_assert(cb_arv_buffer != NULL);
-    ArvBufferUpdate(cb_arv_buffer);
+    if (!ArvBufferFormatUpdate(cb_arv_buffer)){
+      arv_stream_push_buffer(arv_stream, cb_arv_buffer);
+      break;
+    }
 
     // Image metadata.
-    md.put(MM::g_Keyword_Metadata_CameraLabel, "");
-    md.put(MM::g_Keyword_Metadata_ROI_X, CDeviceUtils::ConvertToString((long)img_buffer_width));
-    md.put(MM::g_Keyword_Metadata_ROI_Y, CDeviceUtils::ConvertToString((long)img_buffer_height));
-    md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(counter));
-    md.put(MM::g_Keyword_Metadata_Exposure, exposure_time);
-    md.put(MM::g_Keyword_PixelType, pixel_type);
-    
+    seq_metadata.Clear();
+    seq_metadata.PutImageTag(MM::g_Keyword_Metadata_CameraLabel, "");
+    seq_metadata.PutImageTag(MM::g_Keyword_Metadata_ROI_X, img_buffer_width);
+    seq_metadata.PutImageTag(MM::g_Keyword_Metadata_ROI_Y, img_buffer_height);
+    seq_metadata.PutImageTag(MM::g_Keyword_Metadata_ImageNumber, counter);
+    seq_metadata.PutImageTag(MM::g_Keyword_Metadata_Exposure, exposure_time);
+    seq_metadata.PutImageTag(MM::g_Keyword_PixelType, pixel_type);
+
     // Pass data to MM.
-    int ret = GetCoreCallback()->InsertImage(this,
-					     img_buffer,
-					     img_buffer_width,
-					     img_buffer_height,
-					     img_buffer_bytes_per_pixel,
-					     1,
-					     md.Serialize().c_str(),
-					     FALSE);
-
-    arv_stream_push_buffer(arv_stream, cb_arv_buffer);
+    if (is_native_pixel_format(arv_pixel_format)){
+      // Lend the frame to the core without copying it; the core hands it
+      // back (release_callback) once consumed, and only then is it returned
+      // to the stream.
+      cb_arv_buffer_data = (const unsigned char *)arv_buffer_get_data(cb_arv_buffer, &size);
+      ret = GetCoreCallback()->InsertBorrowedImage(this,
+						   cb_arv_buffer_data,
+						   img_buffer_width,
+						   img_buffer_height,
+						   img_buffer_bytes_per_pixel,
+						   1,
+						   seq_metadata.GetData(),
+						   seq_metadata.GetSize(),
+						   release_callback,
+						   cb_arv_buffer,
+						   FALSE);
+    }
+    else{
+      // Packed and color formats are converted first.
+      ArvBufferUpdate(cb_arv_buffer);
+      ret = GetCoreCallback()->InsertImage(this,
+					   img_buffer,
+					   img_buffer_width,
+					   img_buffer_height,
+					   img_buffer_bytes_per_pixel,
+					   1,
+					   seq_metadata.GetData(),
+					   seq_metadata.GetSize(),
+					   FALSE);
+      arv_stream_push_buffer(arv_stream, cb_arv_buffer);
+    }
     counter += 1;
     break;
   }
 }
 
 
+// Copies the image to img_buffer, converting it if needed. The buffer must
+// have passed ArvBufferFormatUpdate().
 void AravisCamera::ArvBufferUpdate(ArvBuffer *aBuffer)
 {
-  int status;
   size_t arvSize, size;
-  guint32 arvPixelFormat;
   unsigned char *arvBufferData;
-  
-  status = arv_buffer_get_status(aBuffer);
-  if (status != 0){
-    printf("Error, Aravis buffer status is %d\n", status);
-    return;
-  }
-
-  // Pixel format updates.
-  arvPixelFormat = arv_buffer_get_image_pixel_format(aBuffer);
-  ArvPixelFormatUpdate(arvPixelFormat);
-
-  // Image size updates.
-  img_buffer_width = (int)arv_buffer_get_image_width(aBuffer);
-  img_buffer_height = (int)arv_buffer_get_image_height(aBuffer);
-  img_buffer_number_pixels = img_buffer_width * img_buffer_height;
 
   // Copy buffer to MM.
   arvBufferData = (unsigned char *)arv_buffer_get_data(aBuffer, &arvSize);
@@ -224,12 +256,53 @@ void AravisCamera::ArvBufferUpdate(ArvBuffer *aBuffer)
     img_buffer = (unsigned char *)malloc(size);
     img_buffer_size = size;
   }
-  if (img_buffer_number_components == 1){
+  switch (arv_pixel_format){
+  case ARV_PIXEL_FORMAT_MONO_10_P:
+    converter.UnpackMono10p((unsigned short *)img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  case ARV_PIXEL_FORMAT_MONO_12_P:
+    converter.UnpackMono12p((unsigned short *)img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  case ARV_PIXEL_FORMAT_RGB_8_PACKED:
+    converter.RGB8ToBGRA(img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  case ARV_PIXEL_FORMAT_BGR_8_PACKED:
+    converter.BGR8ToBGRA(img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  case ARV_PIXEL_FORMAT_YUV_422_PACKED:
+    converter.UYVYToBGRA(img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  case ARV_PIXEL_FORMAT_YUV_422_YUYV_PACKED:
+    converter.YUYVToBGRA(img_buffer, arvBufferData, img_buffer_number_pixels);
+    break;
+  default:
     memcpy(img_buffer, arvBufferData, size);
+    break;
   }
-  else{
-    rgb_to_rgba(img_buffer, arvBufferData, img_buffer_number_pixels);
-  }  
+}
+
+
+// Returns false if the buffer does not hold a complete image.
+bool AravisCamera::ArvBufferFormatUpdate(ArvBuffer *aBuffer)
+{
+  int status;
+  guint32 arvPixelFormat;
+
+  status = arv_buffer_get_status(aBuffer);
+  if (status != 0){
+    printf("Error, Aravis buffer status is %d\n", status);
+    return false;
+  }
+
+  // Pixel format updates.
+  arvPixelFormat = arv_buffer_get_image_pixel_format(aBuffer);
+  ArvPixelFormatUpdate(arvPixelFormat);
+
+  // Image size updates.
+  img_buffer_width = (int)arv_buffer_get_image_width(aBuffer);
+  img_buffer_height = (int)arv_buffer_get_image_height(aBuffer);
+  img_buffer_number_pixels = img_buffer_width * img_buffer_height;
+  return true;
 }
 
 
@@ -262,6 +335,7 @@ void AravisCamera::ArvGetExposure()
 // Update MM image values based on pixel format.
 void AravisCamera::ArvPixelFormatUpdate(guint32 arvPixelFormat)
 {
+  arv_pixel_format = arvPixelFormat;
   switch (arvPixelFormat){
   case ARV_PIXEL_FORMAT_MONO_8:
     img_buffer_bit_depth = 8;
@@ -281,6 +355,18 @@ void AravisCamera::ArvPixelFormatUpdate(guint32 arvPixelFormat)
     img_buffer_number_components = 1;
     pixel_type = "12bit mono";
     break;
+  case ARV_PIXEL_FORMAT_MONO_10_P:
+    img_buffer_bit_depth = 10;
+    img_buffer_bytes_per_pixel = 2;
+    img_buffer_number_components = 1;
+    pixel_type = "10bit mono";
+    break;
+  case ARV_PIXEL_FORMAT_MONO_12_P:
+    img_buffer_bit_depth = 12;
+    img_buffer_bytes_per_pixel = 2;
+    img_buffer_number_components = 1;
+    pixel_type = "12bit mono";
+    break;
   case ARV_PIXEL_FORMAT_MONO_14:
     img_buffer_bit_depth = 14;
     img_buffer_bytes_per_pixel = 2;
@@ -331,6 +417,13 @@ void AravisCamera::ArvPixelFormatUpdate(guint32 arvPixelFormat)
     img_buffer_number_components = 4;
     pixel_type = "8bitBGR";
     break;
+  case ARV_PIXEL_FORMAT_YUV_422_PACKED:
+  case ARV_PIXEL_FORMAT_YUV_422_YUYV_PACKED:
+    img_buffer_bit_depth = 8;
+    img_buffer_bytes_per_pixel = 4;
+    img_buffer_number_components = 4;
+    pixel_type = "8bitRGB";
+    break;
 
   default:
     printf ("Aravis Error: Pixel Format %d is not implemented\n", (int)arvPixelFormat);
@@ -339,6 +432,12 @@ void AravisCamera::ArvPixelFormatUpdate(guint32 arvPixelFormat)
 }
 
 
+void AravisCamera::ArvPushBuffer(ArvBuffer *aBuffer)
+{
+  arv_stream_push_buffer(arv_stream, aBuffer);
+}
+
+
 int AravisCamera::ArvStartSequenceAcquisition()
 {
   int i;
@@ -362,7 +461,7 @@ int AravisCamera::ArvStartSequenceAcquisition()
     payload = arv_camera_get_payload(arv_cam, &gerror);
     if (!ArvCheckError(gerror)){
       for (i = 0; i < 20; i++)
-	arv_stream_push_buffer(arv_stream, arv_buffer_new(payload, NULL));
+	arv_stream_push_buffer(arv_stream, arv_buffer_new_full(payload, NULL, this, NULL));
     }
     arv_camera_start_acquisition(arv_cam, &gerror);
     if (ArvCheckError(gerror)){
@@ -432,6 +531,10 @@ const unsigned char* AravisCamera::GetImageBuffer()
   unsigned char *arv_buffer_data;
 
   if (ARV_IS_BUFFER (arv_buffer)) {
+    if (!ArvBufferFormatUpdate(arv_buffer)){
+      g_clear_object(&arv_buffer);
+      return NULL;
+    }
     ArvBufferUpdate(arv_buffer);
     g_clear_object(&arv_buffer);
     SetProperty(MM::g_Keyword_PixelType, pixel_type);
@@ -1197,9 +1300,10 @@ int AravisCamera::StopSequenceAcquisition()
     capturing = false;
     arv_camera_stop_acquisition(arv_cam, &gerror);
     ArvCheckError(gerror);
-    g_clear_object(&arv_stream);
-    
+
+    // Frames lent to the core are all returned (to the stream) by now.
     GetCoreCallback()->AcqFinished(this, 0);
+    g_clear_object(&arv_stream);
   }
   return DEVICE_OK;
 }
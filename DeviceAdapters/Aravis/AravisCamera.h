@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 */
+#include "BinaryMetadata.h"
 #include "DeviceBase.h"
 #include "arv.h"
 #include "glib.h"
@@ -97,10 +98,12 @@ public:
 
   // Internal.
   void AcquisitionCallback(ArvStreamCallbackType, ArvBuffer *);
+  bool ArvBufferFormatUpdate(ArvBuffer *aBuffer);
   void ArvBufferUpdate(ArvBuffer *aBuffer);
   int ArvCheckError(GError *gerror) const;
   void ArvGetExposure();
   void ArvPixelFormatUpdate(guint32 arvPixelFormat);
+  void ArvPushBuffer(ArvBuffer *aBuffer);
   int ArvStartSequenceAcquisition();
 
   
@@ -121,9 +124,11 @@ private:
   ArvCamera *arv_cam;
   char *arv_cam_name;
   ArvDevice *arv_device;
+  guint32 arv_pixel_format;
   ArvStream *arv_stream;
   unsigned char *img_buffer;
   const char *pixel_type;
+  MM::BinaryMetadataWriter seq_metadata;
   const char *trigger;
 };
 
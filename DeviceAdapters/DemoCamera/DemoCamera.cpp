@@ -23,6 +23,7 @@
 //                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
 
 #include "DemoCamera.h"
+#include "StripeTable.h"
 #include <cstdio>
 #include <string>
 #include <math.h>
@@ -32,6 +33,7 @@
 #include "WriteCompactTiffRGB.h"
 #include <iostream>
 #include <future>
+#include <cmath>
 
 #ifdef _WIN32
    #include <timeapi.h>
@@ -39,6 +41,177 @@
 
 double g_IntensityFactor_ = 1.0;
 
+namespace {
+
+// Synthetic frames are generated in bands of rows on all cores; below this
+// many rows per band, starting a thread costs more than it saves
+const unsigned g_MinRowsPerBand = 64;
+
+unsigned RowBandCount(unsigned height)
+{
+   unsigned nBands = std::max(1u, std::thread::hardware_concurrency());
+   return std::max(1u, std::min(nBands, height / g_MinRowsPerBand));
+}
+
+// Calls fn(band, rowBegin, rowEnd) for each band, in parallel
+template <typename F>
+void ForEachRowBand(unsigned height, unsigned nBands, F fn)
+{
+   std::vector< std::future<void> > bands;
+   for (unsigned b = 1; b < nBands; ++b)
+   {
+      const unsigned rowBegin = (unsigned)((unsigned long long)height * b / nBands);
+      const unsigned rowEnd = (unsigned)((unsigned long long)height * (b + 1) / nBands);
+      bands.push_back(std::async(std::launch::async, [=, &fn] {
+         fn(b, rowBegin, rowEnd);
+      }));
+   }
+   fn(0, 0, (unsigned)((unsigned long long)height / nBands));
+   for (size_t b = 0; b < bands.size(); ++b)
+      bands[b].get();
+}
+
+// xorshift128+, seeded through splitmix64; much faster than rand() and
+// good enough for image noise
+class FastRandom
+{
+public:
+   FastRandom(uint64_t seed, uint64_t stream)
+   {
+      uint64_t x = seed ^ (stream * 0x9E3779B97F4A7C15ULL);
+      s0_ = SplitMix64(x);
+      s1_ = SplitMix64(x);
+   }
+
+   uint64_t Next()
+   {
+      uint64_t a = s0_;
+      const uint64_t b = s1_;
+      s0_ = b;
+      a ^= a << 23;
+      s1_ = a ^ b ^ (a >> 17) ^ (b >> 26);
+      return s1_ + b;
+   }
+
+private:
+   static uint64_t SplitMix64(uint64_t& x)
+   {
+      uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+   }
+
+   uint64_t s0_;
+   uint64_t s1_;
+};
+
+// Standard normal quantiles at 4096 evenly spaced probabilities, scaled to
+// unit variance: indexing with 12 uniform random bits draws a Gaussian
+// deviate without a transcendental function per pixel
+const unsigned g_NormalTableBits = 12;
+
+const float* StandardNormalTable()
+{
+   static const std::vector<float> table = [] {
+      const unsigned n = 1u << g_NormalTableBits;
+      std::vector<double> quantiles(n);
+      double sumOfSquares = 0.0;
+      for (unsigned i = 0; i < n; ++i)
+      {
+         const double p = (i + 0.5) / n;
+         double lo = -10.0;
+         double hi = 10.0;
+         for (int iter = 0; iter < 64; ++iter)
+         {
+            const double mid = 0.5 * (lo + hi);
+            if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p)
+               lo = mid;
+            else
+               hi = mid;
+         }
+         quantiles[i] = 0.5 * (lo + hi);
+         sumOfSquares += quantiles[i] * quantiles[i];
+      }
+      const double scale = 1.0 / std::sqrt(sumOfSquares / n);
+      std::vector<float> result(n);
+      for (unsigned i = 0; i < n; ++i)
+         result[i] = (float)(quantiles[i] * scale);
+      return result;
+   }();
+   return &table[0];
+}
+
+// Sets each of count pixels to (or, if Add, adds to it) a deviate drawn from
+// table, clamped to [0, maxValue]
+template <bool Add, typename PixelType>
+void DrawDeviates(PixelType* p, size_t count, const int* table, int maxValue, FastRandom& rng)
+{
+   const unsigned indexMask = (1u << g_NormalTableBits) - 1;
+   PixelType* const end = p + count;
+   PixelType* const endOfGroups = p + count / 5 * 5;
+   // Five table indices per 64-bit draw
+   for (; p != endOfGroups; p += 5)
+   {
+      uint64_t bits = rng.Next() >> 4;
+      for (int i = 0; i < 5; ++i, bits >>= g_NormalTableBits)
+      {
+         int value = table[bits & indexMask];
+         if (Add)
+            value += p[i];
+         p[i] = (PixelType) std::max(0, std::min(maxValue, value));
+      }
+   }
+   uint64_t bits = rng.Next() >> 4;
+   for (; p != end; ++p, bits >>= g_NormalTableBits)
+   {
+      int value = table[bits & indexMask];
+      if (Add)
+         value += *p;
+      *p = (PixelType) std::max(0, std::min(maxValue, value));
+   }
+}
+
+// Sets each pixel to (or, if add is true, adds to it) a Gaussian deviate
+// with the given mean and standard deviation, clamped to [0, maxValue]
+template <typename PixelType>
+void ApplyGaussianNoise(PixelType* pixels, unsigned width, unsigned height,
+   bool add, double mean, double stdDev, int maxValue, uint64_t seed)
+{
+   // Tabulate the deviates for this mean and deviation, so that a pixel
+   // costs a table lookup and an integer add
+   const float* normal = StandardNormalTable();
+   const unsigned tableSize = 1u << g_NormalTableBits;
+   std::vector<int> deviates(tableSize);
+   for (unsigned i = 0; i < tableSize; ++i)
+   {
+      double value = std::floor(mean + stdDev * normal[i]);
+      deviates[i] = (int) std::max(-1e9, std::min(1e9, value));
+   }
+
+   const int* table = &deviates[0];
+   ForEachRowBand(height, RowBandCount(height), [=](unsigned band, unsigned rowBegin, unsigned rowEnd) {
+      FastRandom rng(seed, band);
+      PixelType* p = pixels + (size_t) width * rowBegin;
+      const size_t count = (size_t) width * (rowEnd - rowBegin);
+      if (add)
+         DrawDeviates<true>(p, count, table, maxValue, rng);
+      else
+         DrawDeviates<false>(p, count, table, maxValue, rng);
+   });
+}
+
+template <typename T>
+double MaxPixelValue(const T* pixels, size_t count)
+{
+   T maxValue = 0;
+   for (size_t i = 0; i < count; ++i)
+      maxValue = std::max(maxValue, pixels[i]);
+   return static_cast<double>(maxValue);
+}
+
+} // namespace
+
 // External names used used by the rest of the system
 // to load particular device from the "DemoCamera.dll" library
 const char* g_CameraDeviceName = "DCam";
@@ -1067,18 +1240,19 @@ int CDemoCamera::InsertImage()
    this->GetLabel(label);
  
    // Important:  metadata about the image are generated here:
-   Metadata md;
-   md.put(MM::g_Keyword_Metadata_CameraLabel, label);
-   std::string elapsed = CDeviceUtils::ConvertToString((timeStamp - sequenceStartTime_).getMsec());
-   md.put(MM::g_Keyword_Elapsed_Time_ms, elapsed);
-   md.put(MM::g_Keyword_Metadata_ROI_X, CDeviceUtils::ConvertToString( (long) roiX_)); 
-   md.put(MM::g_Keyword_Metadata_ROI_Y, CDeviceUtils::ConvertToString( (long) roiY_)); 
+   MM::BinaryMetadataWriter& md = sequenceMetadata_;
+   md.Clear();
+   md.PutImageTag(MM::g_Keyword_Metadata_CameraLabel, label);
+   md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms,
+         CDeviceUtils::ConvertToString((timeStamp - sequenceStartTime_).getMsec()));
+   md.PutImageTag(MM::g_Keyword_Metadata_ROI_X, roiX_);
+   md.PutImageTag(MM::g_Keyword_Metadata_ROI_Y, roiY_);
 
    imageCounter_++;
 
    char buf[MM::MaxStrLength];
    GetProperty(MM::g_Keyword_Binning, buf);
-   md.put(MM::g_Keyword_Binning, buf);
+   md.PutImageTag(MM::g_Keyword_Binning, buf);
 
    MMThreadGuard g(imgPixelsLock_);
 
@@ -1089,7 +1263,8 @@ int CDemoCamera::InsertImage()
    unsigned int h = GetImageHeight();
    unsigned int b = GetImageBytesPerPixel();
 
-   return GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_, md.Serialize().c_str());
+   return GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_,
+         md.GetData(), md.GetSize());
 }
 
 /*
@@ -2059,7 +2234,6 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
    unsigned int* rawBuf = (unsigned int*) img.GetPixelsRW();
    double maxDrawnVal = 0;
    long lPeriod = (long) imgWidth / 2;
-   double dLinePhase = 0.0;
    const double dAmp = exp;
    double cLinePhaseInc = 2.0 * lSinePeriod / 4.0 / img.Height();
    if (shouldRotateImages_) {
@@ -2088,24 +2262,27 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
 	if( saturatePixels_)
 		pixelsToSaturate = (long)(0.5 + fractionOfPixelsToDropOrSaturate_*img.Height()*imgWidth);
 
+   // Each row of the stripes is one line shifted by the row's phase: draw
+   // rows by copying from a table of the line instead of a sine per pixel
+   const unsigned imgHeight = img.Height();
+   const double phasePerColumn = lPeriod > 0 ? 2.0 * lSinePeriod / lPeriod : 0.0;
+   const unsigned nBands = RowBandCount(imgHeight);
+
    unsigned j, k;
    if (pixelType.compare(g_PixelType_8bit) == 0)
    {
       double pedestal = 127 * exp / 100.0 * GetBinning() * GetBinning();
       unsigned char* pBuf = const_cast<unsigned char*>(img.GetPixels());
-      for (j=0; j<img.Height(); j++)
-      {
-         for (k=0; k<imgWidth; k++)
-         {
-            long lIndex = imgWidth*j + k;
-            unsigned char val = (unsigned char) (g_IntensityFactor_ * std::min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod))));
-            if (val > maxDrawnVal) {
-                maxDrawnVal = val;
-            }
-            *(pBuf + lIndex) = val;
-         }
-         dLinePhase += cLinePhaseInc;
-      }
+      auto line = MakeStripeTable<unsigned char>(imgWidth, phasePerColumn, [=](double s) {
+         return (unsigned char) (g_IntensityFactor_ * std::min(255.0, (pedestal + dAmp * s)));
+      });
+      ForEachRowBand(imgHeight, nBands, [&](unsigned, unsigned rowBegin, unsigned rowEnd) {
+         std::vector<unsigned char> scratch;
+         for (unsigned row = rowBegin; row < rowEnd; ++row)
+            memcpy(pBuf + (size_t) imgWidth * row, line.Row(dPhase_ + row * cLinePhaseInc, scratch), imgWidth);
+      });
+      if (shouldDisplayImageNumber_)
+         maxDrawnVal = MaxPixelValue(pBuf, (size_t) imgWidth * imgHeight);
 	   for(int snoise = 0; snoise < pixelsToSaturate; ++snoise)
 		{
 			j = (unsigned)( (double)(img.Height()-1)*(double)rand()/(double)RAND_MAX);
@@ -2126,19 +2303,16 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
       double pedestal = maxValue/2 * exp / 100.0 * GetBinning() * GetBinning();
       double dAmp16 = dAmp * maxValue/255.0; // scale to behave like 8-bit
       unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (j=0; j<img.Height(); j++)
-      {
-         for (k=0; k<imgWidth; k++)
-         {
-            long lIndex = imgWidth*j + k;
-            unsigned short val = (unsigned short) (g_IntensityFactor_ * std::min((double)maxValue, pedestal + dAmp16 * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod)));
-            if (val > maxDrawnVal) {
-                maxDrawnVal = val;
-            }
-            *(pBuf + lIndex) = val;
-         }
-         dLinePhase += cLinePhaseInc;
-      }         
+      auto line = MakeStripeTable<unsigned short>(imgWidth, phasePerColumn, [=](double s) {
+         return (unsigned short) (g_IntensityFactor_ * std::min((double)maxValue, pedestal + dAmp16 * s));
+      });
+      ForEachRowBand(imgHeight, nBands, [&](unsigned, unsigned rowBegin, unsigned rowEnd) {
+         std::vector<unsigned short> scratch;
+         for (unsigned row = rowBegin; row < rowEnd; ++row)
+            memcpy(pBuf + (size_t) imgWidth * row, line.Row(dPhase_ + row * cLinePhaseInc, scratch), imgWidth * 2);
+      });
+      if (shouldDisplayImageNumber_)
+         maxDrawnVal = MaxPixelValue(pBuf, (size_t) imgWidth * imgHeight);
 	   for(int snoise = 0; snoise < pixelsToSaturate; ++snoise)
 		{
 			j = (unsigned)(0.5 + (double)img.Height()*(double)rand()/(double)RAND_MAX);
@@ -2159,28 +2333,19 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
       double pedestal = 127 * exp / 100.0 * GetBinning() * GetBinning();
       float* pBuf = (float*) const_cast<unsigned char*>(img.GetPixels());
       float saturatedValue = 255.;
-      memset(pBuf, 0, img.Height()*imgWidth*4);
-      // static unsigned int j2;
-      for (j=0; j<img.Height(); j++)
-      {
-         for (k=0; k<imgWidth; k++)
-         {
-            long lIndex = imgWidth*j + k;
-            double value =  (g_IntensityFactor_ * std::min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod))));
-            if (value > maxDrawnVal) {
-                maxDrawnVal = value;
-            }
-            *(pBuf + lIndex) = (float) value;
-            if( 0 == lIndex)
-            {
-               std::ostringstream os;
-               os << " first pixel is " << (float)value;
-               LogMessage(os.str().c_str(), true);
-
-            }
-         }
-         dLinePhase += cLinePhaseInc;
-      }
+      auto line = MakeStripeTable<float>(imgWidth, phasePerColumn, [=](double s) {
+         return (float) (g_IntensityFactor_ * std::min(255.0, (pedestal + dAmp * s)));
+      });
+      ForEachRowBand(imgHeight, nBands, [&](unsigned, unsigned rowBegin, unsigned rowEnd) {
+         std::vector<float> scratch;
+         for (unsigned row = rowBegin; row < rowEnd; ++row)
+            memcpy(pBuf + (size_t) imgWidth * row, line.Row(dPhase_ + row * cLinePhaseInc, scratch), imgWidth * 4);
+      });
+      if (shouldDisplayImageNumber_)
+         maxDrawnVal = MaxPixelValue(pBuf, (size_t) imgWidth * imgHeight);
+      std::ostringstream os;
+      os << " first pixel is " << pBuf[0];
+      LogMessage(os.str().c_str(), true);
 
 	   for(int snoise = 0; snoise < pixelsToSaturate; ++snoise)
 		{
@@ -2202,7 +2367,25 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
       double pedestal = 127 * exp / 100.0;
       unsigned int * pBuf = (unsigned int*) rawBuf;
 
-      unsigned char* pTmpBuffer = NULL;
+      // Components 0, 1, 2 use the line phase times 1, 2, 4
+      auto line = MakeStripeTable<unsigned char>(imgWidth, phasePerColumn, [=](double s) {
+         return (unsigned char) std::min(255.0, (pedestal + dAmp * s));
+      });
+      ForEachRowBand(imgHeight, nBands, [&](unsigned, unsigned rowBegin, unsigned rowEnd) {
+         std::vector<unsigned char> scratch0, scratch1, scratch2;
+         for (unsigned row = rowBegin; row < rowEnd; ++row)
+         {
+            const double dLinePhase = row * cLinePhaseInc;
+            const unsigned char* value0 = line.Row(dPhase_ + dLinePhase, scratch0);
+            const unsigned char* value1 = line.Row(dPhase_ + dLinePhase*2, scratch1);
+            const unsigned char* value2 = line.Row(dPhase_ + dLinePhase*4, scratch2);
+            unsigned int* pRow = pBuf + (size_t) imgWidth * row;
+            for (unsigned col = 0; col < imgWidth; ++col)
+               pRow[col] = value0[col] | (value1[col] << 8) | (value2[col] << 16);
+         }
+      });
+      if (shouldDisplayImageNumber_)
+         maxDrawnVal = MaxPixelValue(pBuf, (size_t) imgWidth * imgHeight);
 
       if(debugRGB)
       {
@@ -2222,54 +2405,21 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
          }
       }
 
-		// only perform the debug operations if pTmpbuffer is not 0
-      pTmpBuffer = pDebug;
-      unsigned char* pTmp2 = pTmpBuffer;
-      if( NULL!= pTmpBuffer)
-			memset( pTmpBuffer, 0, img.Height() * imgWidth * 3);
-
-      for (j=0; j<img.Height(); j++)
-      {
-         unsigned char theBytes[4];
-         for (k=0; k<imgWidth; k++)
-         {
-            long lIndex = imgWidth*j + k;
-            double factor = (2.0 * lSinePeriod * k) / lPeriod;
-            unsigned char value0 =   (unsigned char) std::min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase + factor)));
-            theBytes[0] = value0;
-            if( NULL != pTmpBuffer)
-               pTmp2[1] = value0;
-            unsigned char value1 =   (unsigned char) std::min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase*2 + factor)));
-            theBytes[1] = value1;
-            if( NULL != pTmpBuffer)
-               pTmp2[2] = value1;
-            unsigned char value2 = (unsigned char) std::min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase*4 + factor)));
-            theBytes[2] = value2;
-
-            if( NULL != pTmpBuffer){
-               pTmp2[3] = value2;
-               pTmp2+=3;
-            }
-            theBytes[3] = 0;
-            unsigned long tvalue = *(unsigned long*)(&theBytes[0]);
-            if (tvalue > maxDrawnVal) {
-                maxDrawnVal = tvalue;
-            }
-            *(pBuf + lIndex) =  tvalue ;  //value0+(value1<<8)+(value2<<16);
-         }
-         dLinePhase += cLinePhaseInc;
-      }
-
-
       // ImageJ's AWT images are loaded with a Direct Color processor which expects big endian ARGB,
       // which on little endian architectures corresponds to BGRA (see: https://en.wikipedia.org/wiki/RGBA_color_model), 
       // that's why we swapped the Blue and Red components in the generator above.
-      if(NULL != pTmpBuffer)
+      if(debugRGB && NULL != pDebug)
       {
+         for (unsigned long i = 0; i < (unsigned long) img.Height() * imgWidth; ++i)
+         {
+            pDebug[3 * i] = (unsigned char) pBuf[i];
+            pDebug[3 * i + 1] = (unsigned char) (pBuf[i] >> 8);
+            pDebug[3 * i + 2] = (unsigned char) (pBuf[i] >> 16);
+         }
          // write the compact debug image...
          char ctmp[12];
          snprintf(ctmp,12,"%ld",iseq++);
-         writeCompactTiffRGB(imgWidth, img.Height(), pTmpBuffer, ("democamera" + std::string(ctmp)).c_str());
+         writeCompactTiffRGB(imgWidth, img.Height(), pDebug, ("democamera" + std::string(ctmp)).c_str());
       }
 
 	}
@@ -2282,22 +2432,22 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
       
 		double maxPixelValue = (1<<(bitDepth_))-1;
       unsigned long long * pBuf = (unsigned long long*) rawBuf;
-      for (j=0; j<img.Height(); j++)
-      {
-         for (k=0; k<imgWidth; k++)
+      auto line = MakeStripeTable<unsigned short>(imgWidth, phasePerColumn, [=](double s) {
+         return (unsigned short) std::min(maxPixelValue, (pedestal + dAmp16 * s));
+      });
+      ForEachRowBand(imgHeight, nBands, [&](unsigned, unsigned rowBegin, unsigned rowEnd) {
+         std::vector<unsigned short> scratch0, scratch1, scratch2;
+         for (unsigned row = rowBegin; row < rowEnd; ++row)
          {
-            long lIndex = imgWidth*j + k;
-            unsigned long long value0 = (unsigned short) std::min(maxPixelValue, (pedestal + dAmp16 * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod)));
-            unsigned long long value1 = (unsigned short) std::min(maxPixelValue, (pedestal + dAmp16 * sin(dPhase_ + dLinePhase*2 + (2.0 * lSinePeriod * k) / lPeriod)));
-            unsigned long long value2 = (unsigned short) std::min(maxPixelValue, (pedestal + dAmp16 * sin(dPhase_ + dLinePhase*4 + (2.0 * lSinePeriod * k) / lPeriod)));
-            unsigned long long tval = value0+(value1<<16)+(value2<<32);
-            if (tval > maxDrawnVal) {
-                maxDrawnVal = static_cast<double>(tval);
-            }
-            *(pBuf + lIndex) = tval;
-			}
-         dLinePhase += cLinePhaseInc;
-      }
+            const double dLinePhase = row * cLinePhaseInc;
+            const unsigned short* value0 = line.Row(dPhase_ + dLinePhase, scratch0);
+            const unsigned short* value1 = line.Row(dPhase_ + dLinePhase*2, scratch1);
+            const unsigned short* value2 = line.Row(dPhase_ + dLinePhase*4, scratch2);
+            unsigned long long* pRow = pBuf + (size_t) imgWidth * row;
+            for (unsigned col = 0; col < imgWidth; ++col)
+               pRow[col] = value0[col] + ((unsigned long long) value1[col] << 16) + ((unsigned long long) value2[col] << 32);
+         }
+      });
 	}
 
     if (shouldDisplayImageNumber_) {
@@ -2507,41 +2657,18 @@ void CDemoCamera::AddBackgroundAndNoise(ImgBuffer& img, double mean, double stdD
    GetProperty(MM::g_Keyword_PixelType, buf);
 	std::string pixelType(buf);
 
-   int maxValue = 1 << GetBitDepth();
-   long nrPixels = img.Width() * img.Height();
+   int maxValue = (1 << GetBitDepth()) - 1;
    if (pixelType.compare(g_PixelType_8bit) == 0)
    {
       unsigned char* pBuf = (unsigned char*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++) 
-      {
-         double value = GaussDistributedValue(mean, stdDev);
-         if (value < 0) 
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned char) value;
-      }
+      ApplyGaussianNoise(pBuf, img.Width(), img.Height(), false, mean, stdDev,
+         std::min(maxValue, 255), noiseFrame_++);
    }
    else if (pixelType.compare(g_PixelType_16bit) == 0)
    {
       unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++) 
-      {
-         double value = GaussDistributedValue(mean, stdDev);
-         if (value < 0) 
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned short) value;
-      }
+      ApplyGaussianNoise(pBuf, img.Width(), img.Height(), false, mean, stdDev,
+         std::min(maxValue, 65535), noiseFrame_++);
    }
 }
 
@@ -2560,7 +2687,6 @@ void CDemoCamera::AddSignal(ImgBuffer& img, double photonFlux, double exp, doubl
 	std::string pixelType(buf);
 
    int maxValue = (1 << GetBitDepth()) -1;
-   long nrPixels = img.Width() * img.Height();
    double photons = photonFlux * exp;
    double shotNoise = sqrt(photons);
    double digitalValue = photons / cf;
@@ -2568,36 +2694,14 @@ void CDemoCamera::AddSignal(ImgBuffer& img, double photonFlux, double exp, doubl
    if (pixelType.compare(g_PixelType_8bit) == 0)
    {
       unsigned char* pBuf = (unsigned char*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++) 
-      {
-         double value = *(pBuf + i) + GaussDistributedValue(digitalValue, shotNoiseDigital);
-         if (value < 0) 
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) =  (unsigned char) value;
-      }
+      ApplyGaussianNoise(pBuf, img.Width(), img.Height(), true, digitalValue, shotNoiseDigital,
+         std::min(maxValue, 255), noiseFrame_++);
    }
    else if (pixelType.compare(g_PixelType_16bit) == 0)
    {
       unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++) 
-      {
-         double value = *(pBuf + i) + GaussDistributedValue(digitalValue, shotNoiseDigital);
-         if (value < 0) 
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned short) value;
-      }
+      ApplyGaussianNoise(pBuf, img.Width(), img.Height(), true, digitalValue, shotNoiseDigital,
+         std::min(maxValue, 65535), noiseFrame_++);
    }
 }
 
@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include "BinaryMetadata.h"
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
@@ -37,6 +38,8 @@
 #include <algorithm>
 #include <stdint.h>
 #include <future>
+#include <thread>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////////////
 // Error codes
@@ -230,6 +233,7 @@ private:
 
    double exposureMaximum_ = 10000.0;
    double dPhase_ = 0.0;
+   uint64_t noiseFrame_ = 0; // seeds the noise of each frame
    ImgBuffer img_;
    bool stopOnOverFlow_{};
    bool initialized_ = false;
@@ -240,6 +244,7 @@ private:
    unsigned roiX_ = 0;
    unsigned roiY_ = 0;
    MM::MMTime sequenceStartTime_;
+   MM::BinaryMetadataWriter sequenceMetadata_;
    bool isSequenceable_ = false;
    long sequenceMaxLength_ = 100;
    bool sequenceRunning_ = false;
@@ -962,36 +967,19 @@ public:
    };
 
 
+   // Filters rows [rowBegin, rowEnd) of pI into pSmooth
    template <typename PixelType>
-   int Filter(PixelType* pI, unsigned int width, unsigned int height)
+   void FilterRows(const PixelType* pI, PixelType* pSmooth, unsigned int width,
+      unsigned int height, unsigned int rowBegin, unsigned int rowEnd)
    {
-      int ret = DEVICE_OK;
       int x[9];
       int y[9];
+      std::vector<PixelType> windo;
+      windo.reserve(9);
 
-      const unsigned long thisSize = sizeof(*pI)*width*height;
-      if( thisSize != sizeOfSmoothedIm_)
-      {
-         if(NULL!=pSmoothedIm_)
-         {
-            sizeOfSmoothedIm_ = 0;
-            free(pSmoothedIm_);
-         }
-         // malloc is faster than new...
-         pSmoothedIm_ = (PixelType*)malloc(thisSize);
-         if(NULL!=pSmoothedIm_)
-         {
-            sizeOfSmoothedIm_ = thisSize;
-         }
-      }
-
-      PixelType* pSmooth = (PixelType*) pSmoothedIm_;
-
-      if(NULL != pSmooth)
-      {
       /*Apply 3x3 median filter to reduce shot noise*/
-      for (unsigned int i=0; i<width; i++) {
-         for (unsigned int j=0; j<height; j++) {
+      for (unsigned int j=rowBegin; j<rowEnd; j++) {
+         for (unsigned int i=0; i<width; i++) {
             x[0]=i-1;
             y[0]=(j-1);
             x[1]=i;
@@ -1011,8 +999,6 @@ public:
             x[8]=i+1;
             y[8]=(j+1);
             // truncate the median filter window  -- duplicate edge points
-            // this could be more efficient, we could fill in the interior image [1,w0-1]x[1,h0-1] then explicitly fill in the edge pixels.
-            // also the temporary image could be as small as 2 rasters of the image
             for(int ij =0; ij < 9; ++ij)
             {
                if( x[ij] < 0)
@@ -1024,7 +1010,7 @@ public:
                else if( int(height-1) < y[ij])
                   y[ij] = (int)(height-1);
             }
-            std::vector<PixelType> windo;
+            windo.clear();
             for(int ij = 0; ij < 9; ++ij)
             {
                windo.push_back(pI[ x[ij] + width*y[ij]]);
@@ -1032,6 +1018,51 @@ public:
             pSmooth[i + j*width] = FindMedian(windo);
          }
       }
+   }
+
+   template <typename PixelType>
+   int Filter(PixelType* pI, unsigned int width, unsigned int height)
+   {
+      int ret = DEVICE_OK;
+
+      const unsigned long thisSize = sizeof(*pI)*width*height;
+      if( thisSize != sizeOfSmoothedIm_)
+      {
+         if(NULL!=pSmoothedIm_)
+         {
+            sizeOfSmoothedIm_ = 0;
+            free(pSmoothedIm_);
+         }
+         // malloc is faster than new...
+         pSmoothedIm_ = (PixelType*)malloc(thisSize);
+         if(NULL!=pSmoothedIm_)
+         {
+            sizeOfSmoothedIm_ = thisSize;
+         }
+      }
+
+      PixelType* pSmooth = (PixelType*) pSmoothedIm_;
+
+      if(NULL != pSmooth)
+      {
+      // Bands of rows in parallel; each band reads its neighbor rows from
+      // the unmodified input
+      const unsigned minRowsPerBand = 32;
+      unsigned nBands = std::max(1u, std::thread::hardware_concurrency());
+      nBands = std::max(1u, std::min(nBands, height / minRowsPerBand));
+      std::vector< std::future<void> > bands;
+      for (unsigned b = 1; b < nBands; ++b)
+      {
+         const unsigned rowBegin = (unsigned)((unsigned long long)height * b / nBands);
+         const unsigned rowEnd = (unsigned)((unsigned long long)height * (b + 1) / nBands);
+         bands.push_back(std::async(std::launch::async, [=] {
+            FilterRows(pI, pSmooth, width, height, rowBegin, rowEnd);
+         }));
+      }
+      FilterRows(pI, pSmooth, width, height, 0,
+         (unsigned)((unsigned long long)height / nBands));
+      for (size_t b = 0; b < bands.size(); ++b)
+         bands[b].get();
 
       memcpy( pI, pSmoothedIm_, thisSize);
       }
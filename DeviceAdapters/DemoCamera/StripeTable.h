@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          StripeTable.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Tabulated line of the demo camera's stripe pattern.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+const double g_TwoPi = 6.283185307179586;
+
+// The stripe pattern is value(sin(rowPhase + phasePerColumn * column)), so
+// every row is the same line shifted by its phase. The line is tabulated
+// over a row plus one period, and each row is read from the offset that
+// matches its phase, rounded to the nearest column.
+//
+// When the period is much longer than a row (the stripes are nearly
+// horizontal), the table would be large while saving little, so rows are
+// computed directly instead.
+template <typename T, typename F>
+class StripeTable
+{
+public:
+   // Longest period, in rows' worth of columns, that is tabulated
+   static const unsigned maxTabulatedPeriodRows = 4;
+
+   StripeTable(unsigned width, double phasePerColumn, F value) :
+      width_(width), phasePerColumn_(phasePerColumn), period_(0.0), value_(value)
+   {
+      if (!(phasePerColumn_ > 0.0))
+         return;
+      period_ = g_TwoPi / phasePerColumn_;
+      if (!(period_ <= (double) maxTabulatedPeriodRows * width))
+         return;
+      table_.resize(width + (size_t) std::ceil(period_) + 1);
+      for (size_t k = 0; k < table_.size(); ++k)
+         table_[k] = value_(std::sin(phasePerColumn_ * k));
+   }
+
+   bool IsTabulated() const { return !table_.empty(); }
+
+   // Returns the row for rowPhase; a row that is not read from the table is
+   // written to scratch
+   const T* Row(double rowPhase, std::vector<T>& scratch) const
+   {
+      if (table_.empty())
+      {
+         scratch.resize(width_);
+         if (!(phasePerColumn_ > 0.0))
+            std::fill(scratch.begin(), scratch.end(), value_(std::sin(rowPhase)));
+         else
+         {
+            for (unsigned k = 0; k < width_; ++k)
+               scratch[k] = value_(std::sin(rowPhase + phasePerColumn_ * k));
+         }
+         return scratch.data();
+      }
+      double columns = std::fmod(rowPhase, g_TwoPi) / phasePerColumn_;
+      if (columns < 0.0)
+         columns += period_;
+      size_t offset = std::min((size_t) (columns + 0.5), table_.size() - width_);
+      return &table_[offset];
+   }
+
+private:
+   unsigned width_;
+   double phasePerColumn_;
+   double period_; // in columns
+   F value_;
+   std::vector<T> table_;
+};
+
+template <typename T, typename F>
+StripeTable<T, F> MakeStripeTable(unsigned width, double phasePerColumn, F value)
+{
+   return StripeTable<T, F>(width, phasePerColumn, value);
+}
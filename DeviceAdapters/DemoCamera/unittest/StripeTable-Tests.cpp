@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          StripeTable-Tests.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Tests for the demo camera's tabulated stripe pattern.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include <gtest/gtest.h>
+
+#include "StripeTable.h"
+
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+double Identity(double v) { return v; }
+
+} // namespace
+
+
+TEST(StripeTableTests, TabulatedRowsFollowPhaseToNearestColumn)
+{
+   const unsigned width = 64;
+   const double phasePerColumn = g_TwoPi / 10.0;
+   StripeTable<double, double (*)(double)> line =
+      MakeStripeTable<double>(width, phasePerColumn, &Identity);
+   ASSERT_TRUE(line.IsTabulated());
+
+   std::vector<double> scratch;
+   const double phases[] = { 0.0, 0.3, 2.0, -1.7, 25.0, -40.0 };
+   for (double phase : phases)
+   {
+      const double* row = line.Row(phase, scratch);
+      for (unsigned k = 0; k < width; ++k)
+      {
+         // Rounding to the nearest column shifts the phase by at most half
+         // a column
+         EXPECT_NEAR(std::sin(phase + phasePerColumn * k), row[k],
+            phasePerColumn / 2 + 1e-9) << "phase " << phase << ", column " << k;
+      }
+   }
+}
+
+TEST(StripeTableTests, LongPeriodIsComputedDirectly)
+{
+   const unsigned width = 512;
+   const double phasePerColumn = 1e-9; // Period of billions of columns
+   StripeTable<double, double (*)(double)> line =
+      MakeStripeTable<double>(width, phasePerColumn, &Identity);
+   EXPECT_FALSE(line.IsTabulated());
+
+   std::vector<double> scratch;
+   const double* row = line.Row(1.0, scratch);
+   ASSERT_EQ(scratch.data(), row);
+   ASSERT_EQ(width, scratch.size());
+   for (unsigned k = 0; k < width; ++k)
+      EXPECT_DOUBLE_EQ(std::sin(1.0 + phasePerColumn * k), row[k]);
+}
+
+TEST(StripeTableTests, PeriodUpToLimitIsTabulated)
+{
+   const unsigned width = 100;
+   const unsigned maxRows = StripeTable<double, double (*)(double)>::maxTabulatedPeriodRows;
+   EXPECT_TRUE(MakeStripeTable<double>(width,
+      g_TwoPi / (maxRows * width), &Identity).IsTabulated());
+   EXPECT_FALSE(MakeStripeTable<double>(width,
+      g_TwoPi / (2 * maxRows * width), &Identity).IsTabulated());
+}
+
+TEST(StripeTableTests, ZeroPhasePerColumnGivesConstantRow)
+{
+   const unsigned width = 16;
+   StripeTable<double, double (*)(double)> line =
+      MakeStripeTable<double>(width, 0.0, &Identity);
+   EXPECT_FALSE(line.IsTabulated());
+
+   std::vector<double> scratch;
+   const double* row = line.Row(0.5, scratch);
+   for (unsigned k = 0; k < width; ++k)
+      EXPECT_DOUBLE_EQ(std::sin(0.5), row[k]);
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -95,11 +95,30 @@ int ImageProcessorChain::Initialize()
       for (std::vector<std::string>::iterator iap = availableProcessors.begin();  iap != availableProcessors.end(); ++iap)
          AddAllowedValue(processorSlotName.str().c_str(), iap->c_str());
 
+      // Timing since the slot's processor was assigned
+      pAct = new CPropertyActionEx (this, &ImageProcessorChain::OnLatency, ip);
+      (void)CreateFloatProperty((processorSlotName.str() + "-LatencyMs").c_str(), 0.0, true, pAct);
+      pAct = new CPropertyActionEx (this, &ImageProcessorChain::OnThroughput, ip);
+      (void)CreateFloatProperty((processorSlotName.str() + "-FramesPerSecond").c_str(), 0.0, true, pAct);
    }
 
+   stages_.clear();
+   for( int ip = 0; ip < nSlots_; ++ip)
+      stages_.push_back(std::make_shared<Stage>());
+
+   (void)CreateIntegerProperty(MM::g_Keyword_ConcurrentProcessing, 1, true);
+
    return DEVICE_OK;
 }
 
+std::shared_ptr<ImageProcessorChain::Stage> ImageProcessorChain::GetStage(long slot)
+{
+   std::lock_guard<std::mutex> lock(stagesMutex_);
+   if (slot < 0 || slot >= (long)stages_.size())
+      return std::shared_ptr<Stage>();
+   return stages_[slot];
+}
+
    // action interface
    // ----------------
 int ImageProcessorChain::OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx)
@@ -117,21 +136,69 @@ int ImageProcessorChain::OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAc
       pProp->Get(name);
       processorNames_[indexx] = name;
 
+      std::vector< std::shared_ptr<Stage> > stages;
       for( int islot = 0; islot < this->nSlots_; ++islot)
       {
-         processors_[islot] = NULL;
+         MM::ImageProcessor* processor = NULL;
          if( processorNames_.end() != processorNames_.find(islot))
             if ( 0 < processorNames_[islot].length())
             {
                MM::Device* pDevice = GetDevice(processorNames_[islot].c_str());
                if( NULL != pDevice)
                   if( MM::ImageProcessorDevice == pDevice->GetType())
-                     processors_[islot] = (MM::ImageProcessor*) pDevice;
+                     processor = (MM::ImageProcessor*) pDevice;
             }
+
+         // Keep the stage (and its timing) if its processor is unchanged
+         std::shared_ptr<Stage> stage = GetStage(islot);
+         if (!stage || stage->processor != processor)
+         {
+            stage = std::make_shared<Stage>();
+            stage->processor = processor;
+         }
+         stages.push_back(stage);
+      }
+
+      std::lock_guard<std::mutex> lock(stagesMutex_);
+      stages_.swap(stages);
+   }
+
+   return DEVICE_OK;
+}
+
+
+int ImageProcessorChain::OnLatency(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      double latencyMs = 0.0;
+      std::shared_ptr<Stage> stage = GetStage(indexx);
+      if (stage)
+      {
+         std::lock_guard<std::mutex> lock(stage->timingMutex);
+         if (stage->frames > 0)
+            latencyMs = stage->processingUs / stage->frames / 1000.0;
       }
-      
+      pProp->Set(latencyMs);
    }
+   return DEVICE_OK;
+}
 
+int ImageProcessorChain::OnThroughput(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      double fps = 0.0;
+      std::shared_ptr<Stage> stage = GetStage(indexx);
+      if (stage)
+      {
+         std::lock_guard<std::mutex> lock(stage->timingMutex);
+         const double spanUs = (stage->lastEnd - stage->firstStart).getUsec();
+         if (stage->frames > 0 && spanUs > 0.0)
+            fps = stage->frames * 1e6 / spanUs;
+      }
+      pProp->Set(fps);
+   }
    return DEVICE_OK;
 }
 
@@ -139,34 +206,53 @@ int ImageProcessorChain::OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAc
 int ImageProcessorChain::Process(unsigned char *pBuffer, unsigned int width, unsigned int height, unsigned int byteDepth)
 {
    int ret = DEVICE_OK;
-   busy_ = true;
+   ++busy_;
 
+   std::vector< std::shared_ptr<Stage> > stages;
+   {
+      std::lock_guard<std::mutex> lock(stagesMutex_);
+      stages = stages_;
+   }
 
-   for( int islot = 0; islot < this->nSlots_; ++islot)
+   // Enter each stage before leaving the previous one, so that frames cannot
+   // overtake each other after the first stage. Frames are not ordered on
+   // their way into the first stage: concurrent callers race for it.
+   std::unique_lock<std::mutex> held;
+   for (size_t islot = 0; islot < stages.size(); ++islot)
    {
-      if( processors_.end() != processors_.find(islot))
+      Stage& stage = *stages[islot];
+      MM::ImageProcessor* pP = stage.processor;
+      if( NULL != pP)
       {
+         std::unique_lock<std::mutex> entered(stage.frameMutex);
+         held = std::move(entered);
 
-         MM::ImageProcessor* pP = processors_[islot];
-         if( NULL != pP)
+         const MM::MMTime start = GetCurrentMMTime();
+         try
          {
-            try
-            {
-               pP->Process(pBuffer, width, height,byteDepth);
-            }
-            catch(...)
-            {
-               std::ostringstream m;
-               char name[MM::MaxStrLength];
-               pP->GetName(name);
-               m << "Error in processor " << name;
-               LogMessage(m.str().c_str(), false);
-            }
+            pP->Process(pBuffer, width, height,byteDepth);
+         }
+         catch(...)
+         {
+            std::ostringstream m;
+            char name[MM::MaxStrLength];
+            pP->GetName(name);
+            m << "Error in processor " << name;
+            LogMessage(m.str().c_str(), false);
          }
+         const MM::MMTime end = GetCurrentMMTime();
+
+         std::lock_guard<std::mutex> lock(stage.timingMutex);
+         if (stage.frames++ == 0)
+            stage.firstStart = start;
+         stage.lastEnd = end;
+         stage.processingUs += (end - start).getUsec();
       }
    }
+   if (held)
+      held.unlock();
 
-   busy_ = false;
+   --busy_;
 
    return ret;
 }
@@ -29,19 +29,31 @@
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <map>
+#include <vector>
 
 
 
 //////////////////////////////////////////////////////////////////////////////
 // ImageProcessorChain class
 // run chain of image processors
+//
+// Process() may be called from several threads at once (the Core does so when
+// its ImageProcessingThreads property is set). Each slot is then a pipeline
+// stage that holds one frame at a time: frame N+1 can be in one slot while
+// frame N is in a later one. Frames pass through all stages in the order in
+// which they entered the first one, which need not be the order in which the
+// camera produced them, so processors that depend on frame order (e.g.
+// averaging) may see frames out of order.
 //////////////////////////////////////////////////////////////////////////////
 class ImageProcessorChain : public CImageProcessorBase<ImageProcessorChain>
 {
 public:
-   ImageProcessorChain () : nSlots_(10), busy_(false) {}
+   ImageProcessorChain () : nSlots_(10), busy_(0) {}
    ~ImageProcessorChain () { }
 
    int Shutdown() {return DEVICE_OK;}
@@ -49,19 +61,39 @@ public:
 
    int Initialize();
 
-   bool Busy(void) { return busy_;};
+   bool Busy(void) { return busy_ > 0;};
 
    int Process(unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth);
 
    // action interface
    // ----------------
    int OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx);
+   int OnLatency(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx);
+   int OnThroughput(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx);
 
 private:
+   struct Stage
+   {
+      MM::ImageProcessor* processor = nullptr;
+      std::mutex frameMutex; // Held while a frame is in this stage
+
+      std::mutex timingMutex;
+      unsigned long frames = 0;
+      double processingUs = 0.0; // Total time spent in Process()
+      MM::MMTime firstStart;
+      MM::MMTime lastEnd;
+   };
+
    const int nSlots_;
-   bool busy_;
+   std::atomic<int> busy_; // Frames in the chain
    std::map< int, std::string> processorNames_;
-   std::map< int, MM::ImageProcessor*> processors_;
+
+   // One per slot; replaced (not modified) when processors are reassigned,
+   // so frames in flight finish with the stages they started with
+   std::mutex stagesMutex_;
+   std::vector< std::shared_ptr<Stage> > stages_;
+
+   std::shared_ptr<Stage> GetStage(long slot);
 
    ImageProcessorChain& operator=( const ImageProcessorChain& ){ 
       return *this;
@@ -30,8 +30,13 @@
 #include <boost/bind/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <exception>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -304,7 +309,7 @@ public:
    {
       // clear read buffer;
       {
-         MMThreadGuard g(readBufferLock_);
+         std::lock_guard<std::mutex> g(readBufferLock_);
          data_read_.clear();
       }
 
@@ -320,7 +325,7 @@ public:
    bool ReadOneCharacter(char& msg)
    {
       bool retval = false;
-      MMThreadGuard g(readBufferLock_);
+      std::lock_guard<std::mutex> g(readBufferLock_);
       if (0 < data_read_.size())
       {
          retval = true;
@@ -330,6 +335,35 @@ public:
       return retval;
    }
 
+   // Move up to maxLen received characters into buf without blocking,
+   // stopping early after a character equal to stopAfter (if non-negative).
+   // Returns the number of characters moved.
+   size_t ReadCharacters(char* buf, size_t maxLen, int stopAfter = -1)
+   {
+      std::lock_guard<std::mutex> g(readBufferLock_);
+      size_t n = std::min(maxLen, data_read_.size());
+      if (stopAfter >= 0)
+      {
+         std::deque<char>::const_iterator stop = std::find(data_read_.begin(),
+               data_read_.begin() + n, static_cast<char>(stopAfter));
+         if (stop != data_read_.begin() + n)
+            n = (stop - data_read_.begin()) + 1;
+      }
+      std::copy(data_read_.begin(), data_read_.begin() + n, buf);
+      data_read_.erase(data_read_.begin(), data_read_.begin() + n);
+      return n;
+   }
+
+   // Block until received characters are available, the port is closed, or
+   // the deadline passes. Returns true if characters are available.
+   bool WaitForData(std::chrono::steady_clock::time_point deadline)
+   {
+      std::unique_lock<std::mutex> g(readBufferLock_);
+      dataArrived_.wait_until(g, deadline,
+            [this] { return !data_read_.empty() || !active_; });
+      return !data_read_.empty();
+   }
+
    void ShutDownInProgress(const bool v){ shutDownInProgress_ = v;};
 
 
@@ -363,13 +397,11 @@ private:
       if (!error)
       { // read completed, so process the data
          {
-            MMThreadGuard g(readBufferLock_);
-            for(unsigned int ib = 0; ib < bytes_transferred; ++ib)
-            {
-               data_read_.push_back(read_msg_[ib]);
-            }
+            std::lock_guard<std::mutex> g(readBufferLock_);
+            data_read_.insert(data_read_.end(), read_msg_,
+                  read_msg_ + bytes_transferred);
          }
-         CDeviceUtils::SleepMs(1);
+         dataArrived_.notify_all();
          ReadStart(); // start waiting for another asynchronous read again
       }
       else
@@ -452,12 +484,16 @@ private:
          MMThreadGuard g(implementationLock_);
          serialPortImplementation_.close();
       }
-      active_ = false;
+      {
+         std::lock_guard<std::mutex> g(readBufferLock_);
+         active_ = false;
+      }
+      dataArrived_.notify_all(); // Wake any reader waiting for data
    }
 
 
 private:
-   bool active_; // remains true while this object is still operating
+   std::atomic<bool> active_; // remains true while this object is still operating
    boost::asio::io_service& io_service_; // the main IO service that runs this connection
    boost::asio::serial_port serialPortImplementation_; // the serial port this instance is connected to
    char read_msg_[max_read_length]; // data read from the socket
@@ -466,7 +502,8 @@ private:
    SerialPort* pSerialPortAdapter_;
    std::string device_;
 
-   MMThreadLock readBufferLock_;
+   std::mutex readBufferLock_; // guards data_read_
+   std::condition_variable dataArrived_; // signaled when data_read_ grows
    MMThreadLock writeBufferLock_;
    MMThreadLock implementationLock_;
    bool shutDownInProgress_;
@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SerialLoopbackBench.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Measures SerialPort command/answer round-trip latency over a
+//                pseudo-terminal pair, with a responder thread on the master
+//                side playing the role of a controller. Also checks that a
+//                batch of commands written back to back (as done by
+//                MM::Core::SendSerialCommandBatch()) gets its answers in
+//                order, and compares it with sequential round trips.
+//
+//                Usage: SerialLoopbackBench [iterations] 2>/dev/null
+//                (without a Core, the port logs to stderr)
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SerialManager.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Answers every CR-terminated command with ":A <command>\r\n", in the style
+// of an ASI controller.
+void Respond(int masterFd, const std::atomic<bool>& stop)
+{
+   std::string pending;
+   char buf[256];
+   while (!stop)
+   {
+      pollfd pfd = { masterFd, POLLIN, 0 };
+      if (poll(&pfd, 1, 50) <= 0)
+         continue;
+      ssize_t n = read(masterFd, buf, sizeof(buf));
+      if (n <= 0)
+         continue;
+      pending.append(buf, static_cast<std::size_t>(n));
+      std::size_t pos;
+      while ((pos = pending.find('\r')) != std::string::npos)
+      {
+         const std::string reply = ":A " + pending.substr(0, pos) + "\r\n";
+         pending.erase(0, pos + 1);
+         if (write(masterFd, reply.data(), reply.size()) < 0)
+            return;
+      }
+   }
+}
+
+double Percentile(std::vector<double> v, double p)
+{
+   std::sort(v.begin(), v.end());
+   std::size_t i = static_cast<std::size_t>(p * (v.size() - 1) + 0.5);
+   return v[i];
+}
+
+void PrintStats(const char* title, int iterations, int errors,
+      const std::vector<double>& latenciesUs)
+{
+   double total = 0.0;
+   for (double us : latenciesUs)
+      total += us;
+   std::printf("%s: %d iterations, %d errors\n", title, iterations, errors);
+   std::printf("  mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+         total / latenciesUs.size(), Percentile(latenciesUs, 0.50),
+         Percentile(latenciesUs, 0.99),
+         *std::max_element(latenciesUs.begin(), latenciesUs.end()));
+}
+
+// Sends batchSize commands and collects their answers, either one round trip
+// at a time or with all commands written before the first answer is read.
+// Returns false if any answer is missing or out of order.
+bool RunBatch(SerialPort& port, int batchSize, bool pipelined, int seq)
+{
+   std::vector<std::string> commands;
+   for (int j = 0; j < batchSize; ++j)
+      commands.push_back("M X=" + std::to_string(seq + j));
+
+   char answer[256];
+   if (pipelined)
+   {
+      for (const std::string& cmd : commands)
+      {
+         if (port.SetCommand(cmd.c_str(), "\r") != DEVICE_OK)
+            return false;
+      }
+   }
+   for (const std::string& cmd : commands)
+   {
+      if (!pipelined && port.SetCommand(cmd.c_str(), "\r") != DEVICE_OK)
+         return false;
+      if (port.GetAnswer(answer, sizeof(answer), "\r\n") != DEVICE_OK ||
+            std::string(answer) != ":A " + cmd)
+         return false;
+   }
+   return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   const int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+
+   int masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+   if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+   {
+      std::perror("posix_openpt");
+      return 1;
+   }
+   const std::string slavePath = ptsname(masterFd);
+
+   // Keep the line discipline from echoing or translating on either side
+   int slaveFd = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+   termios tio;
+   tcgetattr(slaveFd, &tio);
+   cfmakeraw(&tio);
+   tcsetattr(slaveFd, TCSANOW, &tio);
+
+   std::atomic<bool> stop(false);
+   std::thread responder(Respond, masterFd, std::cref(stop));
+
+   SerialPort port(slavePath.c_str());
+   int ret = port.Initialize();
+   if (ret != DEVICE_OK)
+   {
+      std::fprintf(stderr, "Failed to open %s (error %d)\n",
+            slavePath.c_str(), ret);
+      stop = true;
+      responder.join();
+      return 1;
+   }
+
+   std::vector<double> latenciesUs;
+   latenciesUs.reserve(iterations);
+   char answer[256];
+   int errors = 0;
+   for (int i = 0; i < iterations; ++i)
+   {
+      const auto start = std::chrono::steady_clock::now();
+      ret = port.SetCommand("WHERE X Y", "\r");
+      if (ret == DEVICE_OK)
+         ret = port.GetAnswer(answer, sizeof(answer), "\r\n");
+      const auto end = std::chrono::steady_clock::now();
+      if (ret != DEVICE_OK || std::string(answer) != ":A WHERE X Y")
+      {
+         ++errors;
+         continue;
+      }
+      latenciesUs.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+   }
+
+   if (latenciesUs.empty())
+   {
+      std::fprintf(stderr, "No successful round trips (%d errors)\n", errors);
+      port.Shutdown();
+      stop = true;
+      responder.join();
+      return 1;
+   }
+   PrintStats("SerialPort pty round trip", iterations, errors, latenciesUs);
+
+   const int batchSize = 16;
+   const int batches = std::max(1, iterations / batchSize);
+   for (int pipelined = 0; pipelined < 2; ++pipelined)
+   {
+      std::vector<double> batchLatenciesUs;
+      int batchErrors = 0;
+      for (int i = 0; i < batches; ++i)
+      {
+         const auto start = std::chrono::steady_clock::now();
+         const bool ok = RunBatch(port, batchSize, pipelined != 0,
+               i * batchSize);
+         const auto end = std::chrono::steady_clock::now();
+         if (!ok)
+         {
+            ++batchErrors;
+            port.Purge();
+            continue;
+         }
+         batchLatenciesUs.push_back(
+               std::chrono::duration<double, std::micro>(end - start).count());
+      }
+      errors += batchErrors;
+      if (!batchLatenciesUs.empty())
+         PrintStats(pipelined ? "Batch of 16, pipelined" :
+               "Batch of 16, sequential", batches, batchErrors,
+               batchLatenciesUs);
+   }
+
+   port.Shutdown();
+   stop = true;
+   responder.join();
+   close(slaveFd);
+   close(masterFd);
+
+   return errors == 0 ? 0 : 1;
+}
@@ -44,6 +44,9 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -771,66 +774,85 @@ int SerialPort::GetAnswer(char* answer, unsigned bufLen, const char* term)
       LogMessage("BUFFER_OVERRUN error occured!");
       return ERR_BUFFER_OVERRUN;
    }
-   std::ostringstream logMsg;
    unsigned long answerOffset = 0;
    memset(answer,0,bufLen);
-   char theData = 0;
 
-   MM::MMTime startTime = GetCurrentMMTime();
-   MM::MMTime answerTimeout(answerTimeoutMs_ * 1000.0);
-   MM::MMTime nonTerminatedAnswerTimeout(5.0 * 1000.0); // For bug-compatibility
-   while ((GetCurrentMMTime() - startTime)  < answerTimeout)
+   const std::size_t termLen = term ? strlen(term) : 0;
+   // Only bytes up to the end of the terminator are consumed, so that any
+   // following bytes remain available for the next answer.
+   const int stopAfter = termLen > 0 ?
+      static_cast<unsigned char>(term[termLen - 1]) : -1;
+
+   const auto startTime = std::chrono::steady_clock::now();
+   const auto answerDeadline = startTime +
+      std::chrono::microseconds(static_cast<long long>(answerTimeoutMs_ * 1000.0));
+   // For bug-compatibility
+   const auto nonTerminatedAnswerDeadline = startTime + std::chrono::seconds(5);
+   for (;;)
    {
-      bool anyRead =  pPort_->ReadOneCharacter(theData);
-      if (anyRead)
+      if (bufLen <= answerOffset)
       {
-         if (bufLen <= answerOffset)
+         // Buffer is full; error if more data arrives before the timeout
+         char extra;
+         if (pPort_->ReadCharacters(&extra, 1) > 0)
          {
-            answer[answerOffset] = '\0';
+            answer[bufLen - 1] = '\0';
             LogMessage("BUFFER_OVERRUN error occured!");
             return ERR_BUFFER_OVERRUN;
          }
-         answer[answerOffset++] = theData;
       }
       else
       {
-         //Yield to other threads:
-         CDeviceUtils::SleepMs(1);
-      }
+         const std::size_t newChars = pPort_->ReadCharacters(
+               answer + answerOffset, bufLen - answerOffset, stopAfter);
+         answerOffset += static_cast<unsigned long>(newChars);
 
-      // look for the terminator, if any
-      if (term && term[0])
-      {
-         // check for terminating sequence
-         char* termPos = strstr(answer, term);
-         if (termPos != 0) // found the terminator
+         // look for the terminator (only the newly read bytes can complete it)
+         if (newChars > 0 && termLen > 0 && answerOffset >= termLen &&
+               memcmp(answer + answerOffset - termLen, term, termLen) == 0)
          {
-            LogAsciiCommunication("GetAnswer", true, answer);
+            LogAsciiCommunication("GetAnswer", true,
+                  std::string(answer, answerOffset));
 
             // erase the terminator from the answer:
-            *termPos = '\0';
+            answer[answerOffset - termLen] = '\0';
 
             return DEVICE_OK;
          }
+         if (newChars > 0)
+            continue; // There may be more data already buffered
       }
-      else
+
+      const auto now = std::chrono::steady_clock::now();
+      if (termLen == 0)
       {
          // XXX Shouldn't it be an error to not have a terminator?
          // TODO Make it a precondition check (immediate error) once we've made
          // sure that no device adapter calls us without a terminator. For now,
          // keep the behavior for the sake of bug-compatibility.
-
-         MM::MMTime elapsed = GetCurrentMMTime() - startTime;
-         if (elapsed > nonTerminatedAnswerTimeout)
+         if (now > nonTerminatedAnswerDeadline)
          {
-            LogAsciiCommunication("GetAnswer", true, answer);
-            long millisecs = static_cast<long>(elapsed.getMsec());
+            LogAsciiCommunication("GetAnswer", true,
+                  std::string(answer, answerOffset));
+            long millisecs = static_cast<long>(
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                     now - startTime).count());
             LogMessage(("GetAnswer without terminator returning after " +
                      boost::lexical_cast<std::string>(millisecs) +
                      "msec").c_str(), true);
             return DEVICE_OK;
          }
       }
+      if (now >= answerDeadline)
+         break;
+
+      // Sleep until the reader thread receives more data
+      const auto waitDeadline = termLen == 0 ?
+            std::min(answerDeadline, nonTerminatedAnswerDeadline) :
+            answerDeadline;
+      if (!pPort_->WaitForData(waitDeadline) &&
+            std::chrono::steady_clock::now() < waitDeadline)
+         break; // Port was closed; no more data will arrive
    }
 
    LogMessage("TERM_TIMEOUT error occured!");
@@ -880,26 +902,8 @@ int SerialPort::Read(unsigned char* buf, unsigned long bufLen, unsigned long& ch
       memset(buf, 0, bufLen);
       charsRead = 0;
 
-      bool anyRead = false;
-      char theData = 0;
-      for (;;)
-      {
-         anyRead = pPort_->ReadOneCharacter(theData);
-         if (anyRead)
-         {
-            buf[charsRead] = (unsigned char)theData;
-            if (bufLen <= ++charsRead)
-            {
-               // buffer is full
-               break;
-            }
-         }
-         else
-         {
-            // no data was available
-            break;
-         }
-      }
+      charsRead = static_cast<unsigned long>(
+            pPort_->ReadCharacters(reinterpret_cast<char*>(buf), bufLen));
       if (0 < charsRead)
       {
          if (verbose_)
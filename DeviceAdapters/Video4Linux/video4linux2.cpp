@@ -58,6 +58,7 @@ strace -f java -Djava.library.path=/usr/lib/micro-manager -classpath /usr/share/
 #include "DeviceBase.h"
 #include "ModuleInterface.h"
 #include "ImgBuffer.h"
+#include "PixelFormatConverter.h"
 #include <sstream>
 #include <map>
 #include <vector>
@@ -102,6 +103,9 @@ struct State {
   struct v4l2_buffer *buf;
 };
 
+// Stateless; picks the CPU's fastest kernels
+const PixelFormatConverter gConverter;
+
 class PixelType {
   public:
     PixelType(string propertyValue, unsigned bytesPerPixel, unsigned numberOfComponents, unsigned bitDepth) :
@@ -135,13 +139,8 @@ class PixelType8Bit : public PixelType {
 
     virtual void convertV4l2ToOutput(
         State *state, unsigned char* in, unsigned char* output) const {
-      int i,j;
-      for (j = 0; j < state->H; j++) {
-        int wj = state->W * j;
-        for (i = 0; i < state->W; i++) {
-          output[i + wj] = in[2*i + 2*wj];
-        }
-      }
+      /* The luma of YUYV */
+      gConverter.YUYVToY(output, in, (size_t)state->W * state->H);
     }
 };
 string PixelType8Bit::PROPERTY_VALUE = "8bit";
@@ -159,37 +158,7 @@ class PixelTypeYUYV : public PixelType {
         State *state, unsigned char* ptrIn, unsigned char* ptrOut) const {
       /* Convert YUYV to RGBA32, apparently mm does only display colors
        * in this format */
-      for (int i = 0;  i < state->W * state->H / 2; ++i) {
-        int y0 = ptrIn[0];
-        int u0 = ptrIn[1];
-        int y1 = ptrIn[2];
-        int v0 = ptrIn[3];
-        ptrIn += 4;
-        int c = y0 - 16;
-        int d = u0 - 128;
-        int e = v0 - 128;
-
-        ptrOut[0] = clip((298 * c + 516 * d + 128) >> 8); // blue
-        ptrOut[1] = clip((298 * c - 100 * d - 208 * e + 128) >> 8); // green
-        ptrOut[2] = clip((298 * c + 409 * e + 128) >> 8); // red
-        ptrOut[4] = 255; // alpha
-        c = y1 - 16;
-        ptrOut[4] = clip((298 * c + 516 * d + 128) >> 8); // blue
-        ptrOut[5] = clip((298 * c - 100 * d - 208 * e + 128) >> 8); // green
-        ptrOut[6] = clip((298 * c + 409 * e + 128) >> 8); // red
-        ptrOut[7] = 255; // alpha
-        ptrOut += 8;
-      }
-    }
-
-  private:
-    inline unsigned char clip(int val) const {
-      if (val <= 0)
-        return 0;
-      else if (val >= 255)
-        return 255;
-      else
-        return val;
+      gConverter.YUYVToBGRA(ptrOut, ptrIn, (size_t)state->W * state->H);
     }
 };
 string PixelTypeYUYV::PROPERTY_VALUE = "YUYV";
@@ -3,10 +3,9 @@
 // PROJECT:       Micro-Manager
 // SUBSYSTEM:     MMCore
 //-----------------------------------------------------------------------------
-// DESCRIPTION:   Generic implementation of the circular buffer. The buffer
-//                allows only one thread to enter at a time by using a mutex lock.
-//                This makes the buffer susceptible to race conditions if the
-//                calling threads are mutually dependent.
+// DESCRIPTION:   Generic implementation of the circular buffer. Producers
+//                are serialized by a mutex; consumers retrieve frames through
+//                atomic index and per-slot sequence counters without locking.
 //              
 // COPYRIGHT:     University of California, San Francisco, 2007,
 //
@@ -27,6 +26,7 @@
 #include "CoreUtils.h"
 
 #include "TaskSet_CopyMemory.h"
+#include "Tracing.h"
 
 #include "DeviceUtils.h"
 
@@ -35,54 +35,114 @@
 #include <ctime>
 #include <memory>
 #include <string>
+#include <thread>
+#include <utility>
 
 const long long bytesInMB = 1 << 20;
-const long adjustThreshold = LONG_MAX / 2;
 
 // Maximum number of images allowed in the buffer. This arbitrary limit is code
 // smell, but kept for now until careful checks for integer overflow and
 // division by zero can be added.
 const unsigned long maxCBSize = 10000000;
 
-CircularBuffer::CircularBuffer(unsigned int memorySizeMB) :
+CircularBuffer::CircularBuffer(unsigned int memorySizeMB,
+      std::size_t copyThreadCount,
+      const std::vector<unsigned>& copyThreadCPUs) :
    width_(0), 
    height_(0), 
    pixDepth_(0), 
    imageCounter_(0), 
    insertIndex_(0), 
    saveIndex_(0), 
+   pinnedCount_(0),
+   activeReaders_(0),
+   reallocating_(false),
    memorySizeMB_(memorySizeMB), 
+   maxImageCount_(maxCBSize),
    overflow_(false),
    overwriteData_(false),
-   threadPool_(std::make_shared<ThreadPool>()),
+   threadPool_(std::make_shared<ThreadPool>(copyThreadCount, copyThreadCPUs)),
    tasksMemCopy_(std::make_shared<TaskSet_CopyMemory>(threadPool_))
 {
 }
 
+// Registers a consumer for the duration of a lock-free read, so that
+// Initialize() can wait for in-flight readers before reallocating the slots.
+// Readers that arrive while reallocation is in progress see an empty buffer.
+class CircularBuffer::ReadGuard
+{
+   const CircularBuffer& buf_;
+   bool valid_;
+
+public:
+   explicit ReadGuard(const CircularBuffer& buf) :
+      buf_(buf)
+   {
+      // Both operations must be sequentially consistent (paired with the
+      // store/load order in Initialize()).
+      buf_.activeReaders_.fetch_add(1);
+      valid_ = !buf_.reallocating_.load();
+   }
+
+   ~ReadGuard() { buf_.activeReaders_.fetch_sub(1, std::memory_order_release); }
+
+   ReadGuard(const ReadGuard&) = delete;
+   ReadGuard& operator=(const ReadGuard&) = delete;
+
+   explicit operator bool() const { return valid_; }
+};
+
 CircularBuffer::~CircularBuffer() {}
 
 int CircularBuffer::SetOverwriteData(bool overwrite) {
-   MMThreadGuard guard(g_bufferLock);
    overwriteData_ = overwrite;
    return DEVICE_OK;
 }
 
+void CircularBuffer::SetCopyThreads(std::size_t threadCount,
+      const std::vector<unsigned>& cpus)
+{
+   // Create the new pool before taking the lock; the old one is joined
+   // after the lock is released
+   std::shared_ptr<ThreadPool> pool =
+      std::make_shared<ThreadPool>(threadCount, cpus);
+   std::shared_ptr<TaskSet_CopyMemory> tasks =
+      std::make_shared<TaskSet_CopyMemory>(pool);
+
+   MMThreadGuard insertGuard(g_insertLock);
+   std::swap(threadPool_, pool);
+   std::swap(tasksMemCopy_, tasks);
+}
+
 bool CircularBuffer::Initialize(unsigned int w, unsigned int h, unsigned int pixDepth)
 {
+   MMThreadGuard insertGuard(g_insertLock);
    MMThreadGuard guard(g_bufferLock);
    imageNumbers_.clear();
    startTime_ = std::chrono::steady_clock::now();
 
+   if (w == 0 || h==0 || pixDepth == 0)
+      return false; // does not make sense
+
+   if (w == width_ && height_ == h && pixDepth_ == pixDepth)
+      if (frameArray_.size() > 0)
+         return true; // nothing to change
+
+   // Wait for lock-free readers to leave before touching the slots
+   reallocating_.store(true);
+   while (activeReaders_.load() > 0)
+      std::this_thread::yield();
+
+   // Images handed out as ImageHandle must stay valid until released
+   if (pinnedCount_.load() > 0)
+   {
+      reallocating_.store(false);
+      return false;
+   }
+
    bool ret = true;
    try
    {
-      if (w == 0 || h==0 || pixDepth == 0)
-         return false; // does not make sense
-
-      if (w == width_ && height_ == h && pixDepth_ == pixDepth)
-         if (frameArray_.size() > 0)
-            return true; // nothing to change
-
       width_ = w;
       height_ = h;
       pixDepth_ = pixDepth;
@@ -100,12 +160,17 @@ bool CircularBuffer::Initialize(unsigned int w, unsigned int h, unsigned int pix
       if (cbSize == 0) 
       {
          frameArray_.resize(0);
+         slotSequence_.reset();
+         slotPins_.reset();
+         reallocating_.store(false);
          return false; // memory footprint too small
       }
 
       // set a reasonable limit to circular buffer capacity 
       if (cbSize > maxCBSize)
          cbSize = maxCBSize; 
+      if (cbSize > maxImageCount_)
+         cbSize = maxImageCount_;
 
       // TODO: verify if we have enough RAM to satisfy this request
 
@@ -119,21 +184,33 @@ bool CircularBuffer::Initialize(unsigned int w, unsigned int h, unsigned int pix
          frameArray_[i].Resize(w, h, pixDepth);
          frameArray_[i].Preallocate();
       }
+
+      slotSequence_.reset(new std::atomic<long long>[cbSize]);
+      slotPins_.reset(new std::atomic<int>[cbSize]);
+      for (unsigned long i=0; i<cbSize; i++)
+      {
+         slotSequence_[i].store(0, std::memory_order_relaxed);
+         slotPins_[i].store(0, std::memory_order_relaxed);
+      }
    }
 
    catch( ... /* std::bad_alloc& ex */)
    {
       frameArray_.resize(0);
+      slotSequence_.reset();
+      slotPins_.reset();
       ret = false;
    }
+   reallocating_.store(false);
    return ret;
 }
 
 void CircularBuffer::Clear() 
 {
-   MMThreadGuard guard(g_bufferLock); 
-   insertIndex_=0; 
-   saveIndex_=0; 
+   // Taking the insert lock keeps producers out; consumers are not blocked
+   // and simply find the buffer empty from here on.
+   MMThreadGuard insertGuard(g_insertLock);
+   saveIndex_.store(insertIndex_.load());
    overflow_ = false;
    startTime_ = std::chrono::steady_clock::now();
    imageNumbers_.clear();
@@ -147,8 +224,11 @@ unsigned long CircularBuffer::GetSize() const
 
 unsigned long CircularBuffer::GetFreeSize() const
 {
-   MMThreadGuard guard(g_bufferLock);
-   long freeSize = (long)frameArray_.size() - (insertIndex_ - saveIndex_);
+   ReadGuard reader(*this);
+   if (!reader)
+      return 0;
+   long long freeSize = (long long)frameArray_.size() -
+      (insertIndex_.load() - saveIndex_.load());
    if (freeSize < 0)
       return 0;
    else
@@ -157,8 +237,14 @@ unsigned long CircularBuffer::GetFreeSize() const
 
 unsigned long CircularBuffer::GetRemainingImageCount() const
 {
-   MMThreadGuard guard(g_bufferLock);
-   return (unsigned long)(insertIndex_ - saveIndex_);
+   // Note that this includes any holes (see IsHole()), which consumers skip
+
+   // Load saveIndex_ first so that the difference is never negative
+   long long save = saveIndex_.load();
+   long long insert = insertIndex_.load();
+   if (insert < save)
+      return 0; // Raced with Initialize()
+   return (unsigned long)(insert - save);
 }
 
 static std::string FormatLocalTime(std::chrono::time_point<std::chrono::system_clock> tp) {
@@ -201,37 +287,139 @@ bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int wid
 */
 bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) MMCORE_LEGACY_THROW(CMMError)
 {
-    MMThreadGuard insertGuard(g_insertLock);
- 
-    mm::ImgBuffer* pImg;
-    unsigned long singleChannelSize = (unsigned long)width * height * byteDepth;
- 
-    {
-       MMThreadGuard guard(g_bufferLock);
- 
-       // check image dimensions
-       if (width != width_ || height != height_ || byteDepth != pixDepth_)
-          throw CMMError("Incompatible image dimensions in the circular buffer", MMERR_CircularBufferIncompatibleImage);
- 
-       bool overflowed = (insertIndex_ - saveIndex_) >= static_cast<long>(frameArray_.size());
-       if (overflowed) {
+   return InsertImage(pixArray, width, height, byteDepth, nComponents, pMd, nullptr);
+}
+
+/**
+* Inserts a multi-channel frame whose metadata is kept in binary form until
+* it is read. The resulting metadata is the same as if binaryMd had been
+* decoded and merged with the camera tags before insertion.
+*/
+bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const mm::BinaryImageMetadata& binaryMd) MMCORE_LEGACY_THROW(CMMError)
+{
+   return InsertImage(pixArray, width, height, byteDepth, nComponents, nullptr, &binaryMd);
+}
+
+const char* CircularBuffer::PixelTypeTag(unsigned int byteDepth, unsigned int nComponents)
+{
+   if (byteDepth == 1)
+      return MM::g_Keyword_PixelType_GRAY8;
+   else if (byteDepth == 2)
+      return MM::g_Keyword_PixelType_GRAY16;
+   else if (byteDepth == 4)
+   {
+      if (nComponents == 1)
+         return MM::g_Keyword_PixelType_GRAY32;
+      else
+         return MM::g_Keyword_PixelType_RGB32;
+   }
+   else if (byteDepth == 8)
+      return MM::g_Keyword_PixelType_RGB64;
+   else
+      return MM::g_Keyword_PixelType_Unknown;
+}
+
+// Common implementation; exactly one of pMd and binaryMd is used (binaryMd
+// if not null).
+bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd, const mm::BinaryImageMetadata* binaryMd) MMCORE_LEGACY_THROW(CMMError)
+{
+   MMCORE_TRACE_SPAN("Image", "CircularBuffer::InsertImage");
+
+   MMThreadGuard insertGuard(g_insertLock);
+
+   unsigned long singleChannelSize = (unsigned long)width * height * byteDepth;
+
+   // Geometry and slots only change under g_insertLock, which we hold
+   if (width != width_ || height != height_ || byteDepth != pixDepth_)
+      throw CMMError("Incompatible image dimensions in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+
+   const long long capacity = static_cast<long long>(frameArray_.size());
+   if (capacity == 0)
+      return false;
+
+   // Find the slot for this frame. Slots pinned by an ImageHandle are
+   // skipped, leaving a hole in the sequence that consumers step over; if
+   // every slot is pinned, report overflow (backpressure) instead.
+   long long index;
+   std::size_t slot;
+   long long previousSequence;
+   for (long long skipped = 0; ; ++skipped)
+   {
+      bool overflowed = (insertIndex_.load(std::memory_order_relaxed) -
+         saveIndex_.load(std::memory_order_acquire)) >= capacity;
+      if (overflowed) {
          if (overwriteData_) {
             Clear();
          } else {
             overflow_ = true;
             return false;
          }
-       }
-    }
- 
-   Metadata md;
-   {
-      MMThreadGuard guard(g_bufferLock);
-      // we assume that all buffers are pre-allocated
-      pImg = frameArray_[insertIndex_ % frameArray_.size()].FindImage(0);
-      if (!pImg)
+      }
+
+      // Only producers (serialized by g_insertLock) modify insertIndex_
+      index = insertIndex_.load(std::memory_order_relaxed);
+      slot = static_cast<std::size_t>(index % capacity);
+
+      // Mark the slot as being rewritten before touching its contents, then
+      // make sure no ImageHandle holds it. Both steps are sequentially
+      // consistent, pairing with PinSlot(): either the reader sees the slot
+      // as being rewritten, or we see its pin.
+      previousSequence = slotSequence_[slot].exchange(0);
+      if (slotPins_[slot].load() == 0)
+         break;
+
+      slotSequence_[slot].store(previousSequence);
+      if (skipped + 1 >= capacity)
+      {
+         overflow_ = true;
          return false;
- 
+      }
+      insertIndex_.store(index + 1, std::memory_order_release);
+   }
+
+   // we assume that all buffers are pre-allocated
+   mm::ImgBuffer* pImg = frameArray_[slot].FindImage(0);
+   if (!pImg)
+   {
+      slotSequence_[slot].store(previousSequence);
+      return false;
+   }
+
+   if (binaryMd)
+   {
+      long& imageNumber = imageNumbers_[binaryMd->cameraLabel];
+
+      // Tags are decoded in order, later ones replacing earlier ones, which
+      // gives the same precedence as the Metadata path below: the elapsed
+      // time default yields to any camera-supplied value, and the core's own
+      // tags come last.
+      spareBaseMetadata_.Clear();
+      {
+         using namespace std::chrono;
+         auto elapsed = steady_clock::now() - startTime_;
+         spareBaseMetadata_.PutImageTag(MM::g_Keyword_Elapsed_Time_ms,
+            std::to_string(duration_cast<milliseconds>(elapsed).count()).c_str());
+      }
+      spareBaseMetadata_.AppendRecords(binaryMd->data, binaryMd->length);
+      spareBaseMetadata_.PutImageTag(MM::g_Keyword_Metadata_CameraLabel,
+         binaryMd->cameraLabel.c_str());
+
+      spareOverrideMetadata_.Clear();
+      spareOverrideMetadata_.PutImageTag(MM::g_Keyword_Metadata_ImageNumber,
+         imageNumber++);
+      spareOverrideMetadata_.PutImageTag(MM::g_Keyword_Metadata_TimeInCore,
+         FormatLocalTime(std::chrono::system_clock::now()).c_str());
+      spareOverrideMetadata_.PutImageTag(MM::g_Keyword_Metadata_Width, width);
+      spareOverrideMetadata_.PutImageTag(MM::g_Keyword_Metadata_Height, height);
+      spareOverrideMetadata_.PutImageTag(MM::g_Keyword_PixelType,
+         PixelTypeTag(byteDepth, nComponents));
+
+      pImg->SwapBinaryMetadata(spareBaseMetadata_, binaryMd->cameraTags,
+         spareOverrideMetadata_);
+   }
+   else
+   {
+      Metadata md;
       if (pMd)
       {
          md = *pMd;
@@ -246,42 +434,28 @@ bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int wid
       // insert image number. 
       md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageNumbers_[cameraName]));
       ++imageNumbers_[cameraName];
-   }
 
-   if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
-   {
-      // if time tag was not supplied by the camera insert current timestamp
-      using namespace std::chrono;
-      auto elapsed = steady_clock::now() - startTime_;
-      md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms,
-         std::to_string(duration_cast<milliseconds>(elapsed).count()));
-   }
+      if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
+      {
+         // if time tag was not supplied by the camera insert current timestamp
+         using namespace std::chrono;
+         auto elapsed = steady_clock::now() - startTime_;
+         md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms,
+            std::to_string(duration_cast<milliseconds>(elapsed).count()));
+      }
 
-   // Note: It is not ideal to use local time. I think this tag is rarely
-   // used. Consider replacing with UTC (micro)seconds-since-epoch (with
-   // different tag key) after addressing current usage.
-   auto now = std::chrono::system_clock::now();
-   md.PutImageTag(MM::g_Keyword_Metadata_TimeInCore, FormatLocalTime(now));
+      // Note: It is not ideal to use local time. I think this tag is rarely
+      // used. Consider replacing with UTC (micro)seconds-since-epoch (with
+      // different tag key) after addressing current usage.
+      auto now = std::chrono::system_clock::now();
+      md.PutImageTag(MM::g_Keyword_Metadata_TimeInCore, FormatLocalTime(now));
 
-   md.PutImageTag(MM::g_Keyword_Metadata_Width, width);
-   md.PutImageTag(MM::g_Keyword_Metadata_Height, height);
-   if (byteDepth == 1)
-      md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_GRAY8);
-   else if (byteDepth == 2)
-      md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_GRAY16);
-   else if (byteDepth == 4)
-   {
-      if (nComponents == 1)
-         md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_GRAY32);
-      else
-         md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_RGB32);
-   }
-   else if (byteDepth == 8)
-      md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_RGB64);
-   else
-      md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_Unknown);
+      md.PutImageTag(MM::g_Keyword_Metadata_Width, width);
+      md.PutImageTag(MM::g_Keyword_Metadata_Height, height);
+      md.PutImageTag(MM::g_Keyword_PixelType, PixelTypeTag(byteDepth, nComponents));
 
-   pImg->SetMetadata(md);
+      pImg->SetMetadata(md);
+   }
    // TODO: In MMCore the ImgBuffer::GetPixels() returns const pointer.
    //       It would be better to have something like ImgBuffer::GetPixelsRW() in MMDevice.
    //       Or even better - pass tasksMemCopy_ to ImgBuffer constructor
@@ -289,18 +463,11 @@ bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int wid
    tasksMemCopy_->MemCopy((void*)pImg->GetPixels(),
          pixArray, singleChannelSize);
 
-   {
-      MMThreadGuard guard(g_bufferLock);
+   imageCounter_++;
 
-      imageCounter_++;
-      insertIndex_++;
-      if ((insertIndex_ - (long)frameArray_.size()) > adjustThreshold && (saveIndex_- (long)frameArray_.size()) > adjustThreshold)
-      {
-         // adjust buffer indices to avoid overflowing integer size
-         insertIndex_ -= adjustThreshold;
-         saveIndex_ -= adjustThreshold;
-      }
-   }
+   // Publish: first the slot, then the position that makes it visible
+   slotSequence_[slot].store(index + 1, std::memory_order_release);
+   insertIndex_.store(index + 1, std::memory_order_release);
 
    return true;
 }
@@ -327,18 +494,38 @@ const mm::ImgBuffer* CircularBuffer::GetNthFromTopImageBuffer(unsigned long n) c
 const mm::ImgBuffer* CircularBuffer::GetNthFromTopImageBuffer(long n,
       unsigned channel) const
 {
-   MMThreadGuard guard(g_bufferLock);
-
-   long availableImages = insertIndex_ - saveIndex_;
-   if (n + 1 > availableImages)
+   ReadGuard reader(*this);
+   if (!reader || n < 0)
       return 0;
 
-   long targetIndex = insertIndex_ - n - 1L;
-   while (targetIndex < 0)
-      targetIndex += (long) frameArray_.size();
-   targetIndex %= frameArray_.size();
+   const long long capacity = static_cast<long long>(frameArray_.size());
+   if (capacity == 0)
+      return 0;
 
-   return frameArray_[targetIndex].FindImage(channel);
+   long long save = saveIndex_.load(std::memory_order_acquire);
+   long long insert = insertIndex_.load(std::memory_order_acquire);
+   long long target = insert - n - 1;
+   for (;;)
+   {
+      if (target < save)
+         return 0;
+
+      const std::size_t slot = static_cast<std::size_t>(target % capacity);
+      const long long sequence =
+         slotSequence_[slot].load(std::memory_order_acquire);
+      if (sequence == target + 1)
+         return frameArray_[slot].FindImage(channel);
+      if (IsHole(sequence, target))
+      {
+         --target; // Frame was skipped by the producer; use the one before
+         continue;
+      }
+      // The slot was recycled (overwrite mode) since we read the indices;
+      // try again with fresh ones.
+      save = saveIndex_.load(std::memory_order_acquire);
+      insert = insertIndex_.load(std::memory_order_acquire);
+      target = insert - n - 1;
+   }
 }
 
 const unsigned char* CircularBuffer::GetNextImage()
@@ -351,13 +538,134 @@ const unsigned char* CircularBuffer::GetNextImage()
 
 const mm::ImgBuffer* CircularBuffer::GetNextImageBuffer(unsigned channel)
 {
-   MMThreadGuard guard(g_bufferLock);
+   ReadGuard reader(*this);
+   if (!reader)
+      return 0;
 
-   long availableImages = insertIndex_ - saveIndex_;
-   if (availableImages < 1)
+   const long long capacity = static_cast<long long>(frameArray_.size());
+   if (capacity == 0)
       return 0;
 
-   long targetIndex = saveIndex_ % frameArray_.size();
-   ++saveIndex_;
-   return frameArray_[targetIndex].FindImage(channel);
+   // Claim the oldest frame; concurrent consumers (and Clear()) race on
+   // saveIndex_ and exactly one of them wins each frame.
+   // Holes left by the producer are claimed and stepped over in the same
+   // way.
+   long long save = saveIndex_.load(std::memory_order_acquire);
+   for (;;)
+   {
+      if (save >= insertIndex_.load(std::memory_order_acquire))
+         return 0;
+      const std::size_t slot = static_cast<std::size_t>(save % capacity);
+      const bool hole = IsHole(
+            slotSequence_[slot].load(std::memory_order_acquire), save);
+      if (saveIndex_.compare_exchange_weak(save, save + 1,
+               std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+         if (!hole)
+            return frameArray_[slot].FindImage(channel);
+         ++save;
+      }
+   }
+}
+
+// Whether frame index was skipped by the producer because its slot was
+// pinned: the slot then still holds an older frame. (0 means the slot is
+// being rewritten, with a newer frame.)
+bool CircularBuffer::IsHole(long long slotSequence, long long index)
+{
+   return slotSequence != 0 && slotSequence < index + 1;
+}
+
+// Pin a slot, provided that it still holds the expected frame.
+bool CircularBuffer::PinSlot(std::size_t slot, long long expectedSequence)
+{
+   slotPins_[slot].fetch_add(1);
+   if (slotSequence_[slot].load() != expectedSequence)
+   {
+      slotPins_[slot].fetch_sub(1);
+      return false;
+   }
+   return true;
+}
+
+void CircularBuffer::UnpinSlot(std::size_t slot)
+{
+   slotPins_[slot].fetch_sub(1, std::memory_order_release);
+   pinnedCount_.fetch_sub(1, std::memory_order_release);
+}
+
+mm::ImageHandle CircularBuffer::MakeHandle(std::size_t slot)
+{
+   pinnedCount_.fetch_add(1);
+   std::shared_ptr<CircularBuffer> self = shared_from_this();
+   return mm::ImageHandle(std::shared_ptr<const mm::ImgBuffer>(
+      frameArray_[slot].FindImage(0),
+      [self, slot](const mm::ImgBuffer*) { self->UnpinSlot(slot); }));
+}
+
+mm::ImageHandle CircularBuffer::GetNthFromTopImageHandle(unsigned long n)
+{
+   ReadGuard reader(*this);
+   if (!reader)
+      return mm::ImageHandle();
+
+   const long long capacity = static_cast<long long>(frameArray_.size());
+   if (capacity == 0)
+      return mm::ImageHandle();
+
+   long long save = saveIndex_.load(std::memory_order_acquire);
+   long long insert = insertIndex_.load(std::memory_order_acquire);
+   long long target = insert - static_cast<long long>(n) - 1;
+   for (;;)
+   {
+      if (target < save)
+         return mm::ImageHandle();
+
+      const std::size_t slot = static_cast<std::size_t>(target % capacity);
+      if (PinSlot(slot, target + 1))
+         return MakeHandle(slot);
+      if (IsHole(slotSequence_[slot].load(), target))
+      {
+         --target;
+         continue;
+      }
+      save = saveIndex_.load(std::memory_order_acquire);
+      insert = insertIndex_.load(std::memory_order_acquire);
+      target = insert - static_cast<long long>(n) - 1;
+   }
+}
+
+mm::ImageHandle CircularBuffer::GetNextImageHandle()
+{
+   ReadGuard reader(*this);
+   if (!reader)
+      return mm::ImageHandle();
+
+   const long long capacity = static_cast<long long>(frameArray_.size());
+   if (capacity == 0)
+      return mm::ImageHandle();
+
+   // Pin before claiming, so that the producer cannot start rewriting the
+   // slot between the claim and the pin.
+   for (;;)
+   {
+      long long save = saveIndex_.load(std::memory_order_acquire);
+      if (save >= insertIndex_.load(std::memory_order_acquire))
+         return mm::ImageHandle();
+
+      const std::size_t slot = static_cast<std::size_t>(save % capacity);
+      if (!PinSlot(slot, save + 1))
+      {
+         // Step over a hole; otherwise the frame was discarded (overwrite
+         // mode), so retry
+         if (IsHole(slotSequence_[slot].load(), save))
+            saveIndex_.compare_exchange_strong(save, save + 1);
+         continue;
+      }
+
+      if (saveIndex_.compare_exchange_strong(save, save + 1))
+         return MakeHandle(slot);
+
+      slotPins_[slot].fetch_sub(1); // Another consumer got it
+   }
 }
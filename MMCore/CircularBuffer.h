@@ -31,23 +31,64 @@
 #include "DeviceThreads.h"
 #include "MMDevice.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <memory>
+#include <string>
 #include <vector>
 
 class ThreadPool;
 class TaskSet_CopyMemory;
 
-class CircularBuffer
+namespace mm {
+
+// Metadata for an image inserted with binary-encoded metadata, which the
+// buffer stores as is and only decodes when the image's metadata is read.
+struct BinaryImageMetadata
+{
+   std::string cameraLabel;
+   // Tags from the camera, already validated (may be null)
+   const unsigned char* data = nullptr;
+   unsigned long length = 0;
+   // The camera's own tags (CameraInstance::GetParsedTags(); may be null)
+   std::shared_ptr<const Metadata> cameraTags;
+};
+
+} // namespace mm
+
+// Sequence buffer shared by the camera (producer) threads and the application
+// (consumer) threads.
+//
+// Producers are serialized by an internal lock, but consumers never take a
+// lock on the per-frame path: the insert and save positions are atomic
+// counters, and each slot carries a sequence number recording which frame it
+// currently holds. Reconfiguration (Initialize()) briefly excludes readers.
+//
+// Frames can also be retrieved as mm::ImageHandle, which pins the slot until
+// released. Handles keep the CircularBuffer alive, so it must be owned by a
+// std::shared_ptr when handles are used.
+class CircularBuffer : public std::enable_shared_from_this<CircularBuffer>
 {
 public:
-   CircularBuffer(unsigned int memorySizeMB);
+   // copyThreadCount and copyThreadCPUs: see SetCopyThreads()
+   CircularBuffer(unsigned int memorySizeMB, std::size_t copyThreadCount = 0,
+      const std::vector<unsigned>& copyThreadCPUs = {});
    ~CircularBuffer();
 
    int SetOverwriteData(bool overwrite);
 
+   // Set the number of threads used to copy inserted frames (0 for one per
+   // hardware thread), optionally pinned to the given logical CPUs (e.g. the
+   // CPUs of the NUMA node that the camera's DMA buffers live on).
+   void SetCopyThreads(std::size_t threadCount, const std::vector<unsigned>& cpus);
+
    unsigned GetMemorySizeMB() const { return memorySizeMB_; }
 
+   // Limit the number of slots allocated by Initialize(), which is otherwise
+   // limited only by the memory size (and a fixed maximum)
+   void SetMaxImageCount(unsigned long count) { maxImageCount_ = count; }
+
    bool Initialize(unsigned int xSize, unsigned int ySize, unsigned int pixDepth);
    unsigned long GetSize() const;
    unsigned long GetFreeSize() const;
@@ -59,38 +100,75 @@ public:
 
    bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, const Metadata* pMd) MMCORE_LEGACY_THROW(CMMError);
    bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) MMCORE_LEGACY_THROW(CMMError);
+   bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const mm::BinaryImageMetadata& binaryMd) MMCORE_LEGACY_THROW(CMMError);
    const unsigned char* GetTopImage() const;
    const unsigned char* GetNextImage();
    const mm::ImgBuffer* GetTopImageBuffer(unsigned channel) const;
    const mm::ImgBuffer* GetNthFromTopImageBuffer(unsigned long n) const;
    const mm::ImgBuffer* GetNthFromTopImageBuffer(long n, unsigned channel) const;
    const mm::ImgBuffer* GetNextImageBuffer(unsigned channel);
+   mm::ImageHandle GetNthFromTopImageHandle(unsigned long n);
+   mm::ImageHandle GetNextImageHandle();
    void Clear(); 
 
-   bool Overflow() {MMThreadGuard guard(g_bufferLock); return overflow_;}
+   bool Overflow() { return overflow_.load(); }
+
+private:
+   class ReadGuard;
+
+   static bool IsHole(long long slotSequence, long long index);
+   static const char* PixelTypeTag(unsigned int byteDepth, unsigned int nComponents);
+   bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd, const mm::BinaryImageMetadata* binaryMd) MMCORE_LEGACY_THROW(CMMError);
+   bool PinSlot(std::size_t slot, long long expectedSequence);
+   void UnpinSlot(std::size_t slot);
+   mm::ImageHandle MakeHandle(std::size_t slot);
 
+   // Guards buffer geometry and allocation; not taken on the per-frame path
    mutable MMThreadLock g_bufferLock;
+   // Serializes producers (and anything that resets producer state)
    mutable MMThreadLock g_insertLock;
 
-private:
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
    long imageCounter_;
    std::chrono::time_point<std::chrono::steady_clock> startTime_;
    std::map<std::string, long> imageNumbers_;
+   // Encoding buffers for binary metadata, recycled through the ImgBuffers
+   // (guarded by g_insertLock)
+   MM::BinaryMetadataWriter spareBaseMetadata_;
+   MM::BinaryMetadataWriter spareOverrideMetadata_;
 
    // Invariants:
    // 0 <= saveIndex_ <= insertIndex_
    // insertIndex_ - saveIndex_ <= frameArray_.size()
-   long insertIndex_;
-   long saveIndex_;
+   // Frame i lives in slot i % frameArray_.size(), unless that slot was
+   // pinned when frame i arrived; index i is then a hole (see IsHole()) and
+   // the frame went to the next index. The counters are 64-bit and only ever
+   // increase (until Initialize()), so they never wrap in practice.
+   std::atomic<long long> insertIndex_;
+   std::atomic<long long> saveIndex_;
+
+   // slotSequence_[k] == i + 1 once frame i has been completely written to
+   // slot k; 0 while the slot is empty or being (re)written.
+   std::unique_ptr<std::atomic<long long>[]> slotSequence_;
+
+   // Number of outstanding ImageHandles per slot, and in total. Slots are
+   // not reallocated while any handle is outstanding.
+   std::unique_ptr<std::atomic<int>[]> slotPins_;
+   std::atomic<long> pinnedCount_;
+
+   // Reader exclusion for Initialize() (see ReadGuard)
+   mutable std::atomic<int> activeReaders_;
+   std::atomic<bool> reallocating_;
 
    unsigned long memorySizeMB_;
-   bool overflow_;
-   bool overwriteData_;
+   unsigned long maxImageCount_;
+   std::atomic<bool> overflow_;
+   std::atomic<bool> overwriteData_;
    std::vector<mm::FrameBuffer> frameArray_;
 
+   // Replaced only under g_insertLock
    std::shared_ptr<ThreadPool> threadPool_;
    std::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
 };
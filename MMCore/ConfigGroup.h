@@ -24,9 +24,19 @@
 
 #include "Configuration.h"
 #include "Error.h"
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+/**
+ * Identifies a device property: (device label, property name).
+ */
+typedef std::pair<std::string, std::string> PropertyKey;
+
 /**
  * Encapsulates a collection (map) of user-defined presets.
  */
@@ -49,7 +59,7 @@ public:
    void Define(const char* configName, const char* deviceLabel, const char* propName, const char* value)
    {
       PropertySetting setting(deviceLabel, propName, value);
-      configs_[configName].addSetting(setting);
+      AddSetting(configs_[configName], setting);
 	}
 
    /**
@@ -76,7 +86,12 @@ public:
       typename std::map<std::string, T>::const_iterator it = configs_.find(oldConfigName);
       if (it == configs_.end())
          return false;
-	  
+      if (it->first == newConfigName)
+         return true;
+
+      typename std::map<std::string, T>::iterator replaced = configs_.find(newConfigName);
+      if (replaced != configs_.end())
+         RemovePropertyUses(replaced->second);
 	  configs_[newConfigName] = it->second;
       configs_.erase(it->first);
       return true;
@@ -94,6 +109,7 @@ public:
       typename std::map<std::string, T>::const_iterator it = configs_.find(configName);
       if (it == configs_.end())
          return false;
+      RemovePropertyUses(it->second);
       configs_.erase(configName);
       return true;
    }
@@ -113,7 +129,12 @@ public:
 		  return false;
 	  
 	  // Delete the specified property
-      configs_[configName].deleteSetting(deviceLabel,propName);
+      T& config = configs_[configName];
+      if (config.isPropertyIncluded(deviceLabel, propName))
+      {
+         config.deleteSetting(deviceLabel,propName);
+         RemovePropertyUse(PropertyKey(deviceLabel, propName));
+      }
 	  return true;
    }
 
@@ -135,11 +156,68 @@ public:
       return configs_.size() == 0;
    }
 
+   /**
+    * Checks if any preset includes the given property.
+    */
+   bool IncludesProperty(const char* deviceLabel, const char* propName) const
+   {
+      return propertyUseCount_.find(PropertyKey(deviceLabel, propName)) !=
+         propertyUseCount_.end();
+   }
+
+   /**
+    * Returns the properties included in at least one preset.
+    */
+   std::vector<PropertyKey> GetIncludedProperties() const
+   {
+      std::vector<PropertyKey> props;
+      typename std::map<PropertyKey, unsigned>::const_iterator it =
+         propertyUseCount_.begin();
+      while (it != propertyUseCount_.end())
+         props.push_back(it++->first);
+      return props;
+   }
+
 protected:
    ConfigGroupBase() {}
    virtual ~ConfigGroupBase() {}
 
+   /**
+    * Adds (or replaces) a setting in a preset of this group, keeping track
+    * of how many presets include each property.
+    */
+   void AddSetting(T& config, const PropertySetting& setting)
+   {
+      if (!config.isPropertyIncluded(setting.getDeviceLabel().c_str(),
+            setting.getPropertyName().c_str()))
+         ++propertyUseCount_[PropertyKey(setting.getDeviceLabel(),
+               setting.getPropertyName())];
+      config.addSetting(setting);
+   }
+
    std::map<std::string, T> configs_;
+
+private:
+   void RemovePropertyUse(const PropertyKey& key)
+   {
+      typename std::map<PropertyKey, unsigned>::iterator it =
+         propertyUseCount_.find(key);
+      if (it != propertyUseCount_.end() && --it->second == 0)
+         propertyUseCount_.erase(it);
+   }
+
+   void RemovePropertyUses(const T& config)
+   {
+      for (size_t i = 0; i < config.size(); ++i)
+      {
+         PropertySetting setting = config.getSetting(i);
+         RemovePropertyUse(PropertyKey(setting.getDeviceLabel(),
+               setting.getPropertyName()));
+      }
+   }
+
+   // Number of presets including each property
+   std::map<PropertyKey, unsigned> propertyUseCount_;
 };
 
 
@@ -155,7 +233,7 @@ class ConfigGroup : public ConfigGroupBase<Configuration>
  */
 class ConfigGroupCollection {
 public:
-   ConfigGroupCollection() {}
+   ConfigGroupCollection() : lastRevision_(0) {}
    ~ConfigGroupCollection() {}
 
    /**
@@ -164,6 +242,7 @@ public:
    void Define(const char* groupName, const char* configName)
    {
       groups_[groupName].Define(configName);
+      Touch(groupName);
    }
 
    /**
@@ -172,6 +251,8 @@ public:
    void Define(const char* groupName, const char* configName, const char* deviceLabel, const char* propName, const char* value)
    {
       groups_[groupName].Define(configName, deviceLabel, propName, value);
+      propertyGroups_[PropertyKey(deviceLabel, propName)].insert(groupName);
+      Touch(groupName);
    }
 
    /**
@@ -183,6 +264,7 @@ public:
       if (it == groups_.end())
       {
          groups_[groupName]; // effectively inserts an empty group
+         Touch(groupName);
          return true;
       }
       else
@@ -223,7 +305,14 @@ public:
          std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
          if (it == groups_.end())
             return false; // group not found
-         return it->second.Rename(oldConfigName, newConfigName);
+         // Renaming over an existing preset replaces it
+         const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+         if (!it->second.Rename(oldConfigName, newConfigName))
+            return false;
+         for (size_t i = 0; i < props.size(); ++i)
+            UpdatePropertyIndex(it->first, props[i]);
+         Touch(it->first);
+         return true;
       } else {
          return true;
       }
@@ -241,7 +330,11 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it == groups_.end())
          return false; // group not found
-      return it->second.Delete(configName, deviceLabel, propName);
+      if (!it->second.Delete(configName, deviceLabel, propName))
+         return false;
+      UpdatePropertyIndex(it->first, PropertyKey(deviceLabel, propName));
+      Touch(it->first);
+      return true;
    }
 
 
@@ -257,7 +350,13 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it == groups_.end())
          return false; // group not found
-      return it->second.Delete(configName);
+      const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+      if (!it->second.Delete(configName))
+         return false;
+      for (size_t i = 0; i < props.size(); ++i)
+         UpdatePropertyIndex(it->first, props[i]);
+      Touch(it->first);
+      return true;
    }
 
    /**
@@ -272,6 +371,8 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it != groups_.end())
       {
+         RemoveFromPropertyIndex(it->first, it->second);
+         Touch(it->first);
          groups_.erase(it->first);
          return true;
       }
@@ -292,7 +393,16 @@ public:
          std::map<std::string, ConfigGroup>::iterator it = groups_.find(oldGroupName);
          if (it != groups_.end())
          {
+            std::map<std::string, ConfigGroup>::iterator replaced = groups_.find(newGroupName);
+            if (replaced != groups_.end())
+               RemoveFromPropertyIndex(replaced->first, replaced->second);
+            RemoveFromPropertyIndex(it->first, it->second);
+            const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+            for (size_t i = 0; i < props.size(); ++i)
+               propertyGroups_[props[i]].insert(newGroupName);
             groups_[newGroupName] = it->second;
+            Touch(it->first);
+            Touch(newGroupName);
             groups_.erase(it->first);
             return true;
          }
@@ -333,14 +443,81 @@ public:
       return confList;
    }
 
+   /**
+    * Returns the names of groups having at least one preset that includes
+    * the given property.
+    */
+   const std::set<std::string>& GetGroupsIncludingProperty(const char* deviceLabel, const char* propName) const
+   {
+      static const std::set<std::string> none;
+      std::map<PropertyKey, std::set<std::string> >::const_iterator it =
+         propertyGroups_.find(PropertyKey(deviceLabel, propName));
+      return it == propertyGroups_.end() ? none : it->second;
+   }
+
+   /**
+    * Returns a number that changes whenever the group or any of its presets
+    * is defined, changed, renamed, or deleted.
+    */
+   unsigned long long GetRevision(const char* groupName) const
+   {
+      std::map<std::string, unsigned long long, std::less<> >::const_iterator it = revisions_.find(groupName);
+      return it == revisions_.end() ? 0 : it->second;
+   }
+
    void Clear()
    {
       groups_.clear();
+      propertyGroups_.clear();
+      revisions_.clear();
    }
 
 
 private:
+   void Touch(const std::string& groupName)
+   {
+      revisions_[groupName] = ++lastRevision_;
+   }
+
+   void UpdatePropertyIndex(const std::string& groupName, const PropertyKey& prop)
+   {
+      std::map<std::string, ConfigGroup>::const_iterator group = groups_.find(groupName);
+      if (group != groups_.end() &&
+            group->second.IncludesProperty(prop.first.c_str(), prop.second.c_str()))
+      {
+         propertyGroups_[prop].insert(groupName);
+         return;
+      }
+      std::map<PropertyKey, std::set<std::string> >::iterator it = propertyGroups_.find(prop);
+      if (it == propertyGroups_.end())
+         return;
+      it->second.erase(groupName);
+      if (it->second.empty())
+         propertyGroups_.erase(it);
+   }
+
+   void RemoveFromPropertyIndex(const std::string& groupName, const ConfigGroup& group)
+   {
+      const std::vector<PropertyKey> props = group.GetIncludedProperties();
+      for (size_t i = 0; i < props.size(); ++i)
+      {
+         std::map<PropertyKey, std::set<std::string> >::iterator it = propertyGroups_.find(props[i]);
+         if (it == propertyGroups_.end())
+            continue;
+         it->second.erase(groupName);
+         if (it->second.empty())
+            propertyGroups_.erase(it);
+      }
+   }
+
    std::map<std::string, ConfigGroup> groups_;
+   // Reverse index: property -> groups with a preset including it
+   std::map<PropertyKey, std::set<std::string> > propertyGroups_;
+   // Revision of each group, drawn from lastRevision_ so that a group
+   // deleted and defined again never repeats a revision (transparent
+   // comparison, so that GetRevision() does not construct a string)
+   std::map<std::string, unsigned long long, std::less<> > revisions_;
+   unsigned long long lastRevision_;
 };
 
 /**
@@ -406,7 +583,7 @@ public:
    bool DefinePixelSize(const char* resolutionID, const char* deviceLabel, const char* propName, const char* value, double pixSizeUm)
    {
       PropertySetting setting(deviceLabel, propName, value);
-      configs_[resolutionID].addSetting(setting);
+      AddSetting(configs_[resolutionID], setting);
       if (configs_[resolutionID].getPixelSizeUm() == 0.0)
       {
          // this is the first setting, so it is OK to set pixel size
@@ -25,21 +25,63 @@
 //                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
 //                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
 
+#include "BinaryMetadata.h"
 #include "CircularBuffer.h"
+#include "ConfigGroup.h"
 #include "CoreCallback.h"
 #include "DeviceManager.h"
+#include "ImageProcessingPipeline.h"
+#include "Tracing.h"
 
 #include "DeviceThreads.h"
 #include "DeviceUtils.h"
 #include "ImgBuffer.h"
 
 #include <cassert>
+#include <climits>
 #include <chrono>
+#include <set>
 #include <string>
 #include <vector>
 #include <algorithm>
 
 
+namespace {
+
+// Returns a borrowed image to the camera when going out of scope, unless
+// that has been handed over (to the image processing pipeline)
+class BorrowedImageRelease
+{
+   MM::ImageReleaseFunction release_;
+   void* context_;
+   const unsigned char* buf_;
+
+public:
+   BorrowedImageRelease(MM::ImageReleaseFunction release, void* context,
+         const unsigned char* buf) :
+      release_(release), context_(context), buf_(buf)
+   {}
+
+   ~BorrowedImageRelease()
+   {
+      if (release_)
+         release_(context_, buf_);
+   }
+
+   BorrowedImageRelease(const BorrowedImageRelease&) = delete;
+   BorrowedImageRelease& operator=(const BorrowedImageRelease&) = delete;
+
+   MM::ImageReleaseFunction HandOver()
+   {
+      MM::ImageReleaseFunction release = release_;
+      release_ = nullptr;
+      return release;
+   }
+};
+
+} // anonymous namespace
+
+
 CoreCallback::CoreCallback(CMMCore* c) :
    core_(c),
    pValueChangeLock_(NULL)
@@ -198,25 +240,50 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
    std::string label = camera->GetLabel();
    newMD.put(MM::g_Keyword_Metadata_CameraLabel, label);
 
-   std::string serializedMD;
    try
    {
-      serializedMD = camera->GetTags();
+      camera->MergeTagsInto(newMD);
    }
    catch (const CMMError&)
    {
-      return newMD;
    }
 
-   Metadata devMD;
-   devMD.Restore(serializedMD.c_str());
-   newMD.Merge(devMD);
-
    return newMD;
 }
 
+/**
+ * Like AddCameraMetadata(const MM::Device*, const Metadata*), but for
+ * (validated) binary metadata, which is not decoded: the camera's tags are
+ * attached to it for the buffer to merge when the metadata is read.
+ */
+mm::BinaryImageMetadata
+CoreCallback::AddCameraMetadata(const MM::Device* caller,
+      const unsigned char* binaryMetadata, unsigned long binaryMetadataLength)
+{
+   std::shared_ptr<CameraInstance> camera =
+      std::static_pointer_cast<CameraInstance>(
+            core_->deviceManager_->GetDevice(caller));
+
+   mm::BinaryImageMetadata binaryMd;
+   binaryMd.cameraLabel = camera->GetLabel();
+   binaryMd.data = binaryMetadata;
+   binaryMd.length = binaryMetadataLength;
+
+   try
+   {
+      binaryMd.cameraTags = camera->GetParsedTags();
+   }
+   catch (const CMMError&)
+   {
+   }
+
+   return binaryMd;
+}
+
 int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess)
 {
+   MMCORE_TRACE_SPAN("Image", "CoreCallback::InsertImage");
+
    Metadata origMd;
    if (serializedMetadata)
    {
@@ -227,18 +294,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
    {
       Metadata md = AddCameraMetadata(caller, &origMd);
 
-      if(doProcess)
-      {
-         MM::ImageProcessor* ip = GetImageProcessor(caller);
-         if( NULL != ip)
-         {
-            ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
-         }
-      }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, &md))
-         return DEVICE_OK;
-      else
-         return DEVICE_BUFFER_OVERFLOW;
+      return ProcessAndInsertImage(caller, buf, width, height, byteDepth, 1, &md, nullptr, doProcess);
    }
    catch (CMMError& /*e*/)
    {
@@ -248,6 +304,8 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
 
 int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata, const bool doProcess)
 {
+   MMCORE_TRACE_SPAN("Image", "CoreCallback::InsertImage");
+
    Metadata origMd;
    if (serializedMetadata)
    {
@@ -258,18 +316,62 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
    {
       Metadata md = AddCameraMetadata(caller, &origMd);
 
-      if(doProcess)
+      return ProcessAndInsertImage(caller, buf, width, height, byteDepth, nComponents, &md, nullptr, doProcess);
+   }
+   catch (CMMError& /*e*/)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+}
+
+int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, const bool doProcess)
+{
+   MMCORE_TRACE_SPAN("Image", "CoreCallback::InsertImage");
+
+   // Only validated here; decoded if and when the image's metadata is read
+   if (binaryMetadata && binaryMetadataLength > 0 &&
+         !MM::ValidateBinaryMetadata(binaryMetadata, binaryMetadataLength))
+      return DEVICE_INVALID_INPUT_PARAM;
+
+   try
+   {
+      mm::BinaryImageMetadata binaryMd =
+         AddCameraMetadata(caller, binaryMetadata, binaryMetadataLength);
+
+      return ProcessAndInsertImage(caller, buf, width, height, byteDepth, nComponents, nullptr, &binaryMd, doProcess);
+   }
+   catch (CMMError& /*e*/)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+}
+
+int CoreCallback::InsertBorrowedImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, MM::ImageReleaseFunction release, void* releaseContext, const bool doProcess)
+{
+   MMCORE_TRACE_SPAN("Image", "CoreCallback::InsertBorrowedImage");
+
+   mm::BinaryImageMetadata binaryMd;
+   {
+      // Until ProcessAndInsertImage() takes over
+      BorrowedImageRelease borrowed(release, releaseContext, buf);
+      if (binaryMetadata && binaryMetadataLength > 0 &&
+            !MM::ValidateBinaryMetadata(binaryMetadata, binaryMetadataLength))
+         return DEVICE_INVALID_INPUT_PARAM;
+
+      try
       {
-         MM::ImageProcessor* ip = GetImageProcessor(caller);
-         if( NULL != ip)
-         {
-            ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
-         }
+         binaryMd = AddCameraMetadata(caller, binaryMetadata, binaryMetadataLength);
       }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, nComponents, &md))
-         return DEVICE_OK;
-      else
-         return DEVICE_BUFFER_OVERFLOW;
+      catch (CMMError& /*e*/)
+      {
+         return DEVICE_INCOMPATIBLE_IMAGE;
+      }
+      borrowed.HandOver();
+   }
+
+   try
+   {
+      return ProcessAndInsertImage(caller, buf, width, height, byteDepth, nComponents, nullptr, &binaryMd, doProcess, release, releaseContext);
    }
    catch (CMMError& /*e*/)
    {
@@ -277,6 +379,36 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
    }
 }
 
+// Runs the image processor (if any) on the image, in place on this thread or
+// in the core's image processing pipeline, then inserts it. The pipeline
+// works on a copy unless the image is borrowed (release is not null), in
+// which case it releases the image once inserted; otherwise it is released
+// before returning. The metadata is binaryMd if not null, otherwise md.
+int CoreCallback::ProcessAndInsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* md, const mm::BinaryImageMetadata* binaryMd, bool doProcess, MM::ImageReleaseFunction release, void* releaseContext)
+{
+   BorrowedImageRelease borrowed(release, releaseContext, buf);
+   MM::ImageProcessor* ip = doProcess ? GetImageProcessor(caller) : 0;
+   std::shared_ptr<CircularBuffer> target = core_->getSequenceBuffer(caller);
+   if (ip)
+   {
+      bool concurrent = false;
+      std::shared_ptr<mm::ImageProcessingPipeline> pipeline =
+         core_->getImageProcessingPipeline(concurrent);
+      if (pipeline)
+         return pipeline->Submit(ip, concurrent, target, buf, width, height,
+               byteDepth, nComponents, md, binaryMd, borrowed.HandOver(),
+               releaseContext);
+      ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
+   }
+   const bool inserted = binaryMd ?
+      target->InsertImage(buf, width, height, byteDepth, nComponents, *binaryMd) :
+      target->InsertImage(buf, width, height, byteDepth, nComponents, md);
+   if (inserted)
+      return DEVICE_OK;
+   else
+      return DEVICE_BUFFER_OVERFLOW;
+}
+
 bool CoreCallback::InitializeImageBuffer(unsigned channels, unsigned slices,
       unsigned int w, unsigned int h, unsigned int pixDepth)
 {
@@ -305,6 +437,9 @@ int CoreCallback::AcqFinished(const MM::Device* caller, int /*statusCode*/)
       return DEVICE_ERR;
    }
 
+   // Frames still being processed belong to the finished acquisition
+   core_->flushImageProcessing();
+
    std::shared_ptr<DeviceInstance> currentCamera =
       core_->currentCameraDevice_.lock();
 
@@ -416,60 +551,38 @@ int CoreCallback::OnPropertyChanged(const MM::Device* device, const char* propNa
       const PropertySetting* ps = new PropertySetting(label, propName, value, readOnly);
       {
          MMThreadGuard scg(core_->stateCacheLock_);
-         core_->stateCache_.addSetting(*ps);
+         core_->cacheSetting(*ps);
       }
       core_->externalCallback_->onPropertyChanged(label, propName, value);
 
-      // Find all configs that contain this property and callback to indicate 
-      // that the config group changed
-      // TODO: Assess whether performance is better by maintaining a map tying
-      // property to configurations
-      std::vector<std::string> configGroups = 
-         core_->getAvailableConfigGroups ();
-      for (std::vector<std::string>::iterator it = configGroups.begin(); 
-            it != configGroups.end(); ++it) 
+      // Notify each config group that has a preset containing this
+      // property that it (may have) changed, using the reverse index
+      // maintained by the group collection
+      const std::set<std::string> configGroups =
+         core_->configGroups_->GetGroupsIncludingProperty(label, propName);
+      for (std::set<std::string>::const_iterator it = configGroups.begin();
+            it != configGroups.end(); ++it)
       {
-         std::vector<std::string> configs = 
-            core_->getAvailableConfigs((*it).c_str());
-         bool found = false;
-         for (std::vector<std::string>::iterator itc = configs.begin();
-               itc != configs.end() && !found; itc++) 
-         {
-            Configuration config = 
-               core_->getConfigData((*it).c_str(), (*itc).c_str());
-            if (config.isPropertyIncluded(label, propName)) {
-               found = true;
-               // If we are part of this configuration, notify that it 
-               // was changed. Get the new config from cache rather 
-               // than by querying the hardware
-               std::string currentConfig = 
-                  core_->getCurrentConfigFromCache( (*it).c_str() );
-               OnConfigGroupChanged((*it).c_str(), currentConfig.c_str());
-            }
-         }
+         // Get the new config from cache rather than by querying the
+         // hardware
+         std::string currentConfig =
+            core_->getCurrentConfigFromCache(it->c_str());
+         OnConfigGroupChanged(it->c_str(), currentConfig.c_str());
       }
-          
 
       // Check if pixel size was potentially affected.  If so, update from cache
-      std::vector<std::string> pixelSizeConfigs = core_->getAvailablePixelSizeConfigs();
-      bool found = false;
-      for (std::vector<std::string>::iterator itpsc = pixelSizeConfigs.begin();
-            itpsc != pixelSizeConfigs.end() && !found; itpsc++) 
+      if (core_->pixelSizeGroup_->IncludesProperty(label, propName))
       {
-         Configuration pixelSizeConfig = core_->getPixelSizeConfigData( (*itpsc).c_str());
-         if (pixelSizeConfig.isPropertyIncluded(label, propName)) {
-            found = true;
-            double pixSizeUm;
-            try {
-               // update pixel size from cache
-               pixSizeUm = core_->getPixelSizeUm(true);
-               OnPixelSizeAffineChanged(core_->getPixelSizeAffine(true));
-            }
-            catch (const CMMError&) {
-               pixSizeUm = 0.0;
-            }
-            OnPixelSizeChanged(pixSizeUm);
+         double pixSizeUm;
+         try {
+            // update pixel size from cache
+            pixSizeUm = core_->getPixelSizeUm(true);
+            OnPixelSizeAffineChanged(core_->getPixelSizeAffine(true));
          }
+         catch (const CMMError&) {
+            pixSizeUm = 0.0;
+         }
+         OnPixelSizeChanged(pixSizeUm);
       }
    }
 
@@ -612,6 +725,25 @@ int CoreCallback::OnShutterOpenChanged(const MM::Device* device, bool state)
    return DEVICE_OK;
 }
 
+/**
+ * Handler for busy state changes: wakes threads in waitForDevice().
+ * The busy flag itself is not used; waiters recheck Busy().
+ */
+int CoreCallback::OnBusyChanged(const MM::Device* device, bool /* busy */)
+{
+   std::shared_ptr<DeviceInstance> instance;
+   try
+   {
+      instance = core_->deviceManager_->GetDevice(device);
+   }
+   catch (const CMMError&)
+   {
+      return DEVICE_ERR; // Not a loaded device
+   }
+   instance->NotifyBusyChanged();
+   return DEVICE_OK;
+}
+
 
 int CoreCallback::SetSerialProperties(const char* portName,
                                       const char* answerTimeout,
@@ -750,6 +882,83 @@ int CoreCallback::GetSerialAnswer(const MM::Device*, const char* portName, unsig
    return DEVICE_OK;
 }
 
+/**
+ * Sends several ASCII commands back to back, then receives one answer per
+ * command, in order. The port must deliver answers that arrive before they
+ * are requested intact and in order (SerialManager does).
+ */
+int CoreCallback::SendSerialCommandBatch(const MM::Device* caller,
+      const char* portName, const char* const* commands,
+      unsigned long numCommands, const char* term, char* answers,
+      unsigned long answerStride, const char* answerTerm,
+      unsigned long& numAnswered)
+{
+   numAnswered = 0;
+   if (numCommands == 0)
+      return DEVICE_OK;
+   if (!commands || !answers || answerStride == 0 ||
+         !answerTerm || answerTerm[0] == '\0')
+      return DEVICE_INVALID_INPUT_PARAM;
+   if (!term)
+      term = "";
+
+   std::shared_ptr<SerialInstance> pSerial;
+   try
+   {
+      pSerial = core_->deviceManager_->GetDeviceOfType<SerialInstance>(portName);
+   }
+   catch (CMMError& err)
+   {
+      return err.getCode();
+   }
+   catch (...)
+   {
+      return DEVICE_SERIAL_COMMAND_FAILED;
+   }
+
+   // don't allow self reference
+   if (pSerial->GetRawPtr() == caller)
+      return DEVICE_SELF_REFERENCE;
+
+   const unsigned answerLen = static_cast<unsigned>(
+         std::min<unsigned long>(answerStride, UINT_MAX));
+   try
+   {
+      // Queue all commands before waiting for the first answer; the port
+      // writes asynchronously, so the device sees them back to back.
+      for (unsigned long i = 0; i < numCommands; ++i)
+      {
+         int ret = pSerial->SetCommand(commands[i] ? commands[i] : "", term);
+         if (ret != DEVICE_OK)
+         {
+            core_->logError(portName,
+                  core_->getDeviceErrorText(ret, pSerial).c_str());
+            return DEVICE_SERIAL_COMMAND_FAILED;
+         }
+      }
+
+      for (unsigned long i = 0; i < numCommands; ++i)
+      {
+         char* answer = answers + i * answerStride;
+         int ret = pSerial->GetAnswer(answer, answerLen, answerTerm);
+         if (ret != DEVICE_OK)
+         {
+            answer[0] = '\0';
+            core_->logError(portName,
+                  core_->getDeviceErrorText(ret, pSerial).c_str());
+            return DEVICE_SERIAL_COMMAND_FAILED;
+         }
+         ++numAnswered;
+      }
+   }
+   catch (...)
+   {
+      // trap all exceptions and return generic serial error
+      return DEVICE_SERIAL_COMMAND_FAILED;
+   }
+   return DEVICE_OK;
+}
+
 int CoreCallback::GetFocusPosition(double& pos)
 {
    std::shared_ptr<StageInstance> focus = core_->currentFocusDevice_.lock();
@@ -74,6 +74,10 @@ public:
    int WriteToSerial(const MM::Device* caller, const char* portName, const unsigned char* buf, unsigned long length);
    int ReadFromSerial(const MM::Device* caller, const char* portName, unsigned char* buf, unsigned long bufLength, unsigned long &bytesRead);
    int PurgeSerial(const MM::Device* caller, const char* portName);
+   int SendSerialCommandBatch(const MM::Device* caller, const char* portName,
+         const char* const* commands, unsigned long numCommands,
+         const char* term, char* answers, unsigned long answerStride,
+         const char* answerTerm, unsigned long& numAnswered);
    int SetSerialCommand(const MM::Device*, const char* portName, const char* command, const char* term);
    int GetSerialAnswer(const MM::Device*, const char* portName, unsigned long ansLength, char* answerTxt, const char* term);
 
@@ -86,6 +90,8 @@ public:
    // continuous acquisition support
    int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess = true);
    int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata, const bool doProcess = true);
+   int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, const bool doProcess = true);
+   int InsertBorrowedImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, MM::ImageReleaseFunction release, void* releaseContext, const bool doProcess = true);
    bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth);
 
    int AcqFinished(const MM::Device* caller, int statusCode);
@@ -103,6 +109,7 @@ public:
    int OnSLMExposureChanged(const MM::Device* device, double newExposure);
    int OnMagnifierChanged(const MM::Device* device);
    int OnShutterOpenChanged(const MM::Device* device, bool open);
+   int OnBusyChanged(const MM::Device* device, bool busy);
 
    // Deprecated
    MM::SignalIO* GetSignalIODevice(const MM::Device* caller,
@@ -117,7 +124,9 @@ private:
    MMThreadLock* pValueChangeLock_;
 
    Metadata AddCameraMetadata(const MM::Device* caller, const Metadata* pMd);
+   mm::BinaryImageMetadata AddCameraMetadata(const MM::Device* caller, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength);
    MM::ImageProcessor* GetImageProcessor(const MM::Device* caller);
+   int ProcessAndInsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* md, const mm::BinaryImageMetadata* binaryMd, bool doProcess, MM::ImageReleaseFunction release = nullptr, void* releaseContext = nullptr);
 
    int OnConfigGroupChanged(const char* groupName, const char* newConfigName);
    int OnPixelSizeChanged(double newPixelSizeUm);
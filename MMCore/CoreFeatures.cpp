@@ -118,6 +118,18 @@ const auto& featureMap() {
             [](bool e) { g_flags.ParallelDeviceInitialization = e; }
          }
       },
+      {
+         "ParallelSystemState", {
+            [] { return g_flags.ParallelSystemState; },
+            [](bool e) { g_flags.ParallelSystemState = e; }
+         }
+      },
+      {
+         "ParallelConfigApplication", {
+            [] { return g_flags.ParallelConfigApplication; },
+            [](bool e) { g_flags.ParallelConfigApplication = e; }
+         }
+      },
       // How to add a new Core feature: see the comment at the top of this file.
       // Features (the string names) must never be removed once added!
    };
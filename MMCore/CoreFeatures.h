@@ -27,6 +27,8 @@ namespace features {
 struct Flags {
    bool strictInitializationChecks = false;
    bool ParallelDeviceInitialization = true;
+   bool ParallelSystemState = false;
+   bool ParallelConfigApplication = false;
    // How to add a new Core feature: see the comment in the .cpp file.
 };
 
@@ -33,6 +33,59 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <sstream>
+
+namespace {
+
+// Parse a list of logical CPU numbers and ranges, such as "0-3;8;10-11".
+// (Commas are not allowed in property values.) Throws CMMError if the list
+// is malformed.
+std::vector<unsigned> ParseCPUList(const std::string& list)
+{
+   std::vector<unsigned> cpus;
+   std::istringstream is(list);
+   std::string item;
+   while (std::getline(is, item, ';'))
+   {
+      const std::string::size_type dash = item.find('-');
+      const std::string first = item.substr(0, dash);
+      const std::string last = dash == std::string::npos ?
+         first : item.substr(dash + 1);
+      const bool valid = !first.empty() && !last.empty() &&
+         first.find_first_not_of("0123456789") == std::string::npos &&
+         last.find_first_not_of("0123456789") == std::string::npos &&
+         first.size() < 6 && last.size() < 6;
+      const unsigned begin = valid ? std::atoi(first.c_str()) : 0;
+      const unsigned end = valid ? std::atoi(last.c_str()) : 0;
+      if (!valid || end < begin)
+         throw CMMError("Invalid CPU list " + ToQuotedString(list) +
+               " (expected a list such as \"0-3;8\")",
+               MMERR_InvalidCoreValue);
+      for (unsigned cpu = begin; cpu <= end; ++cpu)
+         cpus.push_back(cpu);
+   }
+   return cpus;
+}
+
+std::string FormatCPUList(const std::vector<unsigned>& cpus)
+{
+   std::string list;
+   for (std::size_t i = 0; i < cpus.size(); )
+   {
+      std::size_t j = i;
+      while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+         ++j;
+      if (!list.empty())
+         list += ";";
+      list += ToString(cpus[i]);
+      if (j > i)
+         list += "-" + ToString(cpus[j]);
+      i = j + 1;
+   }
+   return list;
+}
+
+} // namespace
 
 std::vector<std::string> CoreProperty::GetAllowedValues() const
 {
@@ -161,6 +214,30 @@ void CorePropertyCollection::Execute(const char* propName, const char* value)
    {
       core_->setChannelGroup(value);
    }
+   else if (strcmp(propName, MM::g_Keyword_CoreImageCopyThreads) == 0)
+   {
+      core_->setImageCopyThreads(static_cast<unsigned>(atol(value)),
+            core_->imageCopyCPUs_);
+   }
+   else if (strcmp(propName, MM::g_Keyword_CoreImageCopyCPUs) == 0)
+   {
+      std::vector<unsigned> cpus;
+      try
+      {
+         cpus = ParseCPUList(value);
+      }
+      catch (const CMMError&)
+      {
+         Set(propName, FormatCPUList(core_->imageCopyCPUs_).c_str());
+         throw;
+      }
+      core_->setImageCopyThreads(core_->imageCopyThreads_, cpus);
+      Set(propName, FormatCPUList(cpus).c_str()); // Normalize
+   }
+   else if (strcmp(propName, MM::g_Keyword_CoreImageProcessingThreads) == 0)
+   {
+      core_->setImageProcessingThreads(static_cast<unsigned>(atol(value)));
+   }
    // unknown property
    else
    {
@@ -242,6 +319,13 @@ void CorePropertyCollection::Refresh()
    // Channel group
    Set(MM::g_Keyword_CoreChannelGroup, core_->getChannelGroup().c_str());
 
+   // Sequence buffer copy threads
+   Set(MM::g_Keyword_CoreImageCopyThreads, ToString(core_->imageCopyThreads_).c_str());
+   Set(MM::g_Keyword_CoreImageCopyCPUs, FormatCPUList(core_->imageCopyCPUs_).c_str());
+
+   // Image processing threads
+   Set(MM::g_Keyword_CoreImageProcessingThreads, ToString(core_->imageProcessingThreads_).c_str());
+
 }
 
 bool CorePropertyCollection::IsReadOnly(const char* propName) const
@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceAdapterManifest.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Cache of what device adapter libraries provide, so that
+//                listing devices does not require loading every library.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DeviceAdapterManifest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace mm {
+
+namespace {
+
+const char* const ManifestHeader = "MMDeviceAdapterManifest";
+const int ManifestVersion = 1;
+
+// Fields are tab-separated; escape the characters that would break that
+std::string Escape(const std::string& s)
+{
+   std::string result;
+   result.reserve(s.size());
+   for (char ch : s)
+   {
+      switch (ch)
+      {
+         case '\\': result += "\\\\"; break;
+         case '\t': result += "\\t"; break;
+         case '\n': result += "\\n"; break;
+         case '\r': result += "\\r"; break;
+         default: result += ch; break;
+      }
+   }
+   return result;
+}
+
+std::vector<std::string> SplitFields(const std::string& line)
+{
+   std::vector<std::string> fields(1);
+   for (std::size_t i = 0; i < line.size(); ++i)
+   {
+      const char ch = line[i];
+      if (ch == '\t')
+         fields.emplace_back();
+      else if (ch == '\\' && i + 1 < line.size())
+      {
+         switch (line[++i])
+         {
+            case 't': fields.back() += '\t'; break;
+            case 'n': fields.back() += '\n'; break;
+            case 'r': fields.back() += '\r'; break;
+            default: fields.back() += line[i]; break;
+         }
+      }
+      else
+         fields.back() += ch;
+   }
+   return fields;
+}
+
+bool ParseInteger(const std::string& s, long long& value)
+{
+   std::istringstream stream(s);
+   stream >> value;
+   return !stream.fail() && stream.eof();
+}
+
+} // namespace
+
+bool
+DeviceAdapterManifest::GetFileStamp(const std::string& path, FileStamp& stamp)
+{
+#ifdef _WIN32
+   struct _stat64 st;
+   if (_stat64(path.c_str(), &st) != 0)
+      return false;
+   stamp.mtime = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+#else
+   struct stat st;
+   if (stat(path.c_str(), &st) != 0)
+      return false;
+#if defined(__APPLE__)
+   stamp.mtime = static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+      st.st_mtimespec.tv_nsec;
+#else
+   stamp.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+      st.st_mtim.tv_nsec;
+#endif
+#endif
+   stamp.size = static_cast<std::int64_t>(st.st_size);
+   return true;
+}
+
+void
+DeviceAdapterManifest::SetFilename(const std::string& filename)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   filename_ = filename;
+   if (!filename_.empty())
+      LoadFile();
+}
+
+std::string
+DeviceAdapterManifest::GetFilename() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return filename_;
+}
+
+bool
+DeviceAdapterManifest::Lookup(const std::string& path, const FileStamp& stamp,
+      Entry& entry) const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   auto it = entries_.find(path);
+   if (it == entries_.end() || it->second.stamp != stamp)
+      return false;
+   entry = it->second;
+   return true;
+}
+
+void
+DeviceAdapterManifest::Store(const Entry& entry)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   entries_[entry.path] = entry;
+}
+
+void
+DeviceAdapterManifest::Retain(const std::set<std::string>& paths)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   for (auto it = entries_.begin(); it != entries_.end(); )
+   {
+      if (paths.count(it->first))
+         ++it;
+      else
+         it = entries_.erase(it);
+   }
+}
+
+std::size_t
+DeviceAdapterManifest::GetSize() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return entries_.size();
+}
+
+void
+DeviceAdapterManifest::Save() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (filename_.empty())
+      return;
+
+   // Write a temporary file and rename it, so that a concurrently starting
+   // process never reads a partial manifest
+   const std::string tempFilename = filename_ + ".tmp";
+   {
+      std::ofstream out(tempFilename.c_str(),
+            std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+      if (!out)
+         return;
+      out << ManifestHeader << '\t' << ManifestVersion << '\n';
+      for (const auto& pathAndEntry : entries_)
+      {
+         const Entry& entry = pathAndEntry.second;
+         out << "L\t" << Escape(entry.path) << '\t' << entry.stamp.mtime <<
+            '\t' << entry.stamp.size << '\t' << entry.moduleInterfaceVersion <<
+            '\t' << entry.deviceInterfaceVersion << '\t' <<
+            entry.devices.size() << '\n';
+         for (const Device& device : entry.devices)
+         {
+            out << "D\t" << Escape(device.name) << '\t' <<
+               static_cast<int>(device.type) << '\t' <<
+               Escape(device.description) << '\n';
+         }
+      }
+      out.flush();
+      if (!out)
+      {
+         out.close();
+         std::remove(tempFilename.c_str());
+         return;
+      }
+   }
+#ifdef _WIN32
+   std::remove(filename_.c_str()); // rename() does not replace on Windows
+#endif
+   if (std::rename(tempFilename.c_str(), filename_.c_str()) != 0)
+      std::remove(tempFilename.c_str());
+}
+
+void
+DeviceAdapterManifest::LoadFile()
+{
+   std::ifstream in(filename_.c_str(), std::ios_base::in | std::ios_base::binary);
+   if (!in)
+      return;
+
+   std::string line;
+   if (!std::getline(in, line))
+      return;
+   std::vector<std::string> fields = SplitFields(line);
+   if (fields.size() != 2 || fields[0] != ManifestHeader ||
+         fields[1] != std::to_string(ManifestVersion))
+      return;
+
+   // Take the file's entries only if all of it is well-formed
+   std::map<std::string, Entry> entries;
+   Entry* current = nullptr;
+   long long remainingDevices = 0;
+   while (std::getline(in, line))
+   {
+      fields = SplitFields(line);
+      if (fields[0] == "L" && fields.size() == 7 && remainingDevices == 0)
+      {
+         Entry entry;
+         long long mtime, size, moduleVersion, deviceVersion;
+         entry.path = fields[1];
+         if (!ParseInteger(fields[2], mtime) || !ParseInteger(fields[3], size) ||
+               !ParseInteger(fields[4], moduleVersion) ||
+               !ParseInteger(fields[5], deviceVersion) ||
+               !ParseInteger(fields[6], remainingDevices) ||
+               remainingDevices < 0)
+            return;
+         entry.stamp.mtime = mtime;
+         entry.stamp.size = size;
+         entry.moduleInterfaceVersion = static_cast<long>(moduleVersion);
+         entry.deviceInterfaceVersion = static_cast<long>(deviceVersion);
+         current = &(entries[entry.path] = entry);
+      }
+      else if (fields[0] == "D" && fields.size() == 4 && remainingDevices > 0)
+      {
+         Device device;
+         long long type;
+         device.name = fields[1];
+         if (!ParseInteger(fields[2], type))
+            return;
+         device.type = static_cast<MM::DeviceType>(type);
+         device.description = fields[3];
+         current->devices.push_back(device);
+         --remainingDevices;
+      }
+      else
+      {
+         return;
+      }
+   }
+   if (remainingDevices != 0)
+      return;
+   entries_ = std::move(entries);
+}
+
+} // namespace mm
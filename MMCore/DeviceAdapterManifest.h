@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceAdapterManifest.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Cache of what device adapter libraries provide, so that
+//                listing devices does not require loading every library.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "MMDeviceConstants.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mm {
+
+/**
+ * The devices (names, descriptions, types) and interface versions of device
+ * adapter libraries, keyed by library path.
+ *
+ * Entries are valid as long as the library file's modification time and size
+ * are unchanged. The manifest can be persisted in a file, so that it survives
+ * across sessions. Thread-safe.
+ */
+class DeviceAdapterManifest
+{
+public:
+   struct FileStamp
+   {
+      std::int64_t mtime; // Nanoseconds since the epoch (or coarser)
+      std::int64_t size;
+
+      FileStamp() : mtime(0), size(-1) {}
+      bool operator==(const FileStamp& other) const
+      { return mtime == other.mtime && size == other.size; }
+      bool operator!=(const FileStamp& other) const
+      { return !(*this == other); }
+   };
+
+   struct Device
+   {
+      std::string name;
+      std::string description;
+      MM::DeviceType type;
+   };
+
+   struct Entry
+   {
+      std::string path;
+      FileStamp stamp;
+      long moduleInterfaceVersion;
+      long deviceInterfaceVersion;
+      // Empty if the interface versions are incompatible with this MMCore
+      std::vector<Device> devices;
+
+      Entry() : moduleInterfaceVersion(0), deviceInterfaceVersion(0) {}
+   };
+
+   // Return false if the file does not exist
+   static bool GetFileStamp(const std::string& path, FileStamp& stamp);
+
+   /**
+    * Set the file to persist the manifest in, and load the entries stored
+    * in it. An empty filename keeps the manifest in memory only. A missing
+    * or unreadable file is not an error (the manifest is rebuilt as
+    * libraries are queried).
+    */
+   void SetFilename(const std::string& filename);
+   std::string GetFilename() const;
+
+   // Get the entry for path if it was recorded with the given stamp
+   bool Lookup(const std::string& path, const FileStamp& stamp,
+         Entry& entry) const;
+   void Store(const Entry& entry);
+   // Remove the entries of libraries not in paths
+   void Retain(const std::set<std::string>& paths);
+   std::size_t GetSize() const;
+
+   /**
+    * Write the manifest to its file, if any. Failure to write is not
+    * reported (the manifest is only a cache).
+    */
+   void Save() const;
+
+private:
+   void LoadFile();
+
+   mutable std::mutex mutex_;
+   std::string filename_;
+   std::map<std::string, Entry> entries_;
+};
+
+} // namespace mm
@@ -18,6 +18,7 @@
 #include "DeviceManager.h"
 
 #include "Devices/HubInstance.h"
+#include "DeviceModuleLock.h"
 #include "CoreUtils.h"
 #include "Devices/DeviceInstance.h"
 #include "Error.h"
@@ -294,8 +295,63 @@ DeviceManager::GetParentDevice(std::shared_ptr<DeviceInstance> device) const
 
 
 DeviceModuleLockGuard::DeviceModuleLockGuard(std::shared_ptr<DeviceInstance> device) :
-   g_(device->GetAdapterModule()->GetLock())
+   DeviceModuleLockGuard(device, false)
 {}
 
 
+DeviceModuleLockGuard::DeviceModuleLockGuard(std::shared_ptr<DeviceInstance> device,
+      bool read) :
+#ifndef MMCORE_DISABLE_TRACING
+   waitBegin_(trace::IsEnabled() ? trace::Now() : 0),
+   holdBegin_(0),
+#endif
+   lock_(device->GetAdapterModule()->GetLock()),
+   shared_(read && device->AllowsConcurrentReads())
+{
+   if (shared_)
+   {
+      // The device's read mutex is taken first, so that a thread waiting for
+      // it is not yet a reader that would keep another reader of the device
+      // from acquiring the module lock exclusively. A thread that already
+      // holds the module lock exclusively needs no device mutex, and must
+      // not wait for it, since its holder may be waiting for the module.
+      if (!lock_.IsOwnedByCurrentThread())
+         deviceReadLock_ = std::unique_lock<std::recursive_mutex>(
+               device->GetReadMutex());
+      lock_.LockShared();
+   }
+   else
+   {
+      lock_.Lock();
+   }
+#ifndef MMCORE_DISABLE_TRACING
+   if (waitBegin_ != 0)
+   {
+      holdBegin_ = trace::Now();
+      trace::Record("Lock", "DeviceModuleLock wait", waitBegin_, holdBegin_);
+   }
+#endif
+}
+
+
+DeviceModuleLockGuard::~DeviceModuleLockGuard()
+{
+#ifndef MMCORE_DISABLE_TRACING
+   if (holdBegin_ != 0)
+      trace::Record("Lock", shared_ ? "DeviceModuleLock shared hold" :
+            "DeviceModuleLock hold", holdBegin_, trace::Now());
+#endif
+   if (shared_)
+   {
+      lock_.UnlockShared();
+      if (deviceReadLock_)
+         deviceReadLock_.unlock();
+   }
+   else
+   {
+      lock_.Unlock();
+   }
+}
+
+
 } // namespace mm
@@ -21,12 +21,15 @@
 #include "Devices/DeviceInstance.h"
 #include "Error.h"
 #include "Logging/Logger.h"
+#include "Tracing.h"
 
 #include "MMDevice.h"
 #include "DeviceThreads.h"
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -38,6 +41,8 @@ class LoadedDeviceAdapter;
 namespace mm
 {
 
+class DeviceModuleLock;
+
 class DeviceManager /* final */
 {
    // Store devices in an ordered container. We could use a map or hash map to
@@ -133,12 +138,42 @@ public:
 };
 
 
-// Scoped acquisition of a device's module's lock
+// Scoped exclusive acquisition of a device's module's lock. When tracing,
+// the time spent waiting for and holding the lock are recorded as separate
+// spans.
 class DeviceModuleLockGuard
 {
-   MMThreadGuard g_;
+#ifndef MMCORE_DISABLE_TRACING
+   std::uint64_t waitBegin_;
+   std::uint64_t holdBegin_;
+#endif
+   DeviceModuleLock& lock_;
+   bool shared_;
+   std::unique_lock<std::recursive_mutex> deviceReadLock_;
+
 public:
    explicit DeviceModuleLockGuard(std::shared_ptr<DeviceInstance> device);
+   ~DeviceModuleLockGuard();
+
+   DeviceModuleLockGuard(const DeviceModuleLockGuard&) = delete;
+   DeviceModuleLockGuard& operator=(const DeviceModuleLockGuard&) = delete;
+
+protected:
+   DeviceModuleLockGuard(std::shared_ptr<DeviceInstance> device, bool read);
+};
+
+
+// Scoped acquisition of a device's module's lock for a call that only reads
+// from the device. If the device declares concurrent reads
+// (MM::g_Keyword_ConcurrentReads), the module lock is shared with readers of
+// other devices and only reads of this device are excluded; otherwise the
+// module lock is acquired exclusively.
+class DeviceModuleReadLockGuard : public DeviceModuleLockGuard
+{
+public:
+   explicit DeviceModuleReadLockGuard(std::shared_ptr<DeviceInstance> device) :
+      DeviceModuleLockGuard(device, true)
+   {}
 };
 
 } // namespace mm
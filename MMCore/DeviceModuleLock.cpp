@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceModuleLock.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   The lock serializing access to a device adapter module, with
+//                optional shared (read) access and contention statistics.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DeviceModuleLock.h"
+
+#include "Error.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace mm {
+
+void
+DeviceModuleLock::Lock()
+{
+   const std::thread::id self = std::this_thread::get_id();
+   std::unique_lock<std::mutex> lock(mutex_);
+   if (owner_ == self)
+   {
+      ++ownerDepth_;
+      return;
+   }
+
+   bool contended = false;
+   Clock::time_point waitBegin;
+   if (!CanLockExclusive(self))
+   {
+      const bool upgrading = FindReader(self) != readers_.end();
+      if (upgrading)
+      {
+         // Each would wait for the other to stop reading
+         if (readerUpgrading_)
+            throw CMMError("Deadlock: two threads reading a device adapter "
+                  "module concurrently both tried to modify it");
+         readerUpgrading_ = true;
+      }
+
+      contended = true;
+      waitBegin = Clock::now();
+      ++waitingWriters_;
+      released_.wait(lock, [&] { return CanLockExclusive(self); });
+      --waitingWriters_;
+      if (upgrading)
+         readerUpgrading_ = false;
+   }
+
+   owner_ = self;
+   ownerDepth_ = 1;
+   ownerHoldBegin_ = Clock::now();
+   RecordAcquisition(false, contended, waitBegin, ownerHoldBegin_);
+}
+
+void
+DeviceModuleLock::Unlock()
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   ReleaseExclusive(lock);
+}
+
+void
+DeviceModuleLock::LockShared()
+{
+   const std::thread::id self = std::this_thread::get_id();
+   std::unique_lock<std::mutex> lock(mutex_);
+   if (owner_ == self)
+   {
+      ++ownerDepth_;
+      return;
+   }
+   auto reader = FindReader(self);
+   if (reader != readers_.end())
+   {
+      // Do not wait for writers, which may be waiting for us to finish
+      ++reader->depth;
+      return;
+   }
+
+   auto canLockShared = [&] {
+      return owner_ == std::thread::id() && waitingWriters_ == 0;
+   };
+   bool contended = false;
+   Clock::time_point waitBegin;
+   if (!canLockShared())
+   {
+      contended = true;
+      waitBegin = Clock::now();
+      released_.wait(lock, canLockShared);
+   }
+
+   const Clock::time_point now = Clock::now();
+   readers_.push_back(Reader{ self, 1, now });
+   RecordAcquisition(true, contended, waitBegin, now);
+}
+
+void
+DeviceModuleLock::UnlockShared()
+{
+   const std::thread::id self = std::this_thread::get_id();
+   std::unique_lock<std::mutex> lock(mutex_);
+   if (owner_ == self) // Acquired by re-entering the exclusive lock
+   {
+      ReleaseExclusive(lock);
+      return;
+   }
+
+   auto reader = FindReader(self);
+   assert(reader != readers_.end());
+   if (--reader->depth > 0)
+      return;
+
+   RecordHold(Clock::now() - reader->holdBegin);
+   readers_.erase(reader);
+   lock.unlock();
+   released_.notify_all();
+}
+
+bool
+DeviceModuleLock::IsOwnedByCurrentThread() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return owner_ == std::this_thread::get_id();
+}
+
+DeviceModuleLock::Statistics
+DeviceModuleLock::GetStatistics() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return stats_;
+}
+
+void
+DeviceModuleLock::ResetStatistics()
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   stats_ = Statistics();
+}
+
+void
+DeviceModuleLock::ReleaseExclusive(std::unique_lock<std::mutex>& lock)
+{
+   assert(owner_ == std::this_thread::get_id() && ownerDepth_ > 0);
+   if (--ownerDepth_ > 0)
+      return;
+
+   owner_ = std::thread::id();
+   RecordHold(Clock::now() - ownerHoldBegin_);
+   lock.unlock();
+   released_.notify_all();
+}
+
+bool
+DeviceModuleLock::CanLockExclusive(std::thread::id self) const
+{
+   if (owner_ != std::thread::id())
+      return false;
+   return std::all_of(readers_.begin(), readers_.end(),
+         [&](const Reader& r) { return r.thread == self; });
+}
+
+std::vector<DeviceModuleLock::Reader>::iterator
+DeviceModuleLock::FindReader(std::thread::id self)
+{
+   return std::find_if(readers_.begin(), readers_.end(),
+         [&](const Reader& r) { return r.thread == self; });
+}
+
+void
+DeviceModuleLock::RecordAcquisition(bool shared, bool contended,
+      Clock::time_point waitBegin, Clock::time_point acquired)
+{
+   ++stats_.acquisitions;
+   if (shared)
+      ++stats_.sharedAcquisitions;
+   if (contended)
+   {
+      ++stats_.contendedAcquisitions;
+      const Clock::duration waitTime = acquired - waitBegin;
+      stats_.totalWaitTime += waitTime;
+      stats_.maxWaitTime = std::max(stats_.maxWaitTime, waitTime);
+   }
+}
+
+void
+DeviceModuleLock::RecordHold(Clock::duration holdTime)
+{
+   stats_.totalHoldTime += holdTime;
+   stats_.maxHoldTime = std::max(stats_.maxHoldTime, holdTime);
+}
+
+} // namespace mm
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceModuleLock.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   The lock serializing access to a device adapter module, with
+//                optional shared (read) access and contention statistics.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mm {
+
+// Exclusive acquisition is recursive, as with the plain module mutex this
+// replaces. Shared acquisition lets several threads hold the lock at once
+// (used only for reads of devices that declare them safe to run
+// concurrently); a thread that already holds the lock exclusively just
+// re-enters it. A thread holding the lock shared may acquire it exclusively:
+// it waits for the other readers to leave. Waiting exclusive acquisitions
+// keep new readers out.
+//
+// Acquisitions, contended acquisitions, wait times and hold times (of the
+// outermost acquisition by each thread) are recorded.
+class DeviceModuleLock
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   struct Statistics
+   {
+      long acquisitions = 0;
+      long sharedAcquisitions = 0; // Included in acquisitions
+      long contendedAcquisitions = 0;
+      Clock::duration totalWaitTime{};
+      Clock::duration maxWaitTime{};
+      Clock::duration totalHoldTime{};
+      Clock::duration maxHoldTime{};
+   };
+
+   DeviceModuleLock() = default;
+   DeviceModuleLock(const DeviceModuleLock&) = delete;
+   DeviceModuleLock& operator=(const DeviceModuleLock&) = delete;
+
+   // Throws CMMError if two threads holding the lock shared both try to
+   // acquire it exclusively, which would otherwise deadlock.
+   void Lock();
+   void Unlock();
+
+   void LockShared();
+   void UnlockShared();
+
+   // Whether the calling thread holds the lock exclusively
+   bool IsOwnedByCurrentThread() const;
+
+   Statistics GetStatistics() const;
+   void ResetStatistics();
+
+private:
+   struct Reader
+   {
+      std::thread::id thread;
+      unsigned depth;
+      Clock::time_point holdBegin;
+   };
+
+   void ReleaseExclusive(std::unique_lock<std::mutex>& lock);
+   bool CanLockExclusive(std::thread::id self) const;
+   std::vector<Reader>::iterator FindReader(std::thread::id self);
+   void RecordAcquisition(bool shared, bool contended,
+         Clock::time_point waitBegin, Clock::time_point acquired);
+   void RecordHold(Clock::duration holdTime);
+
+   mutable std::mutex mutex_;
+   std::condition_variable released_;
+
+   std::thread::id owner_;
+   unsigned ownerDepth_ = 0;
+   Clock::time_point ownerHoldBegin_;
+   std::vector<Reader> readers_;
+   unsigned waitingWriters_ = 0;
+   bool readerUpgrading_ = false;
+
+   Statistics stats_;
+};
+
+} // namespace mm
@@ -144,6 +144,36 @@ std::string CameraInstance::GetTags()
    return serializedMetadataBuf.Get();
 }
 
+/**
+ * Get the camera's tags (see GetTags()), parsed.
+ *
+ * The serialized tags are only parsed when they differ from the previous
+ * call, which avoids a full metadata parse per frame during sequence
+ * acquisition. The returned object is never modified, so it can be kept with
+ * an image and merged only when the image's metadata is read.
+ */
+std::shared_ptr<const Metadata> CameraInstance::GetParsedTags()
+{
+   const std::string serialized = GetTags();
+   std::lock_guard<std::mutex> lock(parsedTagsMutex_);
+   if (!parsedTags_ || serialized != lastSerializedTags_)
+   {
+      auto parsed = std::make_shared<Metadata>();
+      parsed->Restore(serialized.c_str());
+      parsedTags_ = parsed;
+      lastSerializedTags_ = serialized;
+   }
+   return parsedTags_;
+}
+
+/**
+ * Merge the camera's tags (see GetTags()) into md.
+ */
+void CameraInstance::MergeTagsInto(Metadata& md)
+{
+   md.Merge(*GetParsedTags());
+}
+
 void CameraInstance::AddTag(const char* key, const char* deviceLabel, const char* value) { RequireInitialized(__func__); return GetImpl()->AddTag(key, deviceLabel, value); }
 void CameraInstance::RemoveTag(const char* key) { RequireInitialized(__func__); return GetImpl()->RemoveTag(key); }
 int CameraInstance::IsExposureSequenceable(bool& isSequenceable) const { RequireInitialized(__func__); return GetImpl()->IsExposureSequenceable(isSequenceable); }
@@ -21,6 +21,12 @@
 
 #include "DeviceInstanceBase.h"
 
+#include "ImageMetadata.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
 
 class CameraInstance : public DeviceInstanceBase<MM::Camera>
 {
@@ -72,6 +78,8 @@ public:
    int PrepareSequenceAcqusition();
    bool IsCapturing();
    std::string GetTags();
+   void MergeTagsInto(Metadata& md);
+   std::shared_ptr<const Metadata> GetParsedTags();
    void AddTag(const char* key, const char* deviceLabel, const char* value);
    void RemoveTag(const char* key);
    int IsExposureSequenceable(bool& isSequenceable) const;
@@ -81,4 +89,11 @@ public:
    int ClearExposureSequence();
    int AddToExposureSequence(double exposureTime_ms);
    int SendExposureSequence() const;
+
+private:
+   // Cache of the parsed result of GetTags(), which rarely changes between
+   // frames
+   std::mutex parsedTagsMutex_;
+   std::string lastSerializedTags_;
+   std::shared_ptr<const Metadata> parsedTags_;
 };
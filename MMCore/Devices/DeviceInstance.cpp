@@ -39,6 +39,79 @@ DeviceInstance::LogMessage(const char* msg, bool debugOnly)
    return DEVICE_OK;
 }
 
+void
+DeviceInstance::NotifyBusyChanged()
+{
+   {
+      std::lock_guard<std::mutex> lock(busyMutex_);
+      ++busyChangeCount_;
+   }
+   busyCv_.notify_all();
+}
+
+
+unsigned long long
+DeviceInstance::GetBusyChangeCount() const
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   return busyChangeCount_;
+}
+
+
+bool
+DeviceInstance::WaitForBusyChange(unsigned long long changeCount,
+      std::chrono::steady_clock::time_point deadline)
+{
+   std::unique_lock<std::mutex> lock(busyMutex_);
+   return busyCv_.wait_until(lock, deadline,
+         [&] { return busyChangeCount_ != changeCount; });
+}
+
+
+void
+DeviceInstance::RecordWait(std::chrono::steady_clock::duration waitTime)
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   ++waitCount_;
+   waitTime_ += waitTime;
+   if (waitTime > maxWaitTime_)
+      maxWaitTime_ = waitTime;
+}
+
+
+long
+DeviceInstance::GetWaitCount() const
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   return waitCount_;
+}
+
+
+std::chrono::steady_clock::duration
+DeviceInstance::GetTotalWaitTime() const
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   return waitTime_;
+}
+
+
+std::chrono::steady_clock::duration
+DeviceInstance::GetMaxWaitTime() const
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   return maxWaitTime_;
+}
+
+
+void
+DeviceInstance::ResetWaitStatistics()
+{
+   std::lock_guard<std::mutex> lock(busyMutex_);
+   waitCount_ = 0;
+   waitTime_ = std::chrono::steady_clock::duration::zero();
+   maxWaitTime_ = std::chrono::steady_clock::duration::zero();
+}
+
 
 DeviceInstance::DeviceInstance(CMMCore* core,
       std::shared_ptr<LoadedDeviceAdapter> adapter,
@@ -378,6 +451,8 @@ DeviceInstance::Initialize()
    initializeCalled_ = true;
    ThrowIfError(pImpl_->Initialize());
    initialized_ = true;
+   concurrentReads_ = HasProperty(MM::g_Keyword_ConcurrentReads) &&
+      GetProperty(MM::g_Keyword_ConcurrentReads) == "1";
 }
 
 void
@@ -24,9 +24,13 @@
 
 #include "MMDeviceConstants.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -74,6 +78,21 @@ private:
    mm::logging::Logger coreLogger_;
    bool initializeCalled_ = false;
    bool initialized_ = false;
+   // Declared by the device (MM::g_Keyword_ConcurrentReads); read before
+   // acquiring the module lock
+   std::atomic<bool> concurrentReads_{false};
+   // Serializes reads of this device while the module lock is shared
+   std::recursive_mutex readMutex_;
+
+   // Busy notifications from the device (see MM::Core::OnBusyChanged())
+   mutable std::mutex busyMutex_;
+   std::condition_variable busyCv_;
+   unsigned long long busyChangeCount_ = 0;
+
+   // Time spent in CMMCore::waitForDevice(); guarded by busyMutex_
+   long waitCount_ = 0;
+   std::chrono::steady_clock::duration waitTime_{};
+   std::chrono::steady_clock::duration maxWaitTime_{};
 
 public:
    DeviceInstance(const DeviceInstance&) = delete;
@@ -90,8 +109,26 @@ public:
 
    // Callback API
    int LogMessage(const char* msg, bool debugOnly);
+   void NotifyBusyChanged();
+
+   // Number of busy notifications received so far (0 for devices that never
+   // send them)
+   unsigned long long GetBusyChangeCount() const;
+   // Block until a busy notification arrives after the one counted by
+   // changeCount, or until deadline. Returns false on timeout.
+   bool WaitForBusyChange(unsigned long long changeCount,
+         std::chrono::steady_clock::time_point deadline);
+
+   void RecordWait(std::chrono::steady_clock::duration waitTime);
+   long GetWaitCount() const;
+   std::chrono::steady_clock::duration GetTotalWaitTime() const;
+   std::chrono::steady_clock::duration GetMaxWaitTime() const;
+   void ResetWaitStatistics();
 
    bool IsInitialized() const { return initialized_; }
+   // Whether read-only calls may share the module lock with other readers
+   bool AllowsConcurrentReads() const { return concurrentReads_; }
+   std::recursive_mutex& GetReadMutex() { return readMutex_; }
    bool HasInitializationBeenAttempted() const { return initializeCalled_; }
 
 protected:
@@ -76,11 +76,51 @@ void ImgBuffer::Resize(unsigned xSize, unsigned ySize)
 
 void ImgBuffer::SetMetadata(const Metadata& md)
 {
-   //metadata_ = md;
-   // Serialize/Restore instead of =operator used to avoid object new/delete
-   // issues across the DLL boundary (on Windows)
-   // TODO: this is inefficient and should be revised
-    metadata_.Restore(md.Serialize().c_str());
+   if (!encoded_)
+   {
+      // Both md and metadata_ live within MMCore (device adapters only pass
+      // serialized or binary-encoded metadata), so plain assignment is safe.
+      metadata_ = md;
+      return;
+   }
+   std::lock_guard<std::mutex> lock(encoded_->mutex);
+   metadata_ = md;
+   encoded_->deviceTags.reset();
+   encoded_->decoded.store(true, std::memory_order_release);
+}
+
+void ImgBuffer::SwapBinaryMetadata(MM::BinaryMetadataWriter& base,
+      std::shared_ptr<const Metadata> deviceTags,
+      MM::BinaryMetadataWriter& overrides)
+{
+   if (!encoded_)
+      encoded_.reset(new EncodedMetadata());
+   std::lock_guard<std::mutex> lock(encoded_->mutex);
+   encoded_->base.Swap(base);
+   encoded_->deviceTags = std::move(deviceTags);
+   encoded_->overrides.Swap(overrides);
+   encoded_->decoded.store(false, std::memory_order_release);
+}
+
+const Metadata& ImgBuffer::GetMetadata() const
+{
+   if (encoded_ && !encoded_->decoded.load(std::memory_order_acquire))
+   {
+      std::lock_guard<std::mutex> lock(encoded_->mutex);
+      if (!encoded_->decoded.load(std::memory_order_relaxed))
+      {
+         // The encodings were validated when the image was inserted
+         metadata_.Clear();
+         MM::DecodeBinaryMetadata(encoded_->base.GetData(),
+               encoded_->base.GetSize(), metadata_);
+         if (encoded_->deviceTags)
+            metadata_.Merge(*encoded_->deviceTags);
+         MM::DecodeBinaryMetadata(encoded_->overrides.GetData(),
+               encoded_->overrides.GetSize(), metadata_);
+         encoded_->decoded.store(true, std::memory_order_release);
+      }
+   }
+   return metadata_;
 }
 
 
@@ -18,9 +18,13 @@
 
 #pragma once
 
+#include "BinaryMetadata.h"
 #include "ImageMetadata.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <utility>
 
 namespace mm {
 
@@ -30,7 +34,21 @@ class ImgBuffer
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
-   Metadata metadata_;
+
+   // Metadata is either set directly or stored in binary form and decoded on
+   // first access (most sequence frames are never read with metadata)
+   struct EncodedMetadata
+   {
+      std::mutex mutex;
+      std::atomic<bool> decoded{true};
+      MM::BinaryMetadataWriter base;
+      std::shared_ptr<const Metadata> deviceTags;
+      MM::BinaryMetadataWriter overrides;
+   };
+   mutable Metadata metadata_;
+   // Only allocated on first binary insert, so that the many slots of a
+   // sequence buffer with small frames stay small
+   std::unique_ptr<EncodedMetadata> encoded_;
 
 public:
    ImgBuffer(unsigned xSize, unsigned ySize, unsigned pixDepth);
@@ -46,12 +64,45 @@ public:
    void Resize(unsigned xSize, unsigned ySize);
 
    void SetMetadata(const Metadata& md);
-   const Metadata& GetMetadata() const {return metadata_;}
+   // Take the encoded metadata, giving the previous buffers back in base and
+   // overrides for reuse. The decoded metadata consists of base, then
+   // deviceTags (if not null), then overrides, later tags replacing earlier.
+   void SwapBinaryMetadata(MM::BinaryMetadataWriter& base,
+         std::shared_ptr<const Metadata> deviceTags,
+         MM::BinaryMetadataWriter& overrides);
+   const Metadata& GetMetadata() const;
 
 private:
+   ImgBuffer(const ImgBuffer&);
    ImgBuffer& operator=(const ImgBuffer&);
 };
 
+// A read-only reference to an image held in the sequence buffer. While any
+// copy of the handle exists, the buffer slot is pinned: the producer will not
+// overwrite it, so the pixels and metadata can be read in place without
+// copying. Handles should be released promptly, because a pinned slot stalls
+// the producer once it comes around to that slot again.
+class ImageHandle
+{
+   std::shared_ptr<const ImgBuffer> image_; // Deleter unpins the slot
+
+public:
+   ImageHandle() {}
+   explicit ImageHandle(std::shared_ptr<const ImgBuffer> image) :
+      image_(std::move(image)) {}
+
+   explicit operator bool() const { return image_ != nullptr; }
+
+   const unsigned char* GetPixels() const {return image_->GetPixels();}
+   const Metadata& GetMetadata() const {return image_->GetMetadata();}
+   unsigned int Width() const {return image_->Width();}
+   unsigned int Height() const {return image_->Height();}
+   unsigned int Depth() const {return image_->Depth();}
+
+   // Drop this reference (the slot is unpinned when the last copy is gone)
+   void Release() {image_.reset();}
+};
+
 // The FrameBuffer class wraps ImgBuffer (which is part of the MMCore API) for
 // internal use. It was also previously part of a never-completed scheme to
 // support multi-channel frames.
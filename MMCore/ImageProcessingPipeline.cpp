@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageProcessingPipeline.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs the image processor on inserted images on worker
+//                threads, off the camera's thread.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ImageProcessingPipeline.h"
+
+#include "CircularBuffer.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace mm {
+
+ImageProcessingPipeline::ImageProcessingPipeline(unsigned threadCount) :
+   // Enough to keep every worker busy while the next frames arrive
+   maxInFlight_(2 * std::max(1u, threadCount))
+{
+   for (unsigned i = 0; i < std::max(1u, threadCount); ++i)
+      threads_.emplace_back([this] { Run(); });
+}
+
+ImageProcessingPipeline::~ImageProcessingPipeline()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   jobAvailable_.notify_all();
+   for (std::thread& t : threads_)
+      t.join();
+}
+
+int ImageProcessingPipeline::Submit(MM::ImageProcessor* processor,
+   bool concurrent, std::shared_ptr<CircularBuffer> target,
+   const unsigned char* pixels, unsigned width, unsigned height,
+   unsigned byteDepth, unsigned nComponents, const Metadata* md,
+   const BinaryImageMetadata* binaryMd,
+   MM::ImageReleaseFunction release, void* releaseContext)
+{
+   const std::size_t size = static_cast<std::size_t>(width) * height * byteDepth;
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   jobInserted_.wait(lock, [&] {
+      return nextSubmitted_ - nextInserted_ < maxInFlight_;
+   });
+
+   Job job;
+   job.sequence = nextSubmitted_++;
+   job.processor = processor;
+   job.concurrent = concurrent;
+   job.target = std::move(target);
+   job.release = release;
+   job.releaseContext = releaseContext;
+   if (!release && !spareBuffers_.empty())
+   {
+      job.buffer = std::move(spareBuffers_.back());
+      spareBuffers_.pop_back();
+   }
+   job.width = width;
+   job.height = height;
+   job.byteDepth = byteDepth;
+   job.nComponents = nComponents;
+   job.binary = binaryMd != nullptr;
+   if (binaryMd)
+   {
+      job.binaryMd = *binaryMd;
+      if (binaryMd->data)
+         job.binaryData.assign(binaryMd->data,
+            binaryMd->data + binaryMd->length);
+   }
+   else if (md)
+   {
+      job.md = *md;
+   }
+
+   if (release)
+   {
+      job.pixels = const_cast<unsigned char*>(pixels);
+   }
+   else
+   {
+      // Copy without holding the lock, so workers can hand over meanwhile
+      lock.unlock();
+      job.buffer.resize(size);
+      std::memcpy(job.buffer.data(), pixels, size);
+      job.pixels = job.buffer.data();
+      lock.lock();
+   }
+
+   queue_.push_back(std::move(job));
+   const int err = insertError_;
+   insertError_ = DEVICE_OK;
+   lock.unlock();
+   jobAvailable_.notify_one();
+   return err;
+}
+
+void ImageProcessingPipeline::Flush()
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   jobInserted_.wait(lock, [&] { return nextInserted_ == nextSubmitted_; });
+}
+
+void ImageProcessingPipeline::Run()
+{
+   for (;;)
+   {
+      Job job;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         jobAvailable_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+         if (queue_.empty())
+            return; // Stopping, with nothing left to do
+         job = std::move(queue_.front());
+         queue_.pop_front();
+      }
+
+      Process(job);
+
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         jobInserted_.wait(lock, [&] { return nextInserted_ == job.sequence; });
+      }
+      // Only this worker can insert until nextInserted_ is advanced
+      const int err = Insert(job);
+      if (job.release)
+         job.release(job.releaseContext, job.pixels);
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         ++nextInserted_;
+         if (err != DEVICE_OK && insertError_ == DEVICE_OK)
+            insertError_ = err;
+         if (!job.release)
+            spareBuffers_.push_back(std::move(job.buffer));
+      }
+      jobInserted_.notify_all();
+   }
+}
+
+void ImageProcessingPipeline::Process(Job& job)
+{
+   // Frames are handed to the processor in submission order; one that is
+   // not concurrent finishes each frame before getting the next
+   const bool serial = job.processor && !job.concurrent;
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobStarted_.wait(lock, [&] { return nextStarted_ == job.sequence; });
+      if (!serial)
+         ++nextStarted_;
+   }
+   if (!serial)
+      jobStarted_.notify_all();
+
+   if (job.processor)
+   {
+      try
+      {
+         // As on the camera thread, the processor's result is not checked
+         job.processor->Process(job.pixels, job.width, job.height,
+            job.byteDepth);
+      }
+      catch (...)
+      {
+      }
+   }
+
+   if (serial)
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         ++nextStarted_;
+      }
+      jobStarted_.notify_all();
+   }
+}
+
+int ImageProcessingPipeline::Insert(Job& job)
+{
+   try
+   {
+      bool inserted;
+      if (job.binary)
+      {
+         // The vector may have moved with the job since Submit()
+         job.binaryMd.data = job.binaryData.data();
+         inserted = job.target->InsertImage(job.pixels, job.width,
+            job.height, job.byteDepth, job.nComponents, job.binaryMd);
+      }
+      else
+      {
+         inserted = job.target->InsertImage(job.pixels, job.width,
+            job.height, job.byteDepth, job.nComponents, &job.md);
+      }
+      if (inserted)
+         return DEVICE_OK;
+      return DEVICE_BUFFER_OVERFLOW;
+   }
+   catch (const CMMError&)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+}
+
+} // namespace mm
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageProcessingPipeline.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs the image processor on inserted images on worker
+//                threads, off the camera's thread.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "CircularBuffer.h"
+#include "ImageMetadata.h"
+#include "MMDevice.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mm {
+
+// Images submitted by cameras are copied (unless lent by the camera),
+// processed on one of the worker threads, and inserted into their target
+// buffer in submission order.
+//
+// An image processor is called from several workers at once (so that, for
+// example, an ImageProcessorChain can work on consecutive frames in
+// different stages) only if it is declared concurrent; otherwise calls to it
+// are serialized in submission order, which still takes the processing off
+// the camera's thread. Concurrent calls are started in submission order but
+// may still overtake each other (e.g. on the way into the first stage of an
+// ImageProcessorChain).
+//
+// The number of frames in flight is bounded; when the workers fall behind,
+// Submit() blocks the camera until one is done.
+class ImageProcessingPipeline
+{
+public:
+   explicit ImageProcessingPipeline(unsigned threadCount);
+   ~ImageProcessingPipeline(); // Finishes submitted frames
+
+   ImageProcessingPipeline(const ImageProcessingPipeline&) = delete;
+   ImageProcessingPipeline& operator=(const ImageProcessingPipeline&) = delete;
+
+   unsigned GetThreadCount() const
+   { return static_cast<unsigned>(threads_.size()); }
+
+   // Returns the error (DEVICE_BUFFER_OVERFLOW or DEVICE_INCOMPATIBLE_IMAGE)
+   // with which inserting an earlier frame failed, once, or DEVICE_OK.
+   // If release is not null, pixels are processed in place rather than
+   // copied, and released once inserted. The metadata is binaryMd if not
+   // null (its data is copied), otherwise md.
+   int Submit(MM::ImageProcessor* processor, bool concurrent,
+      std::shared_ptr<CircularBuffer> target, const unsigned char* pixels,
+      unsigned width, unsigned height, unsigned byteDepth,
+      unsigned nComponents, const Metadata* md,
+      const BinaryImageMetadata* binaryMd,
+      MM::ImageReleaseFunction release = nullptr,
+      void* releaseContext = nullptr);
+
+   // Waits until all submitted frames have been inserted
+   void Flush();
+
+private:
+   struct Job
+   {
+      unsigned long long sequence;
+      MM::ImageProcessor* processor;
+      bool concurrent;
+      std::shared_ptr<CircularBuffer> target;
+      std::vector<unsigned char> buffer; // Unless borrowed
+      unsigned char* pixels;
+      MM::ImageReleaseFunction release;
+      void* releaseContext;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      Metadata md;
+      bool binary;
+      BinaryImageMetadata binaryMd; // data points into binaryData
+      std::vector<unsigned char> binaryData;
+   };
+
+   void Run();
+   void Process(Job& job);
+   int Insert(Job& job);
+
+   std::size_t maxInFlight_;
+
+   std::mutex mutex_;
+   std::condition_variable jobAvailable_;
+   std::condition_variable jobStarted_;
+   std::condition_variable jobInserted_;
+   std::deque<Job> queue_;
+   std::vector<std::vector<unsigned char>> spareBuffers_;
+   unsigned long long nextSubmitted_ = 0;
+   unsigned long long nextStarted_ = 0; // Next to be given to the processor
+   unsigned long long nextInserted_ = 0;
+   int insertError_ = DEVICE_OK;
+   bool stopping_ = false;
+
+   std::vector<std::thread> threads_;
+};
+
+} // namespace mm
@@ -39,10 +39,10 @@ LoadedDeviceAdapter::LoadedDeviceAdapter(const std::string& name,
 }
 
 
-MMThreadLock*
+mm::DeviceModuleLock&
 LoadedDeviceAdapter::GetLock()
 {
-   return &lock_;
+   return lock_;
 }
 
 
@@ -194,7 +194,14 @@ LoadedDeviceAdapter::CheckInterfaceVersion() const
    {
       throw CMMError("Cannot verify interface compatibility of device adapter", e);
    }
+   CheckInterfaceVersion(moduleInterfaceVersion, deviceInterfaceVersion);
+}
+
 
+void
+LoadedDeviceAdapter::CheckInterfaceVersion(long moduleInterfaceVersion,
+      long deviceInterfaceVersion)
+{
    if (moduleInterfaceVersion != MODULE_INTERFACE_VERSION)
       throw CMMError("Incompatible module interface version (MMCore requires " +
             ToString(MODULE_INTERFACE_VERSION) +
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "../DeviceModuleLock.h"
 #include "../Logging/Logger.h"
 #include "LoadedDeviceAdapterImpl.h"
 
@@ -52,9 +53,13 @@ public:
 
    std::string GetName() const { return name_; }
 
+   // Throw unless the interface versions are those required by this MMCore
+   static void CheckInterfaceVersion(long moduleInterfaceVersion,
+         long deviceInterfaceVersion);
+
    // The "module lock", used to synchronize _most_ access to the device
    // adapter.
-   MMThreadLock* GetLock();
+   mm::DeviceModuleLock& GetLock();
 
    std::vector<std::string> GetAvailableDeviceNames() const;
    std::string GetDeviceDescription(const std::string& deviceName) const;
@@ -98,6 +103,6 @@ private:
    void CheckInterfaceVersion() const;
 
    const std::string name_;
-   MMThreadLock lock_;
+   mm::DeviceModuleLock lock_;
    std::unique_ptr<LoadedDeviceAdapterImpl> impl_;
 };
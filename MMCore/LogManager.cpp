@@ -1,6 +1,7 @@
 #include "LogManager.h"
 
 #include "CoreUtils.h"
+#include "Logging/BinaryLogSink.h"
 #include "Error.h"
 
 #include <memory>
@@ -28,6 +29,14 @@ const char* StringForLogLevel(logging::LogLevel level)
    }
 }
 
+std::shared_ptr<logging::LogSink>
+NewFileSink(const std::string& filename, bool append, bool binary)
+{
+   if (binary)
+      return std::make_shared<logging::BinaryFileLogSink>(filename, append);
+   return std::make_shared<logging::FileLogSink>(filename, append);
+}
+
 } // anonymous namespace
 
 const logging::SinkMode LogManager::PrimarySinkMode = logging::SinkModeAsynchronous;
@@ -37,6 +46,7 @@ LogManager::LogManager() :
    internalLogger_(loggingCore_->NewLogger("LogManager")),
    primaryLogLevel_(logging::LogLevelInfo),
    usingStdErr_(false),
+   primaryBinary_(false),
    nextSecondaryHandle_(0)
 {}
 
@@ -80,14 +90,17 @@ LogManager::IsUsingStdErr() const
 
 
 void
-LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
+LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate,
+      bool binary)
 {
    std::lock_guard<std::mutex> lock(mutex_);
 
-   if (filename == primaryFilename_)
+   if (filename == primaryFilename_ &&
+         (filename.empty() || binary == primaryBinary_))
       return;
 
    primaryFilename_ = filename;
+   primaryBinary_ = binary;
 
    if (primaryFilename_.empty())
    {
@@ -103,7 +116,7 @@ LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
    std::shared_ptr<logging::LogSink> newSink;
    try
    {
-      newSink = std::make_shared<logging::FileLogSink>(primaryFilename_, !truncate);
+      newSink = NewFileSink(primaryFilename_, !truncate, binary);
    }
    catch (const logging::CannotOpenFileException&)
    {
@@ -219,14 +232,15 @@ LogManager::GetPrimaryLogLevel() const
 
 LogManager::LogFileHandle
 LogManager::AddSecondaryLogFile(logging::LogLevel level,
-      const std::string& filename, bool truncate, logging::SinkMode mode)
+      const std::string& filename, bool truncate, logging::SinkMode mode,
+      bool binary)
 {
    std::lock_guard<std::mutex> lock(mutex_);
 
    std::shared_ptr<logging::LogSink> sink;
    try
    {
-      sink = std::make_shared<logging::FileLogSink>(filename, !truncate);
+      sink = NewFileSink(filename, !truncate, binary);
    }
    catch (const logging::CannotOpenFileException&)
    {
@@ -271,6 +285,48 @@ LogManager::RemoveSecondaryLogFile(LogManager::LogFileHandle handle)
 }
 
 
+void
+LogManager::SetAsyncFlushInterval(std::chrono::milliseconds interval)
+{
+   loggingCore_->SetAsyncFlushInterval(interval);
+}
+
+
+std::chrono::milliseconds
+LogManager::GetAsyncFlushInterval() const
+{
+   return loggingCore_->GetAsyncFlushInterval();
+}
+
+
+void
+LogManager::SetAsyncBatchSize(std::size_t packets)
+{
+   loggingCore_->SetAsyncBatchSize(packets);
+}
+
+
+std::size_t
+LogManager::GetAsyncBatchSize() const
+{
+   return loggingCore_->GetAsyncBatchSize();
+}
+
+
+logging::PacketQueueStatistics
+LogManager::GetAsyncQueueStatistics() const
+{
+   return loggingCore_->GetAsyncQueueStatistics();
+}
+
+
+void
+LogManager::ResetAsyncQueueStatistics()
+{
+   loggingCore_->ResetAsyncQueueStatistics();
+}
+
+
 logging::Logger
 LogManager::NewLogger(const std::string& label)
 {
@@ -2,6 +2,8 @@
 
 #include "Logging/Logging.h"
 
+#include <chrono>
+#include <cstddef>
 #include <map>
 #include <mutex>
 #include <string>
@@ -29,6 +31,7 @@ private:
    std::shared_ptr<logging::LogSink> stdErrSink_;
 
    std::string primaryFilename_;
+   bool primaryBinary_;
    std::shared_ptr<logging::LogSink> primaryFileSink_;
 
    LogFileHandle nextSecondaryHandle_;
@@ -56,7 +59,10 @@ public:
    void SetUseStdErr(bool flag);
    bool IsUsingStdErr() const;
 
-   void SetPrimaryLogFilename(const std::string& filename, bool truncate);
+   // With binary set, the file is written in the compact binary format of
+   // logging::BinaryFileLogSink
+   void SetPrimaryLogFilename(const std::string& filename, bool truncate,
+         bool binary = false);
    std::string GetPrimaryLogFilename() const;
    bool IsUsingPrimaryLogFile() const;
 
@@ -65,11 +71,20 @@ public:
 
    LogFileHandle AddSecondaryLogFile(logging::LogLevel level,
          const std::string& filename, bool truncate = true,
-         logging::SinkMode mode = logging::SinkModeAsynchronous);
+         logging::SinkMode mode = logging::SinkModeAsynchronous,
+         bool binary = false);
    void RemoveSecondaryLogFile(LogFileHandle handle);
    // We could add an atomic SwapSecondaryLogFile(handle, filename, truncate),
    // nice for log rotation, but we don't need it now.
 
+   // Tuning and health of the queue feeding the asynchronous sinks
+   void SetAsyncFlushInterval(std::chrono::milliseconds interval);
+   std::chrono::milliseconds GetAsyncFlushInterval() const;
+   void SetAsyncBatchSize(std::size_t packets);
+   std::size_t GetAsyncBatchSize() const;
+   logging::PacketQueueStatistics GetAsyncQueueStatistics() const;
+   void ResetAsyncQueueStatistics();
+
    logging::Logger NewLogger(const std::string& label);
 };
 
@@ -0,0 +1,342 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryLogDecoder.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Rendering of binary log files in the text log format.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "BinaryLogDecoder.h"
+
+#include "BinaryLogFormat.h"
+#include "Metadata.h"
+#include "MetadataFormatter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+
+namespace mm
+{
+namespace logging
+{
+
+namespace
+{
+
+// Buffered reading of records
+class RecordReader
+{
+   std::istream& in_;
+   std::vector<char> buf_;
+   std::size_t pos_;
+   std::size_t size_;
+
+public:
+   explicit RecordReader(std::istream& in) :
+      in_(in), buf_(1 << 16), pos_(0), size_(0)
+   {}
+
+   bool AtEnd()
+   { return pos_ == size_ && !Fill(); }
+
+   bool ReadByte(unsigned char& byte)
+   {
+      if (pos_ == size_ && !Fill())
+         return false;
+      byte = static_cast<unsigned char>(buf_[pos_++]);
+      return true;
+   }
+
+   bool ReadVarint(std::uint64_t& value)
+   {
+      value = 0;
+      for (int shift = 0; shift < 64; shift += 7)
+      {
+         unsigned char byte;
+         if (!ReadByte(byte))
+            return false;
+         value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+         if (!(byte & 0x80))
+            return true;
+      }
+      return false;
+   }
+
+   bool ReadSignedVarint(std::int64_t& value)
+   {
+      std::uint64_t v;
+      if (!ReadVarint(v))
+         return false;
+      value = internal::ZigzagDecode(v);
+      return true;
+   }
+
+   bool ReadBytes(char* dest, std::size_t count)
+   {
+      while (count > 0)
+      {
+         if (pos_ == size_ && !Fill())
+            return false;
+         const std::size_t n = (std::min)(count, size_ - pos_);
+         std::memcpy(dest, &buf_[pos_], n);
+         pos_ += n;
+         dest += n;
+         count -= n;
+      }
+      return true;
+   }
+
+   bool ReadText(std::string& text)
+   {
+      std::uint64_t len;
+      if (!ReadVarint(len) || len > (1u << 24))
+         return false;
+      text.resize(static_cast<std::size_t>(len));
+      return len == 0 || ReadBytes(&text[0], text.size());
+   }
+
+private:
+   bool Fill()
+   {
+      in_.read(buf_.data(), buf_.size());
+      size_ = static_cast<std::size_t>(in_.gcount());
+      pos_ = 0;
+      return size_ > 0;
+   }
+};
+
+
+bool
+MatchesDevice(const std::string& label,
+      const std::vector<std::string>& devices)
+{
+   if (devices.empty())
+      return true;
+   for (const std::string& device : devices)
+   {
+      if (label == device || label == "dev:" + device ||
+            label == "Core:dev:" + device)
+         return true;
+   }
+   return false;
+}
+
+} // anonymous namespace
+
+
+bool
+DecodeBinaryLog(std::istream& in, std::ostream& out,
+      const BinaryLogDecoderOptions& options, std::string& errorMessage)
+{
+   using namespace std::chrono;
+
+   RecordReader reader(in);
+   if (reader.AtEnd())
+      return true; // Nothing logged yet
+
+   struct Label
+   {
+      std::string text;
+      bool included;
+   };
+   std::unordered_map<std::uint64_t, Label> labels;
+   std::int64_t clockSystemMicros = 0;
+   bool haveClock = false;
+
+   std::string text;
+   std::string prefix;
+   std::size_t openBracketCol = 0;
+   std::size_t closeBracketCol = 0;
+   bool includingEntry = false;
+   bool beforeFirst = true;
+
+   // Close the last output line also when stopping at an error
+   auto fail = [&](const std::string& message) {
+      if (!beforeFirst)
+         out << '\n';
+      errorMessage = message;
+      return false;
+   };
+   const char* truncated = "Binary log is truncated or corrupt";
+   bool first = true;
+   while (!reader.AtEnd())
+   {
+      unsigned char type;
+      reader.ReadByte(type);
+      if (first && type != internal::BinaryLogRecordSession)
+         return fail("Not a binary log file");
+      first = false;
+
+      switch (type)
+      {
+         case internal::BinaryLogRecordSession:
+         {
+            char magic[sizeof(internal::BinaryLogMagic)];
+            magic[0] = static_cast<char>(type);
+            unsigned char version;
+            if (!reader.ReadBytes(magic + 1, sizeof(magic) - 1) ||
+                  !reader.ReadByte(version))
+               return fail(truncated);
+            if (std::memcmp(magic, internal::BinaryLogMagic, sizeof(magic)))
+               return fail("Not a binary log file");
+            if (version != internal::BinaryLogVersion)
+               return fail("Unsupported binary log version " +
+                  std::to_string(version));
+            labels.clear();
+            haveClock = false;
+            includingEntry = false;
+            break;
+         }
+
+         case internal::BinaryLogRecordClock:
+         {
+            std::int64_t steadyMicros;
+            if (!reader.ReadSignedVarint(clockSystemMicros) ||
+                  !reader.ReadSignedVarint(steadyMicros))
+               return fail(truncated);
+            haveClock = true;
+            break;
+         }
+
+         case internal::BinaryLogRecordLabel:
+         {
+            std::uint64_t id;
+            Label label;
+            if (!reader.ReadVarint(id) || !reader.ReadText(label.text))
+               return fail(truncated);
+            label.included = MatchesDevice(label.text, options.devices);
+            labels[id] = label;
+            break;
+         }
+
+         case internal::BinaryLogRecordEntry:
+         {
+            std::uint64_t labelId, tid;
+            unsigned char level;
+            std::int64_t offsetMicros;
+            if (!reader.ReadVarint(labelId) || !reader.ReadByte(level) ||
+                  !reader.ReadVarint(tid) ||
+                  !reader.ReadSignedVarint(offsetMicros) ||
+                  !reader.ReadText(text))
+               return fail(truncated);
+            auto label = labels.find(labelId);
+            if (label == labels.end() || !haveClock)
+               return fail(truncated);
+
+            const system_clock::time_point timestamp(
+                  duration_cast<system_clock::duration>(
+                     microseconds(clockSystemMicros + offsetMicros)));
+            includingEntry = label->second.included &&
+               !(options.hasBegin && timestamp < options.begin) &&
+               !(options.hasEnd && timestamp > options.end);
+            if (!includingEntry)
+               break;
+
+            // Same layout as MetadataFormatter
+            prefix = internal::FormatLocalTime(timestamp);
+            prefix += " tid";
+            prefix += std::to_string(tid);
+            prefix += ' ';
+            openBracketCol = prefix.size();
+            prefix += '[';
+            prefix += internal::LevelString(static_cast<LogLevel>(level));
+            prefix += ',';
+            prefix += label->second.text;
+            closeBracketCol = prefix.size();
+            prefix += ']';
+
+            if (!beforeFirst)
+               out << '\n';
+            out << prefix << ' ' << text;
+            beforeFirst = false;
+            break;
+         }
+
+         case internal::BinaryLogRecordNewLine:
+         case internal::BinaryLogRecordLineContinuation:
+         {
+            if (!reader.ReadText(text))
+               return fail(truncated);
+            if (!includingEntry)
+               break;
+            if (type == internal::BinaryLogRecordNewLine)
+            {
+               prefix.assign(closeBracketCol + 1, ' ');
+               prefix[openBracketCol] = '[';
+               prefix[closeBracketCol] = ']';
+               out << '\n' << prefix << ' ';
+            }
+            out << text;
+            break;
+         }
+
+         default:
+            return fail("Unknown record type " + std::to_string(type) +
+               " in binary log");
+      }
+   }
+
+   if (!beforeFirst)
+      out << '\n';
+   return true;
+}
+
+
+bool
+ParseLogTimestamp(const std::string& str,
+      std::chrono::system_clock::time_point& result)
+{
+   int year, month, day, hour, minute, second;
+   int consumed = 0;
+   if (std::sscanf(str.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n",
+            &year, &month, &day, &hour, &minute, &second, &consumed) != 6)
+      return false;
+
+   long micros = 0;
+   const char* frac = str.c_str() + consumed;
+   if (*frac == '.')
+   {
+      long scale = 100000;
+      for (++frac; *frac >= '0' && *frac <= '9'; ++frac)
+      {
+         micros += (*frac - '0') * scale;
+         scale /= 10;
+      }
+   }
+   if (*frac != '\0')
+      return false;
+
+   std::tm tm = std::tm();
+   tm.tm_year = year - 1900;
+   tm.tm_mon = month - 1;
+   tm.tm_mday = day;
+   tm.tm_hour = hour;
+   tm.tm_min = minute;
+   tm.tm_sec = second;
+   tm.tm_isdst = -1;
+   const std::time_t t = std::mktime(&tm);
+   if (t == static_cast<std::time_t>(-1))
+      return false;
+
+   result = std::chrono::system_clock::from_time_t(t) +
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(micros));
+   return true;
+}
+
+} // namespace logging
+} // namespace mm
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryLogDecoder.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Rendering of binary log files in the text log format.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mm
+{
+namespace logging
+{
+
+struct BinaryLogDecoderOptions
+{
+   // Device labels whose entries to include (both the device's own entries
+   // and the core's entries about the device); all entries if empty
+   std::vector<std::string> devices;
+
+   // Inclusive time range of entries to include
+   bool hasBegin;
+   std::chrono::system_clock::time_point begin;
+   bool hasEnd;
+   std::chrono::system_clock::time_point end;
+
+   BinaryLogDecoderOptions() : hasBegin(false), hasEnd(false) {}
+};
+
+/**
+ * Write the entries of a binary log file (see BinaryFileLogSink) to out in
+ * the text format of FileLogSink.
+ *
+ * Returns false, with a description in errorMessage, if the input is not a
+ * binary log or is truncated; entries decoded up to that point are written.
+ */
+bool DecodeBinaryLog(std::istream& in, std::ostream& out,
+      const BinaryLogDecoderOptions& options, std::string& errorMessage);
+
+/**
+ * Parse a local time in the format used in log files ("2024-01-31T13:45:00",
+ * optionally followed by a fraction of a second).
+ */
+bool ParseLogTimestamp(const std::string& str,
+      std::chrono::system_clock::time_point& result);
+
+} // namespace logging
+} // namespace mm
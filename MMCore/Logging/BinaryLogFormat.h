@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryLogFormat.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Record layout of binary log files.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mm
+{
+namespace logging
+{
+namespace internal
+{
+
+// A binary log file is a sequence of records, each starting with a record
+// type byte. Integers are unsigned LEB128 varints unless noted; signed values
+// are zigzag-encoded varints; text is a varint byte count followed by the
+// bytes (without terminator).
+//
+// Session (written each time the file is opened, so that appending works):
+//    BinaryLogMagic (8 bytes, the first being BinaryLogRecordSession),
+//    format version (1 byte)
+// Clock (after each session record and periodically thereafter):
+//    system clock time (signed, microseconds since the Unix epoch),
+//    steady clock time (signed, microseconds)
+// Label (before the first entry using a logger label, per session):
+//    label id, label text
+// Entry (first line of a log entry):
+//    label id, log level (1 byte), thread id, steady clock time (signed,
+//    microseconds since that of the last clock record), line text
+// NewLine (subsequent line of the previous entry):
+//    line text
+// LineContinuation (continuation of an over-long line):
+//    line text
+//
+// Records correspond one-to-one to logging::internal::GenericLinePacket, so
+// the text log format can be reproduced exactly, save for the timestamp,
+// which is derived from the steady clock time and the last clock record.
+
+const char BinaryLogMagic[8] = { '\x89', 'M', 'M', 'L', 'O', 'G', '\r', '\n' };
+const unsigned char BinaryLogVersion = 1;
+
+enum BinaryLogRecordType
+{
+   BinaryLogRecordClock = 0x01,
+   BinaryLogRecordLabel = 0x02,
+   BinaryLogRecordEntry = 0x03,
+   BinaryLogRecordNewLine = 0x04,
+   BinaryLogRecordLineContinuation = 0x05,
+   BinaryLogRecordSession = 0x89,
+};
+
+
+inline void
+AppendVarint(std::string& buf, std::uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      buf += static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+   }
+   buf += static_cast<char>(value);
+}
+
+
+inline void
+AppendSignedVarint(std::string& buf, std::int64_t value)
+{
+   AppendVarint(buf, (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63));
+}
+
+
+inline std::int64_t
+ZigzagDecode(std::uint64_t value)
+{
+   return static_cast<std::int64_t>(value >> 1) ^
+      -static_cast<std::int64_t>(value & 1);
+}
+
+
+inline void
+AppendText(std::string& buf, const char* text, std::size_t len)
+{
+   AppendVarint(buf, len);
+   buf.append(text, len);
+}
+
+} // namespace internal
+} // namespace logging
+} // namespace mm
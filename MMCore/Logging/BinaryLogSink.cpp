@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryLogSink.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Log sink writing compact binary records instead of text.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "BinaryLogSink.h"
+
+#include "BinaryLogFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace mm
+{
+namespace logging
+{
+
+namespace
+{
+
+// Interval at which the relation between the steady clock and wall-clock
+// time is recorded again, so that clock adjustments are picked up
+const std::chrono::seconds ClockRecordInterval(60);
+
+std::int64_t
+Microseconds(std::chrono::system_clock::time_point tp)
+{
+   using namespace std::chrono;
+   return duration_cast<microseconds>(tp.time_since_epoch()).count();
+}
+
+std::int64_t
+Microseconds(std::chrono::steady_clock::time_point tp)
+{
+   using namespace std::chrono;
+   return duration_cast<microseconds>(tp.time_since_epoch()).count();
+}
+
+std::uint64_t
+ThreadIdAsInteger(internal::ThreadIdType tid)
+{
+   // pthread_t may be a pointer or an integer
+   std::uint64_t value = 0;
+   std::memcpy(&value, &tid, (std::min)(sizeof(tid), sizeof(value)));
+   return value;
+}
+
+} // anonymous namespace
+
+
+BinaryFileLogSink::BinaryFileLogSink(const std::string& filename,
+      bool append) :
+   filename_(filename),
+   hadError_(false)
+{
+   std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary;
+   mode |= (append ? std::ios_base::app : std::ios_base::trunc);
+
+   fileStream_.open(filename_.c_str(), mode);
+   if (!fileStream_)
+      throw CannotOpenFileException();
+
+   // Label ids are per session, so that appending to an existing file works
+   buf_.assign(internal::BinaryLogMagic, sizeof(internal::BinaryLogMagic));
+   buf_ += static_cast<char>(internal::BinaryLogVersion);
+   AppendClockRecord();
+}
+
+
+void
+BinaryFileLogSink::AppendClockRecord()
+{
+   clockRecordTime_ = internal::SteadyNow();
+   buf_ += static_cast<char>(internal::BinaryLogRecordClock);
+   internal::AppendSignedVarint(buf_, Microseconds(internal::Now()));
+   internal::AppendSignedVarint(buf_, Microseconds(clockRecordTime_));
+}
+
+
+void
+BinaryFileLogSink::Consume(const PacketArrayType& packets)
+{
+   if (internal::SteadyNow() - clockRecordTime_ >= ClockRecordInterval)
+      AppendClockRecord();
+   const std::int64_t clockMicros = Microseconds(clockRecordTime_);
+
+   std::shared_ptr<EntryFilter> filter = GetFilter();
+   for (PacketArrayType::ConstIteratorType it = packets.Begin(),
+         end = packets.End(); it != end; ++it)
+   {
+      const Metadata& metadata = it->GetMetadataConstRef();
+      if (filter && !filter->Filter(metadata))
+         continue;
+
+      const char* text = it->GetText();
+      switch (it->GetPacketState())
+      {
+         case internal::PacketStateEntryFirstLine:
+         {
+            const char* label = metadata.GetLoggerData().GetComponentLabel();
+            auto found = labelIds_.find(label);
+            if (found == labelIds_.end())
+            {
+               const std::uint32_t id =
+                  static_cast<std::uint32_t>(labelIds_.size());
+               found = labelIds_.emplace(label, id).first;
+               buf_ += static_cast<char>(internal::BinaryLogRecordLabel);
+               internal::AppendVarint(buf_, id);
+               internal::AppendText(buf_, label, std::strlen(label));
+            }
+
+            const StampData stamp = metadata.GetStampData();
+            buf_ += static_cast<char>(internal::BinaryLogRecordEntry);
+            internal::AppendVarint(buf_, found->second);
+            buf_ += static_cast<char>(metadata.GetEntryData().GetLevel());
+            internal::AppendVarint(buf_,
+                  ThreadIdAsInteger(stamp.GetThreadId()));
+            internal::AppendSignedVarint(buf_,
+                  Microseconds(stamp.GetSteadyTimestamp()) - clockMicros);
+            break;
+         }
+         case internal::PacketStateNewLine:
+            buf_ += static_cast<char>(internal::BinaryLogRecordNewLine);
+            break;
+         case internal::PacketStateLineContinuation:
+            buf_ += static_cast<char>(
+                  internal::BinaryLogRecordLineContinuation);
+            break;
+      }
+      internal::AppendText(buf_, text, std::strlen(text));
+   }
+
+   try
+   {
+      fileStream_.write(buf_.data(), buf_.size());
+      fileStream_.flush();
+   }
+   catch (const std::ios_base::failure& e)
+   {
+      if (!hadError_)
+      {
+         hadError_ = true;
+         std::cerr << "Logging: cannot write to file " << filename_ <<
+            ": " << e.what() << '\n';
+      }
+   }
+   buf_.clear();
+}
+
+} // namespace logging
+} // namespace mm
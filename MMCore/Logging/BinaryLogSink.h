@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryLogSink.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Log sink writing compact binary records instead of text.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Logging.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+namespace mm
+{
+namespace logging
+{
+
+/**
+ * File sink writing binary records (see BinaryLogFormat.h).
+ *
+ * Unlike FileLogSink, no formatting is done on the logging thread: entries
+ * are written as a steady clock timestamp, interned label id, level, thread
+ * id, and the raw line text. Use DecodeBinaryLog() (or the mmlogdecode tool)
+ * to render the file in the usual text format.
+ */
+class BinaryFileLogSink : public LogSink
+{
+   std::string filename_;
+   std::ofstream fileStream_;
+   bool hadError_;
+
+   std::unordered_map<const char*, std::uint32_t> labelIds_;
+   std::chrono::steady_clock::time_point clockRecordTime_;
+   std::string buf_; // Reused across batches
+
+public:
+   BinaryFileLogSink(const BinaryFileLogSink&) = delete;
+   BinaryFileLogSink& operator=(const BinaryFileLogSink&) = delete;
+
+   // Throws CannotOpenFileException
+   BinaryFileLogSink(const std::string& filename, bool append = false);
+
+   virtual void Consume(const PacketArrayType& packets);
+
+private:
+   void AppendClockRecord();
+};
+
+} // namespace logging
+} // namespace mm
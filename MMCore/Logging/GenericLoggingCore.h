@@ -23,6 +23,8 @@
 #include "GenericSink.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -66,6 +68,9 @@ private:
 
    std::mutex syncSinksMutex_; // Protect all access to synchronousSinks_
    std::vector< std::shared_ptr<SinkType> > synchronousSinks_;
+   // Size of synchronousSinks_, so that logging skips syncSinksMutex_ when
+   // there are no synchronous sinks
+   std::atomic<std::size_t> synchronousSinkCount_;
 
    std::mutex asyncQueueMutex_; // Protect start/stop and sinks change
    internal::GenericPacketQueue<TMetadata> asyncQueue_;
@@ -74,7 +79,8 @@ private:
    std::vector< std::shared_ptr<SinkType> > asynchronousSinks_;
 
 public:
-   GenericLoggingCore() { StartAsyncReceiveLoop(); }
+   GenericLoggingCore() : synchronousSinkCount_(0)
+   { StartAsyncReceiveLoop(); }
    ~GenericLoggingCore() { StopAsyncReceiveLoop(); }
 
    /**
@@ -102,6 +108,7 @@ public:
          {
             std::lock_guard<std::mutex> lock(syncSinksMutex_);
             synchronousSinks_.push_back(sink);
+            synchronousSinkCount_ = synchronousSinks_.size();
             break;
          }
          case SinkModeAsynchronous:
@@ -133,6 +140,7 @@ public:
                      sink);
             if (it != synchronousSinks_.end())
                synchronousSinks_.erase(it);
+            synchronousSinkCount_ = synchronousSinks_.size();
             break;
          }
          case SinkModeAsynchronous:
@@ -206,6 +214,7 @@ public:
                break;
          }
       }
+      synchronousSinkCount_ = synchronousSinks_.size();
 
       StartAsyncReceiveLoop();
    }
@@ -254,6 +263,33 @@ public:
       StartAsyncReceiveLoop();
    }
 
+   /**
+    * Set the interval at which the asynchronous sinks are run while entries
+    * are being logged.
+    */
+   void SetAsyncFlushInterval(std::chrono::milliseconds interval)
+   { asyncQueue_.SetFlushInterval(interval); }
+   std::chrono::milliseconds GetAsyncFlushInterval() const
+   { return asyncQueue_.GetFlushInterval(); }
+
+   /**
+    * Set the number of queued packets (lines) at which the asynchronous sinks
+    * are run without waiting for the flush interval.
+    */
+   void SetAsyncBatchSize(std::size_t packets)
+   { asyncQueue_.SetBatchSize(packets); }
+   std::size_t GetAsyncBatchSize() const
+   { return asyncQueue_.GetBatchSize(); }
+
+   /**
+    * Get the counts of entries that overflowed the asynchronous queue or had
+    * to be dropped.
+    */
+   PacketQueueStatistics GetAsyncQueueStatistics() const
+   { return asyncQueue_.GetStatistics(); }
+   void ResetAsyncQueueStatistics()
+   { asyncQueue_.ResetStatistics(); }
+
 private:
    // Static wrapper allowing the use of a shared_ptr for the target instance
    static void
@@ -268,9 +304,13 @@ private:
       StampDataType stampData;
       stampData.Stamp();
 
-      PacketArrayType packets;
+      // Reuse the packet storage of the calling thread, so that logging does
+      // not allocate in the steady state
+      static thread_local PacketArrayType packets;
+      packets.Clear();
       packets.AppendEntry(loggerData, entryData, stampData, entryText);
 
+      if (synchronousSinkCount_.load(std::memory_order_acquire) > 0)
       {
          std::lock_guard<std::mutex> lock(syncSinksMutex_);
 
@@ -16,11 +16,19 @@
 
 #pragma once
 
+#include "GenericPacketArray.h"
+
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
+#include <type_traits>
 
 
 namespace mm
@@ -30,38 +38,202 @@ namespace logging
 namespace internal
 {
 
+/**
+ * Counters describing the health of the asynchronous log queue
+ */
+struct PacketQueueStatistics
+{
+   // Entries that did not fit in the ring and went through the (locked)
+   // overflow array instead
+   unsigned long long overflowedEntries;
+   // Entries discarded because the overflow array was also full
+   unsigned long long droppedEntries;
+};
+
+
+/**
+ * Multi-producer, single-consumer queue for asynchronous sinks
+ *
+ * Packets are stored in a fixed-size ring of preallocated slots, so that
+ * sending an entry does not take a lock or allocate memory. Each slot carries
+ * a sequence number (after D. Vyukov's bounded MPMC queue): a producer claims
+ * all the slots for an entry with a single compare-and-swap, so that the
+ * packets of an entry stay contiguous (required for splicing line
+ * continuations), and publishes them by updating the sequence numbers.
+ *
+ * When the ring is full (or an entry has more packets than the ring has
+ * slots), entries are appended to a mutex-protected overflow array instead,
+ * until the receive loop has drained it. Only when the overflow array also
+ * reaches its limit are entries dropped.
+ */
 template <typename TMetadata>
 class GenericPacketQueue
 {
    typedef GenericPacketArray<TMetadata> PacketArrayType;
+   typedef GenericLinePacket<TMetadata> LinePacketType;
+
+public:
+   static const std::size_t DefaultCapacity = 4096; // Packets; power of 2
+   static const std::size_t OverflowCapacityFactor = 16;
+   static const std::size_t DefaultBatchSize = 1024; // Packets
+   static const int DefaultFlushIntervalMs = 10;
 
 private:
-   // The "queue" for asynchronous sinks.
+   struct Slot
+   {
+      std::atomic<std::size_t> sequence;
+      typename std::aligned_storage<sizeof(LinePacketType),
+               alignof(LinePacketType)>::type storage;
+
+      LinePacketType* Packet()
+      { return reinterpret_cast<LinePacketType*>(&storage); }
+   };
+
+   const std::size_t capacity_;
+   const std::size_t mask_;
+   std::unique_ptr<Slot[]> slots_;
+
+   std::atomic<std::size_t> enqueuePos_;
+   std::atomic<std::size_t> dequeuePos_; // Written by receiving thread only
+
+   std::mutex overflowMutex_;
+   PacketArrayType overflow_; // Protected by overflowMutex_
+   std::size_t overflowPackets_; // Protected by overflowMutex_
+   // Set while overflow_ is non-empty; producers then append to overflow_ so
+   // that entries stay in order
+   std::atomic<bool> overflowing_;
+
+   std::atomic<unsigned long long> overflowedEntries_;
+   std::atomic<unsigned long long> droppedEntries_;
+
+   std::atomic<std::size_t> batchSize_;
+   std::atomic<int> flushIntervalMs_;
+
+   // Wakeup of the receiving thread
    std::mutex mutex_;
    std::condition_variable condVar_;
-   PacketArrayType queue_;
+   bool wakeRequested_; // Protected by mutex_
+   bool shutdownRequested_; // Protected by mutex_
+   // Set while the receiving thread waits without timeout
+   std::atomic<bool> consumerIdle_;
+   // Set once a producer has notified about a full batch
+   std::atomic<bool> batchWakeSent_;
 
-   // Swapped with queue_ and accessed from receiving thread.
+   // Accessed from receiving thread.
    PacketArrayType received_;
 
-   bool shutdownRequested_; // Protected by mutex_
-
    // threadMutex_ protects the start/stop of loopThread_; it must be acquired
    // before mutex_.
    std::mutex threadMutex_;
    std::thread loopThread_; // Protected by threadMutex_
 
 public:
-   GenericPacketQueue() :
-      shutdownRequested_(false)
-   {}
+   explicit GenericPacketQueue(std::size_t capacity = DefaultCapacity) :
+      capacity_(RoundUpToPowerOf2(capacity)),
+      mask_(capacity_ - 1),
+      slots_(new Slot[capacity_]),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      overflowPackets_(0),
+      overflowing_(false),
+      overflowedEntries_(0),
+      droppedEntries_(0),
+      batchSize_(DefaultBatchSize),
+      flushIntervalMs_(DefaultFlushIntervalMs),
+      wakeRequested_(false),
+      shutdownRequested_(false),
+      consumerIdle_(false),
+      batchWakeSent_(false)
+   {
+      for (std::size_t i = 0; i < capacity_; ++i)
+         slots_[i].sequence.store(i, std::memory_order_relaxed);
+   }
+
+   ~GenericPacketQueue()
+   {
+      // Destroy packets that were never received
+      std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+      for (;;)
+      {
+         Slot& slot = slots_[pos & mask_];
+         if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            break;
+         slot.Packet()->~LinePacketType();
+         ++pos;
+      }
+   }
+
+   GenericPacketQueue(const GenericPacketQueue&) = delete;
+   GenericPacketQueue& operator=(const GenericPacketQueue&) = delete;
 
+   std::size_t GetCapacity() const { return capacity_; }
+
+   // Maximum time the receiving thread waits to accumulate packets
+   void SetFlushInterval(std::chrono::milliseconds interval)
+   {
+      flushIntervalMs_.store(static_cast<int>(interval.count() < 0 ? 0 :
+               interval.count()));
+   }
+   std::chrono::milliseconds GetFlushInterval() const
+   { return std::chrono::milliseconds(flushIntervalMs_.load()); }
+
+   // Number of pending packets at which the receiving thread is woken before
+   // the flush interval has elapsed; also the (approximate) maximum number of
+   // packets handed to the sinks at once
+   void SetBatchSize(std::size_t packets)
+   { batchSize_.store(packets > 0 ? packets : 1); }
+   std::size_t GetBatchSize() const { return batchSize_.load(); }
+
+   PacketQueueStatistics GetStatistics() const
+   {
+      PacketQueueStatistics stats;
+      stats.overflowedEntries = overflowedEntries_.load();
+      stats.droppedEntries = droppedEntries_.load();
+      return stats;
+   }
+
+   void ResetStatistics()
+   {
+      overflowedEntries_.store(0);
+      droppedEntries_.store(0);
+   }
+
+   // The packets [first, last) must form whole entries.
    template <typename TPacketIter>
    void SendPackets(TPacketIter first, TPacketIter last)
    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      queue_.Append(first, last);
-      condVar_.notify_one();
+      const std::size_t count = std::distance(first, last);
+      if (count == 0)
+         return;
+
+      if (!overflowing_.load(std::memory_order_acquire) &&
+            TryEnqueue(first, count))
+      {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         const std::size_t pending =
+            enqueuePos_.load(std::memory_order_relaxed) -
+            dequeuePos_.load(std::memory_order_relaxed);
+         if (consumerIdle_.load(std::memory_order_relaxed))
+            Wake();
+         else if (pending >= batchSize_.load(std::memory_order_relaxed) &&
+               !batchWakeSent_.exchange(true))
+            Wake();
+         return;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(overflowMutex_);
+         if (overflowPackets_ + count > OverflowCapacityFactor * capacity_)
+         {
+            droppedEntries_.fetch_add(1, std::memory_order_relaxed);
+            return;
+         }
+         overflow_.Append(first, last);
+         overflowPackets_ += count;
+         overflowing_.store(true, std::memory_order_release);
+      }
+      overflowedEntries_.fetch_add(1, std::memory_order_relaxed);
+      Wake();
    }
 
    void RunReceiveLoop(std::function<void (PacketArrayType&)>
@@ -106,16 +278,130 @@ public:
    }
 
 private:
-   void ReceiveLoop(std::function<void (PacketArrayType&)> consume)
+   static std::size_t RoundUpToPowerOf2(std::size_t n)
+   {
+      std::size_t p = 2;
+      while (p < n)
+         p <<= 1;
+      return p;
+   }
+
+   template <typename TPacketIter>
+   bool TryEnqueue(TPacketIter first, std::size_t count)
    {
-      using namespace std::chrono_literals;
+      if (count > capacity_)
+         return false;
+
+      std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+      for (;;)
+      {
+         // The claimed range is free once its last slot has been released
+         // by the receiving thread (slots are released in order).
+         Slot& last = slots_[(pos + count - 1) & mask_];
+         const std::size_t seq =
+            last.sequence.load(std::memory_order_acquire);
+         const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(
+               seq - (pos + count - 1));
+         if (diff == 0)
+         {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + count,
+                     std::memory_order_relaxed))
+               break;
+         }
+         else if (diff < 0)
+         {
+            return false; // Full
+         }
+         else
+         {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+         }
+      }
+
+      // Publish the first slot last, so that the receiving thread sees the
+      // entry as a whole.
+      for (std::size_t i = 0; i < count; ++i, ++first)
+         new (slots_[(pos + i) & mask_].Packet()) LinePacketType(*first);
+      for (std::size_t i = count; i-- > 0; )
+         slots_[(pos + i) & mask_].sequence.store(pos + i + 1,
+               std::memory_order_release);
+      return true;
+   }
+
+   void Wake()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wakeRequested_ = true;
+      condVar_.notify_one();
+   }
+
+   bool HasPending()
+   {
+      const std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+      return slots_[pos & mask_].sequence.load(std::memory_order_acquire) ==
+         pos + 1 || overflowing_.load(std::memory_order_acquire);
+   }
+
+   // Hand all pending packets to consume, in batches; return whether there
+   // were any
+   bool Drain(std::function<void (PacketArrayType&)>& consume)
+   {
+      bool drained = false;
+      const std::size_t batchSize = batchSize_.load(std::memory_order_relaxed);
+      for (;;)
+      {
+         std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+         for (std::size_t taken = 0; ; ++taken, ++pos)
+         {
+            Slot& slot = slots_[pos & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+               break;
+            LinePacketType* packet = slot.Packet();
+            // Split batches between lines only
+            if (taken >= batchSize &&
+                  packet->GetPacketState() != PacketStateLineContinuation)
+               break;
+            received_.Append(packet, packet + 1);
+            packet->~LinePacketType();
+            slot.sequence.store(pos + capacity_, std::memory_order_release);
+         }
+         dequeuePos_.store(pos, std::memory_order_relaxed);
 
+         if (received_.IsEmpty())
+            break;
+         consume(received_);
+         received_.Clear();
+         drained = true;
+      }
+
+      // Entries sent while overflowing come after everything in the ring
+      if (overflowing_.load(std::memory_order_acquire))
+      {
+         {
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            overflow_.Swap(received_);
+            overflowPackets_ = 0;
+            overflowing_.store(false, std::memory_order_release);
+         }
+         if (!received_.IsEmpty())
+         {
+            consume(received_);
+            received_.Clear();
+            drained = true;
+         }
+      }
+      batchWakeSent_.store(false);
+      return drained;
+   }
+
+   void ReceiveLoop(std::function<void (PacketArrayType&)> consume)
+   {
       // The loop operates in one of two modes: timed wait and untimed wait.
       //
-      // When in timed wait mode, the loop unconditionally waits for a fixed
-      // interval before checking for data. If data is available, it is
-      // processed and the loop repeats an unconditional wait. If no data is
-      // available, the loop switches to untimed wait mode.
+      // When in timed wait mode, the loop waits for the flush interval (or
+      // until a full batch is pending) before checking for data. If data is
+      // available, it is processed and the loop repeats the timed wait. If
+      // no data is available, the loop switches to untimed wait mode.
       //
       // In untimed wait mode, the loop waits on a condition variable until
       // notification from the frontend. Once data is available, the loop
@@ -123,62 +409,45 @@ private:
       //
       // This way, data is processed in batches when logging occurs at high
       // frequency, preventing thrashing between the frontend and backend
-      // threads and limiting the frequency of stream flushing.
+      // threads and limiting the frequency of stream flushing. Producers
+      // only take mutex_ to notify in untimed wait mode, when a batch is
+      // full, or when overflowing.
 
       bool timedWaitMode = true;
-      bool shuttingDown = false;
 
       for (;;)
       {
-         if (timedWaitMode)
+         bool shuttingDown = false;
          {
-            // TODO Make interval configurable
-            std::this_thread::sleep_for(10ms);
-
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (timedWaitMode)
             {
-               std::lock_guard<std::mutex> lock(mutex_);
-               if (shutdownRequested_)
-               {
-                  shutdownRequested_ = false; // Allow for restarting
-                  shuttingDown = true;
-               }
-               if (!shuttingDown && queue_.IsEmpty())
-               {
-                  timedWaitMode = false;
-                  continue;
-               }
-               queue_.Swap(received_);
+               condVar_.wait_for(lock,
+                     std::chrono::milliseconds(flushIntervalMs_.load()),
+                     [this] { return shutdownRequested_ || wakeRequested_; });
             }
-            consume(received_);
-            received_.Clear();
-
-            if (shuttingDown)
-               return;
-         }
-         else // untimed wait mode
-         {
+            else
             {
-               std::unique_lock<std::mutex> lock(mutex_);
-               while (queue_.IsEmpty())
-               {
+               consumerIdle_.store(true, std::memory_order_relaxed);
+               std::atomic_thread_fence(std::memory_order_seq_cst);
+               while (!shutdownRequested_ && !wakeRequested_ && !HasPending())
                   condVar_.wait(lock);
-                  if (shutdownRequested_)
-                  {
-                     shutdownRequested_ = false; // Allow for restarting
-                     shuttingDown = true;
-                     break;
-                  }
-               }
-               queue_.Swap(received_);
+               consumerIdle_.store(false, std::memory_order_relaxed);
             }
-            consume(received_);
-            received_.Clear();
+            wakeRequested_ = false;
+            if (shutdownRequested_)
+            {
+               shutdownRequested_ = false; // Allow for restarting
+               shuttingDown = true;
+            }
+         }
 
-            if (shuttingDown)
-               return;
+         const bool drained = Drain(consume);
 
-            timedWaitMode = true;
-         }
+         if (shuttingDown)
+            return;
+
+         timedWaitMode = drained;
       }
    }
 };
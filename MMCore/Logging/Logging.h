@@ -42,6 +42,7 @@ typedef internal::GenericFileLogSink<Metadata, internal::MetadataFormatter>
 
 
 typedef internal::GenericEntryFilter<Metadata> EntryFilter;
+typedef internal::PacketQueueStatistics PacketQueueStatistics;
 
 class LevelFilter : public EntryFilter
 {
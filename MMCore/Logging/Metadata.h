@@ -41,6 +41,10 @@ inline std::chrono::time_point<std::chrono::system_clock>
 Now()
 { return std::chrono::system_clock::now(); }
 
+inline std::chrono::time_point<std::chrono::steady_clock>
+SteadyNow()
+{ return std::chrono::steady_clock::now(); }
+
 
 #ifdef _WIN32
 typedef DWORD ThreadIdType;
@@ -84,17 +88,22 @@ public:
 class StampData
 {
    std::chrono::time_point<std::chrono::system_clock> time_;
+   std::chrono::time_point<std::chrono::steady_clock> steadyTime_;
    internal::ThreadIdType tid_;
 
 public:
    void Stamp()
    {
       time_ = internal::Now();
+      steadyTime_ = internal::SteadyNow();
       tid_ = internal::GetTid();
    }
 
    std::chrono::time_point<std::chrono::system_clock> GetTimestamp() const
    { return time_; }
+   // Monotonic time, for ordering entries and measuring intervals
+   std::chrono::time_point<std::chrono::steady_clock> GetSteadyTimestamp() const
+   { return steadyTime_; }
 
    internal::ThreadIdType GetThreadId() const { return tid_; }
 };
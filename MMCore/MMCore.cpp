@@ -45,11 +45,15 @@
 #include "CoreProperty.h"
 #include "CoreUtils.h"
 #include "DeviceManager.h"
+#include "DeviceModuleLock.h"
 #include "Devices/DeviceInstances.h"
+#include "ImageProcessingPipeline.h"
 #include "LogManager.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
+#include "MultiCameraBuffer.h"
 #include "PluginManager.h"
+#include "Tracing.h"
 
 #include "DeviceThreads.h"
 #include "DeviceUtils.h"
@@ -59,11 +63,13 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <deque>
 #include <fstream>
 #include <future>
 #include <map>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <thread>
@@ -104,7 +110,7 @@
  * (Keep the 3 numbers on one line to make it easier to look at diffs when
  * merging/rebasing.)
  */
-const int MMCore_versionMajor = 11, MMCore_versionMinor = 11, MMCore_versionPatch = 0;
+const int MMCore_versionMajor = 11, MMCore_versionMinor = 22, MMCore_versionPatch = 0;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -129,7 +135,6 @@ CMMCore::CMMCore() :
    properties_(0),
    externalCallback_(0),
    pixelSizeGroup_(0),
-   cbuf_(0),
    pluginManager_(new CPluginManager()),
    deviceManager_(new mm::DeviceManager())
 {
@@ -141,7 +146,7 @@ CMMCore::CMMCore() :
    callback_ = new CoreCallback(this);
 
    const unsigned seqBufMegabytes = (sizeof(void*) > 4) ? 250 : 25;
-   cbuf_ = new CircularBuffer(seqBufMegabytes);
+   cbuf_ = std::make_shared<CircularBuffer>(seqBufMegabytes);
 
    nullAffine_ = new std::vector<double>(6);
    for (int i = 0; i < 6; i++) {
@@ -182,7 +187,6 @@ CMMCore::~CMMCore()
    delete callback_;
    delete configGroups_;
    delete properties_;
-   delete cbuf_;
    delete pixelSizeGroup_;
 
    LOG_INFO(coreLogger_) << "Core session ended";
@@ -205,6 +209,15 @@ CMMCore::~CMMCore()
  *   multiple threads, one per device module.  Early testing shows this to be 
  *   reliable, but switch this off when issues are encountered during 
  *   device initialization.
+ * - "ParallelSystemState" (default: disabled) When enabled, getSystemState()
+ *   queries devices of different device modules concurrently, using one
+ *   thread per module. Do not enable this if devices from different modules
+ *   share a serial port without coordinating their access.
+ * - "ParallelConfigApplication" (default: disabled) When enabled, setConfig()
+ *   and setPixelSizeConfig() apply the settings of different device modules
+ *   concurrently, using one thread per module, keeping the order of settings
+ *   within each module. The same caution as for "ParallelSystemState"
+ *   applies.
  *
  * Permanently enabled features:
  * - None so far.
@@ -249,14 +262,18 @@ bool CMMCore::isFeatureEnabled(const char* name) MMCORE_LEGACY_THROW(CMMError)
  * @param filename The log filename. If empty or null, the primary log file is
  * disabled.
  * @param truncate Whether to truncate the log file if it already exists.
+ * @param binary If true, write compact binary records instead of text. Binary
+ * logs are smaller and cheaper to write; convert them to text with the
+ * mmlogdecode tool.
  */
-void CMMCore::setPrimaryLogFile(const char* filename, bool truncate) MMCORE_LEGACY_THROW(CMMError)
+void CMMCore::setPrimaryLogFile(const char* filename, bool truncate,
+      bool binary) MMCORE_LEGACY_THROW(CMMError)
 {
    std::string filenameStr;
    if (filename)
       filenameStr = filename;
 
-   logManager_->SetPrimaryLogFilename(filenameStr, truncate);
+   logManager_->SetPrimaryLogFilename(filenameStr, truncate, binary);
 }
 
 /**
@@ -333,10 +350,12 @@ bool CMMCore::stderrLogEnabled()
  * (logging calls will not return until the output is written to the file,
  * facilitating the debugging of crashes in some cases, but with a performance
  * cost).
+ * @param binary If true, write compact binary records instead of text (see
+ * setPrimaryLogFile()).
  * @returns A handle required when calling stopSecondaryLogFile().
  */
 int CMMCore::startSecondaryLogFile(const char* filename, bool enableDebug,
-      bool truncate, bool synchronous) MMCORE_LEGACY_THROW(CMMError)
+      bool truncate, bool synchronous, bool binary) MMCORE_LEGACY_THROW(CMMError)
 {
    if (!filename)
       throw CMMError("Filename is null");
@@ -347,7 +366,8 @@ int CMMCore::startSecondaryLogFile(const char* filename, bool enableDebug,
    LogFileHandle handle = logManager_->AddSecondaryLogFile(
             (enableDebug ? LogLevelTrace : LogLevelInfo),
             filename, truncate,
-            (synchronous ? SinkModeSynchronous : SinkModeAsynchronous));
+            (synchronous ? SinkModeSynchronous : SinkModeAsynchronous),
+            binary);
    return static_cast<int>(handle);
 }
 
@@ -364,6 +384,158 @@ void CMMCore::stopSecondaryLogFile(int handle) MMCORE_LEGACY_THROW(CMMError)
    logManager_->RemoveSecondaryLogFile(h);
 }
 
+/**
+ * Set the interval at which asynchronously written log files (the primary
+ * log file, stderr, and non-synchronous secondary log files) are written
+ * while messages are being logged.
+ *
+ * Longer intervals write in larger batches. The default is 10 ms.
+ *
+ * @param intervalMs The flush interval in milliseconds.
+ */
+void CMMCore::setLogFlushIntervalMs(int intervalMs) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (intervalMs < 0)
+      throw CMMError("Log flush interval must not be negative");
+   logManager_->SetAsyncFlushInterval(std::chrono::milliseconds(intervalMs));
+}
+
+/**
+ * Get the interval at which asynchronously written log files are written.
+ */
+int CMMCore::getLogFlushIntervalMs()
+{
+   return static_cast<int>(logManager_->GetAsyncFlushInterval().count());
+}
+
+/**
+ * Set the number of queued log lines at which asynchronously written log
+ * files are written without waiting for the flush interval.
+ *
+ * @param lines The batch size in lines (long lines count more than once).
+ */
+void CMMCore::setLogBatchSize(int lines) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (lines < 1)
+      throw CMMError("Log batch size must be positive");
+   logManager_->SetAsyncBatchSize(static_cast<std::size_t>(lines));
+}
+
+/**
+ * Get the number of queued log lines at which log files are written.
+ */
+int CMMCore::getLogBatchSize()
+{
+   return static_cast<int>(logManager_->GetAsyncBatchSize());
+}
+
+/**
+ * Get the number of log messages that did not fit in the lock-free log queue
+ * since startup or the last call to resetLogQueueStatistics().
+ *
+ * Such messages are still written, but logging them took a lock.
+ */
+long CMMCore::getLogOverflowedEntryCount()
+{
+   return static_cast<long>(
+         logManager_->GetAsyncQueueStatistics().overflowedEntries);
+}
+
+/**
+ * Get the number of log messages that were discarded because logging
+ * outpaced writing of the log files (since startup or the last call to
+ * resetLogQueueStatistics()).
+ */
+long CMMCore::getLogDroppedEntryCount()
+{
+   return static_cast<long>(
+         logManager_->GetAsyncQueueStatistics().droppedEntries);
+}
+
+/**
+ * Reset the counts returned by getLogOverflowedEntryCount() and
+ * getLogDroppedEntryCount().
+ */
+void CMMCore::resetLogQueueStatistics()
+{
+   logManager_->ResetAsyncQueueStatistics();
+}
+
+/**
+ * Start or stop recording timing spans of the core's internals.
+ *
+ * Spans are recorded for image insertion, device module lock waits and
+ * holds, waitForDevice(), setProperty() and applying configurations. Each
+ * thread keeps its most recent spans; retrieve them with getTraceJSON() or
+ * saveTrace().
+ *
+ * Throws if MMCore was built without tracing support (with
+ * MMCORE_DISABLE_TRACING defined) and enable is true.
+ */
+void CMMCore::enableTracing(bool enable) MMCORE_LEGACY_THROW(CMMError)
+{
+#ifndef MMCORE_DISABLE_TRACING
+   mm::trace::SetEnabled(enable);
+   LOG_DEBUG(coreLogger_) << "Tracing " << (enable ? "enabled" : "disabled");
+#else
+   if (enable)
+      throw CMMError("Tracing is not supported by this build of MMCore");
+#endif
+}
+
+/**
+ * Returns whether timing spans are being recorded.
+ */
+bool CMMCore::isTracingEnabled()
+{
+#ifndef MMCORE_DISABLE_TRACING
+   return mm::trace::IsEnabled();
+#else
+   return false;
+#endif
+}
+
+/**
+ * Discard the timing spans recorded so far.
+ */
+void CMMCore::clearTrace()
+{
+#ifndef MMCORE_DISABLE_TRACING
+   mm::trace::Clear();
+#endif
+}
+
+/**
+ * Returns the recorded timing spans in Chrome trace-event JSON format,
+ * which can be viewed with chrome://tracing or Perfetto.
+ */
+std::string CMMCore::getTraceJSON()
+{
+#ifndef MMCORE_DISABLE_TRACING
+   return mm::trace::ToChromeJSON();
+#else
+   return "{\"traceEvents\":[]}\n";
+#endif
+}
+
+/**
+ * Write the recorded timing spans to a file, in the format returned by
+ * getTraceJSON().
+ *
+ * @param filename The file to write; it is overwritten if it exists.
+ */
+void CMMCore::saveTrace(const char* filename) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (!filename)
+      throw CMMError("Filename is null");
+
+   std::ofstream os(filename);
+   if (!os.is_open())
+      throw CMMError(ToQuotedString(filename) + ": " +
+            getCoreErrorText(MMERR_FileOpenFailed), MMERR_FileOpenFailed);
+   os << getTraceJSON();
+}
+
 /**
  * Displays core version.
  */
@@ -386,13 +558,21 @@ int CMMCore::getMMCoreVersionPatch() { return MMCore_versionPatch; }
 
 /**
  * Get available devices from the specified device library.
+ *
+ * The library is not loaded if the device adapter cache (see
+ * setDeviceAdapterCacheFile()) is up to date for it.
  */
 std::vector<std::string>
 CMMCore::getAvailableDevices(const char* moduleName) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::shared_ptr<LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   return module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
+   const auto info = pluginManager_->GetDeviceAdapterInfo(moduleName);
+   std::vector<std::string> names;
+   names.reserve(info.devices.size());
+   for (const auto& device : info.devices)
+      names.push_back(device.name);
+   return names;
 }
 
 /**
@@ -403,16 +583,13 @@ CMMCore::getAvailableDeviceDescriptions(const char* moduleName) MMCORE_LEGACY_TH
 {
    // XXX It is a little silly that we return the list of descriptions, rather
    // than provide access to the description of each device.
-   std::shared_ptr<LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   std::vector<std::string> names = module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
+   const auto info = pluginManager_->GetDeviceAdapterInfo(moduleName);
    std::vector<std::string> descriptions;
-   descriptions.reserve(names.size());
-   for (std::vector<std::string>::const_iterator
-         it = names.begin(), end = names.end(); it != end; ++it)
-   {
-      descriptions.push_back(module->GetDeviceDescription(*it));
-   }
+   descriptions.reserve(info.devices.size());
+   for (const auto& device : info.devices)
+      descriptions.push_back(device.description);
    return descriptions;
 }
 
@@ -424,20 +601,34 @@ CMMCore::getAvailableDeviceTypes(const char* moduleName) MMCORE_LEGACY_THROW(CMM
 {
    // XXX It is a little silly that we return the list of types, rather than
    // provide access to the type of each device.
-   std::shared_ptr<LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   std::vector<std::string> names = module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
+   const auto info = pluginManager_->GetDeviceAdapterInfo(moduleName);
    std::vector<long> types;
-   types.reserve(names.size());
-   for (std::vector<std::string>::const_iterator
-         it = names.begin(), end = names.end(); it != end; ++it)
-   {
-      MM::DeviceType devType = module->GetAdvertisedDeviceType(*it);
-      types.push_back(static_cast<long>(devType));
-   }
+   types.reserve(info.devices.size());
+   for (const auto& device : info.devices)
+      types.push_back(static_cast<long>(device.type));
    return types;
 }
 
+/**
+ * Returns the module interface version of a device adapter library.
+ *
+ * Unlike getAvailableDevices(), this also succeeds for device adapters built
+ * against an incompatible interface version, so that they can be reported.
+ * The library is not loaded if the device adapter cache is up to date for it.
+ *
+ * @param moduleName  the name of the device adapter module
+ */
+long
+CMMCore::getDeviceAdapterModuleInterfaceVersion(const char* moduleName) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
+   return pluginManager_->GetDeviceAdapterInfo(moduleName, false).
+      moduleInterfaceVersion;
+}
+
 /**
  * Returns the module and device interface versions.
  */
@@ -461,55 +652,190 @@ int CMMCore::getMMDeviceDeviceInterfaceVersion() { return DEVICE_INTERFACE_VERSI
  * error. If there is an error, properties may be missing from the return
  * value.
  *
+ * When the "ParallelSystemState" feature is enabled, devices belonging to
+ * different device adapter modules are queried concurrently, one thread per
+ * module (see enableFeature()).
+ *
  * @return Configuration object containing a collection of device-property-value triplets
  */
 Configuration CMMCore::getSystemState()
 {
-   Configuration config;
+   return getSystemState(0.0);
+}
+
+/**
+ * Returns the entire system state, using cached values that are recent enough.
+ *
+ * Same as getSystemState(), except that a property value that has been set or
+ * read (and thus stored in the system state cache) within the last
+ * maxCacheAgeMs milliseconds is taken from the cache instead of querying the
+ * device. This is useful for taking a snapshot shortly after the hardware has
+ * been configured, without re-reading slow devices.
+ *
+ * @param maxCacheAgeMs the maximum age of a cached value to use; if zero or
+ * negative, all values are read from the devices.
+ * @return Configuration object containing a collection of device-property-value triplets
+ */
+Configuration CMMCore::getSystemState(double maxCacheAgeMs)
+{
    std::vector<std::string> devices = deviceManager_->GetDeviceList();
+   std::vector<std::shared_ptr<DeviceInstance>> pDevices;
+   pDevices.reserve(devices.size());
    for (std::vector<std::string>::const_iterator i = devices.begin(), dend = devices.end(); i != dend; ++i)
+      pDevices.push_back(deviceManager_->GetDevice(*i));
+
+   Configuration config;
+   if (!mm::features::flags().ParallelSystemState)
+   {
+      std::vector<PropertySetting> settings = getDeviceStates(pDevices, maxCacheAgeMs);
+      for (size_t i = 0; i < settings.size(); ++i)
+         config.addSetting(settings[i]);
+   }
+   else
+   {
+      // Group the devices by module, keeping the order of devices within
+      // each module. Modules are queried on separate threads; devices within
+      // a module share the module lock, so would not benefit from more.
+      std::map<std::shared_ptr<LoadedDeviceAdapter>, std::vector<std::shared_ptr<DeviceInstance>>> moduleMap;
+      for (size_t i = 0; i < pDevices.size(); ++i)
+         moduleMap[pDevices[i]->GetAdapterModule()].push_back(pDevices[i]);
+
+      LOG_DEBUG(coreLogger_) << "Will query system state of " <<
+         pDevices.size() << " devices from " << moduleMap.size() <<
+         " modules in parallel";
+
+      std::vector<std::future<std::vector<PropertySetting>>> futures;
+      for (auto& moduleDevices : moduleMap)
+      {
+         futures.push_back(std::async(std::launch::async,
+                  &CMMCore::getDeviceStates, this,
+                  std::cref(moduleDevices.second), maxCacheAgeMs));
+      }
+
+      // Wait for all modules before merging, so that no thread outlives the
+      // device list. Settings are merged in device order, so that the result
+      // is the same as that of the serial query.
+      std::map<std::string, std::vector<PropertySetting>> deviceSettings;
+      std::exception_ptr pex;
+      for (auto& fut : futures)
+      {
+         try
+         {
+            std::vector<PropertySetting> settings = fut.get();
+            for (size_t i = 0; i < settings.size(); ++i)
+               deviceSettings[settings[i].getDeviceLabel()].push_back(settings[i]);
+         }
+         catch (const std::exception&)
+         {
+            if (!pex)
+               pex = std::current_exception();
+         }
+      }
+      if (pex)
+         std::rethrow_exception(pex);
+
+      for (std::vector<std::string>::const_iterator i = devices.begin(), dend = devices.end(); i != dend; ++i)
+      {
+         const std::vector<PropertySetting>& settings = deviceSettings[*i];
+         for (size_t j = 0; j < settings.size(); ++j)
+            config.addSetting(settings[j]);
+      }
+   }
+
+   // add core properties
+   std::vector<std::string> coreProps = properties_->GetNames();
+   for (unsigned i=0; i < coreProps.size(); i++)
+   {
+      std::string name = coreProps[i];
+      std::string val = properties_->Get(name.c_str());
+      config.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, name.c_str(), val.c_str(), properties_->IsReadOnly(name.c_str())));
+   }
+
+   return config;
+}
+
+/**
+ * Reads all property values of the given devices, in order, using cached
+ * values no older than maxCacheAgeMs (if positive).
+ */
+std::vector<PropertySetting> CMMCore::getDeviceStates(
+      const std::vector<std::shared_ptr<DeviceInstance>>& devices,
+      double maxCacheAgeMs)
+{
+   std::vector<PropertySetting> settings;
+   const auto now = std::chrono::steady_clock::now();
+   const auto maxAge = std::chrono::duration<double, std::milli>(maxCacheAgeMs);
+   for (std::vector<std::shared_ptr<DeviceInstance>>::const_iterator i = devices.begin(), dend = devices.end(); i != dend; ++i)
    {
-      std::shared_ptr<DeviceInstance> pDev = deviceManager_->GetDevice(*i);
+      const std::shared_ptr<DeviceInstance>& pDev = *i;
+      const std::string label = pDev->GetLabel();
       mm::DeviceModuleLockGuard guard(pDev);
       std::vector<std::string> propertyNames = pDev->GetPropertyNames();
-      for (std::vector<std::string>::const_iterator it = propertyNames.begin(), end = propertyNames.end();
-            it != end; ++it)
+
+      // Look up all fresh cached values of this device at once
+      std::vector<std::pair<bool, std::string>> cached(propertyNames.size());
+      if (maxCacheAgeMs > 0.0)
+      {
+         MMThreadGuard scg(stateCacheLock_);
+         for (size_t j = 0; j < propertyNames.size(); ++j)
+         {
+            auto t = stateCacheTimes_.find(std::make_pair(label, propertyNames[j]));
+            if (t != stateCacheTimes_.end() && now - t->second <= maxAge &&
+                  stateCache_.isPropertyIncluded(label.c_str(), propertyNames[j].c_str()))
+            {
+               cached[j].first = true;
+               cached[j].second = stateCache_.getSetting(label.c_str(),
+                     propertyNames[j].c_str()).getPropertyValue();
+            }
+         }
+      }
+
+      for (size_t j = 0; j < propertyNames.size(); ++j)
       {
+         const std::string& propName = propertyNames[j];
          std::string val;
-         try
+         if (cached[j].first)
          {
-            val = pDev->GetProperty(*it);
+            val = cached[j].second;
          }
-         catch (const CMMError&)
+         else
          {
-            // XXX BUG This should not be ignored, but the interface does not
-            // allow throwing from this function. Keeping old behavior for now.
+            try
+            {
+               val = pDev->GetProperty(propName);
+            }
+            catch (const CMMError&)
+            {
+               // XXX BUG This should not be ignored, but the interface does not
+               // allow throwing from this function. Keeping old behavior for now.
+            }
          }
 
          bool readOnly = false;
          try
          {
-            readOnly = pDev->GetPropertyReadOnly(it->c_str());
+            readOnly = pDev->GetPropertyReadOnly(propName.c_str());
          }
          catch (const CMMError&)
          {
             // XXX BUG This should not be ignored, but the interface does not
             // allow throwing from this function. Keeping old behavior for now.
          }
-         config.addSetting(PropertySetting(i->c_str(), it->c_str(), val.c_str(), readOnly));
+         settings.push_back(PropertySetting(label.c_str(), propName.c_str(), val.c_str(), readOnly));
       }
    }
+   return settings;
+}
 
-   // add core properties
-   std::vector<std::string> coreProps = properties_->GetNames();
-   for (unsigned i=0; i < coreProps.size(); i++)
-   {
-      std::string name = coreProps[i];
-      std::string val = properties_->Get(name.c_str());
-      config.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, name.c_str(), val.c_str(), properties_->IsReadOnly(name.c_str())));
-   }
-
-   return config;
+/**
+ * Stores a setting in the system state cache, recording when it was set.
+ * The caller must hold stateCacheLock_.
+ */
+void CMMCore::cacheSetting(const PropertySetting& setting)
+{
+   stateCache_.addSetting(setting);
+   stateCacheTimes_[std::make_pair(setting.getDeviceLabel(), setting.getPropertyName())] =
+      std::chrono::steady_clock::now();
 }
 
 /**
@@ -679,6 +1005,51 @@ std::vector<std::string> CMMCore::getDeviceAdapterNames() MMCORE_LEGACY_THROW(CM
    return pluginManager_->GetAvailableDeviceAdapters();
 }
 
+/**
+ * Set the file in which to cache the devices provided by device adapters.
+ *
+ * The cache records, for each device adapter library (identified by its
+ * path, modification time, and size), the available devices with their
+ * descriptions and types, and the interface versions. While a library file
+ * is unchanged, getAvailableDevices() and related functions answer from the
+ * cache without loading the library, which can take a long time for some
+ * adapters. Entries are updated as needed, so the file is safe to keep
+ * between sessions.
+ *
+ * Entries already cached in the file are loaded immediately; a missing or
+ * unreadable file is ignored. Pass an empty string to only cache in memory
+ * (the default).
+ *
+ * @param filename   the cache file
+ */
+void CMMCore::setDeviceAdapterCacheFile(const char* filename)
+{
+   pluginManager_->SetManifestFilename(filename ? filename : "");
+}
+
+/**
+ * Return the device adapter cache file, or an empty string if none is set.
+ */
+std::string CMMCore::getDeviceAdapterCacheFile()
+{
+   return pluginManager_->GetManifestFilename();
+}
+
+/**
+ * Update the device adapter cache for all device adapters in the search
+ * paths.
+ *
+ * Libraries that are new or have changed since they were cached are loaded
+ * in parallel, which is faster than loading them one by one when calling
+ * getAvailableDevices() for each adapter. Entries for libraries no longer in
+ * the search paths are removed. Libraries that fail to load are skipped
+ * (the error is reported when the adapter is used).
+ */
+void CMMCore::refreshDeviceAdapterCache() MMCORE_LEGACY_THROW(CMMError)
+{
+   pluginManager_->RefreshManifest();
+}
+
 /**
  * Loads a device from the plugin library.
  * @param label    assigned name for the device during the core session
@@ -814,11 +1185,14 @@ void CMMCore::unloadDevice(const char* label///< the name of the device to unloa
 
    try {
       removeDeviceRole(pDevice);
+      forgetCompiledPresets(label);
+      forgetConfigSequences(label);
 
       mm::DeviceModuleLockGuard guard(pDevice);
       LOG_DEBUG(coreLogger_) << "Will unload device " << label;
       deviceManager_->UnloadDevice(pDevice);
       LOG_DEBUG(coreLogger_) << "Did unload device " << label;
+      forgetSettingPrerequisites(label);
       
       updateCoreProperties();
    }
@@ -840,6 +1214,8 @@ void CMMCore::unloadAllDevices() MMCORE_LEGACY_THROW(CMMError)
       removeAllDeviceRoles();
 
       configGroups_->Clear();
+      compiledPresets_.clear();
+      configSequences_.clear();
       updateAllowedChannelGroups();
 
       // clear pixel size configurations
@@ -856,6 +1232,10 @@ void CMMCore::unloadAllDevices() MMCORE_LEGACY_THROW(CMMError)
       LOG_DEBUG(coreLogger_) << "Will unload all devices";
       deviceManager_->UnloadAllDevices();
       LOG_INFO(coreLogger_) << "Did unload all devices";
+      {
+         MMThreadGuard g(settingOrderLock_);
+         settingPrerequisites_.clear();
+      }
 
 	   properties_->Refresh();
 
@@ -1160,6 +1540,13 @@ void CMMCore::updateSystemStateCache()
    {
       MMThreadGuard scg(stateCacheLock_);
       stateCache_ = wk;
+      stateCacheTimes_.clear();
+      const auto now = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < wk.size(); ++i)
+      {
+         PropertySetting s = wk.getSetting(i);
+         stateCacheTimes_[std::make_pair(s.getDeviceLabel(), s.getPropertyName())] = now;
+      }
    }
    LOG_INFO(coreLogger_) << "Did update system state cache";
 }
@@ -1355,7 +1742,7 @@ bool CMMCore::deviceBusy(const char* label) MMCORE_LEGACY_THROW(CMMError)
       return false;
    std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
 
-   mm::DeviceModuleLockGuard guard(pDevice);
+   mm::DeviceModuleReadLockGuard guard(pDevice);
    return pDevice->Busy();
 }
 
@@ -1388,17 +1775,33 @@ void CMMCore::waitForDevice(const char* label) MMCORE_LEGACY_THROW(CMMError)
 /**
  * Waits (blocks the calling thread) until the specified device becomes
  * @param pDev   the device instance
+ *
+ * Devices that call OnBusyChanged() wake the waiting thread as soon as they
+ * become non-busy. Other devices are polled, starting with a short interval
+ * that backs off to pollingIntervalMs_, so that quick operations are not
+ * charged a full polling interval.
  */
 void CMMCore::waitForDevice(std::shared_ptr<DeviceInstance> pDev) MMCORE_LEGACY_THROW(CMMError)
 {
+   MMCORE_TRACE_SPAN("Core", "CMMCore::waitForDevice");
+
    LOG_DEBUG(coreLogger_) << "Waiting for device " << pDev->GetLabel() << "...";
 
-   auto now = std::chrono::steady_clock::now();
-   auto timeout = std::chrono::duration<long long, std::milli>(timeoutMs_);
-   auto deadline = now + timeout;
+   const auto start = std::chrono::steady_clock::now();
+   const std::chrono::steady_clock::time_point deadline =
+      start + std::chrono::milliseconds(timeoutMs_);
+
+   const std::chrono::steady_clock::duration maxPollInterval =
+      std::chrono::milliseconds(pollingIntervalMs_);
+   std::chrono::steady_clock::duration pollInterval =
+      std::min<std::chrono::steady_clock::duration>(
+            std::chrono::microseconds(500), maxPollInterval);
 
    while (true)
    {
+      // Read before checking Busy(), so that a notification sent after the
+      // check is not missed
+      const unsigned long long busyChangeCount = pDev->GetBusyChangeCount();
       {
          mm::DeviceModuleLockGuard guard(pDev);
          if (!pDev->Busy())
@@ -1407,8 +1810,10 @@ void CMMCore::waitForDevice(std::shared_ptr<DeviceInstance> pDev) MMCORE_LEGACY_
          }
       }
 
-      if (std::chrono::steady_clock::now() > deadline)
+      const auto now = std::chrono::steady_clock::now();
+      if (now > deadline)
       {
+         pDev->RecordWait(now - start);
          std::string label = pDev->GetLabel();
          std::ostringstream mez;
          mez << "wait timed out after " << timeoutMs_ << " ms. ";
@@ -1418,9 +1823,16 @@ void CMMCore::waitForDevice(std::shared_ptr<DeviceInstance> pDev) MMCORE_LEGACY_
                MMERR_DevicePollingTimeout);
       }
 
-     sleep(pollingIntervalMs_);
+      // For notifying devices, polling is only a safety net
+      const auto interval = busyChangeCount > 0 ? maxPollInterval : pollInterval;
+      pDev->WaitForBusyChange(busyChangeCount, std::min(now + interval, deadline));
+      pollInterval = std::min(2 * pollInterval, maxPollInterval);
    }
-   LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel();
+
+   const auto waited = std::chrono::steady_clock::now() - start;
+   pDev->RecordWait(waited);
+   LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel() <<
+      " (" << std::chrono::duration<double, std::milli>(waited).count() << " ms)";
 }
 
 /**
@@ -1483,55 +1895,245 @@ void CMMCore::waitForDeviceType(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMME
 }
 
 /**
- * Blocks until all devices included in the configuration become ready.
- * @param group      the configuration group
- * @param configName the configuration preset
+ * Returns the number of times waitForDevice() (or any of the other wait
+ * functions) has waited for the given device since it was loaded or since
+ * the last resetDeviceWaitStatistics().
+ *
+ * @param label      the device label
  */
-void CMMCore::waitForConfig(const char* group, const char* configName) MMCORE_LEGACY_THROW(CMMError)
+long CMMCore::getDeviceWaitCount(const char* label) MMCORE_LEGACY_THROW(CMMError)
 {
-   CheckConfigGroupName(group);
-   CheckConfigPresetName(configName);
-
-   Configuration cfg = getConfigData(group, configName);
-   try {
-      for(size_t i=0; i<cfg.size(); i++)
-         waitForDevice(cfg.getSetting(i).getDeviceLabel().c_str());
-   } catch (CMMError& err) {
-      // trap MM exceptions and keep quiet - this is not a good time to blow up
-      logError("waitForConfig", err.getMsg().c_str());
-   }
+   if (IsCoreDeviceLabel(label))
+      return 0;
+   return deviceManager_->GetDevice(label)->GetWaitCount();
 }
 
 /**
- * Sets the position of the stage in microns.
- * @param label     the stage device label
- * @param position  the desired stage position, in microns
+ * Returns the total time, in milliseconds, spent waiting for the given device
+ * to become non-busy. See getDeviceWaitCount().
+ *
+ * @param label      the device label
  */
-void CMMCore::setPosition(const char* label, double position) MMCORE_LEGACY_THROW(CMMError)
+double CMMCore::getDeviceWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::shared_ptr<StageInstance> pStage =
-      deviceManager_->GetDeviceOfType<StageInstance>(label);
-
-   LOG_DEBUG(coreLogger_) << "Will start absolute move of " << label <<
-      " to position " << std::fixed << std::setprecision(5) << position <<
-      " um";
-
-   mm::DeviceModuleLockGuard guard(pStage);
-   int ret = pStage->SetPositionUm(position);
-   if (ret != DEVICE_OK)
-   {
-      logError(pStage->GetName().c_str(), getDeviceErrorText(ret, pStage).c_str());
-      throw CMMError(getDeviceErrorText(ret, pStage).c_str(), MMERR_DEVICE_GENERIC);
-   }
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         deviceManager_->GetDevice(label)->GetTotalWaitTime()).count();
 }
+
 /**
- * Sets the position of the stage in microns. Uses the current Z positioner
- * (focus) device.
- * @param position  the desired stage position, in microns
+ * Returns the longest single wait, in milliseconds, for the given device to
+ * become non-busy. See getDeviceWaitCount().
+ *
+ * @param label      the device label
  */
-void CMMCore::setPosition(double position) MMCORE_LEGACY_THROW(CMMError)
+double CMMCore::getDeviceMaxWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
 {
-    setPosition(getFocusDevice().c_str(), position);
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         deviceManager_->GetDevice(label)->GetMaxWaitTime()).count();
+}
+
+/**
+ * Resets the wait statistics of all devices. See getDeviceWaitCount().
+ */
+void CMMCore::resetDeviceWaitStatistics()
+{
+   for (const std::string& label : deviceManager_->GetDeviceList())
+   {
+      try
+      {
+         deviceManager_->GetDevice(label)->ResetWaitStatistics();
+      }
+      catch (const CMMError&)
+      {
+         // Device was unloaded concurrently
+      }
+   }
+}
+
+static mm::DeviceModuleLock::Statistics
+ModuleLockStatistics(std::shared_ptr<DeviceInstance> device)
+{
+   return device->GetAdapterModule()->GetLock().GetStatistics();
+}
+
+/**
+ * Returns the number of times the lock of the given device's adapter module
+ * has been acquired since the module was loaded or since the last
+ * resetDeviceModuleLockStatistics(). Nested acquisitions by a thread that
+ * already holds the lock are not counted.
+ *
+ * Nearly every call to a device holds its module's lock, so that devices of
+ * one module (for example, all the devices behind one hub) are used by one
+ * thread at a time. Devices that declare the read-only
+ * MM::g_Keyword_ConcurrentReads property as "1" share the lock for reads
+ * (getProperty(), deviceBusy() and position getters).
+ *
+ * @param label      the device label
+ */
+long CMMCore::getDeviceModuleLockCount(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0;
+   return ModuleLockStatistics(deviceManager_->GetDevice(label)).acquisitions;
+}
+
+/**
+ * Returns how many of the acquisitions counted by getDeviceModuleLockCount()
+ * were shared (concurrent reads).
+ *
+ * @param label      the device label
+ */
+long CMMCore::getDeviceModuleLockSharedCount(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0;
+   return ModuleLockStatistics(deviceManager_->GetDevice(label)).sharedAcquisitions;
+}
+
+/**
+ * Returns how many of the acquisitions counted by getDeviceModuleLockCount()
+ * had to wait for another thread.
+ *
+ * @param label      the device label
+ */
+long CMMCore::getDeviceModuleLockContentionCount(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0;
+   return ModuleLockStatistics(deviceManager_->GetDevice(label)).contendedAcquisitions;
+}
+
+/**
+ * Returns the total time, in milliseconds, that threads have waited to
+ * acquire the lock of the given device's module. See
+ * getDeviceModuleLockCount().
+ *
+ * @param label      the device label
+ */
+double CMMCore::getDeviceModuleLockWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         ModuleLockStatistics(deviceManager_->GetDevice(label)).totalWaitTime).count();
+}
+
+/**
+ * Returns the longest single wait, in milliseconds, to acquire the lock of
+ * the given device's module. See getDeviceModuleLockCount().
+ *
+ * @param label      the device label
+ */
+double CMMCore::getDeviceModuleLockMaxWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         ModuleLockStatistics(deviceManager_->GetDevice(label)).maxWaitTime).count();
+}
+
+/**
+ * Returns the total time, in milliseconds, that the lock of the given
+ * device's module has been held (summed over threads when shared). See
+ * getDeviceModuleLockCount().
+ *
+ * @param label      the device label
+ */
+double CMMCore::getDeviceModuleLockHoldTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         ModuleLockStatistics(deviceManager_->GetDevice(label)).totalHoldTime).count();
+}
+
+/**
+ * Returns the longest time, in milliseconds, that the lock of the given
+ * device's module has been held at once. See getDeviceModuleLockCount().
+ *
+ * @param label      the device label
+ */
+double CMMCore::getDeviceModuleLockMaxHoldTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      return 0.0;
+   return std::chrono::duration<double, std::milli>(
+         ModuleLockStatistics(deviceManager_->GetDevice(label)).maxHoldTime).count();
+}
+
+/**
+ * Resets the lock statistics of all loaded device adapter modules. See
+ * getDeviceModuleLockCount().
+ */
+void CMMCore::resetDeviceModuleLockStatistics()
+{
+   for (const std::string& label : deviceManager_->GetDeviceList())
+   {
+      try
+      {
+         deviceManager_->GetDevice(label)->GetAdapterModule()->GetLock().ResetStatistics();
+      }
+      catch (const CMMError&)
+      {
+         // Device was unloaded concurrently
+      }
+   }
+}
+
+/**
+ * Blocks until all devices included in the configuration become ready.
+ * @param group      the configuration group
+ * @param configName the configuration preset
+ */
+void CMMCore::waitForConfig(const char* group, const char* configName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(group);
+   CheckConfigPresetName(configName);
+
+   Configuration cfg = getConfigData(group, configName);
+   try {
+      for(size_t i=0; i<cfg.size(); i++)
+         waitForDevice(cfg.getSetting(i).getDeviceLabel().c_str());
+   } catch (CMMError& err) {
+      // trap MM exceptions and keep quiet - this is not a good time to blow up
+      logError("waitForConfig", err.getMsg().c_str());
+   }
+}
+
+/**
+ * Sets the position of the stage in microns.
+ * @param label     the stage device label
+ * @param position  the desired stage position, in microns
+ */
+void CMMCore::setPosition(const char* label, double position) MMCORE_LEGACY_THROW(CMMError)
+{
+   std::shared_ptr<StageInstance> pStage =
+      deviceManager_->GetDeviceOfType<StageInstance>(label);
+
+   LOG_DEBUG(coreLogger_) << "Will start absolute move of " << label <<
+      " to position " << std::fixed << std::setprecision(5) << position <<
+      " um";
+
+   mm::DeviceModuleLockGuard guard(pStage);
+   int ret = pStage->SetPositionUm(position);
+   if (ret != DEVICE_OK)
+   {
+      logError(pStage->GetName().c_str(), getDeviceErrorText(ret, pStage).c_str());
+      throw CMMError(getDeviceErrorText(ret, pStage).c_str(), MMERR_DEVICE_GENERIC);
+   }
+}
+/**
+ * Sets the position of the stage in microns. Uses the current Z positioner
+ * (focus) device.
+ * @param position  the desired stage position, in microns
+ */
+void CMMCore::setPosition(double position) MMCORE_LEGACY_THROW(CMMError)
+{
+    setPosition(getFocusDevice().c_str(), position);
 }
 
 /**
@@ -1577,7 +2179,7 @@ double CMMCore::getPosition(const char* label) MMCORE_LEGACY_THROW(CMMError)
    std::shared_ptr<StageInstance> pStage =
       deviceManager_->GetDeviceOfType<StageInstance>(label);
 
-   mm::DeviceModuleLockGuard guard(pStage);
+   mm::DeviceModuleReadLockGuard guard(pStage);
    double pos;
    int ret = pStage->GetPositionUm(pos);
    if (ret != DEVICE_OK)
@@ -1678,7 +2280,7 @@ void CMMCore::getXYPosition(const char* label, double& x, double& y) MMCORE_LEGA
    std::shared_ptr<XYStageInstance> pXYStage =
       deviceManager_->GetDeviceOfType<XYStageInstance>(label);
 
-   mm::DeviceModuleLockGuard guard(pXYStage);
+   mm::DeviceModuleReadLockGuard guard(pXYStage);
    int ret = pXYStage->GetPositionUm(x, y);
    if (ret != DEVICE_OK)
    {
@@ -1708,7 +2310,7 @@ double CMMCore::getXPosition(const char* label) MMCORE_LEGACY_THROW(CMMError)
    std::shared_ptr<XYStageInstance> pXYStage =
       deviceManager_->GetDeviceOfType<XYStageInstance>(label);
 
-   mm::DeviceModuleLockGuard guard(pXYStage);
+   mm::DeviceModuleReadLockGuard guard(pXYStage);
    double x, y;
    int ret = pXYStage->GetPositionUm(x, y);
    if (ret != DEVICE_OK)
@@ -1740,7 +2342,7 @@ double CMMCore::getYPosition(const char* label) MMCORE_LEGACY_THROW(CMMError)
    std::shared_ptr<XYStageInstance> pXYStage =
       deviceManager_->GetDeviceOfType<XYStageInstance>(label);
 
-   mm::DeviceModuleLockGuard guard(pXYStage);
+   mm::DeviceModuleReadLockGuard guard(pXYStage);
    double x, y;
    int ret = pXYStage->GetPositionUm(x, y);
    if (ret != DEVICE_OK)
@@ -2620,7 +3222,7 @@ void CMMCore::setAutoShutter(bool state)
    autoShutter_ = state;
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoShutter, state ? "1" : "0"));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoShutter, state ? "1" : "0"));
    }
    LOG_DEBUG(coreLogger_) << "Autoshutter turned " << (state ? "on" : "off");
 }
@@ -2656,7 +3258,7 @@ void CMMCore::setShutterOpen(const char* shutterLabel, bool state) MMCORE_LEGACY
       {
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(shutterLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
+            cacheSetting(PropertySetting(shutterLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
          }
       }
    }
@@ -2865,12 +3467,23 @@ void CMMCore::startSequenceAcquisition(long numImages, double intervalMs, bool s
 			}
 			cbuf_->Clear();
          cbuf_->SetOverwriteData(!stopOnOverflow);
+         stopMultiCameraRouting();
          mm::DeviceModuleLockGuard guard(camera);
 
          LOG_DEBUG(coreLogger_) << "Will start sequence acquisition from default camera";
+         startConfigSequences();
 			int nRet = camera->StartSequenceAcquisition(numImages, intervalMs, stopOnOverflow);
 			if (nRet != DEVICE_OK)
+         {
+            try
+            {
+               stopConfigSequences();
+            }
+            catch (const CMMError&)
+            {
+            }
 				throw CMMError(getDeviceErrorText(nRet, camera).c_str(), MMERR_DEVICE_GENERIC);
+         }
 		}
 		catch (std::bad_alloc& ex)
 		{
@@ -2911,6 +3524,7 @@ void CMMCore::startSequenceAcquisition(const char* label, long numImages, double
    }
    cbuf_->Clear();
    cbuf_->SetOverwriteData(!stopOnOverflow);
+   stopMultiCameraRouting();
    LOG_DEBUG(coreLogger_) <<
       "Will start sequence acquisition from camera " << label;
    int nRet = pCam->StartSequenceAcquisition(numImages, intervalMs, stopOnOverflow);
@@ -3016,10 +3630,21 @@ void CMMCore::startContinuousSequenceAcquisition(double intervalMs) MMCORE_LEGAC
       }
       cbuf_->Clear();
       cbuf_->SetOverwriteData(true);
+      stopMultiCameraRouting();
       LOG_DEBUG(coreLogger_) << "Will start continuous sequence acquisition from current camera";
+      startConfigSequences();
       int nRet = camera->StartSequenceAcquisition(intervalMs);
       if (nRet != DEVICE_OK)
+      {
+         try
+         {
+            stopConfigSequences();
+         }
+         catch (const CMMError&)
+         {
+         }
          throw CMMError(getDeviceErrorText(nRet, camera).c_str(), MMERR_DEVICE_GENERIC);
+      }
    }
    else
    {
@@ -3043,6 +3668,13 @@ void CMMCore::stopSequenceAcquisition() MMCORE_LEGACY_THROW(CMMError)
       int nRet = camera->StopSequenceAcquisition();
       if (nRet != DEVICE_OK)
       {
+         try
+         {
+            stopConfigSequences();
+         }
+         catch (const CMMError&)
+         {
+         }
          logError(getDeviceName(camera).c_str(), getDeviceErrorText(nRet, camera).c_str());
          throw CMMError(getDeviceErrorText(nRet, camera).c_str(), MMERR_DEVICE_GENERIC);
       }
@@ -3053,62 +3685,282 @@ void CMMCore::stopSequenceAcquisition() MMCORE_LEGACY_THROW(CMMError)
       throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
    }
 
+   stopConfigSequences();
+
    LOG_DEBUG(coreLogger_) << "Did stop sequence acquisition from current camera";
    // onSequenceAcquisitionStopped will be called by CoreCallback::AcqFinished
 }
 
 /**
- * Check if the current camera is acquiring the sequence
- * Returns false when the sequence is done
+ * Starts sequence acquisition from several cameras together.
+ *
+ * Unlike the other startSequenceAcquisition() variants, each camera gets its
+ * own partition of the sequence buffer (the memory footprint is divided
+ * evenly), so the cameras may differ in image size and pixel depth. Images
+ * are retrieved as frame sets, one frame per camera, with
+ * popNextFrameSetByImageNumber() or popNextFrameSetByTimestamp() (C++ only).
+ * The images from these cameras do not go to the regular sequence buffer
+ * until stopMultiCameraSequenceAcquisition() is called or a regular sequence
+ * acquisition is started.
+ *
+ * All cameras are prepared before any is started, and the first camera is
+ * started last, so that it can act as the trigger master for the others.
+ * Property sequences loaded with loadConfigSequence() are started before the
+ * cameras. If any camera fails to start, the ones already started are
+ * stopped.
+ *
+ * @param cameraLabels     The cameras, master (or first to trigger) first
+ * @param numImages        Number of images requested from each camera
+ * @param intervalMs       The interval between images, if supported by the cameras
+ * @param stopOnOverflow   Whether the cameras stop acquiring when their
+ *                         partition is full
  */
-bool CMMCore::isSequenceRunning() MMCORE_NOEXCEPT
+void CMMCore::startMultiCameraSequenceAcquisition(std::vector<std::string> cameraLabels,
+      long numImages, double intervalMs, bool stopOnOverflow) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
-   if (camera)
+   if (cameraLabels.empty())
+      throw CMMError("No cameras given for multi-camera sequence acquisition",
+            MMERR_CameraNotAvailable);
+
+   std::vector<std::shared_ptr<CameraInstance>> cameras;
+   for (const std::string& label : cameraLabels)
+   {
+      if (std::count(cameraLabels.begin(), cameraLabels.end(), label) > 1)
+         throw CMMError("Camera " + ToQuotedString(label) +
+               " is given more than once", MMERR_DuplicateLabel);
+      cameras.push_back(deviceManager_->GetDeviceOfType<CameraInstance>(label));
+   }
+
+   std::shared_ptr<mm::MultiCameraBuffer> buffer;
+   try
+   {
+      buffer = std::make_shared<mm::MultiCameraBuffer>(cameraLabels,
+            getCircularBufferMemoryFootprint(), imageCopyThreads_,
+            imageCopyCPUs_);
+   }
+   catch (const std::bad_alloc& ex)
+   {
+      std::ostringstream messs;
+      messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << '\n';
+      throw CMMError(messs.str().c_str(), MMERR_OutOfMemory);
+   }
+
+   for (size_t i = 0; i < cameras.size(); ++i)
+   {
+      mm::DeviceModuleLockGuard guard(cameras[i]);
+      if (cameras[i]->IsCapturing())
+         throw CMMError(getCoreErrorText(MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+               MMERR_NotAllowedDuringSequenceAcquisition);
+
+      std::shared_ptr<CircularBuffer> partition =
+         buffer->GetPartition(cameraLabels[i]);
+      if (!partition->Initialize(cameras[i]->GetImageWidth(),
+               cameras[i]->GetImageHeight(), cameras[i]->GetImageBytesPerPixel()))
+      {
+         logError(cameraLabels[i].c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
+         throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(),
+               MMERR_CircularBufferFailedToInitialize);
+      }
+      partition->Clear();
+   }
+   buffer->SetOverwriteData(!stopOnOverflow);
+
+   for (size_t i = 0; i < cameras.size(); ++i)
+   {
+      mm::DeviceModuleLockGuard guard(cameras[i]);
+      int nRet = cameras[i]->PrepareSequenceAcqusition();
+      if (nRet != DEVICE_OK)
+         throw CMMError(getDeviceErrorText(nRet, cameras[i]).c_str(), MMERR_DEVICE_GENERIC);
+   }
+
+   {
+      MMThreadGuard g(multiCameraLock_);
+      multiCameraBuffer_ = buffer;
+      multiCameraRouting_ = true;
+   }
+
+   LOG_DEBUG(coreLogger_) << "Will start multi-camera sequence acquisition from " <<
+      cameras.size() << " cameras";
+   size_t started = 0;
+   try
+   {
+      startConfigSequences();
+      for (size_t i = cameras.size(); i-- > 0; )
+      {
+         mm::DeviceModuleLockGuard guard(cameras[i]);
+         int nRet = cameras[i]->StartSequenceAcquisition(numImages, intervalMs,
+               stopOnOverflow);
+         if (nRet != DEVICE_OK)
+            throw CMMError(getDeviceErrorText(nRet, cameras[i]).c_str(), MMERR_DEVICE_GENERIC);
+         ++started;
+      }
+   }
+   catch (const CMMError& e)
    {
+      logError("multi-camera sequence acquisition", e.getMsg().c_str());
+      for (size_t i = cameras.size() - started; i < cameras.size(); ++i)
+      {
+         mm::DeviceModuleLockGuard guard(cameras[i]);
+         cameras[i]->StopSequenceAcquisition();
+      }
       try
       {
-         mm::DeviceModuleLockGuard guard(camera);
-         return camera->IsCapturing();
+         stopConfigSequences();
       }
-      catch (const CMMError&) // Possibly uninitialized camera
+      catch (const CMMError&)
       {
-         // Fall through
       }
+      stopMultiCameraRouting();
+      throw;
    }
-   return false;
-};
+   LOG_DEBUG(coreLogger_) << "Did start multi-camera sequence acquisition";
+   // onSequenceAcquisitionStarted will be called by CoreCallback::PrepareForAcq
+}
 
 /**
- * Check if the specified camera is acquiring the sequence
- * Returns false when the sequence is done
+ * Stops the acquisition started by startMultiCameraSequenceAcquisition().
+ *
+ * The cameras are stopped in the order given when starting (master first).
+ * Frame sets remaining in the buffer can still be popped afterwards.
  */
-bool CMMCore::isSequenceRunning(const char* label) MMCORE_LEGACY_THROW(CMMError)
+void CMMCore::stopMultiCameraSequenceAcquisition() MMCORE_LEGACY_THROW(CMMError)
 {
-   std::shared_ptr<CameraInstance> pCam =
-      deviceManager_->GetDeviceOfType<CameraInstance>(label);
+   std::shared_ptr<mm::MultiCameraBuffer> buffer = getMultiCameraBuffer();
+   if (!buffer)
+      return;
 
-   mm::DeviceModuleLockGuard guard(pCam);
-   return pCam->IsCapturing();
-};
+   std::string firstError;
+   for (const std::string& label : buffer->GetCameraLabels())
+   {
+      std::shared_ptr<CameraInstance> camera;
+      try
+      {
+         camera = deviceManager_->GetDeviceOfType<CameraInstance>(label);
+      }
+      catch (const CMMError&) // Unloaded meanwhile
+      {
+         continue;
+      }
+      mm::DeviceModuleLockGuard guard(camera);
+      int nRet = camera->StopSequenceAcquisition();
+      if (nRet != DEVICE_OK)
+      {
+         logError(label.c_str(), getDeviceErrorText(nRet, camera).c_str());
+         if (firstError.empty())
+            firstError = getDeviceErrorText(nRet, camera);
+      }
+   }
+
+   stopMultiCameraRouting();
+   stopConfigSequences();
+   if (!firstError.empty())
+      throw CMMError(firstError, MMERR_DEVICE_GENERIC);
+   LOG_DEBUG(coreLogger_) << "Did stop multi-camera sequence acquisition";
+}
 
 /**
- * Gets the last image from the circular buffer.
- * Returns 0 if the buffer is empty.
+ * Returns the number of complete frame sets waiting in the multi-camera
+ * sequence buffer (0 if there is none).
  */
-void* CMMCore::getLastImage() MMCORE_LEGACY_THROW(CMMError)
+long CMMCore::getRemainingFrameSetCount() MMCORE_NOEXCEPT
 {
-   unsigned char* pBuf = const_cast<unsigned char*>(cbuf_->GetTopImage());
-   if (pBuf != 0)
-      return pBuf;
-   else
-   {
-      logError("CMMCore::getLastImage", getCoreErrorText(MMERR_CircularBufferEmpty).c_str());
-      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
-   }
+   std::shared_ptr<mm::MultiCameraBuffer> buffer = getMultiCameraBuffer();
+   return buffer ? static_cast<long>(buffer->GetRemainingFrameSetCount()) : 0;
 }
 
-void* CMMCore::getLastImageMD(unsigned channel, unsigned slice, Metadata& md) const MMCORE_LEGACY_THROW(CMMError)
+/**
+ * Returns the number of frames discarded from the multi-camera sequence
+ * buffer because the other cameras had no matching frame.
+ */
+long CMMCore::getUnmatchedFrameCount() MMCORE_NOEXCEPT
+{
+   std::shared_ptr<mm::MultiCameraBuffer> buffer = getMultiCameraBuffer();
+   return buffer ? static_cast<long>(buffer->GetUnmatchedFrameCount()) : 0;
+}
+
+// Sends images from all cameras back to the regular sequence buffer
+void CMMCore::stopMultiCameraRouting()
+{
+   MMThreadGuard g(multiCameraLock_);
+   multiCameraRouting_ = false;
+}
+
+std::shared_ptr<mm::MultiCameraBuffer> CMMCore::getMultiCameraBuffer() const
+{
+   MMThreadGuard g(multiCameraLock_);
+   return multiCameraBuffer_;
+}
+
+// The buffer into which to insert images from the given camera
+std::shared_ptr<CircularBuffer> CMMCore::getSequenceBuffer(const MM::Device* camera)
+{
+   {
+      MMThreadGuard g(multiCameraLock_);
+      if (multiCameraRouting_ && camera)
+      {
+         char label[MM::MaxStrLength];
+         camera->GetLabel(label);
+         std::shared_ptr<CircularBuffer> partition =
+            multiCameraBuffer_->GetPartition(label);
+         if (partition)
+            return partition;
+      }
+   }
+   return cbuf_;
+}
+
+/**
+ * Check if the current camera is acquiring the sequence
+ * Returns false when the sequence is done
+ */
+bool CMMCore::isSequenceRunning() MMCORE_NOEXCEPT
+{
+   std::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
+   if (camera)
+   {
+      try
+      {
+         mm::DeviceModuleLockGuard guard(camera);
+         return camera->IsCapturing();
+      }
+      catch (const CMMError&) // Possibly uninitialized camera
+      {
+         // Fall through
+      }
+   }
+   return false;
+};
+
+/**
+ * Check if the specified camera is acquiring the sequence
+ * Returns false when the sequence is done
+ */
+bool CMMCore::isSequenceRunning(const char* label) MMCORE_LEGACY_THROW(CMMError)
+{
+   std::shared_ptr<CameraInstance> pCam =
+      deviceManager_->GetDeviceOfType<CameraInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pCam);
+   return pCam->IsCapturing();
+};
+
+/**
+ * Gets the last image from the circular buffer.
+ * Returns 0 if the buffer is empty.
+ */
+void* CMMCore::getLastImage() MMCORE_LEGACY_THROW(CMMError)
+{
+   unsigned char* pBuf = const_cast<unsigned char*>(cbuf_->GetTopImage());
+   if (pBuf != 0)
+      return pBuf;
+   else
+   {
+      logError("CMMCore::getLastImage", getCoreErrorText(MMERR_CircularBufferEmpty).c_str());
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   }
+}
+
+void* CMMCore::getLastImageMD(unsigned channel, unsigned slice, Metadata& md) const MMCORE_LEGACY_THROW(CMMError)
 {
    if (channel != 0)
       throw CMMError("Channel must be 0");
@@ -3220,6 +4072,83 @@ void* CMMCore::popNextImageMD(Metadata& md) MMCORE_LEGACY_THROW(CMMError)
    return popNextImageMD(0, 0, md);
 }
 
+/**
+ * Gets and removes the next image from the circular buffer, without copying.
+ *
+ * The returned handle gives read-only access to the pixels and metadata in
+ * place. The buffer slot is pinned (will not be overwritten) until all copies
+ * of the handle are released, so handles should not be held longer than
+ * necessary: once the camera wraps around to a pinned slot, the acquisition
+ * overflows (or, when overwriting is allowed, the new frame is discarded).
+ *
+ * Not available in the Java and Python bindings.
+ */
+mm::ImageHandle CMMCore::popNextImageHandle() MMCORE_LEGACY_THROW(CMMError)
+{
+   mm::ImageHandle handle = cbuf_->GetNextImageHandle();
+   if (!handle)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return handle;
+}
+
+/**
+ * Returns a handle to the image that was inserted n images ago (0 for the
+ * last image), without removing it or copying it.
+ *
+ * See popNextImageHandle() for the lifetime of the handle.
+ *
+ * Not available in the Java and Python bindings.
+ */
+mm::ImageHandle CMMCore::getNBeforeLastImageHandle(unsigned long n) const MMCORE_LEGACY_THROW(CMMError)
+{
+   mm::ImageHandle handle = cbuf_->GetNthFromTopImageHandle(n);
+   if (!handle)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return handle;
+}
+
+/**
+ * Gets and removes the next frame set from the multi-camera sequence buffer,
+ * matching frames by image number.
+ *
+ * The set holds one frame per camera, in the order given to
+ * startMultiCameraSequenceAcquisition(). Frames that have no counterpart with
+ * the same image number from every other camera (because it was lost) are
+ * discarded; see getUnmatchedFrameCount().
+ *
+ * Not available in the Java and Python bindings.
+ */
+std::vector<mm::ImageHandle> CMMCore::popNextFrameSetByImageNumber() MMCORE_LEGACY_THROW(CMMError)
+{
+   std::shared_ptr<mm::MultiCameraBuffer> buffer = getMultiCameraBuffer();
+   std::vector<mm::ImageHandle> frameSet;
+   if (buffer)
+      frameSet = buffer->PopFrameSetByImageNumber();
+   if (frameSet.empty())
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return frameSet;
+}
+
+/**
+ * Gets and removes the next frame set from the multi-camera sequence buffer,
+ * matching frames whose elapsed-time tags (hardware timestamps, for cameras
+ * that provide them) are within the given tolerance of each other.
+ *
+ * See popNextFrameSetByImageNumber().
+ *
+ * Not available in the Java and Python bindings.
+ */
+std::vector<mm::ImageHandle> CMMCore::popNextFrameSetByTimestamp(double toleranceMs) MMCORE_LEGACY_THROW(CMMError)
+{
+   std::shared_ptr<mm::MultiCameraBuffer> buffer = getMultiCameraBuffer();
+   std::vector<mm::ImageHandle> frameSet;
+   if (buffer)
+      frameSet = buffer->PopFrameSetByTimestamp(toleranceMs);
+   if (frameSet.empty())
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return frameSet;
+}
+
 /**
  * Removes all images from the circular buffer.
  *
@@ -3237,12 +4166,13 @@ void CMMCore::clearCircularBuffer() MMCORE_LEGACY_THROW(CMMError)
 void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
                                                ) MMCORE_LEGACY_THROW(CMMError)
 {
-   delete cbuf_; // discard old buffer
+   cbuf_.reset(); // discard old buffer (kept alive by any image handles)
    LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
       sizeMB << " MB";
 	try
 	{
-		cbuf_ = new CircularBuffer(sizeMB);
+		cbuf_ = std::make_shared<CircularBuffer>(sizeMB, imageCopyThreads_,
+            imageCopyCPUs_);
 	}
 	catch (std::bad_alloc& ex)
 	{
@@ -3251,7 +4181,7 @@ void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
 		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << '\n';
 		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
 	}
-	if (NULL == cbuf_) throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
+	if (!cbuf_) throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
 
 
 	try
@@ -3275,7 +4205,7 @@ void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
 		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << '\n';
 		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
 	}
-	if (NULL == cbuf_)
+	if (!cbuf_)
       throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
 }
 
@@ -3426,7 +4356,7 @@ void CMMCore::setAutoFocusDevice(const char* autofocusLabel) MMCORE_LEGACY_THROW
    properties_->Set(MM::g_Keyword_CoreAutoFocus, newAutofocusLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoFocus, newAutofocusLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoFocus, newAutofocusLabel.c_str()));
    }
 }
 
@@ -3478,22 +4408,40 @@ std::string CMMCore::getGalvoDevice()
  */
 void CMMCore::setImageProcessorDevice(const char* procLabel) MMCORE_LEGACY_THROW(CMMError)
 {
+   // Frames in the pipeline may still be handed to the old processor
+   flushImageProcessing();
    if (procLabel && strlen(procLabel)>0)
    {
-      currentImageProcessor_ =
+      std::shared_ptr<ImageProcessorInstance> processor =
          deviceManager_->GetDeviceOfType<ImageProcessorInstance>(procLabel);
-      LOG_INFO(coreLogger_) << "Default image processor set to " << procLabel;
+      bool concurrent = false;
+      {
+         mm::DeviceModuleLockGuard guard(processor);
+         concurrent = processor->HasProperty(MM::g_Keyword_ConcurrentProcessing) &&
+            processor->GetProperty(MM::g_Keyword_ConcurrentProcessing) == "1";
+      }
+      currentImageProcessor_ = processor;
+      {
+         MMThreadGuard g(imageProcessingLock_);
+         imageProcessorConcurrent_ = concurrent;
+      }
+      LOG_INFO(coreLogger_) << "Default image processor set to " << procLabel <<
+         (concurrent ? " (concurrent)" : "");
    }
    else
    {
       currentImageProcessor_.reset();
+      {
+         MMThreadGuard g(imageProcessingLock_);
+         imageProcessorConcurrent_ = false;
+      }
       LOG_INFO(coreLogger_) << "Default image processor unset";
    }
    std::string newProcLabel = getImageProcessorDevice();
    properties_->Set(MM::g_Keyword_CoreImageProcessor, newProcLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreImageProcessor, newProcLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreImageProcessor, newProcLabel.c_str()));
    }
 }
 
@@ -3517,7 +4465,7 @@ void CMMCore::setSLMDevice(const char* slmLabel) MMCORE_LEGACY_THROW(CMMError)
    properties_->Set(MM::g_Keyword_CoreSLM, newSLMLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreSLM, newSLMLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreSLM, newSLMLabel.c_str()));
    }
 }
 
@@ -3542,7 +4490,7 @@ void CMMCore::setGalvoDevice(const char* galvoLabel) MMCORE_LEGACY_THROW(CMMErro
    properties_->Set(MM::g_Keyword_CoreGalvo, newGalvoLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreGalvo, newGalvoLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreGalvo, newGalvoLabel.c_str()));
    }
 }
 
@@ -3569,7 +4517,7 @@ void CMMCore::setChannelGroup(const char* chGroup) MMCORE_LEGACY_THROW(CMMError)
 
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreChannelGroup, channelGroup_.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreChannelGroup, channelGroup_.c_str()));
    }
    if (externalCallback_ != 0) 
    {
@@ -3631,7 +4579,7 @@ void CMMCore::setShutterDevice(const char* shutterLabel) MMCORE_LEGACY_THROW(CMM
    properties_->Set(MM::g_Keyword_CoreShutter, newShutterLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreShutter, newShutterLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreShutter, newShutterLabel.c_str()));
    }
 }
 
@@ -3656,7 +4604,7 @@ void CMMCore::setFocusDevice(const char* focusLabel) MMCORE_LEGACY_THROW(CMMErro
    properties_->Set(MM::g_Keyword_CoreFocus, newFocusLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreFocus, newFocusLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreFocus, newFocusLabel.c_str()));
    }
 }
 
@@ -3680,7 +4628,7 @@ void CMMCore::setXYStageDevice(const char* xyDeviceLabel) MMCORE_LEGACY_THROW(CM
    properties_->Set(MM::g_Keyword_CoreXYStage, newXYStageLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreXYStage, newXYStageLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreXYStage, newXYStageLabel.c_str()));
    }
 }
 
@@ -3719,7 +4667,7 @@ void CMMCore::setCameraDevice(const char* cameraLabel) MMCORE_LEGACY_THROW(CMMEr
    properties_->Set(MM::g_Keyword_CoreCamera, newCameraLabel.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreCamera, newCameraLabel.c_str()));
+      cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreCamera, newCameraLabel.c_str()));
    }
 }
 
@@ -3815,7 +4763,7 @@ std::string CMMCore::getProperty(const char* label, const char* propName) MMCORE
    std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
    CheckPropertyName(propName);
 
-   mm::DeviceModuleLockGuard guard(pDevice);
+   mm::DeviceModuleReadLockGuard guard(pDevice);
    std::string value = pDevice->GetProperty(propName);
 
    // use the opportunity to update the cache
@@ -3823,7 +4771,7 @@ std::string CMMCore::getProperty(const char* label, const char* propName) MMCORE
    PropertySetting s(label, propName, value.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(s);
+      cacheSetting(s);
    }
 
    return value;
@@ -3864,6 +4812,8 @@ std::string CMMCore::getPropertyFromCache(const char* label, const char* propNam
 void CMMCore::setProperty(const char* label, const char* propName,
                           const char* propValue) MMCORE_LEGACY_THROW(CMMError)
 {
+   MMCORE_TRACE_SPAN("Core", "CMMCore::setProperty");
+
    CheckDeviceLabel(label);
    CheckPropertyName(propName);
    CheckPropertyValue(propValue);
@@ -3876,7 +4826,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
       properties_->Execute(propName, propValue);
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, propName, propValue));
+         cacheSetting(PropertySetting(MM::g_Keyword_CoreDevice, propName, propValue));
       }
 
       LOG_DEBUG(coreLogger_) << "Did set Core property: " <<
@@ -3892,7 +4842,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
 
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(label, propName, propValue));
+         cacheSetting(PropertySetting(label, propName, propValue));
       }
    }
 }
@@ -4360,7 +5310,7 @@ void CMMCore::setExposure(const char* label, double dExp) MMCORE_LEGACY_THROW(CM
       {
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(label, MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(dExp)));
+            cacheSetting(PropertySetting(label, MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(dExp)));
          }
       }
    }
@@ -4717,7 +5667,7 @@ void CMMCore::setState(const char* deviceLabel, long state) MMCORE_LEGACY_THROW(
    {
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
+         cacheSetting(PropertySetting(deviceLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
       }
    }
    if (pStateDev->HasProperty(MM::g_Keyword_Label))
@@ -4726,7 +5676,7 @@ void CMMCore::setState(const char* deviceLabel, long state) MMCORE_LEGACY_THROW(
 
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, posLbl.c_str()));
+         cacheSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, posLbl.c_str()));
       }
    }
 
@@ -4798,7 +5748,7 @@ void CMMCore::setStateLabel(const char* deviceLabel, const char* stateLabel) MMC
    {
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, stateLabel));
+         cacheSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, stateLabel));
       }
    }
    if (pStateDev->HasProperty(MM::g_Keyword_State))
@@ -4806,7 +5756,7 @@ void CMMCore::setStateLabel(const char* deviceLabel, const char* stateLabel) MMC
       long state = getStateFromLabel(deviceLabel, stateLabel);
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_State,
+         cacheSetting(PropertySetting(deviceLabel, MM::g_Keyword_State,
                   CDeviceUtils::ConvertToString(state)));
       }
    }
@@ -4958,6 +5908,7 @@ void CMMCore::deleteConfigGroup(const char* groupName) MMCORE_LEGACY_THROW(CMMEr
       throw CMMError(ToQuotedString(groupName) + ": " + getCoreErrorText(MMERR_NoConfigGroup),
             MMERR_NoConfigGroup);
 
+   forgetConfigSequence(groupName);
    updateAllowedChannelGroups();
 
    LOG_DEBUG(coreLogger_) << "Deleted config group " << groupName;
@@ -4971,10 +5922,28 @@ void CMMCore::renameConfigGroup(const char* oldGroupName, const char* newGroupNa
    CheckConfigGroupName(oldGroupName);
    CheckConfigGroupName(newGroupName);
 
+   const unsigned long long oldRevision = configGroups_->GetRevision(oldGroupName);
    if (!configGroups_->RenameGroup(oldGroupName, newGroupName))
       throw CMMError(ToQuotedString(oldGroupName) + ": " + getCoreErrorText(MMERR_NoConfigGroup),
             MMERR_NoConfigGroup);
 
+   // A loaded config sequence moves to the new name (and stays current
+   // unless the group was changed after it was loaded); that of a group
+   // replaced by the rename is dropped
+   if (strcmp(oldGroupName, newGroupName) != 0)
+   {
+      forgetConfigSequence(newGroupName);
+      auto sequence = configSequences_.find(oldGroupName);
+      if (sequence != configSequences_.end())
+      {
+         ConfigSequence renamed = sequence->second;
+         configSequences_.erase(sequence);
+         if (renamed.groupRevision == oldRevision)
+            renamed.groupRevision = configGroups_->GetRevision(newGroupName);
+         configSequences_[newGroupName] = renamed;
+      }
+   }
+
    LOG_DEBUG(coreLogger_) << "Renamed config group " << oldGroupName <<
       " to " << newGroupName;
 
@@ -5266,12 +6235,53 @@ void CMMCore::setPixelSizeConfig(const char* resolutionID) MMCORE_LEGACY_THROW(C
  */
 void CMMCore::setConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError)
 {
+   // Compiled presets are looked up first, without checking the names (they
+   // were checked when compiled) or looking up the preset
+   if (groupName && configName)
+   {
+      auto group = compiledPresets_.find(groupName);
+      if (group != compiledPresets_.end())
+      {
+         auto compiled = group->second.find(configName);
+         if (compiled != group->second.end())
+         {
+            if (compiled->second->groupRevision == configGroups_->GetRevision(groupName))
+            {
+               LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+                  ": will apply compiled preset " << configName;
+
+               // Keep the plan alive even if it is replaced below
+               std::shared_ptr<const ConfigurationPlan> plan = compiled->second;
+               if (applyConfigurationPlan(*plan))
+               {
+                  // A new prerequisite was learned; recompile to take it
+                  // into account
+                  try
+                  {
+                     compileConfig(groupName, configName);
+                  }
+                  catch (const CMMError&)
+                  {
+                     forgetCompiledPreset(groupName, configName);
+                  }
+               }
+
+               LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+                  ": did apply preset " << configName;
+               return;
+            }
+
+            LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+               ": discarding out-of-date compiled preset " << configName;
+            forgetCompiledPreset(groupName, configName);
+         }
+      }
+   }
+
    CheckConfigGroupName(groupName);
    CheckConfigPresetName(configName);
 
    Configuration* pCfg = configGroups_->Find(groupName, configName);
-   std::ostringstream os;
-   os << groupName << "/" << configName;
    if (!pCfg)
    {
       throw CMMError("Preset " + ToQuotedString(configName) +
@@ -5283,113 +6293,400 @@ void CMMCore::setConfig(const char* groupName, const char* configName) MMCORE_LE
    LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
       ": will apply preset " << configName;
 
-   try {
-      applyConfiguration(*pCfg);
-   } catch (CMMError&) {
-      throw;
-   }
+   applyConfiguration(*pCfg);
 
    LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
       ": did apply preset " << configName;
 }
 
 /**
- * Renames a configuration within a specified group. The command will fail if the
- * configuration was not previously defined.
+ * Compiles a configuration preset for fast repeated application.
  *
+ * The settings of the preset are checked against the devices (the property
+ * must exist, be writable, and accept the value given its allowed values or
+ * limits) and the devices are looked up once. Subsequent calls to setConfig()
+ * for the preset apply the compiled form without repeating this work.
+ *
+ * A compiled preset is discarded when anything in its group is defined,
+ * deleted, or renamed, and when a device it sets is unloaded; call this
+ * function again to recompile it. Presets whose allowed values depend on
+ * the order of application may fail to compile; apply these uncompiled.
+ *
+ * @param groupName   the configuration group name
+ * @param configName  the configuration preset name
  */
-void CMMCore::renameConfig(const char* groupName, const char* oldConfigName, const char* newConfigName) MMCORE_LEGACY_THROW(CMMError)
+void CMMCore::compileConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError)
 {
    CheckConfigGroupName(groupName);
-   CheckConfigPresetName(oldConfigName);
-   CheckConfigPresetName(newConfigName);
+   CheckConfigPresetName(configName);
 
-   if (!configGroups_->RenameConfig(groupName, oldConfigName, newConfigName)) {
-      logError("renameConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
-      throw CMMError("Configuration group " + ToQuotedString(oldConfigName) +
+   Configuration* pCfg = configGroups_->Find(groupName, configName);
+   if (!pCfg)
+   {
+      throw CMMError("Preset " + ToQuotedString(configName) +
+            " of configuration group " + ToQuotedString(groupName) +
             " does not exist",
             MMERR_NoConfiguration);
    }
 
+   std::shared_ptr<ConfigurationPlan> plan =
+      std::make_shared<ConfigurationPlan>(planConfiguration(*pCfg));
+   validateConfigurationPlan(*plan);
+   plan->groupRevision = configGroups_->GetRevision(groupName);
+   compiledPresets_[groupName][configName] = plan;
+
    LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
-      ": renamed preset " << oldConfigName << " to " << newConfigName;
+      ": compiled preset " << configName;
 }
 
 /**
- * Deletes a configuration from a group. The command will fail if the
- * configuration was not previously defined.
+ * Returns true if the preset has been compiled with compileConfig() and
+ * the compiled form is still up to date.
  *
+ * @param groupName   the configuration group name
+ * @param configName  the configuration preset name
  */
-void CMMCore::deleteConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError)
+bool CMMCore::isConfigCompiled(const char* groupName, const char* configName)
 {
    CheckConfigGroupName(groupName);
    CheckConfigPresetName(configName);
 
-   std::ostringstream os;
-   os << groupName << "/" << configName;
-   if (!configGroups_->Delete(groupName, configName)) {
-      logError("deleteConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
-      throw CMMError("Configuration group " + ToQuotedString(groupName) +
-            " does not exist",
-            MMERR_NoConfiguration);
-   }
-
-   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
-      ": deleted preset " << configName;
+   auto group = compiledPresets_.find(groupName);
+   if (group == compiledPresets_.end())
+      return false;
+   auto compiled = group->second.find(configName);
+   return compiled != group->second.end() &&
+      compiled->second->groupRevision == configGroups_->GetRevision(groupName);
 }
 
 /**
- * Deletes a property from a configuration in the specified group. The command will fail if the
- * configuration was not previously defined.
+ * Loads a sequence of presets of a configuration group into the devices as
+ * hardware-triggered property sequences.
+ *
+ * Each preset must define the same properties. Properties that have the same
+ * value in every preset are set once, immediately. Each of the other
+ * properties must be sequenceable, with a maximum sequence length of at least
+ * the number of presets; its values are loaded as a property sequence.
+ * Everything is checked before any device is changed.
+ *
+ * A loaded config sequence is started (from its beginning) together with each
+ * sequence acquisition of the current camera, immediately before the camera
+ * starts, and stopped when the acquisition is stopped with
+ * stopSequenceAcquisition(). It can also be started and stopped explicitly
+ * with startConfigSequence() and stopConfigSequence(), and is removed with
+ * clearConfigSequence(). It is also removed (and stopped) when the group is
+ * deleted, and is no longer started once any preset of the group is changed;
+ * it follows the group when the group is renamed.
+ *
+ * A property can be sequenced by the config sequence of only one group at a
+ * time; loading a sequence for a property that another group's loaded config
+ * sequence sequences fails.
  *
+ * @param groupName       the configuration group name
+ * @param presetSequence  the preset names, in the order of the triggers
  */
-void CMMCore::deleteConfig(const char* groupName, const char* configName, const char* deviceLabel, const char* propName) MMCORE_LEGACY_THROW(CMMError)
+void CMMCore::loadConfigSequence(const char* groupName, std::vector<std::string> presetSequence) MMCORE_LEGACY_THROW(CMMError)
 {
    CheckConfigGroupName(groupName);
-   CheckConfigPresetName(configName);
-   CheckDeviceLabel(deviceLabel);
-   CheckPropertyName(propName);
+   if (presetSequence.empty())
+   {
+      throw CMMError("Preset sequence for configuration group " +
+            ToQuotedString(groupName) + " is empty", MMERR_InvalidContents);
+   }
 
-   std::ostringstream os;
-   os << groupName << "/" << configName << "/" << deviceLabel << "/" << propName;
-   if (!configGroups_->Delete(groupName, configName, deviceLabel, propName)) {
-      logError("deleteConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
-      throw CMMError("Property " + ToQuotedString(propName) +
-            " of device " + ToQuotedString(deviceLabel) +
-            " is not in preset " + ToQuotedString(configName) +
-            " of configuration group " + ToQuotedString(groupName),
-            MMERR_NoConfiguration);
+   forgetStaleConfigSequences();
+
+   std::vector<Configuration> presets;
+   for (size_t i = 0; i < presetSequence.size(); ++i)
+   {
+      CheckConfigPresetName(presetSequence[i].c_str());
+      Configuration* pCfg = configGroups_->Find(groupName, presetSequence[i].c_str());
+      if (!pCfg)
+      {
+         throw CMMError("Preset " + ToQuotedString(presetSequence[i]) +
+               " of configuration group " + ToQuotedString(groupName) +
+               " does not exist",
+               MMERR_NoConfiguration);
+      }
+      presets.push_back(*pCfg);
    }
 
-   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
-      ": preset " << configName << ": deleted property " <<
-      deviceLabel << "-" << propName;
-}
+   // Decompose into one value sequence per property, in order of first
+   // appearance
+   std::vector<std::pair<std::string, std::string>> keys;
+   std::set<std::pair<std::string, std::string>> seen;
+   for (size_t i = 0; i < presets.size(); ++i)
+   {
+      for (size_t j = 0; j < presets[i].size(); ++j)
+      {
+         const PropertySetting setting = presets[i].getSetting(j);
+         const auto key = std::make_pair(setting.getDeviceLabel(), setting.getPropertyName());
+         if (seen.insert(key).second)
+            keys.push_back(key);
+      }
+   }
 
+   Configuration constant;
+   std::vector<std::pair<std::shared_ptr<DeviceInstance>, std::string>> sequenced;
+   std::vector<std::vector<std::string>> sequences;
+   for (size_t k = 0; k < keys.size(); ++k)
+   {
+      const std::string& label = keys[k].first;
+      const std::string& propName = keys[k].second;
+      std::vector<std::string> values;
+      for (size_t i = 0; i < presets.size(); ++i)
+      {
+         if (!presets[i].isPropertyIncluded(label.c_str(), propName.c_str()))
+         {
+            throw CMMError("Property " + ToQuotedString(propName) +
+                  " of device " + ToQuotedString(label) +
+                  " is not defined in preset " + ToQuotedString(presetSequence[i]) +
+                  " of configuration group " + ToQuotedString(groupName),
+                  MMERR_InvalidContents);
+         }
+         values.push_back(presets[i].getSetting(label.c_str(), propName.c_str()).getPropertyValue());
+      }
 
+      if (std::count(values.begin(), values.end(), values.front()) == (long) values.size())
+      {
+         constant.addSetting(PropertySetting(label.c_str(), propName.c_str(), values.front().c_str()));
+         continue;
+      }
 
+      if (IsCoreDeviceLabel(label.c_str()))
+      {
+         throw CMMError("Core property " + ToQuotedString(propName) +
+               " cannot be sequenced", MMERR_InvalidContents);
+      }
+      for (const std::string& other :
+            configGroups_->GetGroupsIncludingProperty(label.c_str(), propName.c_str()))
+      {
+         auto loaded = configSequences_.find(other);
+         if (other == groupName || loaded == configSequences_.end())
+            continue;
+         const auto& properties = loaded->second.properties;
+         for (size_t i = 0; i < properties.size(); ++i)
+         {
+            if (properties[i].first->GetLabel() == label && properties[i].second == propName)
+            {
+               throw CMMError("Property " + ToQuotedString(propName) +
+                     " of device " + ToQuotedString(label) +
+                     " is already sequenced by the preset sequence loaded for configuration group " +
+                     ToQuotedString(other), MMERR_InvalidContents);
+            }
+         }
+      }
+      std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
+      mm::DeviceModuleLockGuard guard(pDevice);
+      if (!pDevice->IsPropertySequenceable(propName.c_str()))
+      {
+         throw CMMError("Property " + ToQuotedString(propName) +
+               " of device " + ToQuotedString(label) + " is not sequenceable",
+               MMERR_InvalidContents);
+      }
+      const long maxLength = pDevice->GetPropertySequenceMaxLength(propName.c_str());
+      if (maxLength < (long) values.size())
+      {
+         throw CMMError("Property " + ToQuotedString(propName) +
+               " of device " + ToQuotedString(label) + " can sequence at most " +
+               ToString(maxLength) + " values, but " + ToString(values.size()) +
+               " presets were given", MMERR_InvalidContents);
+      }
+      sequenced.push_back(std::make_pair(pDevice, propName));
+      sequences.push_back(values);
+   }
 
-/**
- * Returns all defined configuration names in a given group
- *
- * For legacy reasons, an exception is not thrown if there is an error.
- * Instead, an empty vector is returned if group is not a valid config group.
- *
- * @return an array of configuration names
- */
-std::vector<std::string> CMMCore::getAvailableConfigs(const char* group) const
-{
-   std::vector<std::string> ret;
-   try
+   auto existing = configSequences_.find(groupName);
+   if (existing != configSequences_.end())
    {
-      CheckConfigGroupName(group);
-
-      ret = configGroups_->GetAvailableConfigs(group);
+      ConfigSequence previous = existing->second;
+      configSequences_.erase(existing);
+      stopConfigSequenceProperties(previous);
    }
-   catch (const CMMError&)
+
+   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+      ": will load sequence of " << presetSequence.size() << " presets (" <<
+      sequenced.size() << " sequenced and " << constant.size() <<
+      " constant properties)";
+
+   applyConfiguration(constant);
+   for (size_t k = 0; k < sequenced.size(); ++k)
    {
+      std::shared_ptr<DeviceInstance> pDevice = sequenced[k].first;
+      const char* propName = sequenced[k].second.c_str();
+      mm::DeviceModuleLockGuard guard(pDevice);
+      pDevice->ClearPropertySequence(propName);
+      for (size_t i = 0; i < sequences[k].size(); ++i)
+         pDevice->AddToPropertySequence(propName, sequences[k][i].c_str());
+      pDevice->SendPropertySequence(propName);
    }
-   return ret;
+
+   ConfigSequence& loaded = configSequences_[groupName];
+   loaded.properties = sequenced;
+   loaded.running = false;
+   loaded.groupRevision = configGroups_->GetRevision(groupName);
+
+   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+      ": did load preset sequence";
+}
+
+/**
+ * Starts the config sequence loaded for a group with loadConfigSequence(),
+ * restarting it from the beginning if it is running. Fails, removing the
+ * config sequence, if the group has been changed since it was loaded.
+ *
+ * @param groupName   the configuration group name
+ */
+void CMMCore::startConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   auto it = configSequences_.find(groupName);
+   if (it == configSequences_.end())
+   {
+      throw CMMError("No preset sequence is loaded for configuration group " +
+            ToQuotedString(groupName), MMERR_NoConfiguration);
+   }
+   if (it->second.groupRevision != configGroups_->GetRevision(groupName))
+   {
+      forgetConfigSequence(groupName);
+      throw CMMError("Configuration group " + ToQuotedString(groupName) +
+            " was changed after its preset sequence was loaded",
+            MMERR_NoConfiguration);
+   }
+   startConfigSequenceProperties(it->second);
+}
+
+/**
+ * Stops the config sequence loaded for a group with loadConfigSequence().
+ *
+ * @param groupName   the configuration group name
+ */
+void CMMCore::stopConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   auto it = configSequences_.find(groupName);
+   if (it == configSequences_.end())
+   {
+      throw CMMError("No preset sequence is loaded for configuration group " +
+            ToQuotedString(groupName), MMERR_NoConfiguration);
+   }
+   stopConfigSequenceProperties(it->second);
+}
+
+/**
+ * Stops and removes the config sequence loaded for a group, so that it is no
+ * longer started with sequence acquisitions. Does nothing if none is loaded.
+ *
+ * @param groupName   the configuration group name
+ */
+void CMMCore::clearConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   auto it = configSequences_.find(groupName);
+   if (it == configSequences_.end())
+      return;
+   ConfigSequence sequence = it->second;
+   configSequences_.erase(it);
+   stopConfigSequenceProperties(sequence);
+}
+
+/**
+ * Renames a configuration within a specified group. The command will fail if the
+ * configuration was not previously defined.
+ *
+ */
+void CMMCore::renameConfig(const char* groupName, const char* oldConfigName, const char* newConfigName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   CheckConfigPresetName(oldConfigName);
+   CheckConfigPresetName(newConfigName);
+
+   if (!configGroups_->RenameConfig(groupName, oldConfigName, newConfigName)) {
+      logError("renameConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
+      throw CMMError("Configuration group " + ToQuotedString(oldConfigName) +
+            " does not exist",
+            MMERR_NoConfiguration);
+   }
+
+   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+      ": renamed preset " << oldConfigName << " to " << newConfigName;
+}
+
+/**
+ * Deletes a configuration from a group. The command will fail if the
+ * configuration was not previously defined.
+ *
+ */
+void CMMCore::deleteConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   CheckConfigPresetName(configName);
+
+   std::ostringstream os;
+   os << groupName << "/" << configName;
+   if (!configGroups_->Delete(groupName, configName)) {
+      logError("deleteConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
+      throw CMMError("Configuration group " + ToQuotedString(groupName) +
+            " does not exist",
+            MMERR_NoConfiguration);
+   }
+
+   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+      ": deleted preset " << configName;
+}
+
+/**
+ * Deletes a property from a configuration in the specified group. The command will fail if the
+ * configuration was not previously defined.
+ *
+ */
+void CMMCore::deleteConfig(const char* groupName, const char* configName, const char* deviceLabel, const char* propName) MMCORE_LEGACY_THROW(CMMError)
+{
+   CheckConfigGroupName(groupName);
+   CheckConfigPresetName(configName);
+   CheckDeviceLabel(deviceLabel);
+   CheckPropertyName(propName);
+
+   std::ostringstream os;
+   os << groupName << "/" << configName << "/" << deviceLabel << "/" << propName;
+   if (!configGroups_->Delete(groupName, configName, deviceLabel, propName)) {
+      logError("deleteConfig", getCoreErrorText(MMERR_NoConfiguration).c_str());
+      throw CMMError("Property " + ToQuotedString(propName) +
+            " of device " + ToQuotedString(deviceLabel) +
+            " is not in preset " + ToQuotedString(configName) +
+            " of configuration group " + ToQuotedString(groupName),
+            MMERR_NoConfiguration);
+   }
+
+   LOG_DEBUG(coreLogger_) << "Config group " << groupName <<
+      ": preset " << configName << ": deleted property " <<
+      deviceLabel << "-" << propName;
+}
+
+
+
+
+/**
+ * Returns all defined configuration names in a given group
+ *
+ * For legacy reasons, an exception is not thrown if there is an error.
+ * Instead, an empty vector is returned if group is not a valid config group.
+ *
+ * @return an array of configuration names
+ */
+std::vector<std::string> CMMCore::getAvailableConfigs(const char* group) const
+{
+   std::vector<std::string> ret;
+   try
+   {
+      CheckConfigGroupName(group);
+
+      ret = configGroups_->GetAvailableConfigs(group);
+   }
+   catch (const CMMError&)
+   {
+   }
+   return ret;
 }
 
 /**
@@ -8015,9 +9312,72 @@ void CMMCore::CreateCoreProperties()
    CoreProperty propBusyTimeoutMs("5000", false, MM::Integer);
    properties_->Add(MM::g_Keyword_CoreTimeoutMs, propBusyTimeoutMs);
 
+   // Threads copying frames into the sequence buffer (0 = automatic)
+   CoreProperty propImageCopyThreads("0", false, MM::Integer);
+   const unsigned hwThreads = std::max(1u, std::thread::hardware_concurrency());
+   for (unsigned n = 0; n <= hwThreads; ++n)
+      propImageCopyThreads.AddAllowedValue(ToString(n).c_str());
+   properties_->Add(MM::g_Keyword_CoreImageCopyThreads, propImageCopyThreads);
+
+   // Logical CPUs to pin the copy threads to, e.g. "0-7;16" (empty = any)
+   CoreProperty propImageCopyCPUs("", false, MM::String);
+   properties_->Add(MM::g_Keyword_CoreImageCopyCPUs, propImageCopyCPUs);
+
+   // Threads running the image processor (0 = on the camera's thread). More
+   // threads than CPUs can help, as each ImageProcessorChain slot works on
+   // one frame at a time.
+   CoreProperty propImageProcessingThreads("0", false, MM::Integer);
+   for (unsigned n = 0; n <= std::max(16u, hwThreads); ++n)
+      propImageProcessingThreads.AddAllowedValue(ToString(n).c_str());
+   properties_->Add(MM::g_Keyword_CoreImageProcessingThreads, propImageProcessingThreads);
+
    properties_->Refresh();
 }
 
+void CMMCore::setImageCopyThreads(unsigned count,
+      const std::vector<unsigned>& cpus)
+{
+   LOG_DEBUG(coreLogger_) << "Will set sequence buffer copy threads to " <<
+      count << " (0 = automatic), pinned to " << cpus.size() << " CPUs";
+   cbuf_->SetCopyThreads(count, cpus);
+   imageCopyThreads_ = count;
+   imageCopyCPUs_ = cpus;
+}
+
+void CMMCore::setImageProcessingThreads(unsigned count)
+{
+   LOG_DEBUG(coreLogger_) << "Will set image processing threads to " <<
+      count << " (0 = camera thread)";
+   std::shared_ptr<mm::ImageProcessingPipeline> pipeline;
+   if (count > 0)
+      pipeline = std::make_shared<mm::ImageProcessingPipeline>(count);
+   {
+      MMThreadGuard g(imageProcessingLock_);
+      imageProcessingPipeline_.swap(pipeline);
+      imageProcessingThreads_ = count;
+   }
+   // The old pipeline (if not also held by a camera thread right now)
+   // finishes its frames here
+   pipeline.reset();
+}
+
+std::shared_ptr<mm::ImageProcessingPipeline>
+CMMCore::getImageProcessingPipeline(bool& concurrent) const
+{
+   MMThreadGuard g(imageProcessingLock_);
+   concurrent = imageProcessorConcurrent_;
+   return imageProcessingPipeline_;
+}
+
+void CMMCore::flushImageProcessing()
+{
+   bool concurrent;
+   std::shared_ptr<mm::ImageProcessingPipeline> pipeline =
+      getImageProcessingPipeline(concurrent);
+   if (pipeline)
+      pipeline->Flush();
+}
+
 static bool ContainsForbiddenCharacters(const std::string& str)
 {
    return (std::string::npos != str.find_first_of(MM::g_FieldDelimiters));
@@ -8090,103 +9450,640 @@ bool CMMCore::IsCoreDeviceLabel(const char* label) const MMCORE_LEGACY_THROW(CMM
    return (strcmp(label, MM::g_Keyword_CoreDevice) == 0);
 }
 
+static std::pair<std::string, std::string> SettingKeyOf(const PropertySetting& setting)
+{
+   return std::make_pair(setting.getDeviceLabel(), setting.getPropertyName());
+}
+
 /**
  * Set all properties in a configuration
  * Upon error, don't stop, but try to set all failed properties again
  * until all success or no more change takes place
  * If errors remain, throw an error
+ *
+ * A setting that only succeeded on retry is recorded as depending on the
+ * settings that were applied since it last failed. Later applications put
+ * such settings after their prerequisites (and wait for the prerequisite
+ * devices to become non-busy first), so that no retry is needed.
+ *
+ * When the "ParallelConfigApplication" feature is enabled, Core settings are
+ * applied first; device settings are then applied concurrently, one thread
+ * per device module, keeping their order within each module. Settings with
+ * learned prerequisites in another module are deferred until those have been
+ * applied.
  */
 void CMMCore::applyConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::ostringstream sall;
-   bool error = false;
-   std::vector<PropertySetting> failedProps;
-   for (size_t i=0; i<config.size(); i++)
+   MMCORE_TRACE_SPAN("Core", "CMMCore::applyConfiguration");
+   applyConfigurationPlan(planConfiguration(config));
+}
+
+/*
+ * Helper function for applyConfiguration
+ * Orders the settings, resolves their devices, and finds the learned
+ * prerequisites of each setting within the configuration
+ */
+CMMCore::ConfigurationPlan CMMCore::planConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError)
+{
+   typedef std::pair<std::string, std::string> SettingKey;
+
+   ConfigurationPlan plan;
+   plan.settings = orderSettings(config);
+   const std::vector<PropertySetting>& settings = plan.settings;
+   const size_t n = settings.size();
+
+   plan.devices.resize(n);
+   for (size_t i = 0; i < n; ++i)
    {
-      PropertySetting setting = config.getSetting(i);
+      if (settings[i].getDeviceLabel() != MM::g_Keyword_CoreDevice)
+         plan.devices[i] = deviceManager_->GetDevice(settings[i].getDeviceLabel());
+   }
 
-      // perform special processing for core commands
-      if (setting.getDeviceLabel().compare(MM::g_Keyword_CoreDevice) == 0)
+   // Devices to wait for before applying each setting: those of its learned
+   // prerequisites that come earlier in this configuration
+   std::vector<std::vector<size_t>>& prerequisites = plan.prerequisites;
+   prerequisites.resize(n);
+   {
+      std::map<SettingKey, size_t> index;
+      for (size_t i = 0; i < n; ++i)
+         index[SettingKeyOf(settings[i])] = i;
+      MMThreadGuard g(settingOrderLock_);
+      for (size_t i = 0; i < n; ++i)
       {
-         properties_->Execute(setting.getPropertyName().c_str(), setting.getPropertyValue().c_str());
+         auto it = settingPrerequisites_.find(SettingKeyOf(settings[i]));
+         if (it == settingPrerequisites_.end())
+            continue;
+         for (const SettingKey& key : it->second)
          {
-            MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, setting.getPropertyName().c_str(), setting.getPropertyValue().c_str()));
+            auto found = index.find(key);
+            if (found != index.end() && found->second < i)
+               prerequisites[i].push_back(found->second);
+         }
+      }
+   }
+   return plan;
+}
+
+/*
+ * Helper function for applyConfiguration
+ * Applies the settings of a plan, with retries. Returns true if a setting
+ * succeeded only on retry, in which case a new prerequisite was learned.
+ */
+bool CMMCore::applyConfigurationPlan(const ConfigurationPlan& plan) MMCORE_LEGACY_THROW(CMMError)
+{
+   typedef std::pair<std::string, std::string> SettingKey;
+
+   const std::vector<PropertySetting>& settings = plan.settings;
+   const std::vector<std::shared_ptr<DeviceInstance>>& pDevices = plan.devices;
+   const std::vector<std::vector<size_t>>& prerequisites = plan.prerequisites;
+   const size_t n = settings.size();
+
+   // The order in which settings succeed, and the position in that order at
+   // which each failed setting last failed, from which prerequisites are
+   // learned
+   std::mutex progressMutex;
+   std::vector<SettingKey> succeeded;
+   std::map<SettingKey, size_t> failedAt;
+   std::string lastError;
+   bool learned = false;
+
+   // Indices of applied settings, entered into the state cache together
+   // rather than taking stateCacheLock_ for each setting
+   std::vector<size_t> applied;
+   auto cacheApplied = [&]
+   {
+      MMThreadGuard scg(stateCacheLock_);
+      for (size_t i : applied)
+         cacheSetting(settings[i]);
+      applied.clear();
+   };
+
+   auto apply = [&](size_t i, bool logFailure) -> bool
+   {
+      const PropertySetting& setting = settings[i];
+      try
+      {
+         for (size_t j : prerequisites[i])
+         {
+            if (pDevices[j] && pDevices[j] != pDevices[i])
+               waitForDevice(pDevices[j]);
+         }
+
+         mm::DeviceModuleLockGuard guard(pDevices[i]);
+         pDevices[i]->SetProperty(setting.getPropertyName(),
+               setting.getPropertyValue());
+      }
+      catch (const CMMError& e)
+      {
+         std::string message = e.getFullMsg();
+         if (logFailure)
+            logError(setting.getDeviceLabel().c_str(), message.c_str());
+         std::lock_guard<std::mutex> lock(progressMutex);
+         failedAt[SettingKeyOf(setting)] = succeeded.size();
+         lastError = message;
+         return false;
+      }
+
+      std::lock_guard<std::mutex> lock(progressMutex);
+      auto it = failedAt.find(SettingKeyOf(setting));
+      if (it != failedAt.end())
+      {
+         learnSettingPrerequisites(SettingKeyOf(setting),
+               std::vector<SettingKey>(succeeded.begin() + it->second, succeeded.end()));
+         failedAt.erase(it);
+         learned = true;
+      }
+      succeeded.push_back(SettingKeyOf(setting));
+      applied.push_back(i);
+      return true;
+   };
+
+   auto applyCore = [&](size_t i)
+   {
+      const PropertySetting& setting = settings[i];
+      properties_->Execute(setting.getPropertyName().c_str(), setting.getPropertyValue().c_str());
+      std::lock_guard<std::mutex> lock(progressMutex);
+      succeeded.push_back(SettingKeyOf(setting));
+      applied.push_back(i);
+   };
+
+   try
+   {
+      std::vector<size_t> failed;
+      if (!mm::features::flags().ParallelConfigApplication)
+      {
+         for (size_t i = 0; i < n; ++i)
+         {
+            if (!pDevices[i])
+               applyCore(i);
+            else if (!apply(i, false))
+               failed.push_back(i);
          }
       }
       else
       {
-         // normal processing
-         std::shared_ptr<DeviceInstance> pDevice =
-            deviceManager_->GetDevice(setting.getDeviceLabel());
-         mm::DeviceModuleLockGuard guard(pDevice);
-         try
+         // A setting runs in the first round after all of its prerequisites in
+         // other modules, and no earlier than the previous setting of its
+         // module; within a round, each module applies its settings in order
+         // on its own thread.
+         std::vector<size_t> round(n, 0);
+         size_t rounds = 0;
+         std::map<std::shared_ptr<LoadedDeviceAdapter>, size_t> moduleRound;
+         for (size_t i = 0; i < n; ++i)
          {
-            pDevice->SetProperty(setting.getPropertyName(),
-                  setting.getPropertyValue());
+            if (!pDevices[i])
+            {
+               applyCore(i);
+               continue;
+            }
+            size_t& lastRound = moduleRound[pDevices[i]->GetAdapterModule()];
+            round[i] = lastRound;
+            for (size_t j : prerequisites[i])
+            {
+               if (!pDevices[j])
+                  continue;
+               const bool sameModule =
+                  pDevices[j]->GetAdapterModule() == pDevices[i]->GetAdapterModule();
+               round[i] = std::max(round[i], round[j] + (sameModule ? 0 : 1));
+            }
+            lastRound = round[i];
+            rounds = std::max(rounds, round[i] + 1);
+         }
 
+         std::vector<char> ok(n, true); // Not vector<bool>: written concurrently
+         for (size_t r = 0; r < rounds; ++r)
+         {
+            std::map<std::shared_ptr<LoadedDeviceAdapter>, std::vector<size_t>> moduleMap;
+            for (size_t i = 0; i < n; ++i)
             {
-               MMThreadGuard scg(stateCacheLock_);
-               stateCache_.addSetting(setting);
+               if (pDevices[i] && round[i] == r)
+                  moduleMap[pDevices[i]->GetAdapterModule()].push_back(i);
             }
+
+            LOG_DEBUG(coreLogger_) << "Will apply configuration settings of " <<
+               moduleMap.size() << " modules in parallel";
+
+            std::vector<std::future<void>> futures;
+            for (auto& moduleSettings : moduleMap)
+            {
+               const std::vector<size_t>& indices = moduleSettings.second;
+               futures.push_back(std::async(std::launch::async, [&apply, &ok, &indices]
+               {
+                  for (size_t i : indices)
+                     ok[i] = apply(i, false);
+               }));
+            }
+
+            std::exception_ptr pex;
+            for (auto& fut : futures)
+            {
+               try
+               {
+                  fut.get();
+               }
+               catch (const std::exception&)
+               {
+                  if (!pex)
+                     pex = std::current_exception();
+               }
+            }
+            if (pex)
+               std::rethrow_exception(pex);
          }
-         catch (const CMMError&)
+
+         for (size_t i = 0; i < n; ++i)
          {
-            failedProps.push_back(setting);
-            error = true;
+            if (!ok[i])
+               failed.push_back(i);
          }
       }
+
+      // It is possible that setting certain properties failed because they are
+      // dependent on other properties to be set first. As a workaround, continue
+      // to apply these failed properties until there are none left or none
+      // succeed
+      while (!failed.empty())
+      {
+         std::vector<size_t> stillFailed;
+         for (size_t i : failed)
+         {
+            if (!apply(i, true))
+               stillFailed.push_back(i);
+         }
+         if (stillFailed.size() == failed.size())
+            throw CMMError(lastError.c_str(), MMERR_DEVICE_GENERIC);
+         failed.swap(stillFailed);
+      }
    }
-   if (error)
+   catch (...)
    {
-      std::string errorString;
-      while (failedProps.size() > (unsigned) applyProperties(failedProps, errorString) )
+      cacheApplied();
+      throw;
+   }
+   cacheApplied();
+   return learned;
+}
+
+/*
+ * Helper function for applyConfiguration
+ * Returns the settings of the configuration in their original order, except
+ * that settings with learned prerequisites are moved after them
+ */
+std::vector<PropertySetting> CMMCore::orderSettings(const Configuration& config)
+{
+   std::vector<PropertySetting> settings;
+   for (size_t i = 0; i < config.size(); ++i)
+      settings.push_back(config.getSetting(i));
+
+   MMThreadGuard g(settingOrderLock_);
+   if (settingPrerequisites_.empty())
+      return settings;
+
+   std::set<std::pair<std::string, std::string>> pending;
+   for (const PropertySetting& setting : settings)
+      pending.insert(SettingKeyOf(setting));
+
+   // Repeatedly take the earliest setting none of whose prerequisites is
+   // still pending; if there is none (a cycle), take the earliest setting
+   std::vector<PropertySetting> ordered;
+   std::vector<bool> taken(settings.size(), false);
+   while (ordered.size() < settings.size())
+   {
+      size_t next = settings.size();
+      for (size_t i = 0; i < settings.size() && next == settings.size(); ++i)
       {
-         if (failedProps.size() == 0)
-            return;
+         if (taken[i])
+            continue;
+         bool ready = true;
+         auto it = settingPrerequisites_.find(SettingKeyOf(settings[i]));
+         if (it != settingPrerequisites_.end())
+         {
+            for (const auto& key : it->second)
+            {
+               if (pending.count(key))
+               {
+                  ready = false;
+                  break;
+               }
+            }
+         }
+         if (ready)
+            next = i;
       }
+      if (next == settings.size())
+         next = std::find(taken.begin(), taken.end(), false) - taken.begin();
 
-      throw CMMError(errorString.c_str(), MMERR_DEVICE_GENERIC);
+      taken[next] = true;
+      pending.erase(SettingKeyOf(settings[next]));
+      ordered.push_back(settings[next]);
+   }
+   return ordered;
+}
+
+void CMMCore::learnSettingPrerequisites(const std::pair<std::string, std::string>& setting,
+      const std::vector<std::pair<std::string, std::string>>& prerequisites)
+{
+   if (prerequisites.empty())
+      return;
+
+   std::ostringstream names;
+   {
+      MMThreadGuard g(settingOrderLock_);
+      std::set<std::pair<std::string, std::string>>& known = settingPrerequisites_[setting];
+      for (const auto& key : prerequisites)
+      {
+         if (key != setting && known.insert(key).second)
+            names << ' ' << key.first << '-' << key.second;
+      }
+   }
+   if (!names.str().empty())
+   {
+      LOG_INFO(coreLogger_) << "Will apply " << setting.first << '-' <<
+         setting.second << " after" << names.str();
    }
 }
 
 /*
- * Helper function for applyConfiguration
- * It is possible that setting certain properties failed because they are dependent
- * on other properties to be set first. As a workaround, continue to apply these failed
- * properties until there are none left or none succeed
- * returns number of properties successfully set
+ * Helper function for compileConfig
+ * Checks each setting against the property it sets
  */
-int CMMCore::applyProperties(std::vector<PropertySetting>& props, std::string& lastError)
+void CMMCore::validateConfigurationPlan(const ConfigurationPlan& plan) MMCORE_LEGACY_THROW(CMMError)
 {
-  // int succeeded = 0;
-   std::vector<PropertySetting> failedProps;
-   for (size_t i=0; i<props.size(); i++)
+   for (size_t i = 0; i < plan.settings.size(); ++i)
    {
-      // normal processing
-      std::shared_ptr<DeviceInstance> pDevice =
-         deviceManager_->GetDevice(props[i].getDeviceLabel());
+      const std::string name = plan.settings[i].getPropertyName();
+      const std::string value = plan.settings[i].getPropertyValue();
+
+      if (!plan.devices[i])
+      {
+         if (!properties_->Has(name.c_str()) || properties_->IsReadOnly(name.c_str()))
+         {
+            throw CMMError("Core property " + ToQuotedString(name) +
+                  " does not exist or is read-only", MMERR_InvalidCoreProperty);
+         }
+         const std::vector<std::string> allowed = properties_->GetAllowedValues(name.c_str());
+         if (!allowed.empty() && std::find(allowed.begin(), allowed.end(), value) == allowed.end())
+         {
+            throw CMMError("Value " + ToQuotedString(value) +
+                  " is not allowed for Core property " + ToQuotedString(name),
+                  MMERR_InvalidCoreValue);
+         }
+         continue;
+      }
+
+      std::shared_ptr<DeviceInstance> pDevice = plan.devices[i];
       mm::DeviceModuleLockGuard guard(pDevice);
-      try
+      const std::string label = pDevice->GetLabel();
+      if (!pDevice->HasProperty(name) || pDevice->GetPropertyReadOnly(name.c_str()))
+      {
+         throw CMMError("Property " + ToQuotedString(name) + " of device " +
+               ToQuotedString(label) + " does not exist or is read-only",
+               MMERR_InvalidContents);
+      }
+
+      bool allowed = true;
+      const unsigned nValues = pDevice->GetNumberOfPropertyValues(name.c_str());
+      if (nValues > 0)
+      {
+         allowed = false;
+         for (unsigned k = 0; k < nValues && !allowed; ++k)
+            allowed = pDevice->GetPropertyValueAt(name, k) == value;
+      }
+      else if (pDevice->HasPropertyLimits(name.c_str()))
       {
-         pDevice->SetProperty(props[i].getPropertyName(),
-               props[i].getPropertyValue());
+         char* end = nullptr;
+         const double number = strtod(value.c_str(), &end);
+         allowed = end != value.c_str() && *end == '\0' &&
+            number >= pDevice->GetPropertyLowerLimit(name.c_str()) &&
+            number <= pDevice->GetPropertyUpperLimit(name.c_str());
+      }
+      if (!allowed)
+      {
+         throw CMMError("Value " + ToQuotedString(value) +
+               " is not allowed for property " + ToQuotedString(name) +
+               " of device " + ToQuotedString(label), MMERR_InvalidContents);
+      }
+   }
+}
+
+void CMMCore::startConfigSequenceProperties(ConfigSequence& sequence) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (sequence.running)
+      stopConfigSequenceProperties(sequence);
 
+   size_t started = 0;
+   try
+   {
+      for (; started < sequence.properties.size(); ++started)
+      {
+         std::shared_ptr<DeviceInstance> pDevice = sequence.properties[started].first;
+         mm::DeviceModuleLockGuard guard(pDevice);
+         pDevice->StartPropertySequence(sequence.properties[started].second.c_str());
+      }
+   }
+   catch (const CMMError&)
+   {
+      // Leave none of the properties running
+      for (size_t i = 0; i < started; ++i)
+      {
+         std::shared_ptr<DeviceInstance> pDevice = sequence.properties[i].first;
+         try
+         {
+            mm::DeviceModuleLockGuard guard(pDevice);
+            pDevice->StopPropertySequence(sequence.properties[i].second.c_str());
+         }
+         catch (const CMMError&)
          {
-            MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(props[i]);
          }
       }
+      throw;
+   }
+   sequence.running = true;
+}
+
+void CMMCore::stopConfigSequenceProperties(ConfigSequence& sequence) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (!sequence.running)
+      return;
+   sequence.running = false;
+
+   // Stop every property even if some fail
+   std::exception_ptr pex;
+   for (size_t i = 0; i < sequence.properties.size(); ++i)
+   {
+      std::shared_ptr<DeviceInstance> pDevice = sequence.properties[i].first;
+      try
+      {
+         mm::DeviceModuleLockGuard guard(pDevice);
+         pDevice->StopPropertySequence(sequence.properties[i].second.c_str());
+      }
       catch (const CMMError& e)
       {
-         failedProps.push_back(props[i]);
-         std::string message = e.getFullMsg();
-         logError(props[i].getDeviceLabel().c_str(), message.c_str());
-         lastError = message;
+         logError(pDevice->GetLabel().c_str(), e.getFullMsg().c_str());
+         if (!pex)
+            pex = std::current_exception();
+      }
+   }
+   if (pex)
+      std::rethrow_exception(pex);
+}
+
+/*
+ * Starts all loaded config sequences, for a sequence acquisition, except those
+ * of groups changed since they were loaded, which are removed. If one fails
+ * to start, those already started are stopped again.
+ */
+void CMMCore::startConfigSequences() MMCORE_LEGACY_THROW(CMMError)
+{
+   forgetStaleConfigSequences();
+   for (auto it = configSequences_.begin(); it != configSequences_.end(); ++it)
+   {
+      try
+      {
+         startConfigSequenceProperties(it->second);
+      }
+      catch (const CMMError&)
+      {
+         for (auto started = configSequences_.begin(); started != it; ++started)
+         {
+            try
+            {
+               stopConfigSequenceProperties(started->second);
+            }
+            catch (const CMMError&)
+            {
+            }
+         }
+         throw;
+      }
+   }
+}
+
+void CMMCore::stopConfigSequences() MMCORE_LEGACY_THROW(CMMError)
+{
+   std::exception_ptr pex;
+   for (auto it = configSequences_.begin(); it != configSequences_.end(); ++it)
+   {
+      try
+      {
+         stopConfigSequenceProperties(it->second);
+      }
+      catch (const CMMError&)
+      {
+         if (!pex)
+            pex = std::current_exception();
+      }
+   }
+   if (pex)
+      std::rethrow_exception(pex);
+}
+
+void CMMCore::forgetConfigSequences(const std::string& label)
+{
+   for (auto it = configSequences_.begin(); it != configSequences_.end(); )
+   {
+      const auto& properties = it->second.properties;
+      bool usesDevice = false;
+      for (size_t i = 0; i < properties.size() && !usesDevice; ++i)
+         usesDevice = properties[i].first->GetLabel() == label;
+      if (usesDevice)
+         it = configSequences_.erase(it);
+      else
+         ++it;
+   }
+}
+
+void CMMCore::forgetConfigSequence(const std::string& groupName)
+{
+   auto it = configSequences_.find(groupName);
+   if (it == configSequences_.end())
+      return;
+   ConfigSequence sequence = it->second;
+   configSequences_.erase(it);
+   try
+   {
+      stopConfigSequenceProperties(sequence); // Errors are logged
+   }
+   catch (const CMMError&)
+   {
+   }
+}
+
+/*
+ * Removes the config sequences of groups that have been changed (or deleted)
+ * since the sequences were loaded, whose device sequences no longer match
+ * the presets.
+ */
+void CMMCore::forgetStaleConfigSequences()
+{
+   std::vector<std::string> stale;
+   for (auto it = configSequences_.begin(); it != configSequences_.end(); ++it)
+   {
+      if (it->second.groupRevision != configGroups_->GetRevision(it->first.c_str()))
+         stale.push_back(it->first);
+   }
+   for (size_t i = 0; i < stale.size(); ++i)
+   {
+      LOG_INFO(coreLogger_) << "Config group " << stale[i] <<
+         ": dropped preset sequence, as the group was changed after it was loaded";
+      forgetConfigSequence(stale[i]);
+   }
+}
+
+void CMMCore::forgetCompiledPreset(const char* groupName, const char* configName)
+{
+   auto group = compiledPresets_.find(groupName);
+   if (group == compiledPresets_.end())
+      return;
+   auto compiled = group->second.find(configName);
+   if (compiled != group->second.end())
+      group->second.erase(compiled);
+   if (group->second.empty())
+      compiledPresets_.erase(group);
+}
+
+void CMMCore::forgetCompiledPresets(const std::string& label)
+{
+   for (auto group = compiledPresets_.begin(); group != compiledPresets_.end(); )
+   {
+      CompiledPresetMap& presets = group->second;
+      for (auto it = presets.begin(); it != presets.end(); )
+      {
+         const std::vector<PropertySetting>& settings = it->second->settings;
+         bool usesDevice = false;
+         for (size_t i = 0; i < settings.size() && !usesDevice; ++i)
+            usesDevice = settings[i].getDeviceLabel() == label;
+         if (usesDevice)
+            it = presets.erase(it);
+         else
+            ++it;
+      }
+      if (presets.empty())
+         group = compiledPresets_.erase(group);
+      else
+         ++group;
+   }
+}
+
+void CMMCore::forgetSettingPrerequisites(const std::string& label)
+{
+   MMThreadGuard g(settingOrderLock_);
+   for (auto it = settingPrerequisites_.begin(); it != settingPrerequisites_.end(); )
+   {
+      if (it->first.first == label)
+      {
+         it = settingPrerequisites_.erase(it);
+         continue;
+      }
+      for (auto key = it->second.begin(); key != it->second.end(); )
+      {
+         if (key->first == label)
+            key = it->second.erase(key);
+         else
+            ++key;
       }
+      ++it;
    }
-   props = failedProps;
-   return (int) failedProps.size();
 }
 
 
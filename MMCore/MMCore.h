@@ -55,10 +55,13 @@
 #include "MMDevice.h"
 #include "MMDeviceConstants.h"
 
+#include <chrono>
 #include <cstring>
 #include <deque>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -101,7 +104,10 @@ class CMMCore;
 
 namespace mm {
    class DeviceManager;
+   class ImageHandle;
+   class ImageProcessingPipeline;
    class LogManager;
+   class MultiCameraBuffer;
 } // namespace mm
 
 typedef unsigned int* imgRGB32;
@@ -178,6 +184,7 @@ public:
    static int getMMDeviceDeviceInterfaceVersion();
 
    Configuration getSystemState();
+   Configuration getSystemState(double maxCacheAgeMs);
    void setSystemState(const Configuration& conf);
    Configuration getConfigState(const char* group, const char* config) MMCORE_LEGACY_THROW(CMMError);
    Configuration getConfigGroupState(const char* group) MMCORE_LEGACY_THROW(CMMError);
@@ -190,7 +197,8 @@ public:
 
    /** \name Logging and log management. */
    ///@{
-   void setPrimaryLogFile(const char* filename, bool truncate = false) MMCORE_LEGACY_THROW(CMMError);
+   void setPrimaryLogFile(const char* filename, bool truncate = false,
+         bool binary = false) MMCORE_LEGACY_THROW(CMMError);
    std::string getPrimaryLogFile() const;
 
    void logMessage(const char* msg);
@@ -201,9 +209,27 @@ public:
    bool stderrLogEnabled();
 
    int startSecondaryLogFile(const char* filename, bool enableDebug,
-         bool truncate = true, bool synchronous = false) MMCORE_LEGACY_THROW(CMMError);
+         bool truncate = true, bool synchronous = false,
+         bool binary = false) MMCORE_LEGACY_THROW(CMMError);
    void stopSecondaryLogFile(int handle) MMCORE_LEGACY_THROW(CMMError);
 
+   void setLogFlushIntervalMs(int intervalMs) MMCORE_LEGACY_THROW(CMMError);
+   int getLogFlushIntervalMs();
+   void setLogBatchSize(int lines) MMCORE_LEGACY_THROW(CMMError);
+   int getLogBatchSize();
+   long getLogOverflowedEntryCount();
+   long getLogDroppedEntryCount();
+   void resetLogQueueStatistics();
+
+   ///@}
+
+   /** \name Tracing of core internals. */
+   ///@{
+   void enableTracing(bool enable) MMCORE_LEGACY_THROW(CMMError);
+   bool isTracingEnabled();
+   void clearTrace();
+   std::string getTraceJSON();
+   void saveTrace(const char* filename) MMCORE_LEGACY_THROW(CMMError);
    ///@}
 
    /** \name Device listing. */
@@ -216,6 +242,11 @@ public:
    std::vector<std::string> getAvailableDevices(const char* library) MMCORE_LEGACY_THROW(CMMError);
    std::vector<std::string> getAvailableDeviceDescriptions(const char* library) MMCORE_LEGACY_THROW(CMMError);
    std::vector<long> getAvailableDeviceTypes(const char* library) MMCORE_LEGACY_THROW(CMMError);
+   long getDeviceAdapterModuleInterfaceVersion(const char* library) MMCORE_LEGACY_THROW(CMMError);
+
+   void setDeviceAdapterCacheFile(const char* filename);
+   std::string getDeviceAdapterCacheFile();
+   void refreshDeviceAdapterCache() MMCORE_LEGACY_THROW(CMMError);
    ///@}
 
    /** \name Generic device control.
@@ -261,6 +292,20 @@ public:
    bool deviceTypeBusy(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMError);
    void waitForDeviceType(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMError);
 
+   long getDeviceWaitCount(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceMaxWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   void resetDeviceWaitStatistics();
+
+   long getDeviceModuleLockCount(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   long getDeviceModuleLockSharedCount(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   long getDeviceModuleLockContentionCount(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceModuleLockWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceModuleLockMaxWaitTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceModuleLockHoldTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   double getDeviceModuleLockMaxHoldTimeMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
+   void resetDeviceModuleLockStatistics();
+
    double getDeviceDelayMs(const char* label) MMCORE_LEGACY_THROW(CMMError);
    void setDeviceDelayMs(const char* label, double delayMs) MMCORE_LEGACY_THROW(CMMError);
    bool usesDeviceDelay(const char* label) MMCORE_LEGACY_THROW(CMMError);
@@ -320,6 +365,13 @@ public:
    bool isGroupDefined(const char* groupName);
    bool isConfigDefined(const char* groupName, const char* configName);
    void setConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError);
+   void compileConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError);
+   bool isConfigCompiled(const char* groupName, const char* configName);
+   void loadConfigSequence(const char* groupName,
+         std::vector<std::string> presetSequence) MMCORE_LEGACY_THROW(CMMError);
+   void startConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError);
+   void stopConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError);
+   void clearConfigSequence(const char* groupName) MMCORE_LEGACY_THROW(CMMError);
    void deleteConfig(const char* groupName, const char* configName) MMCORE_LEGACY_THROW(CMMError);
    void deleteConfig(const char* groupName, const char* configName,
          const char* deviceLabel, const char* propName) MMCORE_LEGACY_THROW(CMMError);
@@ -423,6 +475,12 @@ public:
    bool isSequenceRunning() MMCORE_NOEXCEPT;
    bool isSequenceRunning(const char* cameraLabel) MMCORE_LEGACY_THROW(CMMError);
 
+   void startMultiCameraSequenceAcquisition(std::vector<std::string> cameraLabels,
+         long numImages, double intervalMs, bool stopOnOverflow) MMCORE_LEGACY_THROW(CMMError);
+   void stopMultiCameraSequenceAcquisition() MMCORE_LEGACY_THROW(CMMError);
+   long getRemainingFrameSetCount() MMCORE_NOEXCEPT;
+   long getUnmatchedFrameCount() MMCORE_NOEXCEPT;
+
    void* getLastImage() MMCORE_LEGACY_THROW(CMMError);
    void* popNextImage() MMCORE_LEGACY_THROW(CMMError);
    void* getLastImageMD(unsigned channel, unsigned slice, Metadata& md)
@@ -451,6 +509,18 @@ public:
          std::vector<double> exposureSequence_ms) MMCORE_LEGACY_THROW(CMMError);
    ///@}
 
+#if !defined(SWIGJAVA) && !defined(SWIGPYTHON)
+   /** \name Zero-copy sequence buffer access (include FrameBuffer.h). */
+   ///@{
+   mm::ImageHandle popNextImageHandle() MMCORE_LEGACY_THROW(CMMError);
+   mm::ImageHandle getNBeforeLastImageHandle(unsigned long n)
+      const MMCORE_LEGACY_THROW(CMMError);
+   std::vector<mm::ImageHandle> popNextFrameSetByImageNumber() MMCORE_LEGACY_THROW(CMMError);
+   std::vector<mm::ImageHandle> popNextFrameSetByTimestamp(double toleranceMs)
+      MMCORE_LEGACY_THROW(CMMError);
+   ///@}
+#endif
+
    /** \name Autofocus control. */
    ///@{
    double getLastFocusScore();
@@ -708,6 +778,18 @@ private:
    std::string channelGroup_;
    long pollingIntervalMs_;
    long timeoutMs_;
+   // Sequence buffer copy threads (0 = one per hardware thread) and the CPUs
+   // to pin them to (empty = not pinned)
+   unsigned imageCopyThreads_ = 0;
+   std::vector<unsigned> imageCopyCPUs_;
+   // Threads running the image processor off the camera's thread (0 = run it
+   // on the camera's thread). The pipeline, and whether the current image
+   // processor may be called from several threads at once, are synchronized
+   // by imageProcessingLock_.
+   unsigned imageProcessingThreads_ = 0;
+   mutable MMThreadLock imageProcessingLock_;
+   std::shared_ptr<mm::ImageProcessingPipeline> imageProcessingPipeline_;
+   bool imageProcessorConcurrent_ = false;
    bool autoShutter_;
    std::vector<double> *nullAffine_;
    MM::Core* callback_;                 // core services for devices
@@ -715,7 +797,14 @@ private:
    CorePropertyCollection* properties_;
    MMEventCallback* externalCallback_;  // notification hook to the higher layer (e.g. GUI)
    PixelSizeConfigGroup* pixelSizeGroup_;
-   CircularBuffer* cbuf_;
+   std::shared_ptr<CircularBuffer> cbuf_;
+   // Per-camera partitions used by startMultiCameraSequenceAcquisition();
+   // images from those cameras are routed there while multiCameraRouting_ is
+   // set. Both are synchronized by multiCameraLock_; the buffer is kept after
+   // stopping so that it can be drained.
+   mutable MMThreadLock multiCameraLock_;
+   std::shared_ptr<mm::MultiCameraBuffer> multiCameraBuffer_;
+   bool multiCameraRouting_ = false;
 
    std::shared_ptr<CPluginManager> pluginManager_;
    std::shared_ptr<mm::DeviceManager> deviceManager_;
@@ -725,6 +814,40 @@ private:
    // or acquiring a module lock
    mutable MMThreadLock stateCacheLock_;
    mutable Configuration stateCache_; // Synchronized by stateCacheLock_
+   // When each stateCache_ entry was last set; synchronized by stateCacheLock_
+   std::map<std::pair<std::string, std::string>,
+      std::chrono::steady_clock::time_point> stateCacheTimes_;
+
+   // Settings (device, property) that applyConfiguration() has found to
+   // succeed only after other settings were applied, mapped to those
+   // settings; synchronized by settingOrderLock_
+   MMThreadLock settingOrderLock_;
+   std::map<std::pair<std::string, std::string>,
+      std::set<std::pair<std::string, std::string>>> settingPrerequisites_;
+
+   // A configuration resolved for application by applyConfiguration()
+   struct ConfigurationPlan
+   {
+      std::vector<PropertySetting> settings; // In application order
+      std::vector<std::shared_ptr<DeviceInstance>> devices; // Null for Core
+      // Earlier settings learned to be prerequisites of each setting
+      std::vector<std::vector<size_t>> prerequisites;
+      unsigned long long groupRevision = 0; // For compiled presets
+   };
+   // Presets compiled by compileConfig(), by group and preset name (compared
+   // transparently, so that setConfig() looks them up without allocating)
+   typedef std::map<std::string, std::shared_ptr<const ConfigurationPlan>,
+      std::less<>> CompiledPresetMap;
+   std::map<std::string, CompiledPresetMap, std::less<>> compiledPresets_;
+
+   // Property sequences loaded by loadConfigSequence()
+   struct ConfigSequence
+   {
+      std::vector<std::pair<std::shared_ptr<DeviceInstance>, std::string>> properties;
+      bool running = false;
+      unsigned long long groupRevision = 0; // Stale once the group changes
+   };
+   std::map<std::string, ConfigSequence> configSequences_; // By group name
 
    // True while interpreting the config file (but not while rolling back on
    // failure):
@@ -744,7 +867,25 @@ private:
    bool IsCoreDeviceLabel(const char* label) const MMCORE_LEGACY_THROW(CMMError);
 
    void applyConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError);
-   int applyProperties(std::vector<PropertySetting>& props, std::string& lastError);
+   ConfigurationPlan planConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError);
+   void validateConfigurationPlan(const ConfigurationPlan& plan) MMCORE_LEGACY_THROW(CMMError);
+   bool applyConfigurationPlan(const ConfigurationPlan& plan) MMCORE_LEGACY_THROW(CMMError);
+   void forgetCompiledPreset(const char* groupName, const char* configName);
+   void forgetCompiledPresets(const std::string& label);
+   void startConfigSequenceProperties(ConfigSequence& sequence) MMCORE_LEGACY_THROW(CMMError);
+   void stopConfigSequenceProperties(ConfigSequence& sequence) MMCORE_LEGACY_THROW(CMMError);
+   void startConfigSequences() MMCORE_LEGACY_THROW(CMMError);
+   void stopConfigSequences() MMCORE_LEGACY_THROW(CMMError);
+   void forgetConfigSequences(const std::string& label);
+   void forgetConfigSequence(const std::string& groupName);
+   void forgetStaleConfigSequences();
+   std::shared_ptr<CircularBuffer> getSequenceBuffer(const MM::Device* camera);
+   std::shared_ptr<mm::MultiCameraBuffer> getMultiCameraBuffer() const;
+   void stopMultiCameraRouting();
+   std::vector<PropertySetting> orderSettings(const Configuration& config);
+   void learnSettingPrerequisites(const std::pair<std::string, std::string>& setting,
+         const std::vector<std::pair<std::string, std::string>>& prerequisites);
+   void forgetSettingPrerequisites(const std::string& label);
    void waitForDevice(std::shared_ptr<DeviceInstance> pDev) MMCORE_LEGACY_THROW(CMMError);
    Configuration getConfigGroupState(const char* group, bool fromCache) MMCORE_LEGACY_THROW(CMMError);
    std::string getDeviceErrorText(int deviceCode, std::shared_ptr<DeviceInstance> pDevice);
@@ -755,8 +896,17 @@ private:
    void removeDeviceRole(std::shared_ptr<DeviceInstance> pDev);
    void removeAllDeviceRoles();
    void updateCoreProperty(const char* propName, MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMError);
+   void setImageCopyThreads(unsigned count, const std::vector<unsigned>& cpus);
+   void setImageProcessingThreads(unsigned count);
+   std::shared_ptr<mm::ImageProcessingPipeline> getImageProcessingPipeline(
+         bool& concurrent) const;
+   void flushImageProcessing();
    void loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_THROW(CMMError);
    void initializeAllDevicesSerial() MMCORE_LEGACY_THROW(CMMError);
    void initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError);
+   std::vector<PropertySetting> getDeviceStates(
+         const std::vector<std::shared_ptr<DeviceInstance>>& devices,
+         double maxCacheAgeMs);
+   void cacheSetting(const PropertySetting& setting);
    int initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<DeviceInstance>, std::string> > pDevices);
 };
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MultiCameraBuffer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Sequence buffer partitioned by camera, for acquiring from
+//                several cameras at once, with matching of frame sets.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "MultiCameraBuffer.h"
+
+#include "MMDeviceConstants.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace mm {
+
+namespace {
+
+// Partitions holding small frames would otherwise get millions of slots,
+// whose per-slot overhead is not part of the memory footprint; this is
+// still ample for matching frame sets.
+const unsigned long maxPartitionImageCount = 100000;
+
+double ImageNumberOf(const ImageHandle& image)
+{
+   return std::atof(image.GetMetadata().GetSingleTag(
+      MM::g_Keyword_Metadata_ImageNumber).GetValue().c_str());
+}
+
+double ElapsedTimeOf(const ImageHandle& image)
+{
+   return std::atof(image.GetMetadata().GetSingleTag(
+      MM::g_Keyword_Elapsed_Time_ms).GetValue().c_str());
+}
+
+} // namespace
+
+MultiCameraBuffer::MultiCameraBuffer(
+      const std::vector<std::string>& cameraLabels, unsigned memorySizeMB,
+      std::size_t copyThreadCount, const std::vector<unsigned>& copyThreadCPUs) :
+   labels_(cameraLabels),
+   heads_(cameraLabels.size()),
+   unmatched_(0)
+{
+   const unsigned partitionMB = std::max<unsigned>(1,
+      memorySizeMB / static_cast<unsigned>(std::max<std::size_t>(1, labels_.size())));
+   for (std::size_t i = 0; i < labels_.size(); ++i)
+   {
+      partitions_.push_back(std::make_shared<CircularBuffer>(partitionMB,
+         copyThreadCount, copyThreadCPUs));
+      partitions_.back()->SetMaxImageCount(maxPartitionImageCount);
+   }
+}
+
+std::shared_ptr<CircularBuffer>
+MultiCameraBuffer::GetPartition(const std::string& cameraLabel) const
+{
+   for (std::size_t i = 0; i < labels_.size(); ++i)
+   {
+      if (labels_[i] == cameraLabel)
+         return partitions_[i];
+   }
+   return std::shared_ptr<CircularBuffer>();
+}
+
+void MultiCameraBuffer::SetOverwriteData(bool overwrite)
+{
+   for (std::size_t i = 0; i < partitions_.size(); ++i)
+      partitions_[i]->SetOverwriteData(overwrite);
+}
+
+std::vector<ImageHandle> MultiCameraBuffer::PopFrameSetByImageNumber()
+{
+   return PopFrameSet(&ImageNumberOf, 0.5);
+}
+
+std::vector<ImageHandle> MultiCameraBuffer::PopFrameSetByTimestamp(double toleranceMs)
+{
+   return PopFrameSet(&ElapsedTimeOf, toleranceMs);
+}
+
+std::vector<ImageHandle> MultiCameraBuffer::PopFrameSet(
+      double (*key)(const ImageHandle&), double tolerance)
+{
+   std::lock_guard<std::mutex> lock(matchMutex_);
+   if (labels_.empty())
+      return std::vector<ImageHandle>();
+
+   for (;;)
+   {
+      for (std::size_t i = 0; i < heads_.size(); ++i)
+      {
+         if (!heads_[i])
+         {
+            heads_[i] = partitions_[i]->GetNextImageHandle();
+            if (!heads_[i])
+               return std::vector<ImageHandle>(); // Keep the other heads
+         }
+      }
+
+      std::size_t earliest = 0;
+      double lo = key(heads_[0]);
+      double hi = lo;
+      for (std::size_t i = 1; i < heads_.size(); ++i)
+      {
+         const double k = key(heads_[i]);
+         if (k < lo)
+         {
+            lo = k;
+            earliest = i;
+         }
+         hi = std::max(hi, k);
+      }
+
+      if (hi - lo <= tolerance)
+      {
+         std::vector<ImageHandle> frameSet;
+         frameSet.swap(heads_);
+         heads_.resize(labels_.size());
+         return frameSet;
+      }
+
+      // The earliest frame cannot be matched by any later frame of the
+      // camera(s) ahead of it
+      heads_[earliest].Release();
+      ++unmatched_;
+   }
+}
+
+unsigned long MultiCameraBuffer::GetRemainingFrameSetCount() const
+{
+   std::lock_guard<std::mutex> lock(matchMutex_);
+   unsigned long count = 0;
+   for (std::size_t i = 0; i < partitions_.size(); ++i)
+   {
+      const unsigned long n = partitions_[i]->GetRemainingImageCount() +
+         (heads_[i] ? 1 : 0);
+      count = i == 0 ? n : std::min(count, n);
+   }
+   return count;
+}
+
+unsigned long MultiCameraBuffer::GetUnmatchedFrameCount() const
+{
+   std::lock_guard<std::mutex> lock(matchMutex_);
+   return unmatched_;
+}
+
+bool MultiCameraBuffer::Overflow() const
+{
+   for (std::size_t i = 0; i < partitions_.size(); ++i)
+   {
+      if (partitions_[i]->Overflow())
+         return true;
+   }
+   return false;
+}
+
+} // namespace mm
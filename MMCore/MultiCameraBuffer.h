@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MultiCameraBuffer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Sequence buffer partitioned by camera, for acquiring from
+//                several cameras at once, with matching of frame sets.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "CircularBuffer.h"
+#include "FrameBuffer.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mm {
+
+// One CircularBuffer per camera, so that cameras with different image sizes
+// and pixel depths can stream at the same time. The memory footprint is
+// divided evenly among the cameras, and the number of frames per camera is
+// limited.
+//
+// Consumers pop frame sets (one frame per camera, in camera order) matched
+// either by image number or by the elapsed-time tag, which cameras set from
+// their hardware timestamps when they have one. Image numbers count the
+// frames each partition has received, so they only line up while no camera
+// drops frames; timestamps also survive dropped frames. A frame for which
+// some other camera has no matching frame is discarded and counted as
+// unmatched.
+class MultiCameraBuffer
+{
+public:
+   MultiCameraBuffer(const std::vector<std::string>& cameraLabels,
+      unsigned memorySizeMB, std::size_t copyThreadCount,
+      const std::vector<unsigned>& copyThreadCPUs);
+
+   const std::vector<std::string>& GetCameraLabels() const { return labels_; }
+
+   // Returns null if the camera is not one of ours
+   std::shared_ptr<CircularBuffer> GetPartition(const std::string& cameraLabel) const;
+
+   void SetOverwriteData(bool overwrite);
+
+   // Return an empty vector if no complete frame set is available
+   std::vector<ImageHandle> PopFrameSetByImageNumber();
+   std::vector<ImageHandle> PopFrameSetByTimestamp(double toleranceMs);
+
+   // Number of complete frame sets that can be popped, assuming no frames
+   // need to be discarded as unmatched
+   unsigned long GetRemainingFrameSetCount() const;
+   unsigned long GetUnmatchedFrameCount() const;
+   bool Overflow() const;
+
+private:
+   std::vector<ImageHandle> PopFrameSet(double (*key)(const ImageHandle&),
+      double tolerance);
+
+   std::vector<std::string> labels_;
+   std::vector<std::shared_ptr<CircularBuffer>> partitions_;
+
+   // Serializes consumers; the heads are frames already taken from the
+   // partitions but not yet part of a complete frame set
+   mutable std::mutex matchMutex_;
+   std::vector<ImageHandle> heads_;
+   unsigned long unmatched_;
+};
+
+} // namespace mm
@@ -35,9 +35,11 @@
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -105,6 +107,19 @@ CPluginManager::FindInSearchPath(std::string filename)
    return filename;
 }
 
+/**
+ * Return the path of the library for a module name (or the bare library
+ * filename if it is not in the search paths).
+ */
+std::string
+CPluginManager::FindModuleFile(const std::string& moduleName)
+{
+   std::string filename(LIB_NAME_PREFIX);
+   filename += moduleName;
+   filename += LIB_NAME_SUFFIX;
+   return FindInSearchPath(filename);
+}
+
 /** 
  * Load a plugin library.
  *
@@ -136,10 +151,7 @@ CPluginManager::GetDeviceAdapter(const std::string& moduleName)
       return it->second;
    }
 
-   std::string filename(LIB_NAME_PREFIX);
-   filename += moduleName;
-   filename += LIB_NAME_SUFFIX;
-   filename = FindInSearchPath(filename);
+   const std::string filename = FindModuleFile(moduleName);
 
    auto module = [&] {
       try {
@@ -185,6 +197,164 @@ CPluginManager::LoadMockAdapter(const std::string& name, MockDeviceAdapter* impl
 }
 
 
+std::vector<mm::DeviceAdapterManifest::Device>
+CPluginManager::DescribeDevices(const LoadedDeviceAdapter& module)
+{
+   std::vector<mm::DeviceAdapterManifest::Device> devices;
+   for (const auto& name : module.GetAvailableDeviceNames())
+   {
+      mm::DeviceAdapterManifest::Device device;
+      device.name = name;
+      device.description = module.GetDeviceDescription(name);
+      device.type = module.GetAdvertisedDeviceType(name);
+      devices.push_back(device);
+   }
+   return devices;
+}
+
+
+/**
+ * Load a device adapter library and record what it provides.
+ *
+ * Does not access any members, so can be run concurrently for different
+ * libraries. The module is only returned (and initialized) if its
+ * interface versions are compatible.
+ */
+CPluginManager::ProbeResult
+CPluginManager::ProbeDeviceAdapter(const std::string& moduleName,
+      const std::string& filename,
+      const mm::DeviceAdapterManifest::FileStamp& stamp)
+{
+   ProbeResult result;
+   result.entry.path = filename;
+   result.entry.stamp = stamp;
+   try
+   {
+      auto impl = std::make_unique<LoadedDeviceAdapterImplRegular>(filename);
+      result.entry.moduleInterfaceVersion = impl->GetModuleVersion();
+      result.entry.deviceInterfaceVersion = impl->GetDeviceInterfaceVersion();
+      if (result.entry.moduleInterfaceVersion != MODULE_INTERFACE_VERSION ||
+            result.entry.deviceInterfaceVersion != DEVICE_INTERFACE_VERSION)
+         return result;
+
+      result.module = std::make_shared<LoadedDeviceAdapter>(moduleName,
+            std::move(impl));
+      result.entry.devices = DescribeDevices(*result.module);
+   }
+   catch (const CMMError& e)
+   {
+      throw CMMError("Failed to load device adapter " + ToQuotedString(moduleName) +
+         " from " + ToQuotedString(filename), e);
+   }
+   return result;
+}
+
+
+/**
+ * Return what a device adapter provides, without loading its library if the
+ * manifest has an entry for the current version of the file.
+ *
+ * Throws (without recording anything) if the library cannot be loaded, and
+ * also if it has incompatible interface versions (which are recorded) unless
+ * checkVersion is false.
+ *
+ * @param moduleName Simple module name without path, prefix, or suffix.
+ * @param checkVersion Whether to throw for incompatible interface versions.
+ */
+mm::DeviceAdapterManifest::Entry
+CPluginManager::GetDeviceAdapterInfo(const std::string& moduleName,
+      bool checkVersion)
+{
+   if (moduleName.empty())
+   {
+      throw CMMError("Empty device adapter module name");
+   }
+
+   mm::DeviceAdapterManifest::Entry entry;
+   const std::string filename = FindModuleFile(moduleName);
+   mm::DeviceAdapterManifest::FileStamp stamp;
+
+   // Already loaded modules (including mock ones) are asked directly, as are
+   // those not found in the search paths (left to the system loader)
+   auto it = moduleMap_.find(moduleName);
+   if (it != moduleMap_.end() ||
+         !mm::DeviceAdapterManifest::GetFileStamp(filename, stamp))
+   {
+      entry.path = filename;
+      entry.moduleInterfaceVersion = MODULE_INTERFACE_VERSION;
+      entry.deviceInterfaceVersion = DEVICE_INTERFACE_VERSION;
+      entry.devices = DescribeDevices(*GetDeviceAdapter(moduleName));
+      return entry;
+   }
+
+   if (!manifest_.Lookup(filename, stamp, entry))
+   {
+      ProbeResult probe = ProbeDeviceAdapter(moduleName, filename, stamp);
+      if (probe.module)
+         moduleMap_[moduleName] = probe.module;
+      entry = probe.entry;
+      manifest_.Store(entry);
+      manifest_.Save();
+   }
+
+   if (!checkVersion)
+      return entry;
+   try
+   {
+      LoadedDeviceAdapter::CheckInterfaceVersion(entry.moduleInterfaceVersion,
+            entry.deviceInterfaceVersion);
+   }
+   catch (const CMMError& e)
+   {
+      throw CMMError("Failed to load device adapter " + ToQuotedString(moduleName) +
+         " from " + ToQuotedString(filename), e);
+   }
+   return entry;
+}
+
+
+void
+CPluginManager::RefreshManifest()
+{
+   std::set<std::string> paths;
+   std::vector<std::pair<std::string, std::future<ProbeResult>>> probes;
+   for (const auto& moduleName : GetAvailableDeviceAdapters())
+   {
+      const std::string filename = FindModuleFile(moduleName);
+      mm::DeviceAdapterManifest::FileStamp stamp;
+      if (!mm::DeviceAdapterManifest::GetFileStamp(filename, stamp))
+         continue;
+      paths.insert(filename);
+
+      mm::DeviceAdapterManifest::Entry entry;
+      if (moduleMap_.count(moduleName) ||
+            manifest_.Lookup(filename, stamp, entry))
+         continue;
+      probes.emplace_back(moduleName, std::async(std::launch::async,
+               &CPluginManager::ProbeDeviceAdapter, moduleName, filename, stamp));
+   }
+
+   for (auto& probe : probes)
+   {
+      try
+      {
+         ProbeResult result = probe.second.get();
+         if (result.module)
+            moduleMap_[probe.first] = result.module;
+         manifest_.Store(result.entry);
+      }
+      catch (const CMMError&)
+      {
+         // Libraries that fail to load are not recorded, so that the error
+         // is reported when they are used.
+      }
+   }
+
+   manifest_.Retain(paths);
+   manifest_.Save();
+}
+
+
 /** 
  * Unload a module.
  */
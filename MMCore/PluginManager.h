@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "DeviceAdapterManifest.h"
 #include "MockDeviceAdapter.h"
 
 #include "DeviceThreads.h"
@@ -59,12 +60,48 @@ public:
 
    void LoadMockAdapter(const std::string& name, MockDeviceAdapter* impl);
 
+   // Discovery cache (see DeviceAdapterManifest)
+   void SetManifestFilename(const std::string& filename)
+   { manifest_.SetFilename(filename); }
+   std::string GetManifestFilename() const
+   { return manifest_.GetFilename(); }
+
+   /**
+    * Return the devices and interface versions of a device adapter, from
+    * the manifest if it is up to date for the library file, otherwise by
+    * loading the module (which then stays loaded). Unless checkVersion is
+    * false, throw if the interface versions are incompatible.
+    */
+   mm::DeviceAdapterManifest::Entry
+   GetDeviceAdapterInfo(const std::string& moduleName,
+         bool checkVersion = true);
+
+   /**
+    * Bring the manifest up to date for all available device adapters,
+    * loading those with missing or stale entries in parallel.
+    */
+   void RefreshManifest();
+
 private:
+   struct ProbeResult
+   {
+      mm::DeviceAdapterManifest::Entry entry;
+      std::shared_ptr<LoadedDeviceAdapter> module; // Null if incompatible
+   };
+
+   static ProbeResult ProbeDeviceAdapter(const std::string& moduleName,
+         const std::string& filename,
+         const mm::DeviceAdapterManifest::FileStamp& stamp);
+   static std::vector<mm::DeviceAdapterManifest::Device>
+   DescribeDevices(const LoadedDeviceAdapter& module);
+
    static std::vector<std::string> GetDefaultSearchPaths();
    static void GetModules(std::vector<std::string> &modules, const char *path);
    std::string FindInSearchPath(std::string filename);
+   std::string FindModuleFile(const std::string& moduleName);
 
    std::vector<std::string> searchPaths_;
 
    std::map< std::string, std::shared_ptr<LoadedDeviceAdapter> > moduleMap_;
+   mm::DeviceAdapterManifest manifest_;
 };
@@ -41,6 +41,15 @@ void Semaphore::Wait(size_t count)
     count_ -= count;
 }
 
+bool Semaphore::TryWait(size_t count)
+{
+    std::lock_guard<std::mutex> lock(mx_);
+    if (count_ < count)
+        return false;
+    count_ -= count;
+    return true;
+}
+
 void Semaphore::Release(size_t count)
 {
     {
@@ -34,6 +34,7 @@ public:
     explicit Semaphore(size_t initCount);
 
     void Wait(size_t count = 1);
+    bool TryWait(size_t count = 1);
     void Release(size_t count = 1);
 
 private:
@@ -50,5 +50,14 @@ void TaskSet::Execute()
 
 void TaskSet::Wait()
 {
-    semaphore_->Wait(usedTaskCount_);
+    // Run queued tasks (ours or others') instead of blocking while there are
+    // any; once none are left, all of ours have been taken by some thread
+    while (!semaphore_->TryWait(usedTaskCount_))
+    {
+        if (!pool_->RunPendingTask())
+        {
+            semaphore_->Wait(usedTaskCount_);
+            return;
+        }
+    }
 }
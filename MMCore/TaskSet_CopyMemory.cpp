@@ -25,19 +25,40 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MMCORE_HAVE_SSE2_STREAMING 1
+#endif
+
+namespace {
+
+// Chunk boundaries are kept at page multiples so that no two threads write
+// to the same page (and first-touch places each page near its writer)
+const size_t ChunkAlignment = 4096;
+
+// The smallest chunk worth handing to another thread. The limit was found
+// experimentally: below it, waking a thread costs more than the copy.
+const size_t MinChunkBytes = 1000000;
+
+} // namespace
+
 TaskSet_CopyMemory::ATask::ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount)
     : Task(semDone, taskIndex, totalTaskCount)
 {
 }
 
-void TaskSet_CopyMemory::ATask::SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount)
+void TaskSet_CopyMemory::ATask::SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount,
+    size_t chunkBytes, bool streaming)
 {
     dst_ = dst;
     src_ = src;
     bytes_ = bytes;
     usedTaskCount_ = usedTaskCount;
+    chunkBytes_ = chunkBytes;
+    streaming_ = streaming;
 }
 
 void TaskSet_CopyMemory::ATask::Execute()
@@ -45,15 +66,18 @@ void TaskSet_CopyMemory::ATask::Execute()
     if (taskIndex_ >= usedTaskCount_)
         return;
 
-    size_t chunkBytes = bytes_ / usedTaskCount_;
-    const size_t chunkOffset = taskIndex_ * chunkBytes;
-    if (taskIndex_ == usedTaskCount_ - 1)
-        chunkBytes += bytes_ % usedTaskCount_;
+    const size_t chunkOffset = taskIndex_ * chunkBytes_;
+    if (chunkOffset >= bytes_)
+        return;
+    const size_t chunkBytes = std::min(chunkBytes_, bytes_ - chunkOffset);
 
     void* dst = static_cast<char*>(dst_) + chunkOffset;
     const void* src = static_cast<const char*>(src_) + chunkOffset;
 
-    std::memcpy(dst, src, chunkBytes);
+    if (streaming_)
+        StreamingCopy(dst, src, chunkBytes);
+    else
+        std::memcpy(dst, src, chunkBytes);
 }
 
 TaskSet_CopyMemory::TaskSet_CopyMemory(std::shared_ptr<ThreadPool> pool)
@@ -62,24 +86,44 @@ TaskSet_CopyMemory::TaskSet_CopyMemory(std::shared_ptr<ThreadPool> pool)
     CreateTasks<ATask>();
 }
 
+void TaskSet_CopyMemory::SetStreamingThreshold(size_t bytes)
+{
+    streamingThreshold_ = bytes;
+}
+
+size_t TaskSet_CopyMemory::GetStreamingThreshold() const
+{
+    return streamingThreshold_;
+}
+
 void TaskSet_CopyMemory::SetUp(void* dst, const void* src, size_t bytes)
 {
     assert(dst);
     assert(src);
     assert(bytes > 0);
 
-    // Call memcpy directly without threading for small frames up to 1MB
-    // Otherwise do parallel copy and add one thread for each 1MB
-    // The limits were found experimentally
-    usedTaskCount_ = std::min<size_t>(1 + bytes / 1000000, tasks_.size());
-    if (usedTaskCount_ == 1)
+    const bool streaming = streamingThreshold_ > 0 && bytes >= streamingThreshold_;
+
+    // Copy directly without threading for small frames up to 1MB.
+    // Otherwise split into one chunk per 1MB, up to one per task (the
+    // calling thread copies the first chunk itself in Execute).
+    usedTaskCount_ = std::min<size_t>(1 + bytes / MinChunkBytes, tasks_.size());
+    if (usedTaskCount_ <= 1)
     {
-        std::memcpy(dst, src, bytes);
+        usedTaskCount_ = 1;
+        if (streaming)
+            StreamingCopy(dst, src, bytes);
+        else
+            std::memcpy(dst, src, bytes);
         return;
     }
 
-    for (Task* task : tasks_)
-        static_cast<ATask*>(task)->SetUp(dst, src, bytes, usedTaskCount_);
+    size_t chunkBytes = (bytes + usedTaskCount_ - 1) / usedTaskCount_;
+    chunkBytes = (chunkBytes + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+    usedTaskCount_ = (bytes + chunkBytes - 1) / chunkBytes;
+
+    for (size_t n = 0; n < usedTaskCount_; ++n)
+        static_cast<ATask*>(tasks_[n])->SetUp(dst, src, bytes, usedTaskCount_, chunkBytes, streaming);
 }
 
 void TaskSet_CopyMemory::Execute()
@@ -87,7 +131,11 @@ void TaskSet_CopyMemory::Execute()
     if (usedTaskCount_ == 1)
         return; // Already done in SetUp, nothing to execute
 
-    TaskSet::Execute();
+    // Hand all but the first chunk to the pool and copy the first one on the
+    // calling thread, which would otherwise sit idle in Wait()
+    pool_->Execute(std::vector<Task*>(tasks_.begin() + 1, tasks_.begin() + usedTaskCount_));
+    tasks_[0]->Execute();
+    tasks_[0]->Done();
 }
 
 void TaskSet_CopyMemory::Wait()
@@ -95,7 +143,7 @@ void TaskSet_CopyMemory::Wait()
     if (usedTaskCount_ == 1)
         return; // Already done in SetUp, nothing to wait for
 
-    semaphore_->Wait(usedTaskCount_);
+    TaskSet::Wait();
 }
 
 void TaskSet_CopyMemory::MemCopy(void* dst, const void* src, size_t bytes)
@@ -104,3 +152,37 @@ void TaskSet_CopyMemory::MemCopy(void* dst, const void* src, size_t bytes)
     Execute();
     Wait();
 }
+
+void TaskSet_CopyMemory::StreamingCopy(void* dst, const void* src, size_t bytes)
+{
+#ifdef MMCORE_HAVE_SSE2_STREAMING
+    char* d = static_cast<char*>(dst);
+    const char* s = static_cast<const char*>(src);
+
+    // Non-temporal stores need a 16-byte aligned destination
+    const size_t head = std::min(bytes,
+        (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    bytes -= head;
+
+    for (; bytes >= 64; bytes -= 64, d += 64, s += 64)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+    }
+    std::memcpy(d, s, bytes);
+
+    // Make the streamed data visible before the caller publishes the frame
+    _mm_sfence();
+#else
+    std::memcpy(dst, src, bytes);
+#endif
+}
@@ -33,7 +33,8 @@ private:
     public:
         explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount);
 
-        void SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount);
+        void SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount,
+            size_t chunkBytes, bool streaming);
 
         virtual void Execute() override;
 
@@ -41,11 +42,22 @@ private:
         void* dst_{ nullptr };
         const void* src_{ nullptr };
         size_t bytes_{ 0 };
+        size_t chunkBytes_{ 0 };
+        bool streaming_{ false };
     };
 
 public:
+    // Copies at least this large bypass the cache with non-temporal stores
+    // (where supported), so that a large frame does not evict everything
+    // else from the last-level cache
+    static constexpr size_t DefaultStreamingThreshold = 8 * 1024 * 1024;
+
     explicit TaskSet_CopyMemory(std::shared_ptr<ThreadPool> pool);
 
+    // 0 disables streaming stores
+    void SetStreamingThreshold(size_t bytes);
+    size_t GetStreamingThreshold() const;
+
     void SetUp(void* dst, const void* src, size_t bytes);
 
     virtual void Execute() override;
@@ -53,4 +65,11 @@ public:
 
     // Helper blocking method calling SetUp, Execute and Wait
     void MemCopy(void* dst, const void* src, size_t bytes);
+
+    // Copy using non-temporal stores if the platform supports them, otherwise
+    // equivalent to memcpy
+    static void StreamingCopy(void* dst, const void* src, size_t bytes);
+
+private:
+    size_t streamingThreshold_{ DefaultStreamingThreshold };
 };
@@ -4,7 +4,9 @@
 // SUBSYSTEM:     MMCore
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
-//                and scaling number of threads based on hardware.
+//                and scaling number of threads based on hardware. Each
+//                worker has its own task deque; idle workers steal tasks
+//                from the others.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -31,12 +33,43 @@
 #include <mutex>
 #include <thread>
 
-ThreadPool::ThreadPool()
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// The pool and worker index of the current thread, if it is a worker
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local size_t tlsWorkerIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount, const std::vector<unsigned>& cpus)
 {
-    const size_t hwThreadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
-    for (size_t n = 0; n < hwThreadCount; ++n)
+    if (threadCount == 0)
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t n = 0; n < threadCount; ++n)
+        workers_.push_back(std::make_unique<Worker>());
+    for (size_t n = 0; n < threadCount; ++n)
     {
-        auto thread = std::make_unique<std::thread>(&ThreadPool::ThreadFunc, this);
+        std::unique_ptr<std::thread> thread;
+        if (cpus.empty())
+        {
+            thread = std::make_unique<std::thread>(&ThreadPool::ThreadFunc, this, n);
+        }
+        else
+        {
+            const unsigned cpu = cpus[n % cpus.size()];
+            thread = std::make_unique<std::thread>([this, cpu, n]() {
+                SetCurrentThreadAffinity(cpu);
+                ThreadFunc(n);
+            });
+        }
         threads_.push_back(std::move(thread));
     }
 }
@@ -44,10 +77,10 @@ ThreadPool::ThreadPool()
 ThreadPool::~ThreadPool()
 {
     {
-        std::lock_guard<std::mutex> lock(mx_);
+        std::lock_guard<std::mutex> lock(sleepMx_);
         abortFlag_ = true;
     }
-    cv_.notify_all();
+    sleepCv_.notify_all();
 
     for (const auto& thread : threads_)
         thread->join();
@@ -61,46 +94,173 @@ size_t ThreadPool::GetSize() const
 void ThreadPool::Execute(Task* task)
 {
     assert(task);
-    {
-        std::lock_guard<std::mutex> lock(mx_);
-        if (abortFlag_)
-            return;
-        queue_.push_back(task);
-    }
-    cv_.notify_one();
+    if (abortFlag_)
+        return;
+
+    const size_t index = tlsPool == this ? tlsWorkerIndex :
+        nextWorker_++ % workers_.size();
+    // Count before pushing, so that the count never goes below zero
+    ++pending_;
+    Push(index, task);
+    WakeWorkers(1);
 }
 
 void ThreadPool::Execute(const std::vector<Task*>& tasks)
 {
     assert(!tasks.empty());
+    if (abortFlag_)
+        return;
 
+    pending_ += tasks.size();
+    if (tlsPool == this)
     {
-        std::lock_guard<std::mutex> lock(mx_);
-        if (abortFlag_)
-            return;
+        // Forked from a task: keep the work local; idle workers will steal
+        Worker& worker = *workers_[tlsWorkerIndex];
+        std::lock_guard<std::mutex> lock(worker.mx);
         for (Task* task : tasks)
         {
             assert(task);
-            queue_.push_back(task);
+            worker.tasks.push_back(task);
         }
     }
-    cv_.notify_all();
+    else
+    {
+        const size_t first = nextWorker_.fetch_add(tasks.size());
+        for (size_t n = 0; n < tasks.size(); ++n)
+        {
+            assert(tasks[n]);
+            Push((first + n) % workers_.size(), tasks[n]);
+        }
+    }
+    WakeWorkers(tasks.size());
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    Task* task = nullptr;
+    if (tlsPool == this)
+    {
+        task = FindTask(tlsWorkerIndex);
+    }
+    else if (pending_ > 0)
+    {
+        task = Steal(nextWorker_ % workers_.size());
+        if (task)
+            --pending_;
+    }
+    if (!task)
+        return false;
+    task->Execute();
+    task->Done();
+    return true;
+}
+
+void ThreadPool::Push(size_t index, Task* task)
+{
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mx);
+    worker.tasks.push_back(task);
+}
+
+Task* ThreadPool::PopLocal(size_t index)
+{
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mx);
+    if (worker.tasks.empty())
+        return nullptr;
+    // Most recently pushed first: its data is most likely still in cache
+    Task* task = worker.tasks.back();
+    worker.tasks.pop_back();
+    return task;
+}
+
+Task* ThreadPool::Steal(size_t thiefIndex)
+{
+    const size_t count = workers_.size();
+    for (size_t n = 1; n <= count; ++n)
+    {
+        Worker& victim = *workers_[(thiefIndex + n) % count];
+        std::lock_guard<std::mutex> lock(victim.mx);
+        if (victim.tasks.empty())
+            continue;
+        // Oldest first, leaving the victim its most recent (cache-hot) work
+        Task* task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return task;
+    }
+    return nullptr;
+}
+
+Task* ThreadPool::FindTask(size_t index)
+{
+    if (pending_ == 0)
+        return nullptr;
+    Task* task = PopLocal(index);
+    if (!task)
+        task = Steal(index);
+    if (task)
+        --pending_;
+    return task;
+}
+
+void ThreadPool::WakeWorkers(size_t count)
+{
+    // Sleepers register (under sleepMx_) before re-checking pending_, and we
+    // incremented pending_ before reading sleepers_, so either they see the
+    // new tasks or we see them and notify.
+    const size_t sleepers = sleepers_;
+    if (sleepers == 0)
+        return;
+    std::lock_guard<std::mutex> lock(sleepMx_);
+    if (count >= sleepers)
+    {
+        sleepCv_.notify_all();
+    }
+    else
+    {
+        for (size_t n = 0; n < count; ++n)
+            sleepCv_.notify_one();
+    }
 }
 
-void ThreadPool::ThreadFunc()
+void ThreadPool::SetCurrentThreadAffinity(unsigned cpu)
 {
+#ifdef _WIN32
+    if (cpu < 8 * sizeof(DWORD_PTR))
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    if (cpu < CPU_SETSIZE)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)cpu; // Not supported (e.g. macOS); threads are left unpinned
+#endif
+}
+
+void ThreadPool::ThreadFunc(size_t index)
+{
+    tlsPool = this;
+    tlsWorkerIndex = index;
     for (;;)
     {
-        Task* task = nullptr;
+        if (abortFlag_)
+            break;
+        Task* task = FindTask(index);
+        if (task)
         {
-            std::unique_lock<std::mutex> lock(mx_);
-            cv_.wait(lock, [&]() { return abortFlag_ || !queue_.empty(); });
-            if (abortFlag_)
-                break;
-            task = queue_.front();
-            queue_.pop_front();
+            task->Execute();
+            task->Done();
+            continue;
         }
-        task->Execute();
-        task->Done();
+
+        std::unique_lock<std::mutex> lock(sleepMx_);
+        ++sleepers_;
+        sleepCv_.wait(lock, [&]() { return abortFlag_ || pending_ > 0; });
+        --sleepers_;
     }
+    tlsPool = nullptr;
 }
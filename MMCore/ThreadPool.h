@@ -4,7 +4,9 @@
 // SUBSYSTEM:     MMCore
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
-//                and scaling number of threads based on hardware.
+//                and scaling number of threads based on hardware. Each
+//                worker has its own task deque; idle workers steal tasks
+//                from the others.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -24,6 +26,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <memory>
@@ -36,21 +39,50 @@ class Task;
 class ThreadPool final
 {
 public:
-    explicit ThreadPool();
+    // threadCount 0 means one thread per hardware thread. If cpus is not
+    // empty, the threads are pinned round-robin to the listed logical CPUs
+    // (ignored on platforms without thread affinity support).
+    explicit ThreadPool(size_t threadCount = 0, const std::vector<unsigned>& cpus = {});
     ~ThreadPool();
 
     size_t GetSize() const;
 
+    // Tasks submitted from a worker thread of this pool go to that worker's
+    // own deque (so that nested fork/join stays local); otherwise they are
+    // spread over the workers round-robin.
     void Execute(Task* task);
     void Execute(const std::vector<Task*>& tasks);
 
+    // Run one queued task on the calling thread, if there is any. Threads
+    // waiting for their tasks to complete (e.g. TaskSet::Wait()) call this so
+    // that they help instead of blocking, which also keeps nested task sets
+    // from deadlocking the pool.
+    bool RunPendingTask();
+
 private:
-    void ThreadFunc();
+    struct Worker
+    {
+        std::mutex mx{};
+        std::deque<Task*> tasks{}; // Owner pops from the back, thieves from the front
+    };
+
+    void ThreadFunc(size_t index);
+    Task* PopLocal(size_t index);
+    Task* Steal(size_t thiefIndex);
+    Task* FindTask(size_t index);
+    void Push(size_t index, Task* task);
+    void WakeWorkers(size_t count);
+    static void SetCurrentThreadAffinity(unsigned cpu);
 
 private:
+    std::vector<std::unique_ptr<Worker>> workers_{};
     std::vector<std::unique_ptr<std::thread>> threads_{};
-    bool abortFlag_{ false };
-    std::mutex mx_{};
-    std::condition_variable cv_{};
-    std::deque<Task*> queue_{};
+    std::atomic<bool> abortFlag_{ false };
+    std::atomic<size_t> pending_{ 0 }; // Tasks queued but not yet taken
+    std::atomic<size_t> nextWorker_{ 0 }; // Round-robin target for external submits
+
+    // Idle workers park here; only as many are woken as there are new tasks
+    std::mutex sleepMx_{};
+    std::condition_variable sleepCv_{};
+    std::atomic<size_t> sleepers_{ 0 };
 };
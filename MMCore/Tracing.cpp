@@ -0,0 +1,348 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          Tracing.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Low-overhead timing spans for the core's hot paths, dumped
+//                in Chrome trace-event format.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "Tracing.h"
+
+#ifndef MMCORE_DISABLE_TRACING
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define MMCORE_TRACE_USE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MMCORE_TRACE_USE_TSC
+#endif
+
+namespace mm {
+namespace trace {
+
+std::atomic<bool> g_Enabled{false};
+
+namespace {
+
+// Per thread; a power of two
+const std::uint64_t g_EventsPerThread = 16384;
+
+// The fields are atomics only so that a concurrent dump is not a data race;
+// relaxed loads and stores compile to plain moves.
+struct Event
+{
+   std::atomic<const char*> category{nullptr};
+   std::atomic<const char*> name{nullptr};
+   std::atomic<std::uint64_t> begin{0};
+   std::atomic<std::uint64_t> end{0};
+};
+
+// Single-writer ring of events. The owning thread publishes each event by
+// advancing head; a reader copies the events it wants and then discards
+// those that the writer may have overwritten while it was copying.
+//
+// When its thread exits, the buffer is handed to the next new thread, which
+// continues the ring under the same thread id. Short-lived threads (such as
+// those of std::async) thus share buffers instead of each keeping one, and a
+// trace shows one row per buffer rather than per thread.
+struct ThreadBuffer
+{
+   explicit ThreadBuffer(unsigned id) :
+      threadId(id),
+      events(new Event[g_EventsPerThread])
+   {}
+
+   const unsigned threadId;
+   std::unique_ptr<Event[]> events;
+   std::atomic<std::uint64_t> head{0};
+   std::atomic<std::uint64_t> clearedAt{0};
+};
+
+struct CopiedEvent
+{
+   const char* category;
+   const char* name;
+   std::uint64_t begin;
+   std::uint64_t end;
+};
+
+// Owns the buffers, so that events of exited threads can still be dumped.
+// The number of buffers is the largest number of threads that have recorded
+// at the same time.
+class Registry
+{
+   std::mutex mutex_;
+   std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+   std::vector<std::shared_ptr<ThreadBuffer>> free_;
+   unsigned nextThreadId_ = 1;
+
+public:
+   std::shared_ptr<ThreadBuffer> Acquire()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty())
+      {
+         auto buffer = free_.back();
+         free_.pop_back();
+         return buffer;
+      }
+      auto buffer = std::make_shared<ThreadBuffer>(nextThreadId_++);
+      buffers_.push_back(buffer);
+      return buffer;
+   }
+
+   void Release(const std::shared_ptr<ThreadBuffer>& buffer)
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.push_back(buffer);
+   }
+
+   std::vector<std::shared_ptr<ThreadBuffer>> Buffers()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return buffers_;
+   }
+
+   void Clear()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& buffer : buffers_)
+         buffer->clearedAt.store(buffer->head.load());
+   }
+};
+
+Registry& GetRegistry()
+{
+   // Never destroyed, because threads may exit (and release their buffers)
+   // during static destruction
+   static Registry* registry = new Registry;
+   return *registry;
+}
+
+// Returns the thread's buffer to the registry when the thread exits
+class ThreadBufferHolder
+{
+   std::shared_ptr<ThreadBuffer> buffer_;
+
+public:
+   ThreadBufferHolder() : buffer_(GetRegistry().Acquire()) {}
+   ~ThreadBufferHolder() { GetRegistry().Release(buffer_); }
+
+   ThreadBufferHolder(const ThreadBufferHolder&) = delete;
+   ThreadBufferHolder& operator=(const ThreadBufferHolder&) = delete;
+
+   ThreadBuffer& Get() { return *buffer_; }
+};
+
+ThreadBuffer& GetThreadBuffer()
+{
+   thread_local ThreadBufferHolder holder;
+   return holder.Get();
+}
+
+std::uint64_t ReadCounter()
+{
+#ifdef MMCORE_TRACE_USE_TSC
+   // Reading the time stamp counter costs a fraction of a clock call; it runs
+   // at a constant rate on all CPUs in use today.
+   return __rdtsc();
+#else
+   return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Pairs of counter and clock readings, from which counter values are
+// converted to nanoseconds when the trace is dumped
+struct CounterSample
+{
+   std::uint64_t counter;
+   std::chrono::steady_clock::time_point time;
+
+   static CounterSample Take()
+   {
+      return { ReadCounter(), std::chrono::steady_clock::now() };
+   }
+};
+
+const CounterSample g_Epoch = CounterSample::Take();
+
+class CounterToNs
+{
+   std::uint64_t epochCounter_;
+   double nsPerTick_;
+
+public:
+   CounterToNs()
+   {
+      const CounterSample now = CounterSample::Take();
+      const double ns = std::chrono::duration<double, std::nano>(
+         now.time - g_Epoch.time).count();
+      epochCounter_ = g_Epoch.counter;
+      nsPerTick_ = now.counter > g_Epoch.counter ?
+         ns / static_cast<double>(now.counter - g_Epoch.counter) : 1.0;
+   }
+
+   std::uint64_t operator()(std::uint64_t counter) const
+   {
+      if (counter <= epochCounter_)
+         return 0;
+      return static_cast<std::uint64_t>(
+         static_cast<double>(counter - epochCounter_) * nsPerTick_);
+   }
+};
+
+std::vector<CopiedEvent> CopyEvents(const ThreadBuffer& buffer)
+{
+   const std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+   std::uint64_t first = buffer.clearedAt.load();
+   if (head - first > g_EventsPerThread)
+      first = head - g_EventsPerThread;
+
+   std::vector<CopiedEvent> copied;
+   copied.reserve(static_cast<std::size_t>(head - first));
+   for (std::uint64_t i = first; i < head; ++i)
+   {
+      const Event& e = buffer.events[i & (g_EventsPerThread - 1)];
+      copied.push_back({
+         e.category.load(std::memory_order_relaxed),
+         e.name.load(std::memory_order_relaxed),
+         e.begin.load(std::memory_order_relaxed),
+         e.end.load(std::memory_order_relaxed),
+      });
+   }
+
+   // Events at indices the writer has since reused may be torn
+   std::atomic_thread_fence(std::memory_order_acquire);
+   const std::uint64_t headAfter = buffer.head.load(std::memory_order_relaxed);
+   if (headAfter - first > g_EventsPerThread)
+   {
+      const std::uint64_t overwritten = headAfter - g_EventsPerThread - first;
+      copied.erase(copied.begin(), copied.begin() +
+         static_cast<std::ptrdiff_t>(std::min<std::uint64_t>(overwritten, copied.size())));
+   }
+   return copied;
+}
+
+void WriteJSONString(std::ostream& os, const char* s)
+{
+   os << '"';
+   for (; s && *s; ++s)
+   {
+      const unsigned char ch = static_cast<unsigned char>(*s);
+      if (ch == '"' || ch == '\\')
+         os << '\\' << *s;
+      else if (ch < 0x20)
+      {
+         char escaped[8];
+         snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+         os << escaped;
+      }
+      else
+         os << *s;
+   }
+   os << '"';
+}
+
+void WriteMicroseconds(std::ostream& os, std::uint64_t ns)
+{
+   char text[32];
+   snprintf(text, sizeof(text), "%llu.%03u",
+      static_cast<unsigned long long>(ns / 1000),
+      static_cast<unsigned>(ns % 1000));
+   os << text;
+}
+
+} // anonymous namespace
+
+void SetEnabled(bool enable)
+{
+   g_Enabled.store(enable);
+}
+
+std::uint64_t Now()
+{
+   // Never 0, which ScopedSpan uses to mean "not recording"
+   return ReadCounter() | 1;
+}
+
+void Record(const char* category, const char* name,
+   std::uint64_t begin, std::uint64_t end)
+{
+   ThreadBuffer& buffer = GetThreadBuffer();
+   const std::uint64_t index = buffer.head.load(std::memory_order_relaxed);
+   Event& e = buffer.events[index & (g_EventsPerThread - 1)];
+   e.category.store(category, std::memory_order_relaxed);
+   e.name.store(name, std::memory_order_relaxed);
+   e.begin.store(begin, std::memory_order_relaxed);
+   e.end.store(end, std::memory_order_relaxed);
+   buffer.head.store(index + 1, std::memory_order_release);
+}
+
+std::string ToChromeJSON()
+{
+   const CounterToNs toNs;
+   std::ostringstream os;
+   os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+   bool first = true;
+   for (const auto& buffer : GetRegistry().Buffers())
+   {
+      const std::vector<CopiedEvent> events = CopyEvents(*buffer);
+      if (events.empty())
+         continue;
+
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+         buffer->threadId << ",\"args\":{\"name\":\"Thread " <<
+         buffer->threadId << "\"}}";
+      for (const CopiedEvent& e : events)
+      {
+         os << ",\n{\"name\":";
+         WriteJSONString(os, e.name);
+         os << ",\"cat\":";
+         WriteJSONString(os, e.category);
+         os << ",\"ph\":\"X\",\"ts\":";
+         const std::uint64_t begin = toNs(e.begin);
+         const std::uint64_t end = toNs(e.end);
+         WriteMicroseconds(os, begin);
+         os << ",\"dur\":";
+         WriteMicroseconds(os, end >= begin ? end - begin : 0);
+         os << ",\"pid\":1,\"tid\":" << buffer->threadId << "}";
+      }
+   }
+   os << "\n]}\n";
+   return os.str();
+}
+
+void Clear()
+{
+   GetRegistry().Clear();
+}
+
+} // namespace trace
+} // namespace mm
+
+#endif // MMCORE_DISABLE_TRACING
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          Tracing.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Low-overhead timing spans for the core's hot paths, dumped
+//                in Chrome trace-event format.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Tracing is compiled in unless MMCORE_DISABLE_TRACING is defined, in which
+// case the MMCORE_TRACE_* macros expand to nothing. When compiled in, it is
+// off until enabled at run time, and a span then costs one relaxed atomic
+// load.
+//
+// Usage:
+//    MMCORE_TRACE_SPAN("Core", "CMMCore::setProperty");
+// records the time from the statement to the end of the enclosing scope.
+// Category and name must be string literals (only the pointers are stored).
+
+namespace mm {
+namespace trace {
+
+#ifndef MMCORE_DISABLE_TRACING
+
+extern std::atomic<bool> g_Enabled;
+
+inline bool IsEnabled()
+{ return g_Enabled.load(std::memory_order_relaxed); }
+
+void SetEnabled(bool enable);
+
+// Timestamp in ticks of a fast monotonic counter (the time stamp counter on
+// x86); ticks are converted to time when the trace is dumped
+std::uint64_t Now();
+
+// Appends a complete span to the calling thread's event buffer. Each thread
+// keeps the most recent events only; older ones are overwritten.
+void Record(const char* category, const char* name,
+   std::uint64_t begin, std::uint64_t end);
+
+// Returns the recorded spans of all threads as a Chrome trace-event JSON
+// document (load with chrome://tracing or Perfetto).
+std::string ToChromeJSON();
+
+// Discards the recorded spans.
+void Clear();
+
+class ScopedSpan
+{
+   const char* category_;
+   const char* name_;
+   std::uint64_t begin_;
+
+public:
+   ScopedSpan(const char* category, const char* name) :
+      category_(category),
+      name_(name),
+      begin_(IsEnabled() ? Now() : 0)
+   {}
+
+   ~ScopedSpan()
+   {
+      if (begin_ != 0)
+         Record(category_, name_, begin_, Now());
+   }
+
+   ScopedSpan(const ScopedSpan&) = delete;
+   ScopedSpan& operator=(const ScopedSpan&) = delete;
+};
+
+#define MMCORE_TRACE_CONCAT_IMPL(a, b) a ## b
+#define MMCORE_TRACE_CONCAT(a, b) MMCORE_TRACE_CONCAT_IMPL(a, b)
+#define MMCORE_TRACE_SPAN(category, name) \
+   ::mm::trace::ScopedSpan MMCORE_TRACE_CONCAT(mmcoreTraceSpan_, __LINE__)( \
+         category, name)
+
+#else // MMCORE_DISABLE_TRACING
+
+#define MMCORE_TRACE_SPAN(category, name) ((void)0)
+
+#endif // MMCORE_DISABLE_TRACING
+
+} // namespace trace
+} // namespace mm
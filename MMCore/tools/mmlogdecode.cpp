@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          mmlogdecode.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Command-line tool rendering binary log files as text.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "Logging/BinaryLogDecoder.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void PrintUsage(std::ostream& stream)
+{
+   stream <<
+      "Usage: mmlogdecode [options] FILE...\n"
+      "Write binary Micro-Manager log files to stdout in the text log format.\n"
+      "\n"
+      "Options:\n"
+      "  --device LABEL   Only entries of this device (may be repeated)\n"
+      "  --from TIME      Only entries at or after TIME\n"
+      "  --to TIME        Only entries at or before TIME\n"
+      "  -o FILE          Write to FILE instead of stdout\n"
+      "  -h, --help       Show this help\n"
+      "\n"
+      "TIME is local time as in the log, e.g. 2024-01-31T13:45:00.5\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+   mm::logging::BinaryLogDecoderOptions options;
+   std::vector<std::string> inputs;
+   std::string outputFile;
+
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "-h" || arg == "--help")
+      {
+         PrintUsage(std::cout);
+         return 0;
+      }
+      else if (arg == "--device" && hasValue)
+      {
+         options.devices.push_back(argv[++i]);
+      }
+      else if ((arg == "--from" || arg == "--to") && hasValue)
+      {
+         const std::string value = argv[++i];
+         const bool from = arg == "--from";
+         if (!mm::logging::ParseLogTimestamp(value,
+                  from ? options.begin : options.end))
+         {
+            std::cerr << "mmlogdecode: invalid time: " << value << '\n';
+            return 2;
+         }
+         (from ? options.hasBegin : options.hasEnd) = true;
+      }
+      else if (arg == "-o" && hasValue)
+      {
+         outputFile = argv[++i];
+      }
+      else if (!arg.empty() && arg[0] == '-')
+      {
+         PrintUsage(std::cerr);
+         return 2;
+      }
+      else
+      {
+         inputs.push_back(arg);
+      }
+   }
+   if (inputs.empty())
+   {
+      PrintUsage(std::cerr);
+      return 2;
+   }
+
+   std::ofstream outputStream;
+   if (!outputFile.empty())
+   {
+      outputStream.open(outputFile.c_str(), std::ios_base::out);
+      if (!outputStream)
+      {
+         std::cerr << "mmlogdecode: cannot open " << outputFile << '\n';
+         return 1;
+      }
+   }
+   std::ostream& out = outputFile.empty() ? std::cout : outputStream;
+
+   int status = 0;
+   for (const std::string& input : inputs)
+   {
+      std::ifstream in(input.c_str(), std::ios_base::in | std::ios_base::binary);
+      if (!in)
+      {
+         std::cerr << "mmlogdecode: cannot open " << input << '\n';
+         status = 1;
+         continue;
+      }
+      std::string error;
+      if (!mm::logging::DecodeBinaryLog(in, out, options, error))
+      {
+         std::cerr << "mmlogdecode: " << input << ": " << error << '\n';
+         status = 1;
+      }
+   }
+   out.flush();
+   return out ? status : 1;
+}
@@ -0,0 +1,348 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "ImageMetadata.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// End-to-end acquisition benchmark: a camera thread inserts frames through
+// CoreCallback::InsertImage while consumer threads pop them with
+// popNextImageMD(). Each frame carries its insert time in its first 8 bytes,
+// so the consumer measures insert-to-pop latency.
+//
+// Environment variables:
+//   MMCORE_ACQ_BENCH_SCENARIOS  comma-separated WxHxB[@fps][/consumers][+tags]
+//                               (fps 0 = as fast as possible), e.g.
+//                               "2048x2048x2@1000/2+16"
+//   MMCORE_ACQ_BENCH_FRAMES     frames per scenario (default 2000)
+//   MMCORE_BENCH_JSON           also write the results to this file
+//
+// Each scenario prints one JSON object per line, for regression tracking.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t NowNs() {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now().time_since_epoch()).count();
+}
+
+// CPU time of the whole process (all threads), in seconds
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+   FILETIME creation, exit, kernel, user;
+   if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+      return 0.0;
+   auto toSeconds = [](const FILETIME& t) {
+      ULARGE_INTEGER u;
+      u.LowPart = t.dwLowDateTime;
+      u.HighPart = t.dwHighDateTime;
+      return u.QuadPart * 1e-7;
+   };
+   return toSeconds(kernel) + toSeconds(user);
+#else
+   rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+      usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+struct Scenario {
+   unsigned width = 512;
+   unsigned height = 512;
+   unsigned bytesPerPixel = 2;
+   double fps = 0.0; // 0 = as fast as possible
+   unsigned consumers = 1;
+   unsigned metadataTags = 0;
+
+   std::string Name() const {
+      std::ostringstream os;
+      os << width << 'x' << height << 'x' << bytesPerPixel << '@' << fps <<
+         '/' << consumers << '+' << metadataTags;
+      return os.str();
+   }
+};
+
+Scenario ParseScenario(const std::string& text) {
+   Scenario s;
+   int n = std::sscanf(text.c_str(), "%ux%ux%u", &s.width, &s.height,
+      &s.bytesPerPixel);
+   if (n != 3 || s.width == 0 || s.height == 0 || s.bytesPerPixel == 0)
+      FAIL("Cannot parse scenario: " << text);
+   auto at = text.find('@');
+   if (at != std::string::npos)
+      s.fps = std::atof(text.c_str() + at + 1);
+   auto slash = text.find('/');
+   if (slash != std::string::npos)
+      s.consumers = std::max(1, std::atoi(text.c_str() + slash + 1));
+   auto plus = text.find('+');
+   if (plus != std::string::npos)
+      s.metadataTags = std::max(0, std::atoi(text.c_str() + plus + 1));
+   return s;
+}
+
+std::vector<Scenario> Scenarios() {
+   std::vector<Scenario> result;
+   if (const char* env = std::getenv("MMCORE_ACQ_BENCH_SCENARIOS")) {
+      std::istringstream is(env);
+      std::string item;
+      while (std::getline(is, item, ','))
+         if (!item.empty())
+            result.push_back(ParseScenario(item));
+      return result;
+   }
+   for (const char* s : {
+         "512x512x2@0/1+0",    // Core overhead per frame
+         "512x512x2@0/1+32",   // Metadata overhead
+         "512x512x2@0/2+0",    // Consumer contention
+         "2048x2048x2@100/1+0", // sCMOS at a steady rate
+         "2048x2048x2@0/1+0",  // Copy bandwidth
+      })
+      result.push_back(ParseScenario(s));
+   return result;
+}
+
+long FramesPerScenario() {
+   const char* env = std::getenv("MMCORE_ACQ_BENCH_FRAMES");
+   long frames = env ? std::atol(env) : 2000;
+   return frames > 0 ? frames : 2000;
+}
+
+class BenchCamera : public CCameraBase<BenchCamera> {
+   unsigned width_;
+   unsigned height_;
+   unsigned bytesPerPixel_;
+   std::atomic<bool> capturing_{false};
+
+public:
+   BenchCamera(unsigned width, unsigned height, unsigned bytesPerPixel) :
+      width_(width), height_(height), bytesPerPixel_(bytesPerPixel) {}
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "BenchCamera");
+   }
+
+   int SnapImage() override { return DEVICE_ERR; }
+   const unsigned char* GetImageBuffer() override { return nullptr; }
+   long GetImageBufferSize() const override {
+      return width_ * height_ * bytesPerPixel_;
+   }
+   unsigned GetImageWidth() const override { return width_; }
+   unsigned GetImageHeight() const override { return height_; }
+   unsigned GetImageBytesPerPixel() const override { return bytesPerPixel_; }
+   unsigned GetBitDepth() const override { return 8 * bytesPerPixel_; }
+   int GetBinning() const override { return 1; }
+   int SetBinning(int) override { return DEVICE_ERR; }
+   void SetExposure(double) override {}
+   double GetExposure() const override { return 0.0; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) override { return DEVICE_ERR; }
+   int GetROI(unsigned&, unsigned&, unsigned&, unsigned&) override { return DEVICE_ERR; }
+   int ClearROI() override { return DEVICE_ERR; }
+   int IsExposureSequenceable(bool& f) const override { f = false; return DEVICE_OK; }
+   int StartSequenceAcquisition(long, double, bool) override {
+      capturing_ = true;
+      return DEVICE_OK;
+   }
+   int StartSequenceAcquisition(double) override {
+      return StartSequenceAcquisition(LONG_MAX, 0.0, false);
+   }
+   int StopSequenceAcquisition() override {
+      capturing_ = false;
+      return DEVICE_OK;
+   }
+   bool IsCapturing() override { return capturing_; }
+
+   int Insert(unsigned char* pixels, const char* serializedMetadata) {
+      const std::int64_t now = NowNs();
+      std::memcpy(pixels, &now, sizeof(now));
+      return GetCoreCallback()->InsertImage(this, pixels, width_, height_,
+         bytesPerPixel_, serializedMetadata);
+   }
+};
+
+struct Result {
+   Scenario scenario;
+   long frames = 0;
+   long popped = 0;
+   long rejected = 0;
+   double seconds = 0.0;
+   double cpuSeconds = 0.0;
+   std::vector<double> latenciesUs;
+
+   double Percentile(double p) const {
+      if (latenciesUs.empty())
+         return 0.0;
+      std::size_t i = static_cast<std::size_t>(p * (latenciesUs.size() - 1));
+      return latenciesUs[i];
+   }
+
+   std::string Json() const {
+      std::ostringstream os;
+      os << "{\"benchmark\":\"AcquisitionPipeline\"" <<
+         ",\"scenario\":\"" << scenario.Name() << "\"" <<
+         ",\"width\":" << scenario.width <<
+         ",\"height\":" << scenario.height <<
+         ",\"bytesPerPixel\":" << scenario.bytesPerPixel <<
+         ",\"targetFps\":" << scenario.fps <<
+         ",\"consumers\":" << scenario.consumers <<
+         ",\"metadataTags\":" << scenario.metadataTags <<
+         ",\"frames\":" << frames <<
+         ",\"popped\":" << popped <<
+         ",\"dropped\":" << (frames - rejected - popped) <<
+         ",\"rejected\":" << rejected <<
+         ",\"fps\":" << (seconds > 0.0 ? popped / seconds : 0.0) <<
+         ",\"latencyUsP50\":" << Percentile(0.50) <<
+         ",\"latencyUsP99\":" << Percentile(0.99) <<
+         ",\"latencyUsP999\":" << Percentile(0.999) <<
+         ",\"latencyUsMax\":" << Percentile(1.0) <<
+         ",\"cpuUsPerFrame\":" << (frames > 0 ? cpuSeconds * 1e6 / frames : 0.0) <<
+         "}";
+      return os.str();
+   }
+};
+
+Result Run(const Scenario& s, long frames) {
+   BenchCamera cam(s.width, s.height, s.bytesPerPixel);
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+
+   Metadata md;
+   md.put(MM::g_Keyword_Metadata_CameraLabel, "cam");
+   for (unsigned t = 0; t < s.metadataTags; ++t)
+      md.PutImageTag("BenchTag-" + std::to_string(t), t * 1.5);
+   const std::string serialized = md.Serialize();
+
+   // A few frames so that the producer does not rewrite a frame while the
+   // core copies it
+   std::vector<std::vector<unsigned char>> frameBuffers(4,
+      std::vector<unsigned char>(cam.GetImageBufferSize(), 0x5a));
+
+   Result result;
+   result.scenario = s;
+   result.frames = frames;
+   result.latenciesUs.reserve(frames);
+   std::mutex latencyMutex;
+   std::atomic<long> popped{0};
+   std::atomic<bool> producerDone{false};
+
+   c.startSequenceAcquisition(frames, 0.0, false);
+   const double cpuStart = ProcessCpuSeconds();
+   const auto start = Clock::now();
+
+   std::vector<std::thread> consumers;
+   for (unsigned i = 0; i < s.consumers; ++i) {
+      consumers.emplace_back([&] {
+         std::vector<double> local;
+         local.reserve(frames);
+         Metadata popMd;
+         for (;;) {
+            const bool done = producerDone.load();
+            if (c.getRemainingImageCount() > 0) {
+               try {
+                  const void* pixels = c.popNextImageMD(popMd);
+                  std::int64_t stamp;
+                  std::memcpy(&stamp, pixels, sizeof(stamp));
+                  local.push_back((NowNs() - stamp) * 1e-3);
+                  popped.fetch_add(1, std::memory_order_relaxed);
+                  continue;
+               }
+               catch (const CMMError&) {
+                  // Another consumer took it
+               }
+            }
+            else if (done) {
+               break;
+            }
+            // Poll without burning the CPU time being measured
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+         }
+         std::lock_guard<std::mutex> lock(latencyMutex);
+         result.latenciesUs.insert(result.latenciesUs.end(), local.begin(),
+            local.end());
+      });
+   }
+
+   const auto interval = s.fps > 0.0 ?
+      std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / s.fps)) :
+      Clock::duration::zero();
+   auto next = start;
+   for (long f = 0; f < frames; ++f) {
+      if (s.fps > 0.0) {
+         std::this_thread::sleep_until(next);
+         next += interval;
+      }
+      if (cam.Insert(frameBuffers[f % frameBuffers.size()].data(),
+            serialized.c_str()) != DEVICE_OK)
+         ++result.rejected;
+   }
+   producerDone = true;
+   for (auto& t : consumers)
+      t.join();
+
+   result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+   result.cpuSeconds = ProcessCpuSeconds() - cpuStart;
+   result.popped = popped.load();
+   c.stopSequenceAcquisition();
+   std::sort(result.latenciesUs.begin(), result.latenciesUs.end());
+   return result;
+}
+
+} // namespace
+
+TEST_CASE("Acquisition pipeline insert-to-pop latency and throughput",
+   "[AcquisitionPipeline][benchmark]")
+{
+   const long frames = FramesPerScenario();
+   std::vector<std::string> lines;
+
+   std::printf("%-24s %9s %8s %8s %10s %10s %10s %10s\n", "scenario", "fps",
+      "dropped", "rejected", "p50 us", "p99 us", "p99.9 us", "cpu us/fr");
+   for (const Scenario& s : Scenarios()) {
+      Result r = Run(s, frames);
+      CHECK(r.popped + r.rejected <= r.frames);
+      std::printf("%-24s %9.1f %8ld %8ld %10.1f %10.1f %10.1f %10.1f\n",
+         s.Name().c_str(), r.seconds > 0.0 ? r.popped / r.seconds : 0.0,
+         r.frames - r.rejected - r.popped, r.rejected, r.Percentile(0.50),
+         r.Percentile(0.99), r.Percentile(0.999),
+         r.cpuSeconds * 1e6 / r.frames);
+      lines.push_back(r.Json());
+   }
+
+   for (const std::string& line : lines)
+      std::printf("%s\n", line.c_str());
+
+   if (const char* path = std::getenv("MMCORE_BENCH_JSON")) {
+      std::ofstream out(path);
+      REQUIRE(out);
+      for (const std::string& line : lines)
+         out << line << '\n';
+   }
+}
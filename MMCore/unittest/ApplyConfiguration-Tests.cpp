@@ -0,0 +1,332 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+// "Gate" takes setTime to set; "Value" can only be set while a gate (this
+// device's or another's) is open. Records the order of property sets.
+class GatedDevice : public CGenericBase<GatedDevice> {
+   std::chrono::milliseconds setTime_;
+
+public:
+   std::atomic<bool> gate{false};
+   std::atomic<bool>* requiredGate = &gate;
+   std::atomic<int> valueAttempts{0};
+   std::mutex logMutex;
+   std::string log;
+
+   explicit GatedDevice(std::chrono::milliseconds setTime =
+         std::chrono::milliseconds(0)) : setTime_(setTime) {}
+
+   int Initialize() override {
+      CreateIntegerProperty("Gate", 0, false,
+         new CPropertyAction(this, &GatedDevice::OnGate));
+      CreateIntegerProperty("Value", 0, false,
+         new CPropertyAction(this, &GatedDevice::OnValue));
+      CreateIntegerProperty("Other", 0, false,
+         new CPropertyAction(this, &GatedDevice::OnOther));
+      SetPropertyLimits("Other", 0, 10);
+      CreateStringProperty("Mode", "A", false);
+      AddAllowedValue("Mode", "A");
+      AddAllowedValue("Mode", "B");
+      CreateStringProperty("Model", "Gated", true);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "GatedDevice");
+   }
+
+   void Record(char c) {
+      std::lock_guard<std::mutex> lock(logMutex);
+      log += c;
+   }
+
+   int OnGate(MM::PropertyBase* pProp, MM::ActionType eAct) {
+      if (eAct == MM::AfterSet) {
+         std::this_thread::sleep_for(setTime_);
+         long v;
+         pProp->Get(v);
+         gate = v != 0;
+         Record('G');
+      }
+      return DEVICE_OK;
+   }
+
+   int OnValue(MM::PropertyBase*, MM::ActionType eAct) {
+      if (eAct == MM::AfterSet) {
+         ++valueAttempts;
+         if (!*requiredGate)
+            return DEVICE_ERR;
+         Record('V');
+      }
+      return DEVICE_OK;
+   }
+
+   int OnOther(MM::PropertyBase*, MM::ActionType eAct) {
+      if (eAct == MM::AfterSet) {
+         std::this_thread::sleep_for(setTime_);
+         Record('O');
+      }
+      return DEVICE_OK;
+   }
+};
+
+class FeatureGuard {
+   std::string name_;
+   bool saved_;
+
+public:
+   FeatureGuard(const char* name, bool enable) :
+      name_(name), saved_(CMMCore::isFeatureEnabled(name)) {
+      CMMCore::enableFeature(name, enable);
+   }
+   ~FeatureGuard() { CMMCore::enableFeature(name_.c_str(), saved_); }
+};
+
+} // namespace
+
+TEST_CASE("Apply configuration learns the order of dependent settings",
+   "[ApplyConfiguration]")
+{
+   const bool parallel = GENERATE(false, true);
+   FeatureGuard f("ParallelConfigApplication", parallel);
+
+   GatedDevice dev;
+   GatedDevice dev2;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   MockAdapterWithDevices adapter2("adapter2", {{"dev", &dev2}});
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.defineConfig("Group", "Open", "dev", "Value", "1");
+   c.defineConfig("Group", "Open", "dev", "Gate", "1");
+
+   c.setConfig("Group", "Open");
+   CHECK(dev.valueAttempts == 2); // Failed, then retried
+   CHECK(dev.log == "GV");
+
+   c.setProperty("dev", "Gate", "0");
+   dev.valueAttempts = 0;
+   dev.log.clear();
+   c.setConfig("Group", "Open");
+   CHECK(dev.valueAttempts == 1);
+   CHECK(dev.log == "GV");
+
+   SECTION("Forgotten when the device is unloaded") {
+      c.unloadAllDevices();
+      adapter2.LoadIntoCore(c);
+      c.defineConfig("Group", "Open", "dev", "Value", "1");
+      c.defineConfig("Group", "Open", "dev", "Gate", "1");
+      c.setConfig("Group", "Open");
+      CHECK(dev2.valueAttempts == 2);
+   }
+}
+
+TEST_CASE("Apply configuration still fails on unsatisfiable settings",
+   "[ApplyConfiguration]")
+{
+   const bool parallel = GENERATE(false, true);
+   FeatureGuard f("ParallelConfigApplication", parallel);
+
+   GatedDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.defineConfig("Group", "Closed", "dev", "Value", "1");
+   c.defineConfig("Group", "Closed", "dev", "Other", "1");
+
+   CHECK_THROWS_AS(c.setConfig("Group", "Closed"), CMMError);
+   CHECK(dev.valueAttempts == 2);
+   CHECK(dev.log == "O");
+}
+
+TEST_CASE("Parallel configuration application overlaps modules",
+   "[ApplyConfiguration]")
+{
+   FeatureGuard f("ParallelConfigApplication", true);
+
+   GatedDevice a(std::chrono::milliseconds(100));
+   GatedDevice b(std::chrono::milliseconds(100));
+   MockAdapterWithDevices adapterA("adapter_a", {{"a", &a}});
+   MockAdapterWithDevices adapterB("adapter_b", {{"b", &b}});
+   CMMCore c;
+   adapterA.LoadIntoCore(c);
+   adapterB.LoadIntoCore(c);
+   c.defineConfig("Group", "Preset", "a", "Other", "1");
+   c.defineConfig("Group", "Preset", "a", "Gate", "1");
+   c.defineConfig("Group", "Preset", "a", "Value", "1");
+   c.defineConfig("Group", "Preset", "b", "Other", "1");
+   c.defineConfig("Group", "Preset", "b", "Gate", "1");
+
+   const auto start = std::chrono::steady_clock::now();
+   c.setConfig("Group", "Preset");
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   CHECK(a.log == "OGV"); // Order within a device is kept
+   CHECK(b.log == "OG");
+   CHECK(elapsed < std::chrono::milliseconds(390));
+}
+
+TEST_CASE("Parallel configuration application defers settings depending on "
+   "other modules", "[ApplyConfiguration]")
+{
+   FeatureGuard f("ParallelConfigApplication", true);
+
+   GatedDevice a(std::chrono::milliseconds(50));
+   GatedDevice b;
+   b.requiredGate = &a.gate;
+   MockAdapterWithDevices adapterA("adapter_a", {{"a", &a}});
+   MockAdapterWithDevices adapterB("adapter_b", {{"b", &b}});
+   CMMCore c;
+   adapterA.LoadIntoCore(c);
+   adapterB.LoadIntoCore(c);
+   c.defineConfig("Group", "Preset", "b", "Value", "1");
+   c.defineConfig("Group", "Preset", "a", "Gate", "1");
+
+   // b's Value is tried while a's Gate is still being set
+   c.setConfig("Group", "Preset");
+   CHECK(b.valueAttempts == 2);
+
+   c.setProperty("a", "Gate", "0");
+   b.valueAttempts = 0;
+   c.setConfig("Group", "Preset");
+   CHECK(b.valueAttempts == 1);
+   CHECK(a.gate);
+}
+
+TEST_CASE("Parallel configuration application keeps module order after a "
+   "deferred setting", "[ApplyConfiguration]")
+{
+   FeatureGuard f("ParallelConfigApplication", true);
+
+   GatedDevice a(std::chrono::milliseconds(50));
+   GatedDevice b;
+   b.requiredGate = &a.gate;
+   MockAdapterWithDevices adapterA("adapter_a", {{"a", &a}});
+   MockAdapterWithDevices adapterB("adapter_b", {{"b", &b}});
+   CMMCore c;
+   adapterA.LoadIntoCore(c);
+   adapterB.LoadIntoCore(c);
+   c.defineConfig("Group", "Preset", "b", "Value", "1");
+   c.defineConfig("Group", "Preset", "a", "Gate", "1");
+   c.setConfig("Group", "Preset"); // Learns that b's Value needs a's Gate
+   c.defineConfig("Group", "Preset", "b", "Other", "1");
+
+   c.setProperty("a", "Gate", "0");
+   b.valueAttempts = 0;
+   b.log.clear();
+   c.setConfig("Group", "Preset");
+   CHECK(b.valueAttempts == 1);
+   CHECK(b.log == "VO"); // Other is not moved ahead of the deferred Value
+}
+
+TEST_CASE("Compiled preset is applied until its group changes",
+   "[ApplyConfiguration]")
+{
+   GatedDevice dev;
+   GatedDevice other;
+   MockAdapterWithDevices adapter{{"dev", &dev}, {"other", &other}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.defineConfig("Group", "Open", "dev", "Gate", "1");
+   c.defineConfig("Group", "Open", "dev", "Mode", "B");
+   c.defineConfig("Group", "Closed", "dev", "Gate", "0");
+   c.defineConfig("Other", "Preset", "other", "Other", "1");
+
+   CHECK_FALSE(c.isConfigCompiled("Group", "Open"));
+   c.compileConfig("Group", "Open");
+   CHECK(c.isConfigCompiled("Group", "Open"));
+   CHECK_FALSE(c.isConfigCompiled("Group", "Closed"));
+
+   c.setConfig("Group", "Open");
+   CHECK(dev.gate);
+   CHECK(c.getPropertyFromCache("dev", "Mode") == "B");
+   c.setConfig("Group", "Closed");
+   CHECK_FALSE(dev.gate);
+   CHECK(c.getCurrentConfig("Group") == "Closed");
+
+   SECTION("Changing another group keeps it") {
+      c.defineConfig("Other", "Preset", "other", "Other", "2");
+      CHECK(c.isConfigCompiled("Group", "Open"));
+   }
+
+   SECTION("Redefining the group discards it") {
+      c.defineConfig("Group", "Closed", "dev", "Mode", "A");
+      CHECK_FALSE(c.isConfigCompiled("Group", "Open"));
+      c.setConfig("Group", "Open");
+      CHECK(dev.gate);
+   }
+
+   SECTION("Renaming the group discards it") {
+      c.renameConfigGroup("Group", "Renamed");
+      c.renameConfigGroup("Renamed", "Group");
+      CHECK_FALSE(c.isConfigCompiled("Group", "Open"));
+   }
+
+   SECTION("Unloading a device it sets discards it") {
+      c.compileConfig("Other", "Preset");
+      c.unloadDevice("other");
+      CHECK(c.isConfigCompiled("Group", "Open"));
+      CHECK_FALSE(c.isConfigCompiled("Other", "Preset"));
+      c.unloadDevice("dev");
+      CHECK_FALSE(c.isConfigCompiled("Group", "Open"));
+      CHECK_THROWS_AS(c.setConfig("Group", "Open"), CMMError);
+   }
+}
+
+TEST_CASE("Compiling a preset checks its values", "[ApplyConfiguration]")
+{
+   GatedDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.defineConfig("Group", "Good", "dev", "Other", "10");
+   c.defineConfig("Group", "Good", "dev", "Mode", "A");
+   c.defineConfig("Group", "Good", "Core", "AutoShutter", "0");
+   c.defineConfig("Group", "OutOfRange", "dev", "Other", "11");
+   c.defineConfig("Group", "NotNumber", "dev", "Other", "x");
+   c.defineConfig("Group", "NotAllowed", "dev", "Mode", "C");
+   c.defineConfig("Group", "ReadOnly", "dev", "Model", "Gated");
+   c.defineConfig("Group", "Missing", "dev", "Missing", "1");
+   c.defineConfig("Group", "CoreValue", "Core", "AutoShutter", "2");
+
+   c.compileConfig("Group", "Good");
+   CHECK(c.isConfigCompiled("Group", "Good"));
+   for (const char* preset : {"OutOfRange", "NotNumber", "NotAllowed",
+         "ReadOnly", "Missing", "CoreValue"}) {
+      CAPTURE(preset);
+      CHECK_THROWS_AS(c.compileConfig("Group", preset), CMMError);
+      CHECK_FALSE(c.isConfigCompiled("Group", preset));
+   }
+   CHECK_THROWS_AS(c.compileConfig("Group", "Undefined"), CMMError);
+}
+
+TEST_CASE("Compiled preset takes learned order into account",
+   "[ApplyConfiguration]")
+{
+   GatedDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.defineConfig("Group", "Open", "dev", "Value", "1");
+   c.defineConfig("Group", "Open", "dev", "Gate", "1");
+   c.compileConfig("Group", "Open");
+
+   c.setConfig("Group", "Open");
+   CHECK(dev.valueAttempts == 2);
+   CHECK(c.isConfigCompiled("Group", "Open"));
+
+   c.setProperty("dev", "Gate", "0");
+   dev.valueAttempts = 0;
+   c.setConfig("Group", "Open");
+   CHECK(dev.valueAttempts == 1);
+}
@@ -0,0 +1,203 @@
+#include <catch2/catch_all.hpp>
+
+#include "Logging/BinaryLogDecoder.h"
+#include "Logging/BinaryLogSink.h"
+#include "Logging/Logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mm {
+namespace logging {
+
+namespace {
+
+// Removes the file when going out of scope
+struct ScratchFile
+{
+   std::string name;
+   explicit ScratchFile(const std::string& n) : name(n) { std::remove(name.c_str()); }
+   ~ScratchFile() { std::remove(name.c_str()); }
+};
+
+std::string ReadFile(const std::string& name)
+{
+   std::ifstream in(name.c_str(), std::ios_base::binary);
+   std::ostringstream content;
+   content << in.rdbuf();
+   return content.str();
+}
+
+std::vector<std::string> Lines(const std::string& text)
+{
+   std::vector<std::string> lines;
+   std::istringstream stream(text);
+   std::string line;
+   while (std::getline(stream, line))
+      lines.push_back(line);
+   return lines;
+}
+
+std::string Decode(const std::string& content,
+      const BinaryLogDecoderOptions& options = BinaryLogDecoderOptions())
+{
+   std::istringstream in(content);
+   std::ostringstream out;
+   std::string error;
+   bool ok = DecodeBinaryLog(in, out, options, error);
+   INFO(error);
+   CHECK(ok);
+   return out.str();
+}
+
+} // anonymous namespace
+
+
+TEST_CASE("binary log decodes to the text log format", "[BinaryLog]")
+{
+   ScratchFile textFile("BinaryLog-Tests-text.log");
+   ScratchFile binaryFile("BinaryLog-Tests-binary.log");
+   {
+      auto c = std::make_shared<LoggingCore>();
+      c->AddSink(std::make_shared<FileLogSink>(textFile.name),
+            SinkModeSynchronous);
+      c->AddSink(std::make_shared<BinaryFileLogSink>(binaryFile.name),
+            SinkModeAsynchronous);
+
+      Logger core = c->NewLogger("Core");
+      Logger dev = c->NewLogger("dev:Camera");
+      core(LogLevelInfo, "Single line");
+      dev(LogLevelDebug, "First line\nSecond line\r\nThird line");
+      dev(LogLevelError, std::string(300, 'x').c_str());
+      core(LogLevelWarning, "");
+      std::thread([&] { core(LogLevelTrace, "From another thread"); }).join();
+   }
+
+   const auto expected = Lines(ReadFile(textFile.name));
+   const auto decoded = Lines(Decode(ReadFile(binaryFile.name)));
+   REQUIRE(expected.size() == 7);
+   REQUIRE(decoded.size() == expected.size());
+   // Timestamps are reconstructed from the steady clock, so may differ in
+   // the last digits; the rest must match exactly
+   const std::size_t timestampLen = 26;
+   for (std::size_t i = 0; i < expected.size(); ++i)
+   {
+      if (expected[i][0] == ' ')
+      {
+         CHECK(decoded[i] == expected[i]);
+      }
+      else
+      {
+         std::chrono::system_clock::time_point decodedTime, expectedTime;
+         REQUIRE(ParseLogTimestamp(decoded[i].substr(0, timestampLen),
+                  decodedTime));
+         REQUIRE(ParseLogTimestamp(expected[i].substr(0, timestampLen),
+                  expectedTime));
+         const auto difference = decodedTime - expectedTime;
+         CHECK(difference < std::chrono::milliseconds(100));
+         CHECK(difference > std::chrono::milliseconds(-100));
+         CHECK(decoded[i].substr(timestampLen) ==
+               expected[i].substr(timestampLen));
+      }
+   }
+}
+
+
+TEST_CASE("binary log decoder filters by device and time", "[BinaryLog]")
+{
+   ScratchFile binaryFile("BinaryLog-Tests-filter.log");
+   std::chrono::system_clock::time_point middle;
+   {
+      auto c = std::make_shared<LoggingCore>();
+      c->AddSink(std::make_shared<BinaryFileLogSink>(binaryFile.name),
+            SinkModeSynchronous);
+      Logger core = c->NewLogger("Core");
+      Logger cam = c->NewLogger("dev:Camera");
+      Logger coreCam = c->NewLogger("Core:dev:Camera");
+      Logger stage = c->NewLogger("dev:Stage");
+
+      cam(LogLevelInfo, "camera early");
+      stage(LogLevelInfo, "stage early");
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      middle = std::chrono::system_clock::now();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      coreCam(LogLevelInfo, "core about camera late\nsecond line");
+      core(LogLevelInfo, "core late");
+   }
+   const std::string content = ReadFile(binaryFile.name);
+
+   BinaryLogDecoderOptions byDevice;
+   byDevice.devices.push_back("Camera");
+   auto lines = Lines(Decode(content, byDevice));
+   REQUIRE(lines.size() == 3);
+   CHECK(lines[0].find("dev:Camera] camera early") != std::string::npos);
+   CHECK(lines[1].find("Core:dev:Camera] core about camera late") !=
+         std::string::npos);
+   CHECK(lines[2].find("] second line") != std::string::npos);
+
+   BinaryLogDecoderOptions byTime;
+   byTime.hasBegin = true;
+   byTime.begin = middle;
+   lines = Lines(Decode(content, byTime));
+   REQUIRE(lines.size() == 3);
+   CHECK(lines[2].find("core late") != std::string::npos);
+
+   byTime.hasBegin = false;
+   byTime.hasEnd = true;
+   byTime.end = middle;
+   lines = Lines(Decode(content, byTime));
+   REQUIRE(lines.size() == 2);
+   CHECK(lines[1].find("stage early") != std::string::npos);
+}
+
+
+TEST_CASE("binary log can be appended to and survives truncation",
+   "[BinaryLog]")
+{
+   ScratchFile binaryFile("BinaryLog-Tests-append.log");
+   for (int session = 0; session < 2; ++session)
+   {
+      auto c = std::make_shared<LoggingCore>();
+      c->AddSink(std::make_shared<BinaryFileLogSink>(binaryFile.name, true),
+            SinkModeSynchronous);
+      Logger lgr = c->NewLogger(session == 0 ? "First" : "Second");
+      lgr(LogLevelInfo, "entry");
+   }
+   const std::string content = ReadFile(binaryFile.name);
+   auto lines = Lines(Decode(content));
+   REQUIRE(lines.size() == 2);
+   CHECK(lines[0].find("[IFO,First] entry") != std::string::npos);
+   CHECK(lines[1].find("[IFO,Second] entry") != std::string::npos);
+
+   // A partially written last record
+   std::istringstream in(content.substr(0, content.size() - 2));
+   std::ostringstream out;
+   std::string error;
+   CHECK_FALSE(DecodeBinaryLog(in, out, BinaryLogDecoderOptions(), error));
+   CHECK_FALSE(error.empty());
+   CHECK(Lines(out.str()).size() == 1);
+
+   std::istringstream text("2024-01-31T13:45:00.000000 tid1 [IFO,Core] x");
+   CHECK_FALSE(DecodeBinaryLog(text, out, BinaryLogDecoderOptions(), error));
+}
+
+
+TEST_CASE("log timestamps parse as local time", "[BinaryLog]")
+{
+   std::chrono::system_clock::time_point tp;
+   REQUIRE(ParseLogTimestamp("2024-01-31T13:45:00.25", tp));
+   CHECK(internal::FormatLocalTime(tp) == "2024-01-31T13:45:00.250000");
+   REQUIRE(ParseLogTimestamp("2024-07-01T00:00:59", tp));
+   CHECK(internal::FormatLocalTime(tp) == "2024-07-01T00:00:59.000000");
+   CHECK_FALSE(ParseLogTimestamp("yesterday", tp));
+   CHECK_FALSE(ParseLogTimestamp("2024-07-01T00:00:59Z", tp));
+}
+
+} // namespace logging
+} // namespace mm
@@ -0,0 +1,69 @@
+#include <catch2/catch_all.hpp>
+
+#include "CircularBuffer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Push nFrames through the buffer from one producer while nConsumers threads
+// pop (and a "display" thread peeks at the newest frame) as fast as they can.
+void RunContention(CircularBuffer& cb, unsigned width, unsigned height,
+   unsigned nConsumers, long nFrames)
+{
+   std::atomic<bool> producerDone{false};
+   std::atomic<long> popped{0};
+
+   std::vector<std::thread> threads;
+   for (unsigned c = 0; c < nConsumers; ++c) {
+      threads.emplace_back([&] {
+         for (;;) {
+            bool done = producerDone.load();
+            if (cb.GetNextImageBuffer(0))
+               popped.fetch_add(1, std::memory_order_relaxed);
+            else if (done)
+               break;
+         }
+      });
+   }
+   threads.emplace_back([&] {
+      while (!producerDone.load()) {
+         (void)cb.GetTopImageBuffer(0);
+         (void)cb.GetRemainingImageCount();
+      }
+   });
+
+   Metadata md;
+   md.put(MM::g_Keyword_Metadata_CameraLabel, "cam");
+   std::vector<unsigned char> pixels(width * height * 2);
+   for (long i = 0; i < nFrames; ) {
+      if (cb.InsertImage(pixels.data(), width, height, 2, &md))
+         ++i;
+   }
+   producerDone = true;
+   for (auto& t : threads)
+      t.join();
+   REQUIRE(popped.load() == nFrames);
+}
+
+} // namespace
+
+TEST_CASE("CircularBuffer single producer, multiple consumers",
+   "[CircularBuffer][benchmark]")
+{
+   const long nFrames = 2000;
+   CircularBuffer cb(64);
+   REQUIRE(cb.Initialize(128, 128, 2));
+
+   BENCHMARK("2000 frames 128x128x2, 1 consumer") {
+      RunContention(cb, 128, 128, 1, nFrames);
+   };
+   BENCHMARK("2000 frames 128x128x2, 2 consumers") {
+      RunContention(cb, 128, 128, 2, nFrames);
+   };
+   BENCHMARK("2000 frames 128x128x2, 4 consumers") {
+      RunContention(cb, 128, 128, 4, nFrames);
+   };
+}
@@ -0,0 +1,273 @@
+#include <catch2/catch_all.hpp>
+
+#include "CircularBuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+long ImageNumber(const Metadata& md) {
+   return std::stol(
+      md.GetSingleTag(MM::g_Keyword_Metadata_ImageNumber).GetValue());
+}
+
+Metadata CameraMetadata() {
+   Metadata md;
+   md.put(MM::g_Keyword_Metadata_CameraLabel, "cam");
+   return md;
+}
+
+} // namespace
+
+TEST_CASE("CircularBuffer pops frames in insertion order", "[CircularBuffer]")
+{
+   const Metadata md = CameraMetadata();
+   CircularBuffer cb(1);
+   REQUIRE(cb.Initialize(16, 16, 1));
+   CHECK(cb.GetRemainingImageCount() == 0);
+   CHECK(cb.GetNextImageBuffer(0) == nullptr);
+
+   std::vector<unsigned char> pixels(16 * 16);
+   for (unsigned char i = 0; i < 3; ++i) {
+      pixels[0] = i;
+      REQUIRE(cb.InsertImage(pixels.data(), 16, 16, 1, &md));
+   }
+   CHECK(cb.GetRemainingImageCount() == 3);
+   CHECK(cb.GetTopImage()[0] == 2);
+   CHECK(cb.GetNthFromTopImageBuffer(2)->GetPixels()[0] == 0);
+   CHECK(cb.GetNthFromTopImageBuffer(3) == nullptr);
+
+   for (unsigned char i = 0; i < 3; ++i) {
+      const mm::ImgBuffer* img = cb.GetNextImageBuffer(0);
+      REQUIRE(img != nullptr);
+      CHECK(img->GetPixels()[0] == i);
+      CHECK(ImageNumber(img->GetMetadata()) == i);
+   }
+   CHECK(cb.GetNextImageBuffer(0) == nullptr);
+   CHECK(cb.GetRemainingImageCount() == 0);
+}
+
+TEST_CASE("CircularBuffer overflow", "[CircularBuffer]")
+{
+   const Metadata md = CameraMetadata();
+   CircularBuffer cb(1);
+   REQUIRE(cb.Initialize(512, 512, 2)); // 2 frames fit in 1 MB
+   REQUIRE(cb.GetSize() == 2);
+   std::vector<unsigned char> pixels(512 * 512 * 2);
+
+   SECTION("stops when full") {
+      REQUIRE(cb.InsertImage(pixels.data(), 512, 512, 2, &md));
+      REQUIRE(cb.InsertImage(pixels.data(), 512, 512, 2, &md));
+      CHECK(cb.GetFreeSize() == 0);
+      CHECK_FALSE(cb.InsertImage(pixels.data(), 512, 512, 2, &md));
+      CHECK(cb.Overflow());
+      CHECK(cb.GetRemainingImageCount() == 2);
+
+      REQUIRE(cb.GetNextImageBuffer(0) != nullptr);
+      CHECK(cb.InsertImage(pixels.data(), 512, 512, 2, &md));
+   }
+
+   SECTION("discards old frames in overwrite mode") {
+      cb.SetOverwriteData(true);
+      for (int i = 0; i < 5; ++i)
+         REQUIRE(cb.InsertImage(pixels.data(), 512, 512, 2, &md));
+      CHECK_FALSE(cb.Overflow());
+      CHECK(cb.GetRemainingImageCount() == 1);
+      CHECK(cb.GetTopImageBuffer(0) != nullptr);
+   }
+
+   SECTION("rejects frames of the wrong size") {
+      CHECK_THROWS_AS(cb.InsertImage(pixels.data(), 256, 512, 2, &md),
+         CMMError);
+   }
+}
+
+TEST_CASE("CircularBuffer delivers each frame to exactly one consumer",
+   "[CircularBuffer]")
+{
+   const unsigned nConsumers = 4;
+   const long nFrames = 20000;
+
+   const Metadata md = CameraMetadata();
+   CircularBuffer cb(1);
+   REQUIRE(cb.Initialize(64, 64, 1));
+
+   std::atomic<bool> producerDone{false};
+   std::vector<std::vector<long>> received(nConsumers);
+   std::vector<std::thread> consumers;
+   for (unsigned c = 0; c < nConsumers; ++c) {
+      consumers.emplace_back([&, c] {
+         for (;;) {
+            bool done = producerDone.load();
+            const mm::ImgBuffer* img = cb.GetNextImageBuffer(0);
+            if (img)
+               received[c].push_back(ImageNumber(img->GetMetadata()));
+            else if (done)
+               break;
+            else
+               std::this_thread::yield();
+         }
+      });
+   }
+
+   std::vector<unsigned char> pixels(64 * 64);
+   for (long i = 0; i < nFrames; ) {
+      if (cb.InsertImage(pixels.data(), 64, 64, 1, &md))
+         ++i;
+      else
+         std::this_thread::yield();
+   }
+   producerDone = true;
+   for (auto& t : consumers)
+      t.join();
+
+   std::set<long> all;
+   std::size_t total = 0;
+   for (const auto& r : received) {
+      total += r.size();
+      all.insert(r.begin(), r.end());
+   }
+   CHECK(total == static_cast<std::size_t>(nFrames));
+   CHECK(all.size() == static_cast<std::size_t>(nFrames));
+   CHECK(*all.begin() == 0);
+   CHECK(*all.rbegin() == nFrames - 1);
+}
+
+TEST_CASE("CircularBuffer image handles pin their slot", "[CircularBuffer]")
+{
+   const Metadata md = CameraMetadata();
+   auto cb = std::make_shared<CircularBuffer>(1);
+   REQUIRE(cb->Initialize(512, 512, 2)); // 2 frames fit in 1 MB
+   std::vector<unsigned char> pixels(512 * 512 * 2);
+
+   CHECK_FALSE(cb->GetNextImageHandle());
+
+   pixels[0] = 10;
+   REQUIRE(cb->InsertImage(pixels.data(), 512, 512, 2, &md));
+   pixels[0] = 11;
+   REQUIRE(cb->InsertImage(pixels.data(), 512, 512, 2, &md));
+
+   mm::ImageHandle top = cb->GetNthFromTopImageHandle(0);
+   REQUIRE(top);
+   CHECK(top.GetPixels()[0] == 11);
+   CHECK(cb->GetRemainingImageCount() == 2);
+   top.Release();
+
+   mm::ImageHandle first = cb->GetNextImageHandle();
+   REQUIRE(first);
+   CHECK(first.GetPixels()[0] == 10);
+   CHECK(ImageNumber(first.GetMetadata()) == 0);
+   CHECK(first.Width() == 512);
+   CHECK(cb->GetRemainingImageCount() == 1);
+
+   SECTION("producer does not overwrite a pinned slot") {
+      pixels[0] = 12;
+      CHECK_FALSE(cb->InsertImage(pixels.data(), 512, 512, 2, &md));
+      CHECK(cb->Overflow());
+      CHECK(first.GetPixels()[0] == 10);
+
+      first.Release();
+      cb->Clear();
+      CHECK(cb->InsertImage(pixels.data(), 512, 512, 2, &md));
+   }
+
+   SECTION("overwrite mode skips a pinned slot") {
+      cb->SetOverwriteData(true);
+      for (unsigned char value = 12; value < 20; ++value) {
+         pixels[0] = value;
+         CHECK(cb->InsertImage(pixels.data(), 512, 512, 2, &md));
+         CHECK_FALSE(cb->Overflow());
+         mm::ImageHandle latest = cb->GetNthFromTopImageHandle(0);
+         REQUIRE(latest);
+         CHECK(latest.GetPixels()[0] == value);
+      }
+      CHECK(first.GetPixels()[0] == 10);
+   }
+
+   SECTION("buffer cannot be reallocated while handles are outstanding") {
+      CHECK_FALSE(cb->Initialize(256, 256, 2));
+      first.Release();
+      CHECK(cb->Initialize(256, 256, 2));
+   }
+
+   SECTION("handle outlives the buffer's owner") {
+      cb.reset();
+      CHECK(first.GetPixels()[0] == 10);
+   }
+}
+
+TEST_CASE("CircularBuffer consumers step over slots skipped while pinned",
+   "[CircularBuffer]")
+{
+   const Metadata md = CameraMetadata();
+   auto cb = std::make_shared<CircularBuffer>(1);
+   REQUIRE(cb->Initialize(400, 400, 2)); // 3 frames fit in 1 MB
+   REQUIRE(cb->GetSize() == 3);
+   std::vector<unsigned char> pixels(400 * 400 * 2);
+
+   for (unsigned char value = 10; value < 13; ++value) {
+      pixels[0] = value;
+      REQUIRE(cb->InsertImage(pixels.data(), 400, 400, 2, &md));
+   }
+   mm::ImageHandle pinned = cb->GetNextImageHandle();
+   REQUIRE(pinned);
+   REQUIRE(cb->GetNextImageBuffer(0));
+
+   // Frame 13 would go to the pinned slot, so goes to the next one
+   pixels[0] = 13;
+   REQUIRE(cb->InsertImage(pixels.data(), 400, 400, 2, &md));
+   CHECK(pinned.GetPixels()[0] == 10);
+
+   const mm::ImgBuffer* top = cb->GetTopImageBuffer(0);
+   REQUIRE(top);
+   CHECK(top->GetPixels()[0] == 13);
+   const mm::ImgBuffer* second = cb->GetNthFromTopImageBuffer(1);
+   REQUIRE(second);
+   CHECK(second->GetPixels()[0] == 12);
+
+   SECTION("popping buffers") {
+      const mm::ImgBuffer* img = cb->GetNextImageBuffer(0);
+      REQUIRE(img);
+      CHECK(img->GetPixels()[0] == 12);
+      img = cb->GetNextImageBuffer(0);
+      REQUIRE(img);
+      CHECK(img->GetPixels()[0] == 13);
+      CHECK(ImageNumber(img->GetMetadata()) == 3);
+      CHECK_FALSE(cb->GetNextImageBuffer(0));
+   }
+
+   SECTION("popping handles") {
+      mm::ImageHandle img = cb->GetNextImageHandle();
+      REQUIRE(img);
+      CHECK(img.GetPixels()[0] == 12);
+      img = cb->GetNextImageHandle();
+      REQUIRE(img);
+      CHECK(img.GetPixels()[0] == 13);
+      CHECK_FALSE(cb->GetNextImageHandle());
+   }
+
+   SECTION("all slots pinned") {
+      mm::ImageHandle a = cb->GetNextImageHandle();
+      mm::ImageHandle b = cb->GetNextImageHandle();
+      REQUIRE(a);
+      REQUIRE(b);
+      cb->SetOverwriteData(true);
+      CHECK_FALSE(cb->InsertImage(pixels.data(), 400, 400, 2, &md));
+      CHECK(cb->Overflow());
+   }
+}
+
+TEST_CASE("CircularBuffer slot count can be limited", "[CircularBuffer]")
+{
+   CircularBuffer cb(1);
+   cb.SetMaxImageCount(100);
+   REQUIRE(cb.Initialize(4, 4, 1)); // 65536 frames would fit in 1 MB
+   CHECK(cb.GetSize() == 100);
+   REQUIRE(cb.Initialize(512, 512, 2));
+   CHECK(cb.GetSize() == 2);
+}
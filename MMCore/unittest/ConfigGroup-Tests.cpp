@@ -0,0 +1,146 @@
+#include <catch2/catch_all.hpp>
+
+#include "ConfigGroup.h"
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MMEventCallback.h"
+#include "MockDeviceUtils.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace {
+
+std::set<std::string> Groups(std::initializer_list<std::string> il) {
+   return std::set<std::string>(il);
+}
+
+class NotifyingDevice : public CGenericBase<NotifyingDevice> {
+public:
+   int Initialize() override {
+      CreateIntegerProperty("Position", 0, false);
+      CreateIntegerProperty("Temperature", 0, false);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "NotifyingDevice");
+   }
+
+   void Notify(const char* propName, const char* value) {
+      SetProperty(propName, value);
+      OnPropertyChanged(propName, value);
+   }
+};
+
+class CountingCallback : public MMEventCallback {
+public:
+   std::map<std::string, int> groupChanges;
+   int pixelSizeChanges = 0;
+
+   void onConfigGroupChanged(const char* groupName, const char*) override {
+      ++groupChanges[groupName];
+   }
+   void onPixelSizeChanged(double) override { ++pixelSizeChanges; }
+};
+
+} // namespace
+
+TEST_CASE("Config group property index follows definitions", "[ConfigGroup]")
+{
+   ConfigGroupCollection groups;
+   groups.Define("Channel", "DAPI", "Filter", "State", "0");
+   groups.Define("Channel", "FITC", "Filter", "State", "1");
+   groups.Define("Channel", "FITC", "Shutter", "State", "1");
+   groups.Define("Objective", "10x", "Nosepiece", "State", "0");
+   CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+      Groups({"Channel"}));
+   CHECK(groups.GetGroupsIncludingProperty("Nosepiece", "State") ==
+      Groups({"Objective"}));
+   CHECK(groups.GetGroupsIncludingProperty("Filter", "Label").empty());
+
+   SECTION("Redefining a setting does not double count") {
+      groups.Define("Channel", "DAPI", "Filter", "State", "2");
+      REQUIRE(groups.Delete("Channel", "FITC"));
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+         Groups({"Channel"}));
+      CHECK(groups.GetGroupsIncludingProperty("Shutter", "State").empty());
+      REQUIRE(groups.Delete("Channel", "DAPI", "Filter", "State"));
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State").empty());
+   }
+
+   SECTION("Property shared by groups") {
+      groups.Define("Objective", "20x", "Filter", "State", "3");
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+         Groups({"Channel", "Objective"}));
+      REQUIRE(groups.Delete("Objective"));
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+         Groups({"Channel"}));
+      CHECK(groups.GetGroupsIncludingProperty("Nosepiece", "State").empty());
+   }
+
+   SECTION("Renaming presets and groups") {
+      REQUIRE(groups.RenameConfig("Channel", "DAPI", "FITC"));
+      CHECK(groups.GetGroupsIncludingProperty("Shutter", "State").empty());
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+         Groups({"Channel"}));
+
+      REQUIRE(groups.RenameGroup("Channel", "Objective"));
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State") ==
+         Groups({"Objective"}));
+      CHECK(groups.GetGroupsIncludingProperty("Nosepiece", "State").empty());
+   }
+
+   SECTION("Clear") {
+      groups.Clear();
+      CHECK(groups.GetGroupsIncludingProperty("Filter", "State").empty());
+   }
+}
+
+TEST_CASE("Pixel size group tracks included properties", "[ConfigGroup]")
+{
+   PixelSizeConfigGroup group;
+   CHECK(group.DefinePixelSize("Res10x", "Nosepiece", "State", "0", 0.65));
+   group.Define("Res20x", "Nosepiece", "State", "1");
+   CHECK(group.IncludesProperty("Nosepiece", "State"));
+   CHECK_FALSE(group.IncludesProperty("Nosepiece", "Label"));
+   REQUIRE(group.Delete("Res10x"));
+   CHECK(group.IncludesProperty("Nosepiece", "State"));
+   REQUIRE(group.Rename("Res20x", "Res20x"));
+   CHECK(group.IncludesProperty("Nosepiece", "State"));
+   REQUIRE(group.Delete("Res20x"));
+   CHECK_FALSE(group.IncludesProperty("Nosepiece", "State"));
+}
+
+TEST_CASE("Property change notifies only affected groups", "[ConfigGroup]")
+{
+   NotifyingDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   CountingCallback cb;
+   c.registerCallback(&cb);
+
+   c.defineConfig("Position", "Home", "dev", "Position", "0");
+   c.defineConfig("Position", "Away", "dev", "Position", "100");
+   c.defineConfig("Other", "A", "dev", "Temperature", "20");
+   c.definePixelSizeConfig("Res", "dev", "Position", "0");
+
+   dev.Notify("Position", "100");
+   CHECK(cb.groupChanges["Position"] == 1);
+   CHECK(cb.groupChanges.count("Other") == 0);
+   CHECK(cb.pixelSizeChanges == 1);
+
+   c.deleteConfig("Position", "Home");
+   c.deleteConfig("Position", "Away");
+   c.deletePixelSizeConfig("Res");
+   dev.Notify("Position", "0");
+   CHECK(cb.groupChanges["Position"] == 1);
+   CHECK(cb.pixelSizeChanges == 1);
+
+   dev.Notify("Temperature", "25");
+   CHECK(cb.groupChanges["Other"] == 1);
+   c.registerCallback(nullptr);
+}
@@ -0,0 +1,317 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Shared record of sequence starts and stops, in order
+std::string g_events;
+
+// "State" is sequenceable up to maxLength values; "Power" is not
+class SequencedDevice : public CGenericBase<SequencedDevice> {
+   long maxLength_;
+
+public:
+   std::vector<std::string> loaded;
+   bool running = false;
+   bool failStart = false;
+   long power = 0;
+
+   explicit SequencedDevice(long maxLength) : maxLength_(maxLength) {}
+
+   int Initialize() override {
+      CreateIntegerProperty("State", 0, false,
+         new CPropertyAction(this, &SequencedDevice::OnState));
+      CreateIntegerProperty("Power", 0, false,
+         new CPropertyAction(this, &SequencedDevice::OnPower));
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "SequencedDevice");
+   }
+
+   int OnState(MM::PropertyBase* pProp, MM::ActionType eAct) {
+      if (eAct == MM::IsSequenceable) {
+         pProp->SetSequenceable(maxLength_);
+      } else if (eAct == MM::AfterLoadSequence) {
+         loaded = static_cast<MM::Property*>(pProp)->GetSequence();
+      } else if (eAct == MM::StartSequence) {
+         if (failStart)
+            return DEVICE_ERR;
+         running = true;
+         g_events += "S";
+      } else if (eAct == MM::StopSequence) {
+         running = false;
+         g_events += "s";
+      }
+      return DEVICE_OK;
+   }
+
+   int OnPower(MM::PropertyBase* pProp, MM::ActionType eAct) {
+      if (eAct == MM::AfterSet)
+         pProp->Get(power);
+      return DEVICE_OK;
+   }
+};
+
+class SequenceCamera : public CCameraBase<SequenceCamera> {
+public:
+   bool failStart = false;
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "SequenceCamera");
+   }
+
+   int SnapImage() override { return DEVICE_ERR; }
+   const unsigned char* GetImageBuffer() override { return nullptr; }
+   long GetImageBufferSize() const override { return 64; }
+   unsigned GetImageWidth() const override { return 8; }
+   unsigned GetImageHeight() const override { return 8; }
+   unsigned GetImageBytesPerPixel() const override { return 1; }
+   unsigned GetBitDepth() const override { return 8; }
+   int GetBinning() const override { return 1; }
+   int SetBinning(int) override { return DEVICE_ERR; }
+   void SetExposure(double) override {}
+   double GetExposure() const override { return 10.0; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) override { return DEVICE_ERR; }
+   int GetROI(unsigned&, unsigned&, unsigned&, unsigned&) override { return DEVICE_ERR; }
+   int ClearROI() override { return DEVICE_ERR; }
+   int IsExposureSequenceable(bool& f) const override { f = false; return DEVICE_OK; }
+   int StartSequenceAcquisition(long, double, bool) override {
+      if (failStart)
+         return DEVICE_ERR;
+      g_events += "C";
+      return DEVICE_OK;
+   }
+   int StartSequenceAcquisition(double) override {
+      return StartSequenceAcquisition(LONG_MAX, 0.0, false);
+   }
+   int StopSequenceAcquisition() override {
+      g_events += "c";
+      return DEVICE_OK;
+   }
+   bool IsCapturing() override { return false; }
+};
+
+void DefineChannels(CMMCore& c) {
+   c.defineConfig("Channel", "DAPI", "filter", "State", "0");
+   c.defineConfig("Channel", "DAPI", "laser", "State", "3");
+   c.defineConfig("Channel", "DAPI", "laser", "Power", "50");
+   c.defineConfig("Channel", "FITC", "filter", "State", "1");
+   c.defineConfig("Channel", "FITC", "laser", "State", "4");
+   c.defineConfig("Channel", "FITC", "laser", "Power", "50");
+}
+
+} // namespace
+
+TEST_CASE("Config sequence decomposes presets into property sequences",
+   "[ConfigSequence]")
+{
+   SequencedDevice filter(10);
+   SequencedDevice laser(10);
+   MockAdapterWithDevices adapter{{"filter", &filter}, {"laser", &laser}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   DefineChannels(c);
+   g_events.clear();
+
+   c.loadConfigSequence("Channel", {"DAPI", "FITC", "FITC", "DAPI"});
+   CHECK(filter.loaded == std::vector<std::string>{"0", "1", "1", "0"});
+   CHECK(laser.loaded == std::vector<std::string>{"3", "4", "4", "3"});
+   CHECK(laser.power == 50); // Constant, so set directly
+   CHECK(g_events.empty());
+
+   c.startConfigSequence("Channel");
+   CHECK(filter.running);
+   CHECK(laser.running);
+   c.startConfigSequence("Channel"); // Restarts
+   CHECK(g_events == "SSssSS");
+   c.stopConfigSequence("Channel");
+   CHECK_FALSE(filter.running);
+   CHECK_FALSE(laser.running);
+
+   c.clearConfigSequence("Channel");
+   CHECK_THROWS_AS(c.startConfigSequence("Channel"), CMMError);
+}
+
+TEST_CASE("Config sequence is checked before loading", "[ConfigSequence]")
+{
+   SequencedDevice filter(3);
+   SequencedDevice laser(10);
+   MockAdapterWithDevices adapter{{"filter", &filter}, {"laser", &laser}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   DefineChannels(c);
+
+   SECTION("Too long") {
+      CHECK_THROWS_AS(c.loadConfigSequence("Channel",
+         {"DAPI", "FITC", "DAPI", "FITC"}), CMMError);
+   }
+   SECTION("Varying property that is not sequenceable") {
+      c.defineConfig("Channel", "FITC", "laser", "Power", "70");
+      CHECK_THROWS_AS(c.loadConfigSequence("Channel", {"DAPI", "FITC"}),
+         CMMError);
+   }
+   SECTION("Property missing from a preset") {
+      c.defineConfig("Channel", "TRITC", "filter", "State", "2");
+      CHECK_THROWS_AS(c.loadConfigSequence("Channel", {"DAPI", "TRITC"}),
+         CMMError);
+   }
+   SECTION("Undefined preset") {
+      CHECK_THROWS_AS(c.loadConfigSequence("Channel", {"DAPI", "Cy5"}),
+         CMMError);
+   }
+   SECTION("Empty") {
+      CHECK_THROWS_AS(c.loadConfigSequence("Channel", {}), CMMError);
+   }
+   CHECK(filter.loaded.empty());
+   CHECK(laser.loaded.empty());
+   CHECK(laser.power == 0);
+}
+
+TEST_CASE("Config sequence starts and stops with the camera sequence",
+   "[ConfigSequence]")
+{
+   SequencedDevice filter(10);
+   SequencedDevice laser(10);
+   SequenceCamera cam;
+   MockAdapterWithDevices adapter{{"filter", &filter}, {"laser", &laser},
+      {"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   DefineChannels(c);
+   c.loadConfigSequence("Channel", {"DAPI", "FITC"});
+   g_events.clear();
+
+   SECTION("Started before the camera, stopped after it") {
+      c.startSequenceAcquisition(10, 0.0, true);
+      CHECK(g_events == "SSC");
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "SSCcss");
+      g_events.clear();
+      c.startContinuousSequenceAcquisition(0.0);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "SSCcss");
+   }
+
+   SECTION("Camera not started if a sequence fails to start") {
+      laser.failStart = true;
+      CHECK_THROWS_AS(c.startSequenceAcquisition(10, 0.0, true), CMMError);
+      CHECK(g_events == "Ss");
+      CHECK_FALSE(filter.running);
+   }
+
+   SECTION("Sequences stopped if the camera fails to start") {
+      cam.failStart = true;
+      CHECK_THROWS_AS(c.startSequenceAcquisition(10, 0.0, true), CMMError);
+      CHECK(g_events == "SSss");
+   }
+
+   SECTION("Cleared sequences are not started") {
+      c.clearConfigSequence("Channel");
+      c.startSequenceAcquisition(10, 0.0, true);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "Cc");
+   }
+}
+
+TEST_CASE("Config sequence follows changes to its group", "[ConfigSequence]")
+{
+   SequencedDevice filter(10);
+   SequencedDevice laser(10);
+   SequenceCamera cam;
+   MockAdapterWithDevices adapter{{"filter", &filter}, {"laser", &laser},
+      {"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   DefineChannels(c);
+   c.loadConfigSequence("Channel", {"DAPI", "FITC"});
+   g_events.clear();
+
+   SECTION("Deleting the group stops and removes its sequence") {
+      c.startConfigSequence("Channel");
+      c.deleteConfigGroup("Channel");
+      CHECK_FALSE(filter.running);
+      CHECK_FALSE(laser.running);
+      CHECK(g_events == "SSss");
+      g_events.clear();
+      c.startSequenceAcquisition(10, 0.0, true);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "Cc");
+   }
+
+   SECTION("Renaming the group moves its sequence") {
+      c.renameConfigGroup("Channel", "Color");
+      CHECK_THROWS_AS(c.startConfigSequence("Channel"), CMMError);
+      c.startConfigSequence("Color");
+      CHECK(filter.running);
+      c.stopConfigSequence("Color");
+      c.clearConfigSequence("Color");
+      c.startSequenceAcquisition(10, 0.0, true);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "SSssCc");
+   }
+
+   SECTION("Editing a preset makes the sequence stale") {
+      c.defineConfig("Channel", "FITC", "filter", "State", "2");
+      CHECK_THROWS_AS(c.startConfigSequence("Channel"), CMMError);
+      CHECK_FALSE(filter.running);
+      c.startSequenceAcquisition(10, 0.0, true);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "Cc");
+
+      c.loadConfigSequence("Channel", {"DAPI", "FITC"});
+      CHECK(filter.loaded == std::vector<std::string>{"0", "2"});
+      c.startConfigSequence("Channel");
+      CHECK(filter.running);
+   }
+
+   SECTION("Deleting a preset makes the sequence stale") {
+      c.deleteConfig("Channel", "DAPI");
+      g_events.clear();
+      c.startSequenceAcquisition(10, 0.0, true);
+      c.stopSequenceAcquisition();
+      CHECK(g_events == "Cc");
+   }
+}
+
+TEST_CASE("A property is sequenced by one group's config sequence only",
+   "[ConfigSequence]")
+{
+   SequencedDevice filter(10);
+   SequencedDevice laser(10);
+   MockAdapterWithDevices adapter{{"filter", &filter}, {"laser", &laser}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   DefineChannels(c);
+   c.defineConfig("Filter", "Open", "filter", "State", "5");
+   c.defineConfig("Filter", "Closed", "filter", "State", "6");
+   c.loadConfigSequence("Channel", {"DAPI", "FITC"});
+
+   try {
+      c.loadConfigSequence("Filter", {"Open", "Closed"});
+      FAIL("Loaded a competing sequence");
+   } catch (const CMMError& e) {
+      CHECK(e.getMsg().find("\"Channel\"") != std::string::npos);
+   }
+   CHECK(filter.loaded == std::vector<std::string>{"0", "1"});
+
+   // Constant in the other group, so not sequenced
+   c.loadConfigSequence("Filter", {"Open", "Open"});
+
+   c.clearConfigSequence("Channel");
+   c.loadConfigSequence("Filter", {"Open", "Closed"});
+   CHECK(filter.loaded == std::vector<std::string>{"5", "6"});
+}
@@ -0,0 +1,97 @@
+#include <catch2/catch_all.hpp>
+
+#include "TaskSet_CopyMemory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Frame sizes typical of sCMOS cameras: 2048x2048 and 4096x4096 at 16 bit,
+// plus a small ROI
+const std::size_t FrameSizes[] = {
+   512 * 512 * 2,
+   2048 * 2048 * 2,
+   4096 * 4096 * 2,
+};
+
+// Copy the frame repeatedly and print throughput and per-frame latency
+// percentiles
+void ReportThroughput(const char* name, std::size_t bytes,
+   const std::function<void(void*, const void*, std::size_t)>& copy)
+{
+   std::vector<unsigned char> src(bytes, 1);
+   std::vector<unsigned char> dst(bytes);
+   copy(dst.data(), src.data(), bytes); // Fault in the pages
+
+   const int iterations = static_cast<int>(
+      std::max<std::size_t>(20, (2048u << 20) / bytes));
+   std::vector<double> latencies;
+   latencies.reserve(iterations);
+   for (int i = 0; i < iterations; ++i)
+   {
+      const auto start = std::chrono::steady_clock::now();
+      copy(dst.data(), src.data(), bytes);
+      const auto end = std::chrono::steady_clock::now();
+      latencies.push_back(
+         std::chrono::duration<double, std::micro>(end - start).count());
+   }
+   double total = 0.0;
+   for (double l : latencies)
+      total += l;
+   std::sort(latencies.begin(), latencies.end());
+
+   std::printf("%-24s %9zu bytes: %7.2f GB/s, p50 %8.1f us, p99 %8.1f us\n",
+      name, bytes, bytes * iterations / (total * 1e3),
+      latencies[latencies.size() / 2],
+      latencies[latencies.size() * 99 / 100]);
+}
+
+} // namespace
+
+TEST_CASE("Frame copy throughput", "[CopyMemory][benchmark]")
+{
+   auto pool = std::make_shared<ThreadPool>();
+   TaskSet_CopyMemory parallel(pool);
+   TaskSet_CopyMemory parallelCached(pool);
+   parallelCached.SetStreamingThreshold(0);
+
+   for (std::size_t bytes : FrameSizes)
+   {
+      ReportThroughput("memcpy", bytes,
+         [](void* d, const void* s, std::size_t n) { std::memcpy(d, s, n); });
+      ReportThroughput("streaming, 1 thread", bytes,
+         &TaskSet_CopyMemory::StreamingCopy);
+      ReportThroughput("parallel, no streaming", bytes,
+         [&](void* d, const void* s, std::size_t n) {
+            parallelCached.MemCopy(d, s, n);
+         });
+      ReportThroughput("parallel (default)", bytes,
+         [&](void* d, const void* s, std::size_t n) {
+            parallel.MemCopy(d, s, n);
+         });
+   }
+}
+
+TEST_CASE("Frame copy latency", "[CopyMemory][benchmark]")
+{
+   auto pool = std::make_shared<ThreadPool>();
+   TaskSet_CopyMemory parallel(pool);
+
+   const std::size_t bytes = 2048 * 2048 * 2;
+   std::vector<unsigned char> src(bytes, 1);
+   std::vector<unsigned char> dst(bytes);
+
+   BENCHMARK("memcpy 2048x2048x2") {
+      std::memcpy(dst.data(), src.data(), bytes);
+   };
+   BENCHMARK("TaskSet_CopyMemory 2048x2048x2") {
+      parallel.MemCopy(dst.data(), src.data(), bytes);
+   };
+}
@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+
+#include "MMCore.h"
+#include "TaskSet_CopyMemory.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> Pattern(std::size_t bytes)
+{
+   std::vector<unsigned char> v(bytes);
+   for (std::size_t i = 0; i < bytes; ++i)
+      v[i] = static_cast<unsigned char>((i * 131) ^ (i >> 11));
+   return v;
+}
+
+} // namespace
+
+TEST_CASE("Parallel copy is exact for all sizes and offsets", "[CopyMemory]")
+{
+   auto pool = std::make_shared<ThreadPool>(4);
+   TaskSet_CopyMemory copier(pool);
+
+   const bool streaming = GENERATE(false, true);
+   copier.SetStreamingThreshold(streaming ? 1 : 0);
+
+   const std::size_t size = GENERATE(1, 63, 4096, 999999, 1000000,
+      3 * 1000000 + 17, 9 * 1000000 + 4095);
+   const std::size_t offset = GENERATE(0, 1, 15);
+
+   const std::vector<unsigned char> src = Pattern(size + offset);
+   std::vector<unsigned char> dst(size + 2 * offset + 1, 0xee);
+   copier.MemCopy(dst.data() + offset, src.data() + offset, size);
+
+   CHECK(std::memcmp(dst.data() + offset, src.data() + offset, size) == 0);
+   for (std::size_t i = 0; i < offset; ++i)
+      CHECK(dst[i] == 0xee);
+   CHECK(dst[size + offset] == 0xee);
+}
+
+TEST_CASE("Pinned thread pool runs tasks", "[CopyMemory]")
+{
+   auto pool = std::make_shared<ThreadPool>(3, std::vector<unsigned>{0});
+   CHECK(pool->GetSize() == 3);
+   TaskSet_CopyMemory copier(pool);
+   const std::vector<unsigned char> src = Pattern(5 * 1000000);
+   std::vector<unsigned char> dst(src.size());
+   copier.MemCopy(dst.data(), src.data(), src.size());
+   CHECK(dst == src);
+}
+
+TEST_CASE("Image copy core properties", "[CopyMemory]")
+{
+   CMMCore c;
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyThreads) == "0");
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyCPUs).empty());
+
+   c.setProperty("Core", MM::g_Keyword_CoreImageCopyThreads, "1");
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyThreads) == "1");
+
+   c.setProperty("Core", MM::g_Keyword_CoreImageCopyCPUs, "3;0-1;2");
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyCPUs) == "3;0-2");
+
+   CHECK_THROWS_AS(c.setProperty("Core", MM::g_Keyword_CoreImageCopyCPUs,
+      "1-x"), CMMError);
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyCPUs) == "3;0-2");
+
+   // Settings survive reallocation of the sequence buffer
+   c.setCircularBufferMemoryFootprint(10);
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageCopyThreads) == "1");
+}
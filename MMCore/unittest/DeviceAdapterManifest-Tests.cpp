@@ -0,0 +1,204 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceAdapterManifest.h"
+#include "MMCore.h"
+#include "MockDeviceAdapter.h"
+#include "ModuleInterface.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace mm {
+
+namespace {
+
+// Removes the file when going out of scope
+struct ScratchFile
+{
+   std::string name;
+   explicit ScratchFile(const std::string& n) : name(n) { std::remove(name.c_str()); }
+   ~ScratchFile() { std::remove(name.c_str()); }
+};
+
+DeviceAdapterManifest::Entry MakeEntry(const std::string& path)
+{
+   DeviceAdapterManifest::Entry entry;
+   entry.path = path;
+   entry.stamp.mtime = 1700000000123456789;
+   entry.stamp.size = 4096;
+   entry.moduleInterfaceVersion = 10;
+   entry.deviceInterfaceVersion = 73;
+   DeviceAdapterManifest::Device camera;
+   camera.name = "Camera";
+   camera.description = "A camera";
+   camera.type = MM::CameraDevice;
+   DeviceAdapterManifest::Device stage;
+   stage.name = "Stage\twith tab";
+   stage.description = "Line 1\nLine 2\r\\n not a newline";
+   stage.type = MM::StageDevice;
+   entry.devices.push_back(camera);
+   entry.devices.push_back(stage);
+   return entry;
+}
+
+} // anonymous namespace
+
+
+TEST_CASE("manifest entries are valid only for the stored file stamp",
+   "[DeviceAdapterManifest]")
+{
+   DeviceAdapterManifest manifest;
+   const auto stored = MakeEntry("/path/libmmgr_dal_A.so.0");
+   manifest.Store(stored);
+   CHECK(manifest.GetSize() == 1);
+
+   DeviceAdapterManifest::Entry entry;
+   REQUIRE(manifest.Lookup(stored.path, stored.stamp, entry));
+   CHECK(entry.devices.size() == 2);
+   CHECK(entry.devices[1].name == "Stage\twith tab");
+
+   DeviceAdapterManifest::FileStamp modified = stored.stamp;
+   modified.mtime += 1;
+   CHECK_FALSE(manifest.Lookup(stored.path, modified, entry));
+   DeviceAdapterManifest::FileStamp resized = stored.stamp;
+   resized.size += 1;
+   CHECK_FALSE(manifest.Lookup(stored.path, resized, entry));
+   CHECK_FALSE(manifest.Lookup("/other/libmmgr_dal_A.so.0", stored.stamp,
+            entry));
+
+   manifest.Store(MakeEntry("/path/libmmgr_dal_B.so.0"));
+   manifest.Retain({ "/path/libmmgr_dal_B.so.0", "/path/missing" });
+   CHECK(manifest.GetSize() == 1);
+   CHECK_FALSE(manifest.Lookup(stored.path, stored.stamp, entry));
+}
+
+
+TEST_CASE("manifest round-trips through its file", "[DeviceAdapterManifest]")
+{
+   ScratchFile file("DeviceAdapterManifest-Tests.txt");
+   const auto stored = MakeEntry("C:\\Program Files\\Micro-Manager\\mmgr_dal_A.dll");
+   DeviceAdapterManifest::Entry incompatible;
+   incompatible.path = "/path/libmmgr_dal_Old.so.0";
+   incompatible.moduleInterfaceVersion = 9;
+   incompatible.deviceInterfaceVersion = 60;
+   {
+      DeviceAdapterManifest manifest;
+      manifest.SetFilename(file.name);
+      CHECK(manifest.GetSize() == 0);
+      manifest.Store(stored);
+      manifest.Store(incompatible);
+      manifest.Save();
+   }
+
+   DeviceAdapterManifest manifest;
+   manifest.SetFilename(file.name);
+   CHECK(manifest.GetFilename() == file.name);
+   REQUIRE(manifest.GetSize() == 2);
+
+   DeviceAdapterManifest::Entry entry;
+   REQUIRE(manifest.Lookup(stored.path, stored.stamp, entry));
+   CHECK(entry.moduleInterfaceVersion == stored.moduleInterfaceVersion);
+   CHECK(entry.deviceInterfaceVersion == stored.deviceInterfaceVersion);
+   REQUIRE(entry.devices.size() == stored.devices.size());
+   for (std::size_t i = 0; i < entry.devices.size(); ++i)
+   {
+      CHECK(entry.devices[i].name == stored.devices[i].name);
+      CHECK(entry.devices[i].description == stored.devices[i].description);
+      CHECK(entry.devices[i].type == stored.devices[i].type);
+   }
+
+   REQUIRE(manifest.Lookup(incompatible.path, incompatible.stamp, entry));
+   CHECK(entry.moduleInterfaceVersion == 9);
+   CHECK(entry.devices.empty());
+}
+
+
+TEST_CASE("corrupt manifest files are ignored", "[DeviceAdapterManifest]")
+{
+   ScratchFile file("DeviceAdapterManifest-Tests-corrupt.txt");
+   {
+      DeviceAdapterManifest manifest;
+      manifest.SetFilename(file.name);
+      manifest.Store(MakeEntry("/path/libmmgr_dal_A.so.0"));
+      manifest.Save();
+   }
+   std::string content;
+   {
+      std::ifstream in(file.name.c_str(), std::ios_base::binary);
+      std::getline(in, content, '\0');
+   }
+
+   SECTION("truncated")
+   {
+      // Drop the last device line
+      content.erase(content.rfind('\n', content.size() - 2) + 1);
+   }
+   SECTION("bad number")
+   {
+      content.replace(content.find("4096"), 4, "40x6");
+   }
+   SECTION("other version")
+   {
+      content.replace(content.find("\t1\n"), 3, "\t2\n");
+   }
+   {
+      std::ofstream out(file.name.c_str(), std::ios_base::binary);
+      out << content;
+   }
+
+   DeviceAdapterManifest manifest;
+   manifest.SetFilename(file.name);
+   CHECK(manifest.GetSize() == 0);
+}
+
+
+TEST_CASE("file stamps reflect file size", "[DeviceAdapterManifest]")
+{
+   ScratchFile file("DeviceAdapterManifest-Tests-stamp.bin");
+   DeviceAdapterManifest::FileStamp stamp;
+   CHECK_FALSE(DeviceAdapterManifest::GetFileStamp(file.name, stamp));
+   {
+      std::ofstream out(file.name.c_str(), std::ios_base::binary);
+      out << "12345";
+   }
+   REQUIRE(DeviceAdapterManifest::GetFileStamp(file.name, stamp));
+   CHECK(stamp.size == 5);
+   CHECK(stamp.mtime > 0);
+}
+
+} // namespace mm
+
+
+namespace {
+
+class ListingMockAdapter : public MockDeviceAdapter {
+public:
+   void InitializeModuleData(RegisterDeviceFunc registerDevice) override {
+      registerDevice("cam", MM::CameraDevice, "camera description");
+      registerDevice("shutter", MM::ShutterDevice, "shutter description");
+   }
+   MM::Device* CreateDevice(const char*) override { return nullptr; }
+   void DeleteDevice(MM::Device*) override {}
+};
+
+} // anonymous namespace
+
+
+TEST_CASE("available devices are listed for loaded adapters",
+   "[DeviceAdapterManifest]")
+{
+   ListingMockAdapter adapter;
+   CMMCore c;
+   c.loadMockDeviceAdapter("listing", &adapter);
+   CHECK(c.getAvailableDevices("listing") ==
+         std::vector<std::string>{ "cam", "shutter" });
+   CHECK(c.getAvailableDeviceDescriptions("listing") ==
+         std::vector<std::string>{ "camera description", "shutter description" });
+   CHECK(c.getAvailableDeviceTypes("listing") ==
+         std::vector<long>{ MM::CameraDevice, MM::ShutterDevice });
+   CHECK(c.getDeviceAdapterModuleInterfaceVersion("listing") ==
+         MODULE_INTERFACE_VERSION);
+   CHECK_THROWS_AS(c.getAvailableDevices("NoSuchAdapterAnywhere"), CMMError);
+   CHECK(c.getDeviceAdapterCacheFile().empty());
+}
@@ -0,0 +1,312 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "DeviceModuleLock.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Counts readers of "Value" (across devices sharing the same Readers) and
+// has each reader wait a while for another one to arrive
+struct Readers {
+   std::mutex mutex;
+   std::condition_variable cv;
+   int inside = 0;
+   int maxInside = 0;
+   std::chrono::milliseconds patience{300};
+
+   void Read() {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++inside;
+      maxInside = std::max(maxInside, inside);
+      cv.notify_all();
+      cv.wait_for(lock, patience, [&] { return inside >= 2; });
+      --inside;
+   }
+};
+
+class ReadableDevice : public CGenericBase<ReadableDevice> {
+   Readers* readers_;
+   bool concurrentReads_;
+   std::chrono::milliseconds setTime_;
+
+public:
+   ReadableDevice(Readers* readers, bool concurrentReads,
+         std::chrono::milliseconds setTime = std::chrono::milliseconds(0)) :
+      readers_(readers), concurrentReads_(concurrentReads), setTime_(setTime) {}
+
+   int Initialize() override {
+      CreateIntegerProperty("Value", 0, false,
+         new CPropertyAction(this, &ReadableDevice::OnValue));
+      if (concurrentReads_)
+         CreateStringProperty(MM::g_Keyword_ConcurrentReads, "1", true);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "ReadableDevice");
+   }
+
+   int OnValue(MM::PropertyBase*, MM::ActionType eAct) {
+      if (eAct == MM::BeforeGet && readers_)
+         readers_->Read();
+      else if (eAct == MM::AfterSet)
+         std::this_thread::sleep_for(setTime_);
+      return DEVICE_OK;
+   }
+};
+
+// Declares concurrent reads and calls a hook, once, on the first read or set
+// of "Value"
+class HookDevice : public CGenericBase<HookDevice> {
+public:
+   std::function<void()> onRead;
+   std::function<void()> onSet;
+
+   int Initialize() override {
+      CreateIntegerProperty("Value", 0, false,
+         new CPropertyAction(this, &HookDevice::OnValue));
+      CreateStringProperty(MM::g_Keyword_ConcurrentReads, "1", true);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "HookDevice");
+   }
+
+   int OnValue(MM::PropertyBase*, MM::ActionType eAct) {
+      std::function<void()> hook;
+      if (eAct == MM::BeforeGet)
+         hook.swap(onRead);
+      else if (eAct == MM::AfterSet)
+         hook.swap(onSet);
+      if (hook)
+         hook();
+      return DEVICE_OK;
+   }
+};
+
+// Lets a device hook wait until the test has started a competing thread
+struct Rendezvous {
+   std::mutex mutex;
+   std::condition_variable cv;
+   bool hookEntered = false;
+   bool competitorStarted = false;
+
+   void EnterHook() {
+      std::unique_lock<std::mutex> lock(mutex);
+      hookEntered = true;
+      cv.notify_all();
+      cv.wait(lock, [&] { return competitorStarted; });
+      lock.unlock();
+      // Give the competitor time to block
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+   }
+
+   void StartCompetitor(std::thread& t, std::function<void()> f) {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return hookEntered; });
+      t = std::thread(f);
+      competitorStarted = true;
+      cv.notify_all();
+   }
+};
+
+} // namespace
+
+TEST_CASE("Devices declaring concurrent reads are read in parallel",
+   "[DeviceModuleLock]")
+{
+   Readers readers;
+   readers.patience = std::chrono::seconds(10);
+   ReadableDevice a(&readers, true);
+   ReadableDevice b(&readers, true);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.resetDeviceModuleLockStatistics();
+
+   std::thread t([&] { c.getProperty("b", "Value"); });
+   c.getProperty("a", "Value");
+   t.join();
+
+   CHECK(readers.maxInside == 2);
+   CHECK(c.getDeviceModuleLockSharedCount("a") == 2);
+   CHECK(c.getDeviceModuleLockCount("b") == 2);
+}
+
+TEST_CASE("Reads of devices not declaring concurrent reads are serialized",
+   "[DeviceModuleLock]")
+{
+   Readers readers;
+   ReadableDevice a(&readers, false);
+   ReadableDevice b(&readers, true);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.resetDeviceModuleLockStatistics();
+
+   std::thread t([&] { c.getProperty("b", "Value"); });
+   c.getProperty("a", "Value");
+   t.join();
+
+   CHECK(readers.maxInside == 1);
+   CHECK(c.getDeviceModuleLockSharedCount("a") == 1);
+   CHECK(c.getDeviceModuleLockCount("a") == 2);
+}
+
+TEST_CASE("Module lock statistics record contention", "[DeviceModuleLock]")
+{
+   ReadableDevice a(nullptr, false, std::chrono::milliseconds(100));
+   ReadableDevice b(nullptr, false);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.resetDeviceModuleLockStatistics();
+   CHECK(c.getDeviceModuleLockCount("a") == 0);
+   CHECK(c.getDeviceModuleLockHoldTimeMs("a") == 0.0);
+
+   std::thread t([&] { c.setProperty("a", "Value", "1"); });
+   while (c.getDeviceModuleLockCount("a") == 0)
+      std::this_thread::yield();
+   c.getProperty("b", "Value");
+   t.join();
+
+   CHECK(c.getDeviceModuleLockCount("b") == 2);
+   CHECK(c.getDeviceModuleLockContentionCount("b") == 1);
+   CHECK(c.getDeviceModuleLockWaitTimeMs("b") > 0.0);
+   CHECK(c.getDeviceModuleLockMaxWaitTimeMs("b") ==
+      c.getDeviceModuleLockWaitTimeMs("b"));
+   CHECK(c.getDeviceModuleLockMaxHoldTimeMs("b") >= 90.0);
+   CHECK(c.getDeviceModuleLockHoldTimeMs("b") >=
+      c.getDeviceModuleLockMaxHoldTimeMs("b"));
+
+   CHECK(c.getDeviceModuleLockCount("Core") == 0);
+}
+
+TEST_CASE("DeviceModuleLock is recursive and re-entrant across modes",
+   "[DeviceModuleLock]")
+{
+   mm::DeviceModuleLock lock;
+   lock.Lock();
+   lock.Lock();
+   lock.LockShared();
+   lock.UnlockShared();
+   lock.Unlock();
+   lock.Unlock();
+
+   lock.LockShared();
+   lock.LockShared();
+   lock.Lock(); // Sole reader upgrades
+   lock.Unlock();
+   lock.UnlockShared();
+   lock.UnlockShared();
+
+   auto stats = lock.GetStatistics();
+   CHECK(stats.acquisitions == 3);
+   CHECK(stats.sharedAcquisitions == 1);
+   CHECK(stats.contendedAcquisitions == 0);
+
+   lock.ResetStatistics();
+   CHECK(lock.GetStatistics().acquisitions == 0);
+}
+
+TEST_CASE("DeviceModuleLock writer waits for readers and blocks new ones",
+   "[DeviceModuleLock]")
+{
+   mm::DeviceModuleLock lock;
+   std::atomic<int> step{0};
+
+   lock.LockShared();
+   std::thread writer([&] {
+      lock.Lock();
+      step = 2;
+      lock.Unlock();
+   });
+   // Acquisitions are counted once acquired, so just give the writer time
+   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+   std::thread reader([&] {
+      lock.LockShared(); // Must wait for the waiting writer
+      CHECK(step == 2);
+      lock.UnlockShared();
+   });
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   CHECK(step == 0);
+   lock.UnlockShared();
+
+   writer.join();
+   reader.join();
+   CHECK(lock.GetStatistics().contendedAcquisitions == 2);
+}
+
+TEST_CASE("Reader of a device can modify the module while another reader "
+   "waits for the device", "[DeviceModuleLock]")
+{
+   HookDevice x;
+   HookDevice y;
+   MockAdapterWithDevices adapter{{"x", &x}, {"y", &y}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   Rendezvous rendezvous;
+   x.onRead = [&] {
+      rendezvous.EnterHook();
+      c.setProperty("y", "Value", "1"); // Upgrades to exclusive
+   };
+   std::atomic<bool> done{false};
+   std::thread upgrader([&] {
+      c.getProperty("x", "Value");
+      done = true;
+   });
+   std::thread reader;
+   rendezvous.StartCompetitor(reader, [&] { c.getProperty("x", "Value"); });
+
+   for (int i = 0; i < 500 && !done; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   REQUIRE(done); // Otherwise deadlocked
+   upgrader.join();
+   reader.join();
+   CHECK(c.getProperty("y", "Value") == "1");
+}
+
+TEST_CASE("Writer to a module can read a device another reader waits for",
+   "[DeviceModuleLock]")
+{
+   HookDevice x;
+   HookDevice y;
+   MockAdapterWithDevices adapter{{"x", &x}, {"y", &y}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   Rendezvous rendezvous;
+   y.onSet = [&] {
+      rendezvous.EnterHook();
+      c.getProperty("x", "Value");
+   };
+   std::atomic<bool> done{false};
+   std::thread writer([&] {
+      c.setProperty("y", "Value", "1");
+      done = true;
+   });
+   std::thread reader;
+   rendezvous.StartCompetitor(reader, [&] { c.getProperty("x", "Value"); });
+
+   for (int i = 0; i < 500 && !done; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   REQUIRE(done); // Otherwise deadlocked
+   writer.join();
+   reader.join();
+}
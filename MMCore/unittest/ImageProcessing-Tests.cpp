@@ -0,0 +1,250 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "FrameBuffer.h"
+#include "ImageMetadata.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Increments every pixel, taking a while; records how many calls overlap and
+// the order in which frames (by their first pixel) arrive
+class SlowProcessor : public CImageProcessorBase<SlowProcessor> {
+   bool concurrent_;
+   std::atomic<int> active_{0};
+
+public:
+   std::chrono::milliseconds processTime{5};
+   std::atomic<int> calls{0};
+   std::atomic<int> maxActive{0};
+   std::mutex arrivalMutex;
+   std::vector<unsigned char> arrivals;
+
+   explicit SlowProcessor(bool concurrent) : concurrent_(concurrent) {}
+
+   int Initialize() override {
+      if (concurrent_)
+         CreateIntegerProperty(MM::g_Keyword_ConcurrentProcessing, 1, true);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "SlowProcessor");
+   }
+
+   int Process(unsigned char* buffer, unsigned width, unsigned height,
+         unsigned byteDepth) override {
+      {
+         std::lock_guard<std::mutex> lock(arrivalMutex);
+         arrivals.push_back(buffer[0]);
+      }
+      const int active = ++active_;
+      int seen = maxActive;
+      while (active > seen && !maxActive.compare_exchange_weak(seen, active)) {}
+      std::this_thread::sleep_for(processTime);
+      for (unsigned i = 0; i < width * height * byteDepth; ++i)
+         ++buffer[i];
+      ++calls;
+      --active_;
+      return DEVICE_OK;
+   }
+};
+
+class PushCamera : public CCameraBase<PushCamera> {
+public:
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "PushCamera");
+   }
+
+   int SnapImage() override { return DEVICE_ERR; }
+   const unsigned char* GetImageBuffer() override { return nullptr; }
+   long GetImageBufferSize() const override { return 64; }
+   unsigned GetImageWidth() const override { return 8; }
+   unsigned GetImageHeight() const override { return 8; }
+   unsigned GetImageBytesPerPixel() const override { return 1; }
+   unsigned GetBitDepth() const override { return 8; }
+   int GetBinning() const override { return 1; }
+   int SetBinning(int) override { return DEVICE_ERR; }
+   void SetExposure(double) override {}
+   double GetExposure() const override { return 10.0; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) override { return DEVICE_ERR; }
+   int GetROI(unsigned&, unsigned&, unsigned&, unsigned&) override { return DEVICE_ERR; }
+   int ClearROI() override { return DEVICE_ERR; }
+   int IsExposureSequenceable(bool& f) const override { f = false; return DEVICE_OK; }
+   int StartSequenceAcquisition(long, double, bool) override { return DEVICE_OK; }
+   int StartSequenceAcquisition(double) override { return DEVICE_OK; }
+   int StopSequenceAcquisition() override { return DEVICE_OK; }
+   bool IsCapturing() override { return false; }
+
+   int Push(unsigned char value) {
+      std::vector<unsigned char> pixels(64, value);
+      return GetCoreCallback()->InsertImage(this, pixels.data(), 8, 8, 1);
+   }
+   void Finish() { GetCoreCallback()->AcqFinished(this, DEVICE_OK); }
+
+   // Lends the frame to the core, which must release it exactly once
+   int Lend(unsigned char value, const unsigned char* metadata = nullptr,
+         unsigned long metadataLength = 0) {
+      auto* pixels = new std::vector<unsigned char>(64, value);
+      return GetCoreCallback()->InsertBorrowedImage(this, pixels->data(),
+         8, 8, 1, 1, metadata, metadataLength, &Release, pixels);
+   }
+
+private:
+   static void Release(void* context, const unsigned char* buf) {
+      auto* pixels = static_cast<std::vector<unsigned char>*>(context);
+      REQUIRE(buf == pixels->data());
+      delete pixels;
+      ++releasedFrames;
+   }
+
+public:
+   static std::atomic<int> releasedFrames;
+};
+
+std::atomic<int> PushCamera::releasedFrames{0};
+
+void PushFrames(CMMCore& c, PushCamera& cam, int count) {
+   c.initializeCircularBuffer();
+   for (int i = 0; i < count; ++i)
+      REQUIRE(cam.Push(static_cast<unsigned char>(10 * i)) == DEVICE_OK);
+}
+
+void CheckFramesInOrder(CMMCore& c, int count) {
+   REQUIRE(c.getRemainingImageCount() == count);
+   for (int i = 0; i < count; ++i) {
+      mm::ImageHandle image = c.popNextImageHandle();
+      CHECK(image.GetPixels()[0] == 10 * i + 1);
+      CHECK(image.GetMetadata().GetSingleTag(
+         MM::g_Keyword_Metadata_ImageNumber).GetValue() == std::to_string(i));
+   }
+}
+
+} // namespace
+
+TEST_CASE("Image processor runs on the camera thread by default",
+   "[ImageProcessing]")
+{
+   PushCamera cam;
+   SlowProcessor proc(false);
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"proc", &proc}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("proc");
+   CHECK(c.getProperty("Core", MM::g_Keyword_CoreImageProcessingThreads) == "0");
+
+   PushFrames(c, cam, 3);
+   CHECK(proc.calls == 3);
+   CheckFramesInOrder(c, 3);
+}
+
+TEST_CASE("Image processing pipeline processes off the camera thread in order",
+   "[ImageProcessing]")
+{
+   const bool concurrent = GENERATE(false, true);
+   PushCamera cam;
+   SlowProcessor proc(concurrent);
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"proc", &proc}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("proc");
+   c.setProperty("Core", MM::g_Keyword_CoreImageProcessingThreads, "4");
+
+   proc.processTime = std::chrono::milliseconds(20);
+   c.initializeCircularBuffer();
+   const auto start = std::chrono::steady_clock::now();
+   REQUIRE(cam.Push(0) == DEVICE_OK);
+   // Returns before the frame has been processed
+   CHECK(std::chrono::steady_clock::now() - start <
+      std::chrono::milliseconds(20));
+   cam.Finish(); // Waits for processing
+   CHECK(proc.calls == 1);
+   c.clearCircularBuffer();
+
+   proc.processTime = std::chrono::milliseconds(5);
+   proc.arrivals.clear();
+   PushFrames(c, cam, 12);
+   cam.Finish();
+   CHECK(proc.calls == 13);
+   CheckFramesInOrder(c, 12);
+   if (concurrent)
+      CHECK(proc.maxActive > 1);
+   else {
+      CHECK(proc.maxActive == 1);
+      // A processor that is not concurrent sees frames in order
+      REQUIRE(proc.arrivals.size() == 12);
+      for (int i = 0; i < 12; ++i)
+         CHECK(proc.arrivals[i] == 10 * i);
+   }
+}
+
+TEST_CASE("Changing image processor waits for frames in flight",
+   "[ImageProcessing]")
+{
+   PushCamera cam;
+   SlowProcessor proc(true);
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"proc", &proc}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("proc");
+   c.setProperty("Core", MM::g_Keyword_CoreImageProcessingThreads, "2");
+
+   PushFrames(c, cam, 4);
+   c.setImageProcessorDevice("");
+   CHECK(proc.calls == 4);
+   CHECK(c.getRemainingImageCount() == 4);
+
+   // Turning the pipeline off finishes its frames too
+   c.setImageProcessorDevice("proc");
+   PushFrames(c, cam, 3);
+   c.setProperty("Core", MM::g_Keyword_CoreImageProcessingThreads, "0");
+   CHECK(c.getRemainingImageCount() == 3);
+}
+
+TEST_CASE("Borrowed images are inserted and released once",
+   "[ImageProcessing]")
+{
+   const std::string threads = GENERATE("0", "3");
+   PushCamera cam;
+   SlowProcessor proc(true);
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"proc", &proc}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("proc");
+   c.setProperty("Core", MM::g_Keyword_CoreImageProcessingThreads, threads.c_str());
+   c.initializeCircularBuffer();
+   PushCamera::releasedFrames = 0;
+
+   for (int i = 0; i < 6; ++i)
+      REQUIRE(cam.Lend(static_cast<unsigned char>(10 * i)) == DEVICE_OK);
+   cam.Finish(); // All released by now
+   CHECK(PushCamera::releasedFrames == 6);
+   CHECK(proc.calls == 6);
+   CheckFramesInOrder(c, 6);
+
+   // Released without processing, and on error
+   c.setImageProcessorDevice("");
+   REQUIRE(cam.Lend(0) == DEVICE_OK);
+   const unsigned char garbage[] = { 'x', 'y', 'z', 'w', 0 };
+   CHECK(cam.Lend(0, garbage, sizeof(garbage)) == DEVICE_INVALID_INPUT_PARAM);
+   cam.Finish();
+   CHECK(PushCamera::releasedFrames == 8);
+   CHECK(c.getRemainingImageCount() == 1);
+}
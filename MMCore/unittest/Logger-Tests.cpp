@@ -2,7 +2,9 @@
 
 #include "Logging/Logging.h"
 
+#include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <thread>
@@ -119,5 +121,142 @@ TEST_CASE("async logger on thread", "[Logger]")
       threads[i]->join();
 }
 
+
+namespace {
+
+struct CapturedPacket
+{
+   std::string label;
+   internal::PacketState state;
+   std::string text;
+};
+
+class CapturingSink : public LogSink
+{
+public:
+   std::vector<CapturedPacket> packets;
+
+   virtual void Consume(const PacketArrayType& packetArray)
+   {
+      for (auto it = packetArray.Begin(); it != packetArray.End(); ++it)
+      {
+         packets.push_back({
+               it->GetMetadataConstRef().GetLoggerData().GetComponentLabel(),
+               it->GetPacketState(), it->GetText() });
+      }
+   }
+};
+
+} // anonymous namespace
+
+
+TEST_CASE("async queue keeps entries whole and in order", "[Logger]")
+{
+   std::shared_ptr<LoggingCore> c =
+      std::make_shared<LoggingCore>();
+   // Small batches, so that the receive loop splits the stream often
+   c->SetAsyncBatchSize(7);
+   c->SetAsyncFlushInterval(std::chrono::milliseconds(1));
+
+   auto sink = std::make_shared<CapturingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   const unsigned nThreads = 8;
+   const unsigned nEntries = 500;
+   const std::string longLine(300, 'x');
+   std::vector<std::thread> threads;
+   for (unsigned i = 0; i < nThreads; ++i)
+   {
+      threads.emplace_back([&, i] {
+         Logger lgr = c->NewLogger("thread" + std::to_string(i));
+         for (unsigned j = 0; j < nEntries; ++j)
+            lgr(LogLevelDebug, (std::to_string(j) + ' ' + longLine +
+                     "\nsecond").c_str());
+      });
+   }
+   for (auto& t : threads)
+      t.join();
+   c->RemoveSink(sink, SinkModeAsynchronous); // Drains the queue
+
+   // Reassemble the entries of each thread
+   std::map<std::string, std::vector<std::string>> entries;
+   std::string* current = nullptr;
+   for (const auto& packet : sink->packets)
+   {
+      if (packet.state == internal::PacketStateEntryFirstLine)
+      {
+         entries[packet.label].push_back(packet.text);
+         current = &entries[packet.label].back();
+      }
+      else
+      {
+         REQUIRE(current != nullptr);
+         if (packet.state == internal::PacketStateNewLine)
+            *current += '\n';
+         *current += packet.text;
+      }
+   }
+
+   CHECK(entries.size() == nThreads);
+   for (const auto& threadEntries : entries)
+   {
+      REQUIRE(threadEntries.second.size() == nEntries);
+      for (unsigned j = 0; j < nEntries; ++j)
+      {
+         CHECK(threadEntries.second[j] ==
+               std::to_string(j) + ' ' + longLine + "\nsecond");
+      }
+   }
+   CHECK(c->GetAsyncQueueStatistics().droppedEntries == 0);
+}
+
+
+TEST_CASE("packet queue overflows and then drops entries", "[Logger]")
+{
+   internal::GenericPacketQueue<Metadata> q(4);
+   REQUIRE(q.GetCapacity() == 4);
+   const std::size_t overflowCapacity =
+      internal::GenericPacketQueue<Metadata>::OverflowCapacityFactor * 4;
+
+   StampData stamp;
+   stamp.Stamp();
+   auto send = [&](unsigned n) {
+      internal::GenericPacketArray<Metadata> packets;
+      packets.AppendEntry("queue", LogLevelInfo, stamp,
+            std::to_string(n).c_str());
+      q.SendPackets(packets.Begin(), packets.End());
+   };
+
+   // Nothing is received until the loop runs
+   unsigned n = 0;
+   for (; n < 4; ++n)
+      send(n);
+   CHECK(q.GetStatistics().overflowedEntries == 0);
+
+   for (; n < 4 + overflowCapacity; ++n)
+      send(n);
+   CHECK(q.GetStatistics().overflowedEntries == overflowCapacity);
+   CHECK(q.GetStatistics().droppedEntries == 0);
+
+   send(n);
+   CHECK(q.GetStatistics().droppedEntries == 1);
+
+   std::vector<std::string> received;
+   q.RunReceiveLoop([&](internal::GenericPacketArray<Metadata>& packets) {
+      for (auto it = packets.Begin(); it != packets.End(); ++it)
+         received.push_back(it->GetText());
+   });
+   q.ShutdownReceiveLoop();
+
+   REQUIRE(received.size() == n);
+   for (unsigned i = 0; i < n; ++i)
+      CHECK(received[i] == std::to_string(i));
+
+   // Back to the ring once the overflow has been drained
+   q.ResetStatistics();
+   send(0);
+   CHECK(q.GetStatistics().overflowedEntries == 0);
+}
+
 } // namespace logging
 } // namespace mm
\ No newline at end of file
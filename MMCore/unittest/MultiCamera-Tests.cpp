@@ -0,0 +1,194 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "FrameBuffer.h"
+#include "ImageMetadata.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Shared record of camera starts and stops, in order
+std::string g_events;
+
+// A camera of fixed geometry that inserts frames when told to
+class PushCamera : public CCameraBase<PushCamera> {
+   std::string name_;
+   unsigned width_;
+   unsigned height_;
+   unsigned bytesPerPixel_;
+   bool capturing_ = false;
+
+public:
+   bool failStart = false;
+
+   PushCamera(const std::string& name, unsigned width, unsigned height,
+         unsigned bytesPerPixel) :
+      name_(name), width_(width), height_(height),
+      bytesPerPixel_(bytesPerPixel) {}
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "PushCamera");
+   }
+
+   int SnapImage() override { return DEVICE_ERR; }
+   const unsigned char* GetImageBuffer() override { return nullptr; }
+   long GetImageBufferSize() const override {
+      return width_ * height_ * bytesPerPixel_;
+   }
+   unsigned GetImageWidth() const override { return width_; }
+   unsigned GetImageHeight() const override { return height_; }
+   unsigned GetImageBytesPerPixel() const override { return bytesPerPixel_; }
+   unsigned GetBitDepth() const override { return 8 * bytesPerPixel_; }
+   int GetBinning() const override { return 1; }
+   int SetBinning(int) override { return DEVICE_ERR; }
+   void SetExposure(double) override {}
+   double GetExposure() const override { return 10.0; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) override { return DEVICE_ERR; }
+   int GetROI(unsigned&, unsigned&, unsigned&, unsigned&) override { return DEVICE_ERR; }
+   int ClearROI() override { return DEVICE_ERR; }
+   int IsExposureSequenceable(bool& f) const override { f = false; return DEVICE_OK; }
+   int StartSequenceAcquisition(long, double, bool) override {
+      if (failStart)
+         return DEVICE_ERR;
+      capturing_ = true;
+      g_events += name_ + "+";
+      return DEVICE_OK;
+   }
+   int StartSequenceAcquisition(double) override {
+      return StartSequenceAcquisition(LONG_MAX, 0.0, false);
+   }
+   int StopSequenceAcquisition() override {
+      capturing_ = false;
+      g_events += name_ + "-";
+      return DEVICE_OK;
+   }
+   bool IsCapturing() override { return capturing_; }
+
+   // Inserts a frame filled with value, stamped with the given time
+   int Push(unsigned char value, double elapsedMs) {
+      std::vector<unsigned char> pixels(GetImageBufferSize(), value);
+      Metadata md;
+      md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms, elapsedMs);
+      return GetCoreCallback()->InsertImage(this, pixels.data(), width_,
+         height_, bytesPerPixel_, md.Serialize().c_str());
+   }
+};
+
+} // namespace
+
+TEST_CASE("Multi-camera acquisition keeps per-camera geometry",
+   "[MultiCamera]")
+{
+   PushCamera a("a", 16, 8, 2);
+   PushCamera b("b", 4, 4, 1);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCircularBufferMemoryFootprint(1);
+   g_events.clear();
+
+   c.startMultiCameraSequenceAcquisition({"a", "b"}, 10, 0.0, true);
+   CHECK(g_events == "b+a+"); // First camera starts last
+   CHECK(c.isSequenceRunning("a"));
+   CHECK_THROWS(c.startMultiCameraSequenceAcquisition({"b"}, 10, 0.0, true));
+
+   for (unsigned char i = 0; i < 3; ++i) {
+      REQUIRE(a.Push(i, 10.0 * i) == DEVICE_OK);
+      REQUIRE(b.Push(100 + i, 10.0 * i + 1.0) == DEVICE_OK);
+   }
+   CHECK(c.getRemainingImageCount() == 0); // Not in the regular buffer
+   CHECK(c.getRemainingFrameSetCount() == 3);
+
+   for (unsigned char i = 0; i < 3; ++i) {
+      std::vector<mm::ImageHandle> frames = c.popNextFrameSetByImageNumber();
+      REQUIRE(frames.size() == 2);
+      CHECK(frames[0].Width() == 16);
+      CHECK(frames[0].Height() == 8);
+      CHECK(frames[0].Depth() == 2);
+      CHECK(frames[0].GetPixels()[0] == i);
+      CHECK(frames[1].Width() == 4);
+      CHECK(frames[1].Depth() == 1);
+      CHECK(frames[1].GetPixels()[0] == 100 + i);
+   }
+   CHECK_THROWS(c.popNextFrameSetByImageNumber());
+   CHECK(c.getUnmatchedFrameCount() == 0);
+
+   g_events.clear();
+   c.stopMultiCameraSequenceAcquisition();
+   CHECK(g_events == "a-b-");
+
+   // Images go to the regular buffer again
+   c.setCameraDevice("b");
+   c.initializeCircularBuffer();
+   REQUIRE(b.Push(7, 0.0) == DEVICE_OK);
+   CHECK(c.getRemainingImageCount() == 1);
+}
+
+TEST_CASE("Frame sets matched by timestamp skip unmatched frames",
+   "[MultiCamera]")
+{
+   PushCamera a("a", 4, 4, 1);
+   PushCamera b("b", 4, 4, 1);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCircularBufferMemoryFootprint(1);
+
+   c.startMultiCameraSequenceAcquisition({"a", "b"}, 10, 0.0, true);
+   // Camera b misses the frame at 10 ms
+   a.Push(0, 0.0);
+   a.Push(1, 10.0);
+   a.Push(2, 20.0);
+   b.Push(100, 0.4);
+   b.Push(102, 20.3);
+
+   std::vector<mm::ImageHandle> frames = c.popNextFrameSetByTimestamp(1.0);
+   CHECK(frames[0].GetPixels()[0] == 0);
+   CHECK(frames[1].GetPixels()[0] == 100);
+   frames = c.popNextFrameSetByTimestamp(1.0);
+   CHECK(frames[0].GetPixels()[0] == 2);
+   CHECK(frames[1].GetPixels()[0] == 102);
+   CHECK(c.getUnmatchedFrameCount() == 1);
+
+   // An incomplete set stays pending until the other camera catches up
+   a.Push(3, 30.0);
+   CHECK_THROWS(c.popNextFrameSetByTimestamp(1.0));
+   b.Push(103, 30.2);
+   frames = c.popNextFrameSetByTimestamp(1.0);
+   CHECK(frames[0].GetPixels()[0] == 3);
+   CHECK(frames[1].GetPixels()[0] == 103);
+   c.stopMultiCameraSequenceAcquisition();
+}
+
+TEST_CASE("Multi-camera start failure stops cameras already started",
+   "[MultiCamera]")
+{
+   PushCamera a("a", 4, 4, 1);
+   PushCamera b("b", 4, 4, 1);
+   PushCamera d("d", 4, 4, 1);
+   MockAdapterWithDevices adapter{{"a", &a}, {"b", &b}, {"d", &d}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCircularBufferMemoryFootprint(1);
+   g_events.clear();
+
+   b.failStart = true;
+   CHECK_THROWS(c.startMultiCameraSequenceAcquisition({"a", "b", "d"}, 10,
+      0.0, true));
+   CHECK(g_events == "d+d-");
+   CHECK_FALSE(d.IsCapturing());
+   CHECK_THROWS(c.startMultiCameraSequenceAcquisition({"a", "a"}, 10, 0.0,
+      true));
+
+   c.setCameraDevice("a");
+   c.initializeCircularBuffer();
+   REQUIRE(a.Push(1, 0.0) == DEVICE_OK);
+   CHECK(c.getRemainingImageCount() == 1);
+}
@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Answers each command with "ack <command>", queued until read; records the
+// order of writes and reads
+class EchoPort : public CSerialBase<EchoPort> {
+   std::deque<std::string> pending_;
+
+public:
+   std::string log; // 'W' per command written, 'R' per answer read
+   std::string failOn; // Command for which no answer arrives
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "EchoPort");
+   }
+
+   MM::PortType GetPortType() const override { return MM::SerialPort; }
+   int SetCommand(const char* command, const char*) override {
+      log += 'W';
+      if (command != failOn)
+         pending_.push_back(std::string("ack ") + command);
+      return DEVICE_OK;
+   }
+   int GetAnswer(char* txt, unsigned maxChars, const char*) override {
+      log += 'R';
+      if (pending_.empty())
+         return DEVICE_SERIAL_TIMEOUT;
+      const std::string answer = pending_.front();
+      pending_.pop_front();
+      if (answer.size() >= maxChars)
+         return DEVICE_SERIAL_BUFFER_OVERRUN;
+      snprintf(txt, maxChars, "%s", answer.c_str());
+      return DEVICE_OK;
+   }
+   int Write(const unsigned char*, unsigned long) override { return DEVICE_OK; }
+   int Read(unsigned char*, unsigned long, unsigned long& read) override {
+      read = 0;
+      return DEVICE_OK;
+   }
+   int Purge() override { pending_.clear(); return DEVICE_OK; }
+};
+
+class BatchingDevice : public CGenericBase<BatchingDevice> {
+public:
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "BatchingDevice");
+   }
+
+   int Batch(const std::vector<std::string>& commands,
+         std::vector<std::string>& answers) {
+      return SendSerialCommandBatch("port", commands, "\r", "\r\n", answers);
+   }
+
+   int RawBatch(const char* const* commands, unsigned long n, char* answers,
+         unsigned long stride, unsigned long& numAnswered) {
+      return GetCoreCallback()->SendSerialCommandBatch(this, "port", commands,
+            n, "\r", answers, stride, "\r\n", numAnswered);
+   }
+};
+
+} // namespace
+
+TEST_CASE("Serial command batch writes all commands before reading",
+   "[SerialBatch]")
+{
+   EchoPort port;
+   BatchingDevice dev;
+   MockAdapterWithDevices adapter{{"port", &port}, {"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   std::vector<std::string> answers;
+   REQUIRE(dev.Batch({"M X=1", "M Y=2", "LED X=50"}, answers) == DEVICE_OK);
+   REQUIRE(answers.size() == 3);
+   CHECK(answers[0] == "ack M X=1");
+   CHECK(answers[1] == "ack M Y=2");
+   CHECK(answers[2] == "ack LED X=50");
+   CHECK(port.log == "WWWRRR");
+
+   port.log.clear();
+   CHECK(dev.Batch({}, answers) == DEVICE_OK);
+   CHECK(answers.empty());
+   CHECK(port.log.empty());
+}
+
+TEST_CASE("Serial command batch reports answers received before an error",
+   "[SerialBatch]")
+{
+   EchoPort port;
+   BatchingDevice dev;
+   MockAdapterWithDevices adapter{{"port", &port}, {"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   port.failOn = "B";
+   std::vector<std::string> answers;
+   CHECK(dev.Batch({"A", "B", "C"}, answers) == DEVICE_SERIAL_COMMAND_FAILED);
+   // The answer to "C" is taken as the answer to "B"; the missing answer is
+   // only noticed at the end
+   REQUIRE(answers.size() == 2);
+   CHECK(answers[0] == "ack A");
+   CHECK(answers[1] == "ack C");
+}
+
+TEST_CASE("Serial command batch checks answer slot size", "[SerialBatch]")
+{
+   EchoPort port;
+   BatchingDevice dev;
+   MockAdapterWithDevices adapter{{"port", &port}, {"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   const char* commands[] = {"X", "LONG COMMAND"};
+   char answers[2][8];
+   unsigned long numAnswered = 99;
+   CHECK(dev.RawBatch(commands, 2, &answers[0][0], 8, numAnswered) ==
+      DEVICE_SERIAL_COMMAND_FAILED);
+   CHECK(numAnswered == 1);
+   CHECK(std::string(answers[0]) == "ack X");
+   CHECK(std::string(answers[1]).empty());
+
+   CHECK(dev.RawBatch(commands, 2, &answers[0][0], 0, numAnswered) ==
+      DEVICE_INVALID_INPUT_PARAM);
+   CHECK(numAnswered == 0);
+}
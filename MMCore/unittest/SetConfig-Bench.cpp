@@ -0,0 +1,67 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <string>
+
+namespace {
+
+// A device with a few properties that have allowed values and limits, like
+// filter wheels, shutters, and light sources in a channel preset
+class PresetDevice : public CGenericBase<PresetDevice> {
+public:
+   int Initialize() override {
+      CreateStringProperty("Label", "Pos-0", false);
+      for (int i = 0; i < 6; ++i)
+         AddAllowedValue("Label", ("Pos-" + std::to_string(i)).c_str());
+      CreateIntegerProperty("State", 0, false);
+      SetPropertyLimits("State", 0, 5);
+      CreateFloatProperty("Intensity", 0.0, false);
+      SetPropertyLimits("Intensity", 0.0, 100.0);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "PresetDevice");
+   }
+};
+
+} // namespace
+
+TEST_CASE("Compiled and interpreted preset application",
+   "[ApplyConfiguration][benchmark]")
+{
+   const int nDevices = 8;
+   PresetDevice d[nDevices];
+   MockAdapterWithDevices adapter{{"dev0", &d[0]}, {"dev1", &d[1]},
+      {"dev2", &d[2]}, {"dev3", &d[3]}, {"dev4", &d[4]}, {"dev5", &d[5]},
+      {"dev6", &d[6]}, {"dev7", &d[7]}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   // Two channel presets setting three properties on each device
+   for (int i = 0; i < nDevices; ++i) {
+      const std::string label = "dev" + std::to_string(i);
+      c.defineConfig("Channel", "DAPI", label.c_str(), "Label", "Pos-1");
+      c.defineConfig("Channel", "DAPI", label.c_str(), "State", "1");
+      c.defineConfig("Channel", "DAPI", label.c_str(), "Intensity", "20");
+      c.defineConfig("Channel", "FITC", label.c_str(), "Label", "Pos-2");
+      c.defineConfig("Channel", "FITC", label.c_str(), "State", "2");
+      c.defineConfig("Channel", "FITC", label.c_str(), "Intensity", "40");
+   }
+
+   BENCHMARK("interpreted, 8 devices x 3 properties") {
+      c.setConfig("Channel", "DAPI");
+      c.setConfig("Channel", "FITC");
+   };
+
+   c.compileConfig("Channel", "DAPI");
+   c.compileConfig("Channel", "FITC");
+   BENCHMARK("compiled, 8 devices x 3 properties") {
+      c.setConfig("Channel", "DAPI");
+      c.setConfig("Channel", "FITC");
+   };
+}
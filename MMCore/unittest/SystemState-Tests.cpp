@@ -0,0 +1,142 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+// A device whose "Position" property takes a while to read, counting reads
+class SlowDevice : public CGenericBase<SlowDevice> {
+   std::chrono::milliseconds readTime_;
+
+public:
+   std::atomic<int> reads{0};
+   long position = 0;
+
+   explicit SlowDevice(std::chrono::milliseconds readTime) :
+      readTime_(readTime) {}
+
+   int Initialize() override {
+      CreateIntegerProperty("Position", 0, false,
+         new CPropertyAction(this, &SlowDevice::OnPosition));
+      CreateStringProperty("Model", "Slow", true);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "SlowDevice");
+   }
+
+   int OnPosition(MM::PropertyBase* pProp, MM::ActionType eAct) {
+      if (eAct == MM::BeforeGet) {
+         ++reads;
+         std::this_thread::sleep_for(readTime_);
+         pProp->Set(position);
+      } else if (eAct == MM::AfterSet) {
+         pProp->Get(position);
+      }
+      return DEVICE_OK;
+   }
+};
+
+class FeatureGuard {
+   std::string name_;
+   bool saved_;
+
+public:
+   FeatureGuard(const char* name, bool enable) :
+      name_(name), saved_(CMMCore::isFeatureEnabled(name)) {
+      CMMCore::enableFeature(name, enable);
+   }
+   ~FeatureGuard() { CMMCore::enableFeature(name_.c_str(), saved_); }
+};
+
+} // namespace
+
+TEST_CASE("Parallel system state matches serial system state",
+   "[SystemState]")
+{
+   SlowDevice a1(std::chrono::milliseconds(0));
+   SlowDevice a2(std::chrono::milliseconds(0));
+   SlowDevice b1(std::chrono::milliseconds(0));
+   MockAdapterWithDevices adapterA("adapter_a", {{"a1", &a1}, {"a2", &a2}});
+   MockAdapterWithDevices adapterB("adapter_b", {{"b1", &b1}});
+   CMMCore c;
+   adapterA.LoadIntoCore(c);
+   adapterB.LoadIntoCore(c);
+   a2.position = 2;
+   b1.position = 3;
+
+   Configuration serial;
+   {
+      FeatureGuard f("ParallelSystemState", false);
+      serial = c.getSystemState();
+   }
+   Configuration parallel;
+   {
+      FeatureGuard f("ParallelSystemState", true);
+      parallel = c.getSystemState();
+   }
+
+   REQUIRE(parallel.size() == serial.size());
+   for (size_t i = 0; i < serial.size(); ++i) {
+      CHECK(parallel.getSetting(i).getKey() == serial.getSetting(i).getKey());
+      CHECK(parallel.getSetting(i).getPropertyValue() ==
+         serial.getSetting(i).getPropertyValue());
+      CHECK(parallel.getSetting(i).getReadOnly() ==
+         serial.getSetting(i).getReadOnly());
+   }
+   CHECK(parallel.getSetting("b1", "Position").getPropertyValue() == "3");
+   CHECK(parallel.getSetting("a1", "Model").getReadOnly());
+}
+
+TEST_CASE("Parallel system state queries modules concurrently",
+   "[SystemState]")
+{
+   SlowDevice a(std::chrono::milliseconds(100));
+   SlowDevice b(std::chrono::milliseconds(100));
+   MockAdapterWithDevices adapterA("adapter_a", {{"a", &a}});
+   MockAdapterWithDevices adapterB("adapter_b", {{"b", &b}});
+   CMMCore c;
+   adapterA.LoadIntoCore(c);
+   adapterB.LoadIntoCore(c);
+
+   FeatureGuard f("ParallelSystemState", true);
+   const auto start = std::chrono::steady_clock::now();
+   c.getSystemState();
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   CHECK(a.reads == 1);
+   CHECK(b.reads == 1);
+   CHECK(elapsed < std::chrono::milliseconds(190));
+}
+
+TEST_CASE("System state uses recent cached values", "[SystemState]")
+{
+   SlowDevice dev(std::chrono::milliseconds(0));
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.setProperty("dev", "Position", "5");
+   dev.position = 6; // Changed behind the Core's back
+   dev.reads = 0;
+
+   Configuration state = c.getSystemState(60000.0);
+   CHECK(dev.reads == 0);
+   CHECK(state.getSetting("dev", "Position").getPropertyValue() == "5");
+
+   state = c.getSystemState();
+   CHECK(dev.reads == 1);
+   CHECK(state.getSetting("dev", "Position").getPropertyValue() == "6");
+
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   state = c.getSystemState(10.0);
+   CHECK(dev.reads == 2);
+}
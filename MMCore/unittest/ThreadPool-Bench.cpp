@@ -0,0 +1,156 @@
+#include <catch2/catch_all.hpp>
+
+#include "Semaphore.h"
+#include "Task.h"
+#include "TaskSet.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Per-frame statistics (sum and histogram of 16-bit pixels) split into one
+// band of rows per task, standing in for processing, binning, and
+// statistics stages
+class HistogramTask : public Task {
+public:
+   const std::uint16_t* pixels = nullptr;
+   std::size_t count = 0;
+   std::uint64_t sum = 0;
+   std::vector<std::uint32_t> histogram = std::vector<std::uint32_t>(256);
+
+   using Task::Task;
+
+   void Execute() override {
+      const std::size_t begin = count * taskIndex_ / totalTaskCount_;
+      const std::size_t end = count * (taskIndex_ + 1) / totalTaskCount_;
+      std::fill(histogram.begin(), histogram.end(), 0);
+      std::uint64_t s = 0;
+      for (std::size_t i = begin; i < end; ++i) {
+         s += pixels[i];
+         ++histogram[pixels[i] >> 8];
+      }
+      sum = s;
+   }
+};
+
+class HistogramTaskSet : public TaskSet {
+public:
+   explicit HistogramTaskSet(std::shared_ptr<ThreadPool> pool) :
+      TaskSet(pool) {
+      CreateTasks<HistogramTask>();
+   }
+
+   std::uint64_t Run(const std::uint16_t* pixels, std::size_t count) {
+      for (Task* task : tasks_) {
+         static_cast<HistogramTask*>(task)->pixels = pixels;
+         static_cast<HistogramTask*>(task)->count = count;
+      }
+      Execute();
+      Wait();
+      std::uint64_t sum = 0;
+      for (Task* task : tasks_)
+         sum += static_cast<HistogramTask*>(task)->sum;
+      return sum;
+   }
+};
+
+// Almost no work per task: measures submit, wakeup, and join overhead
+class EmptyTask : public Task {
+public:
+   using Task::Task;
+   void Execute() override {}
+};
+
+class EmptyTaskSet : public TaskSet {
+public:
+   explicit EmptyTaskSet(std::shared_ptr<ThreadPool> pool) : TaskSet(pool) {
+      CreateTasks<EmptyTask>();
+   }
+};
+
+std::vector<std::size_t> ThreadCounts() {
+   const std::size_t hw =
+      std::max<std::size_t>(1, std::thread::hardware_concurrency());
+   std::vector<std::size_t> counts;
+   for (std::size_t n = 1; n < hw; n *= 2)
+      counts.push_back(n);
+   counts.push_back(hw);
+   return counts;
+}
+
+template <typename F>
+void ReportLatency(const char* name, std::size_t threads, int iterations,
+   double baselineUs, F&& run, double* p50Out = nullptr)
+{
+   std::vector<double> latencies;
+   latencies.reserve(iterations);
+   for (int i = 0; i < iterations; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      run();
+      const auto end = std::chrono::steady_clock::now();
+      latencies.push_back(
+         std::chrono::duration<double, std::micro>(end - start).count());
+   }
+   std::sort(latencies.begin(), latencies.end());
+   const double p50 = latencies[latencies.size() / 2];
+   std::printf("%-20s %3zu threads: p50 %9.1f us, p99 %9.1f us",
+      name, threads, p50, latencies[latencies.size() * 99 / 100]);
+   if (baselineUs > 0.0)
+      std::printf(", speedup %5.2fx", baselineUs / p50);
+   std::printf("\n");
+   if (p50Out)
+      *p50Out = p50;
+}
+
+} // namespace
+
+TEST_CASE("Thread pool scaling", "[ThreadPool][benchmark]")
+{
+   const std::size_t count = 4096 * 4096; // One 16-bit 4096x4096 frame
+   std::vector<std::uint16_t> pixels(count);
+   for (std::size_t i = 0; i < count; ++i)
+      pixels[i] = static_cast<std::uint16_t>(i * 2654435761u >> 16);
+
+   double baselineUs = 0.0;
+   for (std::size_t threads : ThreadCounts()) {
+      auto pool = std::make_shared<ThreadPool>(threads);
+      HistogramTaskSet stats(pool);
+      stats.Run(pixels.data(), count); // Warm up
+      ReportLatency("histogram 4096^2", threads, 50, baselineUs,
+         [&] { stats.Run(pixels.data(), count); },
+         threads == 1 ? &baselineUs : nullptr);
+   }
+
+   for (std::size_t threads : ThreadCounts()) {
+      auto pool = std::make_shared<ThreadPool>(threads);
+      EmptyTaskSet empty(pool);
+      ReportLatency("empty fork/join", threads, 2000, 0.0,
+         [&] { empty.Execute(); empty.Wait(); });
+   }
+}
+
+TEST_CASE("Thread pool fork/join overhead", "[ThreadPool][benchmark]")
+{
+   auto pool = std::make_shared<ThreadPool>();
+   EmptyTaskSet empty(pool);
+
+   BENCHMARK("empty fork/join, all hardware threads") {
+      empty.Execute();
+      empty.Wait();
+   };
+
+   auto sem = std::make_shared<Semaphore>();
+   EmptyTask task(sem, 0, 1);
+   BENCHMARK("single task submit and wait") {
+      pool->Execute(&task);
+      sem->Wait();
+   };
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+
+#include "Semaphore.h"
+#include "Task.h"
+#include "TaskSet.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace {
+
+class CountingTask : public Task {
+public:
+   std::atomic<int>* counter = nullptr;
+
+   using Task::Task;
+   void Execute() override { ++*counter; }
+};
+
+class CountingTaskSet : public TaskSet {
+public:
+   explicit CountingTaskSet(std::shared_ptr<ThreadPool> pool,
+         std::atomic<int>& counter) : TaskSet(pool) {
+      CreateTasks<CountingTask>();
+      for (Task* task : tasks_)
+         static_cast<CountingTask*>(task)->counter = &counter;
+   }
+};
+
+// Each task runs a nested CountingTaskSet on the same pool and waits for it
+class ForkingTask : public Task {
+public:
+   std::shared_ptr<ThreadPool> pool;
+   std::atomic<int>* counter = nullptr;
+
+   using Task::Task;
+   void Execute() override {
+      CountingTaskSet inner(pool, *counter);
+      inner.Execute();
+      inner.Wait();
+   }
+};
+
+class ForkingTaskSet : public TaskSet {
+public:
+   ForkingTaskSet(std::shared_ptr<ThreadPool> pool, std::atomic<int>& counter)
+      : TaskSet(pool) {
+      CreateTasks<ForkingTask>();
+      for (Task* task : tasks_) {
+         static_cast<ForkingTask*>(task)->pool = pool;
+         static_cast<ForkingTask*>(task)->counter = &counter;
+      }
+   }
+};
+
+} // namespace
+
+TEST_CASE("Thread pool runs every task exactly once", "[ThreadPool]")
+{
+   const std::size_t threads = GENERATE(1, 2, 7);
+   auto pool = std::make_shared<ThreadPool>(threads);
+   REQUIRE(pool->GetSize() == threads);
+
+   std::atomic<int> counter{0};
+   CountingTaskSet tasks(pool, counter);
+   for (int i = 0; i < 200; ++i) {
+      tasks.Execute();
+      tasks.Wait();
+   }
+   CHECK(counter == 200 * static_cast<int>(threads));
+}
+
+TEST_CASE("Thread pool runs single submitted tasks", "[ThreadPool]")
+{
+   auto pool = std::make_shared<ThreadPool>(3);
+   auto sem = std::make_shared<Semaphore>();
+   std::atomic<int> counter{0};
+   std::vector<std::unique_ptr<CountingTask>> tasks;
+   for (int i = 0; i < 50; ++i) {
+      tasks.push_back(std::make_unique<CountingTask>(sem, 0, 1));
+      tasks.back()->counter = &counter;
+      pool->Execute(tasks.back().get());
+   }
+   sem->Wait(50);
+   CHECK(counter == 50);
+   CHECK_FALSE(sem->TryWait());
+}
+
+TEST_CASE("Nested task sets on the same pool do not deadlock",
+   "[ThreadPool]")
+{
+   // With one thread, the only worker waits inside the outer task for the
+   // inner tasks, so it has to run them itself
+   const std::size_t threads = GENERATE(1, 4);
+   auto pool = std::make_shared<ThreadPool>(threads);
+   std::atomic<int> counter{0};
+   ForkingTaskSet outer(pool, counter);
+   outer.Execute();
+   outer.Wait();
+   CHECK(counter == static_cast<int>(threads * threads));
+}
+
+TEST_CASE("Waiting thread helps run queued tasks", "[ThreadPool]")
+{
+   auto pool = std::make_shared<ThreadPool>(2);
+   auto sem = std::make_shared<Semaphore>();
+   std::atomic<int> counter{0};
+   CountingTask task(sem, 0, 1);
+   task.counter = &counter;
+
+   // Whether a worker or this thread runs it, the task runs once
+   pool->Execute(&task);
+   while (!sem->TryWait())
+      pool->RunPendingTask();
+   CHECK(counter == 1);
+   CHECK_FALSE(pool->RunPendingTask());
+}
@@ -0,0 +1,49 @@
+#include <catch2/catch_all.hpp>
+
+#include "MMCore.h"
+#include "Tracing.h"
+
+#include <chrono>
+#include <cstdio>
+
+#ifndef MMCORE_DISABLE_TRACING
+
+namespace {
+
+// Nanoseconds per empty span, amortized over many spans
+double NsPerSpan(long spans) {
+   const auto start = std::chrono::steady_clock::now();
+   for (long i = 0; i < spans; ++i) {
+      MMCORE_TRACE_SPAN("Bench", "EmptySpan");
+   }
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   return std::chrono::duration<double, std::nano>(elapsed).count() / spans;
+}
+
+} // namespace
+
+TEST_CASE("Tracing span overhead", "[Tracing][benchmark]")
+{
+   CMMCore c;
+   const long spans = 1000000;
+
+   c.enableTracing(false);
+   NsPerSpan(spans / 10); // Warm up
+   const double disabled = NsPerSpan(spans);
+
+   c.clearTrace();
+   c.enableTracing(true);
+   NsPerSpan(spans / 10);
+   const double enabled = NsPerSpan(spans);
+   c.enableTracing(false);
+   c.clearTrace();
+
+   std::printf("Span cost: %.1f ns disabled, %.1f ns enabled\n",
+      disabled, enabled);
+
+   BENCHMARK("Span, tracing disabled") {
+      MMCORE_TRACE_SPAN("Bench", "EmptySpan");
+   };
+}
+
+#endif // MMCORE_DISABLE_TRACING
@@ -0,0 +1,159 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "Tracing.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef MMCORE_DISABLE_TRACING
+
+namespace {
+
+class PropertyDevice : public CGenericBase<PropertyDevice> {
+public:
+   int Initialize() override {
+      CreateIntegerProperty("Value", 0, false);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "PropertyDevice");
+   }
+};
+
+std::size_t CountOccurrences(const std::string& text, const std::string& what) {
+   std::size_t count = 0;
+   for (auto pos = text.find(what); pos != std::string::npos;
+         pos = text.find(what, pos + what.size()))
+      ++count;
+   return count;
+}
+
+// Tracing state is process-wide; leave it off for other tests
+struct TracingSession {
+   CMMCore& core;
+   explicit TracingSession(CMMCore& c) : core(c) {
+      core.clearTrace();
+      core.enableTracing(true);
+   }
+   ~TracingSession() {
+      core.enableTracing(false);
+      core.clearTrace();
+   }
+};
+
+} // namespace
+
+TEST_CASE("Tracing records spans of setProperty and device module locks",
+   "[Tracing]")
+{
+   PropertyDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   CHECK_FALSE(c.isTracingEnabled());
+   TracingSession session(c);
+   CHECK(c.isTracingEnabled());
+
+   c.setProperty("dev", "Value", "3");
+   c.waitForDevice("dev");
+
+   const std::string json = c.getTraceJSON();
+   CHECK(json.find("\"traceEvents\"") != std::string::npos);
+   CHECK(CountOccurrences(json, "\"CMMCore::setProperty\"") == 1);
+   CHECK(CountOccurrences(json, "\"CMMCore::waitForDevice\"") == 1);
+   CHECK(CountOccurrences(json, "\"DeviceModuleLock wait\"") >= 2);
+   CHECK(CountOccurrences(json, "\"DeviceModuleLock hold\"") >= 2);
+   CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+}
+
+TEST_CASE("Tracing records nothing while disabled", "[Tracing]")
+{
+   PropertyDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.clearTrace();
+   c.setProperty("dev", "Value", "1");
+   CHECK(c.getTraceJSON().find("CMMCore::setProperty") == std::string::npos);
+}
+
+TEST_CASE("clearTrace discards recorded spans", "[Tracing]")
+{
+   PropertyDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   TracingSession session(c);
+   c.setProperty("dev", "Value", "1");
+   REQUIRE(c.getTraceJSON().find("CMMCore::setProperty") != std::string::npos);
+   c.clearTrace();
+   CHECK(c.getTraceJSON().find("CMMCore::setProperty") == std::string::npos);
+   c.setProperty("dev", "Value", "2");
+   CHECK(CountOccurrences(c.getTraceJSON(), "\"CMMCore::setProperty\"") == 1);
+}
+
+TEST_CASE("Spans of exited threads are kept, up to the per-thread capacity",
+   "[Tracing]")
+{
+   CMMCore c;
+   TracingSession session(c);
+
+   std::thread([] {
+      for (int i = 0; i < 100000; ++i) {
+         MMCORE_TRACE_SPAN("Test", "TestSpan");
+      }
+   }).join();
+
+   const std::string json = c.getTraceJSON();
+   const std::size_t count = CountOccurrences(json, "\"TestSpan\"");
+   CHECK(count > 0);
+   CHECK(count < 100000);
+}
+
+TEST_CASE("Threads that do not overlap share an event buffer", "[Tracing]")
+{
+   CMMCore c;
+   TracingSession session(c);
+
+   for (int i = 0; i < 64; ++i) {
+      std::thread([] {
+         MMCORE_TRACE_SPAN("Test", "SharedSpan");
+      }).join();
+   }
+
+   const std::string json = c.getTraceJSON();
+   CHECK(CountOccurrences(json, "\"SharedSpan\"") == 64);
+   CHECK(CountOccurrences(json, "\"thread_name\"") == 1);
+}
+
+TEST_CASE("saveTrace writes the trace to a file", "[Tracing]")
+{
+   CMMCore c;
+   TracingSession session(c);
+   {
+      MMCORE_TRACE_SPAN("Test", "SavedSpan");
+   }
+
+   const std::string path = "mmcore-tracing-test.json";
+   c.saveTrace(path.c_str());
+   std::ifstream in(path);
+   std::stringstream contents;
+   contents << in.rdbuf();
+   in.close();
+   std::remove(path.c_str());
+   CHECK(contents.str().find("\"traceEvents\"") != std::string::npos);
+   CHECK(CountOccurrences(contents.str(), "\"SavedSpan\"") == 1);
+}
+
+#endif // MMCORE_DISABLE_TRACING
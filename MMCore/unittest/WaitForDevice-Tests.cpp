@@ -0,0 +1,100 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Busy for a given time after each Start(), optionally announcing completion
+// through OnBusyChanged()
+class TimedBusyDevice : public CGenericBase<TimedBusyDevice> {
+   bool notify_;
+   std::atomic<bool> busy_{false};
+   std::thread worker_;
+
+public:
+   explicit TimedBusyDevice(bool notify) : notify_(notify) {}
+   ~TimedBusyDevice() { Join(); }
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { Join(); return DEVICE_OK; }
+   bool Busy() override { return busy_; }
+   void GetName(char* name) const override {
+      snprintf(name, MM::MaxStrLength, "TimedBusyDevice");
+   }
+
+   void Start(std::chrono::milliseconds duration) {
+      Join();
+      busy_ = true;
+      worker_ = std::thread([this, duration] {
+         std::this_thread::sleep_for(duration);
+         busy_ = false;
+         if (notify_)
+            OnBusyChanged(false);
+      });
+   }
+
+   void Join() {
+      if (worker_.joinable())
+         worker_.join();
+   }
+};
+
+} // namespace
+
+TEST_CASE("waitForDevice returns when a notifying device finishes",
+   "[WaitForDevice]")
+{
+   TimedBusyDevice dev(true);
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.waitForDevice("dev");
+   CHECK(c.getDeviceWaitCount("dev") == 1);
+
+   dev.Start(std::chrono::milliseconds(30));
+   c.waitForDevice("dev");
+   CHECK_FALSE(c.deviceBusy("dev"));
+   CHECK(c.getDeviceWaitCount("dev") == 2);
+   CHECK(c.getDeviceWaitTimeMs("dev") >= 25.0);
+   CHECK(c.getDeviceMaxWaitTimeMs("dev") <= c.getDeviceWaitTimeMs("dev"));
+   dev.Join();
+
+   c.resetDeviceWaitStatistics();
+   CHECK(c.getDeviceWaitCount("dev") == 0);
+   CHECK(c.getDeviceWaitTimeMs("dev") == 0.0);
+}
+
+TEST_CASE("waitForDevice polls devices that do not notify", "[WaitForDevice]")
+{
+   TimedBusyDevice dev(false);
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   dev.Start(std::chrono::milliseconds(30));
+   c.waitForDevice("dev");
+   CHECK_FALSE(c.deviceBusy("dev"));
+   CHECK(c.getDeviceWaitCount("dev") == 1);
+   dev.Join();
+}
+
+TEST_CASE("waitForDevice times out", "[WaitForDevice]")
+{
+   TimedBusyDevice dev(true);
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setTimeoutMs(20);
+
+   dev.Start(std::chrono::milliseconds(200));
+   CHECK_THROWS_AS(c.waitForDevice("dev"), CMMError);
+   CHECK(c.getDeviceWaitCount("dev") == 1);
+   dev.Join();
+}
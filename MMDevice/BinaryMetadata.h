@@ -0,0 +1,343 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          BinaryMetadata.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compact binary encoding of per-image metadata, for passing
+//                metadata to the Core without text serialization.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "ImageMetadata.h"
+#include "MMDeviceConstants.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace MM {
+
+// The encoding is only ever exchanged within a single process (between a
+// device adapter and the Core), so values are stored in native byte order.
+//
+// Layout: a 4-byte header ('M', 'M', 'B', version) followed by records:
+//
+//    u8  value type (BinaryMetadataValueType)
+//    u8  flags (BinaryMetadataFlags)
+//    key: u16 interned key id if FlagInternedKey, else u16 length + bytes
+//    device label: absent if FlagImageTag, else u16 length + bytes
+//    value: i64 or f64 (8 bytes), or u32 length + bytes for strings
+//
+// Interned keys are the well-known metadata keys that nearly every camera
+// sends with every frame. The table is part of the format: never reorder it,
+// and bump BinaryMetadataVersion when adding entries.
+
+const unsigned char BinaryMetadataVersion = 1;
+
+enum BinaryMetadataValueType
+{
+   BinaryMetadataInteger = 0,
+   BinaryMetadataFloat = 1,
+   BinaryMetadataString = 2,
+};
+
+enum BinaryMetadataFlags
+{
+   BinaryMetadataFlagInternedKey = 0x01,
+   BinaryMetadataFlagImageTag = 0x02, // Not associated with a device ("_")
+};
+
+inline const char* const* BinaryMetadataInternedKeys(unsigned& count)
+{
+   static const char* const keys[] = {
+      g_Keyword_Metadata_CameraLabel,
+      g_Keyword_Elapsed_Time_ms,
+      g_Keyword_Metadata_ImageNumber,
+      g_Keyword_Metadata_Width,
+      g_Keyword_Metadata_Height,
+      g_Keyword_PixelType,
+      g_Keyword_Metadata_ROI_X,
+      g_Keyword_Metadata_ROI_Y,
+      g_Keyword_Binning,
+      g_Keyword_Metadata_Exposure,
+      g_Keyword_Metadata_TimeInCore,
+      g_Keyword_Metadata_Score,
+   };
+   count = sizeof(keys) / sizeof(keys[0]);
+   return keys;
+}
+
+/**
+ * Builds binary-encoded metadata for MM::Core::InsertImage().
+ *
+ * Keep one instance per acquisition thread and Clear() it for each frame; the
+ * internal buffer is reused, so encoding does not allocate in steady state.
+ */
+class BinaryMetadataWriter
+{
+public:
+   BinaryMetadataWriter() { Clear(); }
+
+   void Clear()
+   {
+      data_.clear();
+      data_.push_back('M');
+      data_.push_back('M');
+      data_.push_back('B');
+      data_.push_back(BinaryMetadataVersion);
+   }
+
+   /*
+    * Add a tag not associated with any device.
+    */
+   void PutImageTag(const char* key, long long value)
+   { PutTag(key, nullptr, value); }
+   void PutImageTag(const char* key, long value)
+   { PutTag(key, nullptr, static_cast<long long>(value)); }
+   void PutImageTag(const char* key, int value)
+   { PutTag(key, nullptr, static_cast<long long>(value)); }
+   void PutImageTag(const char* key, unsigned value)
+   { PutTag(key, nullptr, static_cast<long long>(value)); }
+   void PutImageTag(const char* key, double value)
+   { PutTag(key, nullptr, value); }
+   void PutImageTag(const char* key, const char* value)
+   { PutTag(key, nullptr, value); }
+
+   /*
+    * Add a tag associated with deviceLabel (nullptr or "_" for none).
+    */
+   void PutTag(const char* key, const char* deviceLabel, long long value)
+   {
+      PutHeader(BinaryMetadataInteger, key, deviceLabel);
+      Append(&value, sizeof(value));
+   }
+
+   void PutTag(const char* key, const char* deviceLabel, double value)
+   {
+      PutHeader(BinaryMetadataFloat, key, deviceLabel);
+      Append(&value, sizeof(value));
+   }
+
+   void PutTag(const char* key, const char* deviceLabel, const char* value)
+   {
+      PutHeader(BinaryMetadataString, key, deviceLabel);
+      const unsigned len = static_cast<unsigned>(std::strlen(value));
+      Append(&len, sizeof(len));
+      Append(value, len);
+   }
+
+   /*
+    * Append the tags of another encoding (which must be valid; see
+    * ValidateBinaryMetadata()).
+    */
+   void AppendRecords(const unsigned char* data, unsigned long length)
+   {
+      if (length > 4)
+         Append(data + 4, length - 4);
+   }
+
+   const unsigned char* GetData() const { return data_.data(); }
+   unsigned long GetSize() const
+   { return static_cast<unsigned long>(data_.size()); }
+
+   // Exchange contents (and buffers, which are thus reused) with other
+   void Swap(BinaryMetadataWriter& other) { data_.swap(other.data_); }
+
+private:
+   void Append(const void* p, std::size_t n)
+   {
+      const unsigned char* bytes = static_cast<const unsigned char*>(p);
+      data_.insert(data_.end(), bytes, bytes + n);
+   }
+
+   void AppendShortString(const char* s)
+   {
+      std::size_t len = std::strlen(s);
+      if (len > 0xffff)
+         len = 0xffff;
+      const unsigned short len16 = static_cast<unsigned short>(len);
+      Append(&len16, sizeof(len16));
+      Append(s, len);
+   }
+
+   void PutHeader(BinaryMetadataValueType type, const char* key,
+         const char* deviceLabel)
+   {
+      unsigned char flags = 0;
+      const bool imageTag = !deviceLabel || std::strcmp(deviceLabel, "_") == 0;
+      if (imageTag)
+         flags |= BinaryMetadataFlagImageTag;
+
+      unsigned nKeys;
+      const char* const* keys = BinaryMetadataInternedKeys(nKeys);
+      unsigned short keyId = 0;
+      for (; keyId < nKeys; ++keyId)
+      {
+         if (std::strcmp(keys[keyId], key) == 0)
+            break;
+      }
+      if (keyId < nKeys)
+         flags |= BinaryMetadataFlagInternedKey;
+
+      data_.push_back(static_cast<unsigned char>(type));
+      data_.push_back(flags);
+      if (flags & BinaryMetadataFlagInternedKey)
+         Append(&keyId, sizeof(keyId));
+      else
+         AppendShortString(key);
+      if (!imageTag)
+         AppendShortString(deviceLabel);
+   }
+
+   std::vector<unsigned char> data_;
+};
+
+namespace internal {
+
+// Decodes into md, or only checks the data if md is null
+inline bool ParseBinaryMetadata(const unsigned char* data,
+      unsigned long length, Metadata* md)
+{
+   if (length < 4 || data[0] != 'M' || data[1] != 'M' || data[2] != 'B' ||
+         data[3] != BinaryMetadataVersion)
+      return false;
+
+   unsigned nKeys;
+   const char* const* keys = BinaryMetadataInternedKeys(nKeys);
+
+   const unsigned char* p = data + 4;
+   const unsigned char* const end = data + length;
+   std::string key;
+   std::string device;
+   std::string value;
+
+   auto readShortString = [&](std::string& s) {
+      unsigned short len;
+      if (end - p < static_cast<long>(sizeof(len)))
+         return false;
+      std::memcpy(&len, p, sizeof(len));
+      p += sizeof(len);
+      if (end - p < len)
+         return false;
+      if (md)
+         s.assign(reinterpret_cast<const char*>(p), len);
+      p += len;
+      return true;
+   };
+
+   auto put = [&](auto v) {
+      if (!md)
+         return;
+      md->RemoveTag((device == "_" ? key : device + "-" + key).c_str());
+      md->PutTag(key, device, v);
+   };
+
+   while (p < end)
+   {
+      if (end - p < 2)
+         return false;
+      const unsigned char type = p[0];
+      const unsigned char flags = p[1];
+      p += 2;
+
+      if (flags & BinaryMetadataFlagInternedKey)
+      {
+         unsigned short keyId;
+         if (end - p < static_cast<long>(sizeof(keyId)))
+            return false;
+         std::memcpy(&keyId, p, sizeof(keyId));
+         p += sizeof(keyId);
+         if (keyId >= nKeys)
+            return false;
+         if (md)
+            key = keys[keyId];
+      }
+      else if (!readShortString(key))
+         return false;
+
+      if (flags & BinaryMetadataFlagImageTag)
+         device = "_";
+      else if (!readShortString(device))
+         return false;
+
+      switch (type)
+      {
+         case BinaryMetadataInteger:
+         {
+            long long v;
+            if (end - p < static_cast<long>(sizeof(v)))
+               return false;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            put(v);
+            break;
+         }
+         case BinaryMetadataFloat:
+         {
+            double v;
+            if (end - p < static_cast<long>(sizeof(v)))
+               return false;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            put(v);
+            break;
+         }
+         case BinaryMetadataString:
+         {
+            unsigned len;
+            if (end - p < static_cast<long>(sizeof(len)))
+               return false;
+            std::memcpy(&len, p, sizeof(len));
+            p += sizeof(len);
+            if (static_cast<unsigned long>(end - p) < len)
+               return false;
+            if (md)
+               value.assign(reinterpret_cast<const char*>(p), len);
+            p += len;
+            put(value);
+            break;
+         }
+         default:
+            return false;
+      }
+   }
+   return true;
+}
+
+} // namespace internal
+
+/**
+ * Decodes binary metadata produced by BinaryMetadataWriter, adding each tag
+ * to md (replacing any existing tag with the same qualified name). Numeric
+ * values are converted to text exactly as Metadata::PutTag() does.
+ *
+ * Returns false if the data is malformed; tags decoded before the error
+ * remain in md.
+ */
+inline bool DecodeBinaryMetadata(const unsigned char* data,
+      unsigned long length, Metadata& md)
+{
+   return internal::ParseBinaryMetadata(data, length, &md);
+}
+
+/**
+ * Checks that binary metadata is well-formed, without decoding it.
+ */
+inline bool ValidateBinaryMetadata(const unsigned char* data,
+      unsigned long length)
+{
+   return internal::ParseBinaryMetadata(data, length, nullptr);
+}
+
+} // namespace MM
@@ -25,7 +25,499 @@
 
 #include "Debayer.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEBAYER_HAVE_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DEBAYER_TARGET_AVX2
+#else
+#define DEBAYER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// Rows per band below which splitting across threads does not pay off
+const int kMinBandRows = 64;
+
+// Raw rows kept per band; enough for the 7-row window of Edge-Aware
+const int kRowCacheSlots = 7;
+
+// Where an output channel is taken from, relative to the current site
+enum Source
+{
+   Center,     // the site itself
+   Horizontal, // left/right neighbors
+   Vertical,   // up/down neighbors
+   Diagonal,   // the four diagonal neighbors
+   Cross,      // the four horizontal and vertical neighbors
+   NumSources
+};
+
+// Output channel (0 = blue, 1 = green, 2 = red byte of the RGB32 pixel)
+// sampled at each site of the 2x2 mosaic tile, by [order][y & 1][x & 1]
+const int kSiteChannel[4][2][2] = {
+   { { 2, 1 }, { 1, 0 } }, // R-G-R-G
+   { { 0, 1 }, { 1, 2 } }, // B-G-B-G
+   { { 1, 0 }, { 2, 1 } }, // G-R-G-R
+   { { 1, 2 }, { 0, 1 } }, // G-B-G-B
+};
+
+// Mirror an out-of-range coordinate back into [0, n) without repeating the
+// edge sample, which preserves the mosaic parity
+inline int Reflect(int i, int n)
+{
+   if (n == 1)
+      return 0;
+   while (i < 0 || i >= n)
+   {
+      if (i < 0)
+         i = -i;
+      if (i >= n)
+         i = 2 * (n - 1) - i;
+   }
+   return i;
+}
+
+Source ChannelSource(int order, int yParity, int xParity, int channel, bool replicate)
+{
+   if (kSiteChannel[order][yParity][xParity] == channel)
+      return Center;
+   bool horizontal = kSiteChannel[order][yParity][xParity ^ 1] == channel;
+   bool vertical = kSiteChannel[order][yParity ^ 1][xParity] == channel;
+   if (horizontal && vertical)
+      return replicate ? Horizontal : Cross;
+   if (horizontal)
+      return Horizontal;
+   if (vertical)
+      return Vertical;
+   return Diagonal;
+}
+
+// Input rows widened to 16 bits, with two mirrored columns on each side so
+// that kernels can read x - 2 .. x + 2 without bounds checks
+template <typename T>
+class RowCache
+{
+public:
+   RowCache(const T* input, int width, int height) :
+      input_(input), width_(width), height_(height), stride_(width + 4),
+      data_(kRowCacheSlots * (width + 4)), tags_(kRowCacheSlots, -1)
+   {}
+
+   const unsigned short* Get(int y)
+   {
+      int row = Reflect(y, height_);
+      int slot = row % kRowCacheSlots;
+      unsigned short* data = &data_[slot * stride_];
+      if (tags_[slot] != row)
+      {
+         const T* src = input_ + static_cast<size_t>(row) * width_;
+         for (int x = 0; x < width_; ++x)
+            data[x + 2] = src[x];
+         for (int x = -2; x < 0; ++x)
+            data[x + 2] = src[Reflect(x, width_)];
+         for (int x = width_; x < width_ + 2; ++x)
+            data[x + 2] = src[Reflect(x, width_)];
+         tags_[slot] = row;
+      }
+      return data + 2;
+   }
+
+private:
+   const T* input_;
+   int width_;
+   int height_;
+   int stride_;
+   std::vector<unsigned short> data_;
+   std::vector<int> tags_;
+};
+
+struct RowSources
+{
+   const unsigned short* up;   // row y - 1 (Bilinear)
+   const unsigned short* mid;  // row y
+   const unsigned short* down; // row y + 1 (Bilinear)
+   const unsigned short* pair; // row y ^ 1 (Replication)
+   Source src[3][2];           // by channel and column parity
+};
+
+inline unsigned Avg(unsigned a, unsigned b)
+{
+   return (a + b + 1) >> 1;
+}
+
+inline unsigned Sample(const RowSources& rows, Source src, int x, bool replicate)
+{
+   const unsigned short* mid = rows.mid;
+   if (replicate)
+   {
+      switch (src)
+      {
+         case Center: return mid[x];
+         case Horizontal: return mid[x ^ 1];
+         case Vertical: return rows.pair[x];
+         default: return rows.pair[x ^ 1];
+      }
+   }
+   const unsigned short* up = rows.up;
+   const unsigned short* down = rows.down;
+   switch (src)
+   {
+      case Center: return mid[x];
+      case Horizontal: return Avg(mid[x - 1], mid[x + 1]);
+      case Vertical: return Avg(up[x], down[x]);
+      case Diagonal: return Avg(Avg(up[x - 1], up[x + 1]), Avg(down[x - 1], down[x + 1]));
+      default: return Avg(Avg(mid[x - 1], mid[x + 1]), Avg(up[x], down[x]));
+   }
+}
+
+inline unsigned char ToByte(unsigned value, int shift)
+{
+   value >>= shift;
+   return static_cast<unsigned char>(value > 255 ? 255 : value);
+}
+
+inline void SetRGB32(int* pixel, unsigned char blue, unsigned char green, unsigned char red)
+{
+   unsigned char* bytePix = reinterpret_cast<unsigned char*>(pixel);
+   bytePix[0] = blue;
+   bytePix[1] = green;
+   bytePix[2] = red;
+   bytePix[3] = 0;
+}
+
+void InterpolateRowScalar(const RowSources& rows, int* out, int begin, int width, int shift, bool replicate)
+{
+   for (int x = begin; x < width; ++x)
+   {
+      int parity = x & 1;
+      SetRGB32(out + x,
+         ToByte(Sample(rows, rows.src[0][parity], x, replicate), shift),
+         ToByte(Sample(rows, rows.src[1][parity], x, replicate), shift),
+         ToByte(Sample(rows, rows.src[2][parity], x, replicate), shift));
+   }
+}
+
+#ifdef DEBAYER_HAVE_SSE2
+
+inline __m128i Load8(const unsigned short* p)
+{
+   return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Exchange the samples of each even/odd column pair
+inline __m128i SwapPairs(__m128i v)
+{
+   return _mm_or_si128(_mm_srli_epi32(v, 16), _mm_slli_epi32(v, 16));
+}
+
+// Interleave 8 blue, green, and red bytes (low halves) into 8 RGB32 pixels
+inline void StoreRGB32(int* out, __m128i blue, __m128i green, __m128i red)
+{
+   __m128i bg = _mm_unpacklo_epi8(blue, green);
+   __m128i r0 = _mm_unpacklo_epi8(red, _mm_setzero_si128());
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(bg, r0));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(bg, r0));
+}
+
+int InterpolateRowSSE2(const RowSources& rows, int* out, int width, int shift, bool replicate)
+{
+   const __m128i evenLanes = _mm_set1_epi32(0x0000FFFF);
+   const __m128i count = _mm_cvtsi32_si128(shift);
+   const __m128i max8 = _mm_set1_epi16(255);
+   const unsigned short* mid = rows.mid;
+
+   int x = 0;
+   for (; x + 8 <= width; x += 8)
+   {
+      __m128i q[NumSources];
+      if (replicate)
+      {
+         q[Center] = Load8(mid + x);
+         q[Horizontal] = SwapPairs(q[Center]);
+         q[Vertical] = Load8(rows.pair + x);
+         q[Diagonal] = SwapPairs(q[Vertical]);
+         q[Cross] = q[Horizontal];
+      }
+      else
+      {
+         const unsigned short* up = rows.up;
+         const unsigned short* down = rows.down;
+         q[Center] = Load8(mid + x);
+         q[Horizontal] = _mm_avg_epu16(Load8(mid + x - 1), Load8(mid + x + 1));
+         q[Vertical] = _mm_avg_epu16(Load8(up + x), Load8(down + x));
+         q[Diagonal] = _mm_avg_epu16(
+            _mm_avg_epu16(Load8(up + x - 1), Load8(up + x + 1)),
+            _mm_avg_epu16(Load8(down + x - 1), Load8(down + x + 1)));
+         q[Cross] = _mm_avg_epu16(q[Horizontal], q[Vertical]);
+      }
+
+      __m128i channel[3];
+      for (int ch = 0; ch < 3; ++ch)
+      {
+         __m128i v = _mm_or_si128(_mm_and_si128(evenLanes, q[rows.src[ch][0]]),
+            _mm_andnot_si128(evenLanes, q[rows.src[ch][1]]));
+         v = _mm_srl_epi16(v, count);
+         v = _mm_sub_epi16(v, _mm_subs_epu16(v, max8)); // min(v, 255)
+         channel[ch] = _mm_packus_epi16(v, v);
+      }
+      StoreRGB32(out + x, channel[0], channel[1], channel[2]);
+   }
+   return x;
+}
+
+inline DEBAYER_TARGET_AVX2 __m256i Load16(const unsigned short* p)
+{
+   return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+inline DEBAYER_TARGET_AVX2 __m256i SwapPairs(__m256i v)
+{
+   return _mm256_or_si256(_mm256_srli_epi32(v, 16), _mm256_slli_epi32(v, 16));
+}
+
+DEBAYER_TARGET_AVX2
+int InterpolateRowAVX2(const RowSources& rows, int* out, int width, int shift, bool replicate)
+{
+   const __m256i evenLanes = _mm256_set1_epi32(0x0000FFFF);
+   const __m128i count = _mm_cvtsi32_si128(shift);
+   const __m256i max8 = _mm256_set1_epi16(255);
+   const unsigned short* mid = rows.mid;
+
+   int x = 0;
+   for (; x + 16 <= width; x += 16)
+   {
+      __m256i q[NumSources];
+      if (replicate)
+      {
+         q[Center] = Load16(mid + x);
+         q[Horizontal] = SwapPairs(q[Center]);
+         q[Vertical] = Load16(rows.pair + x);
+         q[Diagonal] = SwapPairs(q[Vertical]);
+         q[Cross] = q[Horizontal];
+      }
+      else
+      {
+         const unsigned short* up = rows.up;
+         const unsigned short* down = rows.down;
+         q[Center] = Load16(mid + x);
+         q[Horizontal] = _mm256_avg_epu16(Load16(mid + x - 1), Load16(mid + x + 1));
+         q[Vertical] = _mm256_avg_epu16(Load16(up + x), Load16(down + x));
+         q[Diagonal] = _mm256_avg_epu16(
+            _mm256_avg_epu16(Load16(up + x - 1), Load16(up + x + 1)),
+            _mm256_avg_epu16(Load16(down + x - 1), Load16(down + x + 1)));
+         q[Cross] = _mm256_avg_epu16(q[Horizontal], q[Vertical]);
+      }
+
+      __m128i lo[3];
+      __m128i hi[3];
+      for (int ch = 0; ch < 3; ++ch)
+      {
+         __m256i v = _mm256_or_si256(_mm256_and_si256(evenLanes, q[rows.src[ch][0]]),
+            _mm256_andnot_si256(evenLanes, q[rows.src[ch][1]]));
+         v = _mm256_srl_epi16(v, count);
+         v = _mm256_sub_epi16(v, _mm256_subs_epu16(v, max8)); // min(v, 255)
+         __m128i v0 = _mm256_castsi256_si128(v);
+         __m128i v1 = _mm256_extracti128_si256(v, 1);
+         lo[ch] = _mm_packus_epi16(v0, v0);
+         hi[ch] = _mm_packus_epi16(v1, v1);
+      }
+      StoreRGB32(out + x, lo[0], lo[1], lo[2]);
+      StoreRGB32(out + x + 8, hi[0], hi[1], hi[2]);
+   }
+   return x;
+}
+
+#endif // DEBAYER_HAVE_SSE2
+
+inline int Clamp(int value, int maxValue)
+{
+   return value < 0 ? 0 : (value > maxValue ? maxValue : value);
+}
+
+// Green plane rows for Edge-Aware, with one mirrored column on each side
+template <typename T>
+class GreenRowCache
+{
+public:
+   GreenRowCache(RowCache<T>& raw, int order, int width, int height, int maxValue) :
+      raw_(raw), order_(order), width_(width), height_(height), maxValue_(maxValue),
+      stride_(width + 2), data_(3 * (width + 2)), tags_(3, -1)
+   {}
+
+   const int* Get(int y)
+   {
+      int row = Reflect(y, height_);
+      int slot = row % 3;
+      int* green = &data_[slot * stride_] + 1;
+      if (tags_[slot] != row)
+      {
+         Interpolate(row, green);
+         tags_[slot] = row;
+      }
+      return green;
+   }
+
+private:
+   // Hamilton-Adams: at red and blue sites, interpolate green along the
+   // direction with the smaller gradient, corrected by the Laplacian of the
+   // site's own color
+   void Interpolate(int y, int* green)
+   {
+      const unsigned short* up2 = raw_.Get(y - 2);
+      const unsigned short* up = raw_.Get(y - 1);
+      const unsigned short* mid = raw_.Get(y);
+      const unsigned short* down = raw_.Get(y + 1);
+      const unsigned short* down2 = raw_.Get(y + 2);
+      const int* siteChannel = kSiteChannel[order_][y & 1];
+
+      for (int x = 0; x < width_; ++x)
+      {
+         int c = mid[x];
+         if (siteChannel[x & 1] == 1)
+         {
+            green[x] = c;
+            continue;
+         }
+         int lapH = 2 * c - mid[x - 2] - mid[x + 2];
+         int lapV = 2 * c - up2[x] - down2[x];
+         int gradH = std::abs(mid[x - 1] - mid[x + 1]) + std::abs(lapH);
+         int gradV = std::abs(up[x] - down[x]) + std::abs(lapV);
+         int estH = Clamp((2 * (mid[x - 1] + mid[x + 1]) + lapH + 2) / 4, maxValue_);
+         int estV = Clamp((2 * (up[x] + down[x]) + lapV + 2) / 4, maxValue_);
+         if (gradH < gradV)
+            green[x] = estH;
+         else if (gradV < gradH)
+            green[x] = estV;
+         else
+            green[x] = (estH + estV + 1) / 2;
+      }
+      green[-1] = green[Reflect(-1, width_)];
+      green[width_] = green[Reflect(width_, width_)];
+   }
+
+   RowCache<T>& raw_;
+   int order_;
+   int width_;
+   int height_;
+   int maxValue_;
+   int stride_;
+   std::vector<int> data_;
+   std::vector<int> tags_;
+};
+
+// Red and blue from the color difference to the interpolated green plane
+template <typename T>
+void EdgeAwareRow(RowCache<T>& raw, GreenRowCache<T>& greens, int order, int y,
+   int* out, int width, int shift, int maxValue)
+{
+   const int* greenUp = greens.Get(y - 1);
+   const int* greenMid = greens.Get(y);
+   const int* greenDown = greens.Get(y + 1);
+   const unsigned short* up = raw.Get(y - 1);
+   const unsigned short* mid = raw.Get(y);
+   const unsigned short* down = raw.Get(y + 1);
+
+   for (int x = 0; x < width; ++x)
+   {
+      int g = greenMid[x];
+      int value[3];
+      value[1] = g;
+      for (int ch = 0; ch < 3; ch += 2)
+      {
+         int v;
+         switch (ChannelSource(order, y & 1, x & 1, ch, false))
+         {
+            case Center:
+               v = mid[x];
+               break;
+            case Horizontal:
+               v = g + ((mid[x - 1] - greenMid[x - 1]) + (mid[x + 1] - greenMid[x + 1])) / 2;
+               break;
+            case Vertical:
+               v = g + ((up[x] - greenUp[x]) + (down[x] - greenDown[x])) / 2;
+               break;
+            default:
+               v = g + ((up[x - 1] - greenUp[x - 1]) + (up[x + 1] - greenUp[x + 1]) +
+                  (down[x - 1] - greenDown[x - 1]) + (down[x + 1] - greenDown[x + 1])) / 4;
+               break;
+         }
+         value[ch] = Clamp(v, maxValue);
+      }
+      SetRGB32(out + x, ToByte(value[0], shift), ToByte(value[1], shift), ToByte(value[2], shift));
+   }
+}
+
+template <typename T>
+void DecodeRows(const T* input, int* output, int width, int height, int bitDepth,
+   int order, int algorithm, Debayer::InstructionSet instructionSet, int yBegin, int yEnd)
+{
+   int shift = std::max(0, bitDepth - 8);
+   int maxValue = (bitDepth > 0 && bitDepth < 16) ? (1 << bitDepth) - 1 : 0xFFFF;
+   RowCache<T> raw(input, width, height);
+
+   if (algorithm == 4)
+   {
+      GreenRowCache<T> greens(raw, order, width, height, maxValue);
+      for (int y = yBegin; y < yEnd; ++y)
+         EdgeAwareRow(raw, greens, order, y, output + static_cast<size_t>(y) * width, width, shift, maxValue);
+      return;
+   }
+
+   bool replicate = algorithm == 0;
+   Source src[2][3][2];
+   for (int yParity = 0; yParity < 2; ++yParity)
+      for (int ch = 0; ch < 3; ++ch)
+         for (int xParity = 0; xParity < 2; ++xParity)
+            src[yParity][ch][xParity] = ChannelSource(order, yParity, xParity, ch, replicate);
+
+   for (int y = yBegin; y < yEnd; ++y)
+   {
+      RowSources rows;
+      rows.mid = raw.Get(y);
+      if (replicate)
+      {
+         rows.up = rows.down = 0;
+         rows.pair = raw.Get(y ^ 1);
+      }
+      else
+      {
+         rows.up = raw.Get(y - 1);
+         rows.down = raw.Get(y + 1);
+         rows.pair = 0;
+      }
+      std::copy(&src[y & 1][0][0], &src[y & 1][0][0] + 6, &rows.src[0][0]);
+
+      int* out = output + static_cast<size_t>(y) * width;
+      int x = 0;
+#ifdef DEBAYER_HAVE_SSE2
+      if (instructionSet >= Debayer::AVX2)
+         x = InterpolateRowAVX2(rows, out, width, shift, replicate);
+      if (instructionSet >= Debayer::SSE2)
+      {
+         RowSources tail = rows;
+         tail.mid += x;
+         tail.up = tail.up ? tail.up + x : 0;
+         tail.down = tail.down ? tail.down + x : 0;
+         tail.pair = tail.pair ? tail.pair + x : 0;
+         x += InterpolateRowSSE2(tail, out + x, width - x, shift, replicate);
+      }
+#endif
+      InterpolateRowScalar(rows, out, x, width, shift, replicate);
+   }
+}
+
+} // namespace
 
 ///////////////////////////////////////////////////////////////////////////////
 // Debayer class implementation
@@ -43,16 +535,45 @@ Debayer::Debayer()
    algorithms.push_back("Bilinear");
    algorithms.push_back("Smooth-Hue");
    algorithms.push_back("Adaptive-Smooth-Hue");
+   algorithms.push_back("Edge-Aware");
 
    // default settings
    orderIndex = 0; // RGRG ordering
    algoIndex = 0;  // replication - faster
+   threadCount = 0; // one per hardware thread
+   maxInstructionSet = AVX2;
 }
 
 Debayer::~Debayer()
 {
 }
 
+Debayer::InstructionSet Debayer::GetCpuInstructionSet()
+{
+#ifdef DEBAYER_HAVE_SSE2
+   static const InstructionSet cpuSet = []
+   {
+#ifdef _MSC_VER
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7)
+         return SSE2;
+      __cpuid(info, 1);
+      bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+         (_xgetbv(0) & 6) == 6;
+      __cpuidex(info, 7, 0);
+      return (osSavesAvx && (info[1] & (1 << 5))) ? AVX2 : SSE2;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+#endif
+   }();
+   return cpuSet;
+#else
+   return Scalar;
+#endif
+}
+
 int Debayer::Process(ImgBuffer& out, const ImgBuffer& input, int bitDepth)
 {
    assert(sizeof(int) == 4);
@@ -98,10 +619,13 @@ int Debayer::ProcessT(ImgBuffer& out, const T* in, int width, int height, int bi
 template<typename T>
 int Debayer::Convert(const T* input, int* output, int width, int height, int bitDepth, int rowOrder, int algorithm)
 {				
-	if (algorithm == 0)
-      ReplicateDecode(input, output, width, height, bitDepth, rowOrder);
-	else if (algorithm == 1)
-      return DEVICE_NOT_SUPPORTED;
+   if (rowOrder < 0 || rowOrder > 3)
+      return DEVICE_INVALID_INPUT_PARAM;
+   if (width <= 0 || height <= 0)
+      return DEVICE_OK;
+
+	if (algorithm == 0 || algorithm == 1 || algorithm == 4)
+      DecodeBands(input, output, width, height, bitDepth, rowOrder, algorithm);
 	else if (algorithm == 2)
       SmoothDecode(input, output, width, height, bitDepth, rowOrder);
 	else if (algorithm == 3)
@@ -135,153 +659,33 @@ unsigned short Debayer::GetPixel(const unsigned char* v, int x, int y, int width
       return v[y*width + x];
 }
 
-// Replication algorithm
+// Replication, Bilinear, and Edge-Aware, in bands of rows
 template <typename T>
-void Debayer::ReplicateDecode(const T* input, int* output, int width, int height, int bitDepth, int rowOrder)
+void Debayer::DecodeBands(const T* input, int* output, int width, int height, int bitDepth, int rowOrder, int algorithm)
 {
-   unsigned numPixels(width*height);
-   if (r.size() != numPixels)
+   InstructionSet instructionSet = std::min(maxInstructionSet, GetCpuInstructionSet());
+
+   unsigned threads = threadCount ? threadCount : std::thread::hardware_concurrency();
+   int bands = std::min(static_cast<int>(std::max(threads, 1u)), std::max(1, height / kMinBandRows));
+   if (bands == 1)
    {
-      r.resize(numPixels);
-      g.resize(numPixels);
-      b.resize(numPixels);
+      DecodeRows(input, output, width, height, bitDepth, rowOrder, algorithm, instructionSet, 0, height);
+      return;
    }
 
-   int bitShift = bitDepth - 8;
-	
-	if (rowOrder == 0 || rowOrder == 1) {
-		for (int y=0; y<height; y+=2) {
-			for (int x=0; x<width; x+=2) {
-				unsigned short one = GetPixel(input, x, y, width, height);
-				SetPixel(b, one, x, y, width, height);
-				SetPixel(b, one, x+1, y, width, height);
-				SetPixel(b, one, x, y+1, width, height); 
-				SetPixel(b, one, x+1, y+1, width, height);
-			}
-		}
-		
-		for (int y=1; y<height; y+=2) {
-			for (int x=1; x<width; x+=2) {
-            unsigned short one = GetPixel(input, x, y, width, height);
-				SetPixel(r, one, x, y, width, height);
-				SetPixel(r, one, x+1, y, width, height);
-				SetPixel(r, one, x, y+1, width, height); 
-				SetPixel(r, one, x+1, y+1, width, height);
-			}
-		}
-		
-		for (int y=0; y<height; y+=2) {
-			for (int x=1; x<width; x+=2) {
-				unsigned short one = GetPixel(input, x, y, width, height);
-            SetPixel(g, one, x, y, width, height);
-            SetPixel(g, one, x+1, y, width, height);
-			}
-		}	
-			
-		for (int y=1; y<height; y+=2) {
-			for (int x=0; x<width; x+=2) {
-            unsigned short one = GetPixel(input, x, y, width, height);
-            SetPixel(g, one, x, y, width, height);
-            SetPixel(g, one, x+1, y, width, height);
-			}
-		}	
-		
-		if (rowOrder == 0) {
-         for (int i=0; i<height*width; i++)
-         {
-            output[i] = 0;
-            unsigned char* bytePix = (unsigned char*)(output+i);
-            *bytePix = (unsigned char)(r[i] >> bitShift);
-            *(bytePix+1) = (unsigned char)(g[i] >> bitShift);
-            *(bytePix+2) = (unsigned char)(b[i] >> bitShift);
-
-			   //rgb.addSlice("red",b);	
-			   //rgb.addSlice("green",g);
-			   //rgb.addSlice("blue",r);
-         }
-		}
-		else if (rowOrder == 1) {
-         for (int i=0; i<height*width; i++)
-         {
-            output[i] = 0;
-            unsigned char* bytePix = (unsigned char*)(output+i);
-            *bytePix = (unsigned char)(b[i] >> bitShift);
-            *(bytePix+1) = (unsigned char)(g[i] >> bitShift);
-            *(bytePix+2) = (unsigned char)(r[i] >> bitShift);
-
-			   //rgb.addSlice("red",r);	
-			   //rgb.addSlice("green",g);
-			   //rgb.addSlice("blue",b);			
-		   }
-      }
-	}
-
-	else if (rowOrder == 2 || rowOrder == 3) {
-		for (int y=1; y<height; y+=2) {
-			for (int x=0; x<width; x+=2) {
-				unsigned short one = GetPixel(input, x, y, width, height);
-				SetPixel(b, one, x, y, width, height);
-				SetPixel(b, one, x+1, y, width, height);
-				SetPixel(b, one, x, y+1, width, height); 
-				SetPixel(b, one, x+1, y+1, width, height);
-			}
-		}
-		
-		for (int y=0; y<height; y+=2) {
-			for (int x=1; x<width; x+=2) {
-            unsigned short one = GetPixel(input, x, y, width, height);
-				SetPixel(r, one, x, y, width, height);
-				SetPixel(r, one, x+1, y, width, height);
-				SetPixel(r, one, x, y+1, width, height); 
-				SetPixel(r, one, x+1, y+1, width, height);
-			}
-		}
-		
-		for (int y=0; y<height; y+=2) {
-			for (int x=0; x<width; x+=2) {
-				unsigned short one = GetPixel(input, x, y, width, height);
-            SetPixel(g, one, x, y, width, height);
-            SetPixel(g, one, x+1, y, width, height);
-			}
-		}	
-			
-		for (int y=1; y<height; y+=2) {
-			for (int x=1; x<width; x+=2) {
-            unsigned short one = GetPixel(input, x, y, width, height);
-            SetPixel(g, one, x, y, width, height);
-            SetPixel(g, one, x+1, y, width, height);
-			}
-		}	
-		
-		if (rowOrder == 2) {
-         for (int i=0; i<height*width; i++)
-         {
-            output[i] = 0;
-            unsigned char* bytePix = (unsigned char*)(output+i);
-            *bytePix = (unsigned char)(r[i] >> bitShift);
-            *(bytePix+1) = (unsigned char)(g[i] >> bitShift);
-            *(bytePix+2) = (unsigned char)(b[i] >> bitShift);
-
-            //rgb.addSlice("red",b);	
-			   //rgb.addSlice("green",g);
-			   //rgb.addSlice("blue",r);
-         }
-		}
-		else if (rowOrder == 3) {
-         for (int i=0; i<height*width; i++)
-         {
-            output[i] = 0;
-            unsigned char* bytePix = (unsigned char*)(output+i);
-            *bytePix = (unsigned char)(b[i] >> bitShift);
-            *(bytePix+1) = (unsigned char)(g[i] >> bitShift);
-            *(bytePix+2) = (unsigned char)(r[i] >> bitShift);
-
-            //rgb.addSlice("red",r);	
-			   //rgb.addSlice("green",g);
-			   //rgb.addSlice("blue",b);
-         }
-		}
-	}
+   std::vector<std::future<void>> futures;
+   for (int band = 1; band < bands; ++band)
+   {
+      int yBegin = static_cast<int>(static_cast<long long>(height) * band / bands);
+      int yEnd = static_cast<int>(static_cast<long long>(height) * (band + 1) / bands);
+      futures.push_back(std::async(std::launch::async, [=] {
+         DecodeRows(input, output, width, height, bitDepth, rowOrder, algorithm, instructionSet, yBegin, yEnd);
+      }));
+   }
+   DecodeRows(input, output, width, height, bitDepth, rowOrder, algorithm, instructionSet,
+      0, static_cast<int>(height / bands));
+   for (size_t i = 0; i < futures.size(); ++i)
+      futures[i].get();
 }
 
 // Smooth Hue algorithm
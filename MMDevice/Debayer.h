@@ -32,10 +32,19 @@
 /**
  * Utility class to build color image from the Bayer grayscale image
  * Based on the Debayer_Image plugin for ImageJ, by Jennifer West, University of Manitoba
+ *
+ * Replication, Bilinear, and Edge-Aware write the RGB32 output in a single
+ * pass over the input, split into bands of rows processed in parallel;
+ * Replication and Bilinear use SSE2 or AVX2 when the CPU has them.
+ * Edge-Aware interpolates green along the direction of the smaller gradient
+ * and red and blue from color differences (Hamilton-Adams).
  */
 class Debayer
 {
 public:
+   // Instruction sets for the vectorized kernels
+   enum InstructionSet { Scalar, SSE2, AVX2 };
+
    Debayer();
    ~Debayer();
 
@@ -49,11 +58,18 @@ public:
    void SetOrderIndex(int idx) {orderIndex = idx;}
    void SetAlgorithmIndex(int idx) {algoIndex = idx;}
 
+   // Number of threads (0 = one per hardware thread)
+   void SetThreadCount(unsigned count) {threadCount = count;}
+   // Use at most the given instruction set (for testing and benchmarking);
+   // the CPU's best one is used by default
+   void SetMaxInstructionSet(InstructionSet set) {maxInstructionSet = set;}
+   static InstructionSet GetCpuInstructionSet();
+
 private:
    template <typename T>
    int ProcessT(ImgBuffer& out, const T* in, int width, int height, int bitDepth);
-   template<typename T>
-   void ReplicateDecode(const T* input, int* out, int width, int height, int bitDepth, int rowOrder);
+   template <typename T>
+   void DecodeBands(const T* input, int* output, int width, int height, int bitDepth, int rowOrder, int algorithm);
    template <typename T>
    void SmoothDecode(const T* input, int* output, int width, int height, int bitDepth, int rowOrder);
    template<typename T>
@@ -71,4 +87,6 @@ private:
 
    int orderIndex;
    int algoIndex;
+   unsigned threadCount;
+   InstructionSet maxInstructionSet;
 };
@@ -1018,6 +1018,43 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+   * Sends several ASCII commands to the serial port back to back, then
+   * receives one answer per command, in order. Use this instead of repeated
+   * SendSerialCommand()/GetSerialAnswer() pairs when the device accepts a
+   * new command before answering the previous one.
+   * @param portName
+   * @param commands - command strings, sent in order
+   * @param term - terminating string appended to each command
+   * @param answerTerm - terminating string of each answer
+   * @param answers - answers without the terminating characters; on error,
+   *        contains the answers received before the error
+   */
+   int SendSerialCommandBatch(const char* portName,
+         const std::vector<std::string>& commands, const char* term,
+         const char* answerTerm, std::vector<std::string>& answers)
+   {
+      answers.clear();
+      if (!callback_)
+         return DEVICE_NO_CALLBACK_REGISTERED;
+      if (commands.empty())
+         return DEVICE_OK;
+
+      const unsigned long MAX_BUFLEN = 2000;
+      std::vector<const char*> cmds;
+      cmds.reserve(commands.size());
+      for (const std::string& cmd : commands)
+         cmds.push_back(cmd.c_str());
+      std::vector<char> buf(commands.size() * MAX_BUFLEN);
+      unsigned long numAnswered = 0;
+      int ret = callback_->SendSerialCommandBatch(this, portName, cmds.data(),
+            static_cast<unsigned long>(cmds.size()), term, buf.data(),
+            MAX_BUFLEN, answerTerm, numAnswered);
+      for (unsigned long i = 0; i < numAnswered; ++i)
+         answers.push_back(&buf[i * MAX_BUFLEN]);
+      return ret;
+   }
+
    /**
    * Reads the current contents of Rx serial buffer.
    */
@@ -1118,6 +1155,18 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+    * Signals that Busy() changed, e.g. because a move completed. Devices
+    * that know when their operations finish should call this so that the
+    * Core does not have to poll Busy().
+    */
+   int OnBusyChanged(bool busy)
+   {
+      if (callback_)
+         return callback_->OnBusyChanged(this, busy);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
    /**
    * Gets the system ticks in microseconds.
    * OBSOLETE, use GetCurrentTime()
@@ -28,7 +28,7 @@
 // Header version
 // If any of the class definitions changes, the interface version
 // must be incremented
-#define DEVICE_INTERFACE_VERSION 74
+#define DEVICE_INTERFACE_VERSION 78
 ///////////////////////////////////////////////////////////////////////////////
 
 // N.B.
@@ -1477,6 +1477,13 @@ namespace MM {
    };
 
 
+   /**
+    * Returns an image buffer lent to the Core with
+    * Core::InsertBorrowedImage() to the camera. context is the releaseContext
+    * given with the image and buf its pixel buffer.
+    */
+   typedef void (*ImageReleaseFunction)(void* context, const unsigned char* buf);
+
    /**
     * Callback API to the core control module.
     * Devices use this abstract interface to use Core services
@@ -1525,6 +1532,23 @@ namespace MM {
       virtual int WriteToSerial(const Device* caller, const char* port, const unsigned char* buf, unsigned long length) = 0;
       virtual int ReadFromSerial(const Device* caller, const char* port, unsigned char* buf, unsigned long length, unsigned long& read) = 0;
       virtual int PurgeSerial(const Device* caller, const char* portName) = 0;
+      /**
+       * Send several commands to a serial port and collect their answers.
+       *
+       * All numCommands commands (each followed by term) are written back
+       * to back before any answer is read, so a controller that queues its
+       * input can process them without waiting for a round trip per
+       * command. One answer terminated by answerTerm is then read per
+       * command, in order, into consecutive answerStride-sized slots of
+       * answers (answerTerm is stripped). On return, numAnswered holds the
+       * number of answers received, which is less than numCommands only if
+       * an error is returned.
+       */
+      virtual int SendSerialCommandBatch(const Device* caller,
+            const char* portName, const char* const* commands,
+            unsigned long numCommands, const char* term,
+            char* answers, unsigned long answerStride,
+            const char* answerTerm, unsigned long& numAnswered) = 0;
       virtual MM::PortType GetSerialPortType(const char* portName) const = 0;
 
       virtual int OnPropertiesChanged(const Device* caller) = 0;
@@ -1560,6 +1584,16 @@ namespace MM {
        * Signals that the shutter opened or closed
        */
       virtual int OnShutterOpenChanged(const Device* caller, bool open) = 0;
+      /**
+       * Signals that the value returned by Busy() has changed (for example,
+       * when the controller reports that a move has completed).
+       *
+       * Calling this is optional, but lets the Core wake threads waiting
+       * for the device immediately instead of at the next poll of Busy().
+       * Busy() must still return the correct state. May be called from any
+       * thread.
+       */
+      virtual int OnBusyChanged(const Device* caller, bool busy) = 0;
 
       // Deprecated: Return value overflows in ~72 minutes on Windows.
       // Prefer std::chrono::steady_clock for time delta measurements.
@@ -1603,6 +1637,36 @@ namespace MM {
        */
       virtual int InsertImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata = nullptr, const bool doProcess = true) = 0;
 
+      /**
+       * Same as the overload taking serializedMetadata, but with metadata in
+       * the binary encoding produced by MM::BinaryMetadataWriter (see
+       * BinaryMetadata.h). This avoids formatting and parsing the text
+       * serialization for every frame.
+       *
+       * binaryMetadata may be null (with binaryMetadataLength 0) to send no
+       * metadata. Returns DEVICE_INVALID_INPUT_PARAM if the metadata cannot be
+       * decoded.
+       */
+      virtual int InsertImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, const bool doProcess = true) = 0;
+
+      /**
+       * Same as the overload taking binaryMetadata, but lends the pixel
+       * buffer to the Core instead of having it copied before returning, so
+       * that cameras whose driver delivers frames in its own buffers can
+       * insert them without copying them first.
+       *
+       * buf must stay valid, and must not be written by the camera, until
+       * the Core calls release(releaseContext, buf). The Core calls it
+       * exactly once for each call to this function (including when an error
+       * is returned), either before returning or later from another thread;
+       * in any case before AcqFinished() returns. The Core may run the image
+       * processor on buf in place.
+       *
+       * If release is null, the image is copied before returning, as with
+       * InsertImage().
+       */
+      virtual int InsertBorrowedImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const unsigned char* binaryMetadata, unsigned long binaryMetadataLength, ImageReleaseFunction release, void* releaseContext, const bool doProcess = true) = 0;
+
       /**
        * Prepare the sequence buffer for the given image size and pixel format.
        *
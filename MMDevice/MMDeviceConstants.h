@@ -147,6 +147,9 @@ namespace MM {
    const char* const g_Keyword_CorePressurePump = "PressurePump";
    const char* const g_Keyword_CoreVolumetricPump = "VolumetricPump";
    const char* const g_Keyword_CoreTimeoutMs    = "TimeoutMs";
+   const char* const g_Keyword_CoreImageCopyThreads = "ImageCopyThreads";
+   const char* const g_Keyword_CoreImageCopyCPUs = "ImageCopyCPUs";
+   const char* const g_Keyword_CoreImageProcessingThreads = "ImageProcessingThreads";
    const char* const g_Keyword_Channel          = "Channel";
    const char* const g_Keyword_Version          = "Version";
    const char* const g_Keyword_ColorMode        = "ColorMode";
@@ -156,6 +159,14 @@ namespace MM {
    const char* const g_Keyword_Transpose_Correction = "TransposeCorrection";
    const char* const g_Keyword_Closed_Position = "ClosedPosition";
    const char* const g_Keyword_HubID = "HubID";
+   // Image processors set this (read-only) to "1" if Process() may be called
+   // from several threads at once. Such calls may process frames in a
+   // different order than the camera produced them.
+   const char* const g_Keyword_ConcurrentProcessing = "ConcurrentProcessing";
+   // Devices set this (read-only) to "1" if they may be read (property
+   // values, Busy(), positions) while other devices of the same module are
+   // being read on other threads. Reads of one device are still serialized.
+   const char* const g_Keyword_ConcurrentReads = "ConcurrentReads";
 
    const char* const g_Keyword_PixelType_GRAY8   = "GRAY8";
    const char* const g_Keyword_PixelType_GRAY16  = "GRAY16";
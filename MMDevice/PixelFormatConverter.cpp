@@ -0,0 +1,498 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelFormatConverter.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of common camera pixel formats to the formats
+//                used by Micro-Manager (8- and 16-bit gray, RGB32).
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelFormatConverter.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELFORMAT_HAVE_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PIXELFORMAT_TARGET_SSSE3
+#define PIXELFORMAT_TARGET_AVX2
+#else
+#define PIXELFORMAT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PIXELFORMAT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+typedef PixelFormatConverter::InstructionSet InstructionSet;
+
+///////////////////////////////////////////////////////////////////////////////
+// Packed 4:2:2 YCbCr
+///////////////////////////////////////////////////////////////////////////////
+
+inline unsigned char ClipByte(int value)
+{
+   return static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// 8-bit fixed point BT.601 (as in the V4L2 documentation); the vectorized
+// kernels compute exactly the same
+inline void YCbCrToBGRA(unsigned char* out, int y, int cb, int cr)
+{
+   const int c = 298 * (y - 16) + 128;
+   const int d = cb - 128;
+   const int e = cr - 128;
+   out[0] = ClipByte((c + 516 * d) >> 8);
+   out[1] = ClipByte((c - 100 * d - 208 * e) >> 8);
+   out[2] = ClipByte((c + 409 * e) >> 8);
+   out[3] = 0;
+}
+
+// Byte offsets of Y0, Cb, Y1, Cr in a pixel pair
+template <bool UYVY> struct YCbCrLayout
+{ enum { Y0 = 0, Cb = 1, Y1 = 2, Cr = 3 }; };
+template <> struct YCbCrLayout<true>
+{ enum { Y0 = 1, Cb = 0, Y1 = 3, Cr = 2 }; };
+
+template <bool UYVY>
+void YCbCrToBGRAScalar(unsigned char* out, const unsigned char* in,
+   std::size_t begin, std::size_t pixelCount)
+{
+   typedef YCbCrLayout<UYVY> L;
+   for (std::size_t x = begin; x + 1 < pixelCount; x += 2)
+   {
+      const unsigned char* pair = in + 2 * x;
+      YCbCrToBGRA(out + 4 * x, pair[L::Y0], pair[L::Cb], pair[L::Cr]);
+      YCbCrToBGRA(out + 4 * x + 4, pair[L::Y1], pair[L::Cb], pair[L::Cr]);
+   }
+}
+
+template <bool UYVY>
+void YCbCrToYScalar(unsigned char* out, const unsigned char* in,
+   std::size_t begin, std::size_t pixelCount)
+{
+   const std::size_t offset = UYVY ? 1 : 0;
+   for (std::size_t x = begin; x < pixelCount; ++x)
+      out[x] = in[2 * x + offset];
+}
+
+#ifdef PIXELFORMAT_HAVE_SSE2
+
+// Broadcast (lo, hi) pairs of 16-bit values, for _mm_madd_epi16()
+inline __m128i Pairs(short lo, short hi)
+{
+   return _mm_set_epi16(hi, lo, hi, lo, hi, lo, hi, lo);
+}
+
+// Interleave 8 blue, green, and red bytes (low halves) into 8 RGB32 pixels
+inline void StoreBGRA(unsigned char* out, __m128i blue, __m128i green, __m128i red)
+{
+   __m128i bg = _mm_unpacklo_epi8(blue, green);
+   __m128i r0 = _mm_unpacklo_epi8(red, _mm_setzero_si128());
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(bg, r0));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi16(bg, r0));
+}
+
+// (Y term + chroma term) >> 8 for 8 pixels, packed to bytes with clipping
+inline __m128i ChannelBytes(__m128i yLo, __m128i yHi,
+   __m128i chromaLo, __m128i chromaHi, __m128i coefficients)
+{
+   __m128i lo = _mm_srai_epi32(_mm_add_epi32(yLo, _mm_madd_epi16(chromaLo, coefficients)), 8);
+   __m128i hi = _mm_srai_epi32(_mm_add_epi32(yHi, _mm_madd_epi16(chromaHi, coefficients)), 8);
+   __m128i words = _mm_packs_epi32(lo, hi);
+   return _mm_packus_epi16(words, words);
+}
+
+// Each 16-bit lane of a YCbCr vector holds a Y and a chroma byte; chroma
+// alternates Cb, Cr. Returns Y - 16 and, for each pixel, Cb - 128 and
+// Cr - 128.
+template <bool UYVY>
+inline void SplitYCbCr(__m128i v, __m128i& c, __m128i& d, __m128i& e)
+{
+   const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+   const __m128i evenLanes = _mm_set1_epi32(0x0000FFFF);
+   __m128i y = UYVY ? _mm_srli_epi16(v, 8) : _mm_and_si128(v, lowBytes);
+   __m128i chroma = UYVY ? _mm_and_si128(v, lowBytes) : _mm_srli_epi16(v, 8);
+   c = _mm_sub_epi16(y, _mm_set1_epi16(16));
+   chroma = _mm_sub_epi16(chroma, _mm_set1_epi16(128));
+   d = _mm_or_si128(_mm_and_si128(chroma, evenLanes), _mm_slli_epi32(chroma, 16));
+   e = _mm_or_si128(_mm_srli_epi32(chroma, 16), _mm_andnot_si128(evenLanes, chroma));
+}
+
+template <bool UYVY>
+std::size_t YCbCrToBGRASSE2(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount)
+{
+   const __m128i ones = _mm_set1_epi16(1);
+   const __m128i kY = Pairs(298, 128); // With rounding
+   const __m128i kB = Pairs(516, 0);
+   const __m128i kG = Pairs(-100, -208);
+   const __m128i kR = Pairs(0, 409);
+
+   std::size_t x = 0;
+   for (; x + 8 <= pixelCount; x += 8)
+   {
+      __m128i c, d, e;
+      SplitYCbCr<UYVY>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * x)), c, d, e);
+      __m128i yLo = _mm_madd_epi16(_mm_unpacklo_epi16(c, ones), kY);
+      __m128i yHi = _mm_madd_epi16(_mm_unpackhi_epi16(c, ones), kY);
+      __m128i deLo = _mm_unpacklo_epi16(d, e);
+      __m128i deHi = _mm_unpackhi_epi16(d, e);
+      StoreBGRA(out + 4 * x,
+         ChannelBytes(yLo, yHi, deLo, deHi, kB),
+         ChannelBytes(yLo, yHi, deLo, deHi, kG),
+         ChannelBytes(yLo, yHi, deLo, deHi, kR));
+   }
+   return x;
+}
+
+inline PIXELFORMAT_TARGET_AVX2 __m256i Pairs256(short lo, short hi)
+{
+   return _mm256_set1_epi32(static_cast<int>((static_cast<unsigned>(static_cast<unsigned short>(hi)) << 16) |
+      static_cast<unsigned short>(lo)));
+}
+
+inline PIXELFORMAT_TARGET_AVX2 __m256i ChannelBytes(__m256i yLo, __m256i yHi,
+   __m256i chromaLo, __m256i chromaHi, __m256i coefficients)
+{
+   __m256i lo = _mm256_srai_epi32(_mm256_add_epi32(yLo, _mm256_madd_epi16(chromaLo, coefficients)), 8);
+   __m256i hi = _mm256_srai_epi32(_mm256_add_epi32(yHi, _mm256_madd_epi16(chromaHi, coefficients)), 8);
+   __m256i words = _mm256_packs_epi32(lo, hi);
+   return _mm256_packus_epi16(words, words);
+}
+
+// As the SSE2 kernel; the in-lane unpacks and packs leave pixels 0-7 in the
+// low and 8-15 in the high lane until the final stores
+template <bool UYVY>
+PIXELFORMAT_TARGET_AVX2
+std::size_t YCbCrToBGRAAVX2(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount)
+{
+   const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+   const __m256i evenLanes = _mm256_set1_epi32(0x0000FFFF);
+   const __m256i ones = _mm256_set1_epi16(1);
+   const __m256i kY = Pairs256(298, 128);
+   const __m256i kB = Pairs256(516, 0);
+   const __m256i kG = Pairs256(-100, -208);
+   const __m256i kR = Pairs256(0, 409);
+
+   std::size_t x = 0;
+   for (; x + 16 <= pixelCount; x += 16)
+   {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * x));
+      __m256i y = UYVY ? _mm256_srli_epi16(v, 8) : _mm256_and_si256(v, lowBytes);
+      __m256i chroma = UYVY ? _mm256_and_si256(v, lowBytes) : _mm256_srli_epi16(v, 8);
+      __m256i c = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+      chroma = _mm256_sub_epi16(chroma, _mm256_set1_epi16(128));
+      __m256i d = _mm256_or_si256(_mm256_and_si256(chroma, evenLanes), _mm256_slli_epi32(chroma, 16));
+      __m256i e = _mm256_or_si256(_mm256_srli_epi32(chroma, 16), _mm256_andnot_si256(evenLanes, chroma));
+
+      __m256i yLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(c, ones), kY);
+      __m256i yHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(c, ones), kY);
+      __m256i deLo = _mm256_unpacklo_epi16(d, e);
+      __m256i deHi = _mm256_unpackhi_epi16(d, e);
+      __m256i blue = ChannelBytes(yLo, yHi, deLo, deHi, kB);
+      __m256i green = ChannelBytes(yLo, yHi, deLo, deHi, kG);
+      __m256i red = ChannelBytes(yLo, yHi, deLo, deHi, kR);
+
+      __m256i bg = _mm256_unpacklo_epi8(blue, green);
+      __m256i r0 = _mm256_unpacklo_epi8(red, _mm256_setzero_si256());
+      __m256i lo = _mm256_unpacklo_epi16(bg, r0); // Pixels 0-3, 8-11
+      __m256i hi = _mm256_unpackhi_epi16(bg, r0); // Pixels 4-7, 12-15
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x),
+         _mm256_permute2x128_si256(lo, hi, 0x20));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x + 32),
+         _mm256_permute2x128_si256(lo, hi, 0x31));
+   }
+   return x;
+}
+
+template <bool UYVY>
+std::size_t YCbCrToYSSE2(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount)
+{
+   const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+   std::size_t x = 0;
+   for (; x + 16 <= pixelCount; x += 16)
+   {
+      __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * x));
+      __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * x + 16));
+      if (UYVY)
+      {
+         v0 = _mm_srli_epi16(v0, 8);
+         v1 = _mm_srli_epi16(v1, 8);
+      }
+      else
+      {
+         v0 = _mm_and_si128(v0, lowBytes);
+         v1 = _mm_and_si128(v1, lowBytes);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(v0, v1));
+   }
+   return x;
+}
+
+#endif // PIXELFORMAT_HAVE_SSE2
+
+template <bool UYVY>
+void YCbCrToBGRA(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount, InstructionSet instructionSet)
+{
+   std::size_t x = 0;
+#ifdef PIXELFORMAT_HAVE_SSE2
+   if (instructionSet >= PixelFormatConverter::AVX2)
+      x = YCbCrToBGRAAVX2<UYVY>(out, in, pixelCount);
+   if (instructionSet >= PixelFormatConverter::SSE2)
+      x += YCbCrToBGRASSE2<UYVY>(out + 4 * x, in + 2 * x, pixelCount - x);
+#else
+   (void)instructionSet;
+#endif
+   YCbCrToBGRAScalar<UYVY>(out, in, x, pixelCount);
+}
+
+template <bool UYVY>
+void YCbCrToY(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount, InstructionSet instructionSet)
+{
+   std::size_t x = 0;
+#ifdef PIXELFORMAT_HAVE_SSE2
+   if (instructionSet >= PixelFormatConverter::SSE2)
+      x = YCbCrToYSSE2<UYVY>(out, in, pixelCount);
+#else
+   (void)instructionSet;
+#endif
+   YCbCrToYScalar<UYVY>(out, in, x, pixelCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 24-bit color
+///////////////////////////////////////////////////////////////////////////////
+
+template <bool RGB>
+void ColorToBGRAScalar(unsigned char* out, const unsigned char* in,
+   std::size_t begin, std::size_t pixelCount)
+{
+   for (std::size_t x = begin; x < pixelCount; ++x)
+   {
+      const unsigned char* p = in + 3 * x;
+      unsigned char* q = out + 4 * x;
+      q[0] = p[RGB ? 2 : 0];
+      q[1] = p[1];
+      q[2] = p[RGB ? 0 : 2];
+      q[3] = 0;
+   }
+}
+
+#ifdef PIXELFORMAT_HAVE_SSE2
+
+// 16 pixels (48 bytes) at a time; each shuffle makes 4 RGB32 pixels out of
+// 12 bytes. The last 12 bytes are loaded from 4 bytes earlier so as not to
+// read past the input.
+template <bool RGB>
+PIXELFORMAT_TARGET_SSSE3
+std::size_t ColorToBGRASSSE3(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount)
+{
+   const __m128i shuffle = RGB ?
+      _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+   const __m128i shuffleLast = _mm_add_epi8(shuffle,
+      _mm_and_si128(_mm_set1_epi8(4), _mm_cmpgt_epi8(shuffle, _mm_set1_epi8(-1))));
+
+   std::size_t x = 0;
+   for (; x + 16 <= pixelCount; x += 16)
+   {
+      const unsigned char* p = in + 3 * x;
+      __m128i* q = reinterpret_cast<__m128i*>(out + 4 * x);
+      _mm_storeu_si128(q, _mm_shuffle_epi8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), shuffle));
+      _mm_storeu_si128(q + 1, _mm_shuffle_epi8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), shuffle));
+      _mm_storeu_si128(q + 2, _mm_shuffle_epi8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 24)), shuffle));
+      _mm_storeu_si128(q + 3, _mm_shuffle_epi8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)), shuffleLast));
+   }
+   return x;
+}
+
+#endif // PIXELFORMAT_HAVE_SSE2
+
+template <bool RGB>
+void ColorToBGRA(unsigned char* out, const unsigned char* in,
+   std::size_t pixelCount, InstructionSet instructionSet)
+{
+   std::size_t x = 0;
+#ifdef PIXELFORMAT_HAVE_SSE2
+   if (instructionSet >= PixelFormatConverter::SSSE3)
+      x = ColorToBGRASSSE3<RGB>(out, in, pixelCount);
+#else
+   (void)instructionSet;
+#endif
+   ColorToBGRAScalar<RGB>(out, in, x, pixelCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bit-packed mono
+///////////////////////////////////////////////////////////////////////////////
+
+template <int Bits>
+void UnpackScalar(unsigned short* out, const unsigned char* in,
+   std::size_t begin, std::size_t pixelCount)
+{
+   // Each pixel spans two bytes (Bits > 8)
+   const unsigned mask = (1u << Bits) - 1;
+   for (std::size_t x = begin; x < pixelCount; ++x)
+   {
+      const std::size_t bit = x * Bits;
+      const unsigned char* p = in + bit / 8;
+      const unsigned value = p[0] | (p[1] << 8);
+      out[x] = static_cast<unsigned short>((value >> (bit % 8)) & mask);
+   }
+}
+
+#ifdef PIXELFORMAT_HAVE_SSE2
+
+// 8 pixels (Bits bytes) at a time: a shuffle gathers the two bytes holding
+// each pixel into its 16-bit lane; multiplying by 2^(16 - Bits - offset)
+// drops the bits above the pixel, and a shift by 16 - Bits the bits below
+template <int Bits>
+PIXELFORMAT_TARGET_SSSE3
+std::size_t UnpackSSSE3(unsigned short* out, const unsigned char* in,
+   std::size_t pixelCount)
+{
+   char gather[16];
+   short multipliers[8];
+   for (int i = 0; i < 8; ++i)
+   {
+      gather[2 * i] = static_cast<char>(i * Bits / 8);
+      gather[2 * i + 1] = static_cast<char>(i * Bits / 8 + 1);
+      multipliers[i] = static_cast<short>(1 << (16 - Bits - i * Bits % 8));
+   }
+   const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gather));
+   const __m128i scale = _mm_loadu_si128(reinterpret_cast<const __m128i*>(multipliers));
+
+   // Loads are 16 bytes, of which the last 16 - Bits are not used
+   const std::size_t inputSize = (pixelCount * Bits + 7) / 8;
+   std::size_t x = 0;
+   for (; x * Bits / 8 + 16 <= inputSize && x + 8 <= pixelCount; x += 8)
+   {
+      __m128i v = _mm_shuffle_epi8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * Bits / 8)), shuffle);
+      v = _mm_srli_epi16(_mm_mullo_epi16(v, scale), 16 - Bits);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), v);
+   }
+   return x;
+}
+
+#endif // PIXELFORMAT_HAVE_SSE2
+
+template <int Bits>
+void Unpack(unsigned short* out, const unsigned char* in,
+   std::size_t pixelCount, InstructionSet instructionSet)
+{
+   std::size_t x = 0;
+#ifdef PIXELFORMAT_HAVE_SSE2
+   if (instructionSet >= PixelFormatConverter::SSSE3)
+      x = UnpackSSSE3<Bits>(out, in, pixelCount);
+#else
+   (void)instructionSet;
+#endif
+   UnpackScalar<Bits>(out, in, x, pixelCount);
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// PixelFormatConverter class implementation
+///////////////////////////////////////////////////////////////////////////////
+
+PixelFormatConverter::InstructionSet PixelFormatConverter::GetCpuInstructionSet()
+{
+#ifdef PIXELFORMAT_HAVE_SSE2
+   static const InstructionSet cpuSet = []
+   {
+#ifdef _MSC_VER
+      int info[4];
+      __cpuid(info, 0);
+      const int maxLeaf = info[0];
+      __cpuid(info, 1);
+      const bool ssse3 = (info[2] & (1 << 9)) != 0;
+      if (maxLeaf < 7)
+         return ssse3 ? SSSE3 : SSE2;
+      bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+         (_xgetbv(0) & 6) == 6;
+      __cpuidex(info, 7, 0);
+      if (osSavesAvx && (info[1] & (1 << 5)))
+         return AVX2;
+      return ssse3 ? SSSE3 : SSE2;
+#else
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+         return AVX2;
+      return __builtin_cpu_supports("ssse3") ? SSSE3 : SSE2;
+#endif
+   }();
+   return cpuSet;
+#else
+   return Scalar;
+#endif
+}
+
+PixelFormatConverter::InstructionSet PixelFormatConverter::GetInstructionSet() const
+{
+   return std::min(maxInstructionSet, GetCpuInstructionSet());
+}
+
+void PixelFormatConverter::YUYVToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   YCbCrToBGRA<false>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::UYVYToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   YCbCrToBGRA<true>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::YUYVToY(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   YCbCrToY<false>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::UYVYToY(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   YCbCrToY<true>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::RGB8ToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   ColorToBGRA<true>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::BGR8ToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   ColorToBGRA<false>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::UnpackMono10p(unsigned short* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   Unpack<10>(out, in, pixelCount, GetInstructionSet());
+}
+
+void PixelFormatConverter::UnpackMono12p(unsigned short* out, const unsigned char* in, std::size_t pixelCount) const
+{
+   Unpack<12>(out, in, pixelCount, GetInstructionSet());
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelFormatConverter.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of common camera pixel formats to the formats
+//                used by Micro-Manager (8- and 16-bit gray, RGB32).
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Converts frames delivered by cameras into Micro-Manager's pixel formats.
+ *
+ * All functions convert pixelCount pixels stored contiguously (rows without
+ * padding) from in to out. RGB32 output is in the byte order B, G, R, 0.
+ * SSE2, SSSE3 or AVX2 are used when the CPU has them; results are identical
+ * to the scalar code.
+ */
+class PixelFormatConverter
+{
+public:
+   // Instruction sets for the vectorized kernels
+   enum InstructionSet { Scalar, SSE2, SSSE3, AVX2 };
+
+   PixelFormatConverter() : maxInstructionSet(AVX2) {}
+
+   // Packed 4:2:2 YCbCr (ITU-R BT.601, limited range) to RGB32, in the
+   // Y0 Cb Y1 Cr (YUYV, YUY2) or Cb Y0 Cr Y1 (UYVY) byte order. pixelCount
+   // must be even.
+   void YUYVToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+   void UYVYToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+
+   // The 8-bit luma (Y) plane of packed 4:2:2 YCbCr. pixelCount must be even.
+   void YUYVToY(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+   void UYVYToY(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+
+   // 24-bit color, in the byte order R, G, B or B, G, R, to RGB32
+   void RGB8ToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+   void BGR8ToBGRA(unsigned char* out, const unsigned char* in, std::size_t pixelCount) const;
+
+   // GenICam Mono10p and Mono12p (pixels packed without gaps, least
+   // significant bit first) to 16 bits per pixel
+   void UnpackMono10p(unsigned short* out, const unsigned char* in, std::size_t pixelCount) const;
+   void UnpackMono12p(unsigned short* out, const unsigned char* in, std::size_t pixelCount) const;
+
+   // Use at most the given instruction set (for testing and benchmarking);
+   // the CPU's best one is used by default
+   void SetMaxInstructionSet(InstructionSet set) {maxInstructionSet = set;}
+   static InstructionSet GetCpuInstructionSet();
+
+private:
+   InstructionSet GetInstructionSet() const;
+
+   InstructionSet maxInstructionSet;
+};
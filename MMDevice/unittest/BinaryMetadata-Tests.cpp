@@ -0,0 +1,144 @@
+#include <catch2/catch_all.hpp>
+
+#include "BinaryMetadata.h"
+#include "ImageMetadata.h"
+#include "MMDeviceConstants.h"
+
+#include <string>
+#include <vector>
+
+namespace MM {
+
+TEST_CASE("Empty binary metadata decodes to nothing", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter w;
+   Metadata md;
+   CHECK(DecodeBinaryMetadata(w.GetData(), w.GetSize(), md));
+   CHECK(md.GetKeys().empty());
+}
+
+TEST_CASE("Binary metadata matches Metadata::PutTag", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter w;
+   w.PutImageTag(g_Keyword_Metadata_CameraLabel, "Camera");
+   w.PutImageTag(g_Keyword_Metadata_ImageNumber, 42LL);
+   w.PutImageTag(g_Keyword_Metadata_ROI_X, 7u);
+   w.PutImageTag(g_Keyword_Elapsed_Time_ms, 12.345);
+   w.PutImageTag("CustomKey", "custom value");
+   w.PutTag("Position", "Stage", 3.25);
+   w.PutTag(g_Keyword_Binning, "Camera", "2");
+
+   Metadata expected;
+   expected.PutImageTag(g_Keyword_Metadata_CameraLabel, "Camera");
+   expected.PutImageTag(g_Keyword_Metadata_ImageNumber, 42LL);
+   expected.PutImageTag(g_Keyword_Metadata_ROI_X, 7u);
+   expected.PutImageTag(g_Keyword_Elapsed_Time_ms, 12.345);
+   expected.PutImageTag("CustomKey", "custom value");
+   expected.PutTag("Position", "Stage", 3.25);
+   expected.PutTag(g_Keyword_Binning, "Camera", "2");
+
+   Metadata md;
+   REQUIRE(DecodeBinaryMetadata(w.GetData(), w.GetSize(), md));
+   CHECK(md.Serialize() == expected.Serialize());
+   CHECK(md.GetSingleTag("Stage-Position").GetDevice() == "Stage");
+   CHECK(md.GetSingleTag("CustomKey").GetValue() == "custom value");
+}
+
+TEST_CASE("Binary metadata replaces existing tags", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter w;
+   w.PutImageTag("Key", "new");
+
+   Metadata md;
+   md.PutImageTag("Key", "old");
+   md.PutImageTag("Other", "kept");
+   REQUIRE(DecodeBinaryMetadata(w.GetData(), w.GetSize(), md));
+   CHECK(md.GetSingleTag("Key").GetValue() == "new");
+   CHECK(md.GetSingleTag("Other").GetValue() == "kept");
+}
+
+TEST_CASE("Writer can be reused after Clear", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter w;
+   w.PutImageTag("First", 1);
+   w.Clear();
+   w.PutImageTag("Second", 2);
+
+   Metadata md;
+   REQUIRE(DecodeBinaryMetadata(w.GetData(), w.GetSize(), md));
+   CHECK_FALSE(md.HasTag("First"));
+   CHECK(md.GetSingleTag("Second").GetValue() == "2");
+}
+
+TEST_CASE("Malformed binary metadata is rejected", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter w;
+   w.PutTag("Key", "Device", "value");
+   std::vector<unsigned char> data(w.GetData(), w.GetData() + w.GetSize());
+   Metadata md;
+
+   SECTION("bad header")
+   {
+      data[0] = 'X';
+      CHECK_FALSE(DecodeBinaryMetadata(data.data(),
+         static_cast<unsigned long>(data.size()), md));
+   }
+
+   SECTION("truncated")
+   {
+      for (std::size_t len = 0; len < data.size(); ++len)
+      {
+         if (len == 4)
+            continue; // Header alone is valid
+         Metadata partial;
+         CHECK_FALSE(DecodeBinaryMetadata(data.data(),
+            static_cast<unsigned long>(len), partial));
+         CHECK_FALSE(ValidateBinaryMetadata(data.data(),
+            static_cast<unsigned long>(len)));
+      }
+      CHECK(ValidateBinaryMetadata(data.data(),
+         static_cast<unsigned long>(data.size())));
+   }
+
+   SECTION("unknown value type")
+   {
+      data[4] = 0x7f;
+      CHECK_FALSE(DecodeBinaryMetadata(data.data(),
+         static_cast<unsigned long>(data.size()), md));
+   }
+
+   SECTION("unknown interned key")
+   {
+      const unsigned char bad[] = { 'M', 'M', 'B', BinaryMetadataVersion,
+         BinaryMetadataInteger,
+         BinaryMetadataFlagInternedKey | BinaryMetadataFlagImageTag,
+         0xff, 0xff, 0, 0, 0, 0, 0, 0, 0, 0 };
+      CHECK_FALSE(DecodeBinaryMetadata(bad, sizeof(bad), md));
+   }
+}
+
+TEST_CASE("Binary metadata records can be concatenated", "[BinaryMetadata]")
+{
+   BinaryMetadataWriter camera;
+   camera.PutImageTag(g_Keyword_Metadata_ImageNumber, 1LL);
+   camera.PutTag("Position", "Stage", 3.25);
+
+   BinaryMetadataWriter w;
+   w.PutImageTag(g_Keyword_Metadata_ImageNumber, 0LL);
+   w.AppendRecords(camera.GetData(), camera.GetSize());
+   w.PutImageTag("After", "x");
+   REQUIRE(ValidateBinaryMetadata(w.GetData(), w.GetSize()));
+
+   Metadata md;
+   REQUIRE(DecodeBinaryMetadata(w.GetData(), w.GetSize(), md));
+   CHECK(md.GetKeys().size() == 3);
+   CHECK(md.GetSingleTag(g_Keyword_Metadata_ImageNumber).GetValue() == "1");
+   CHECK(md.GetSingleTag("Stage-Position").GetValue() == "3.25");
+
+   BinaryMetadataWriter other;
+   other.Swap(w);
+   CHECK(w.GetSize() == 4);
+   CHECK(other.GetSize() > 4);
+}
+
+} // namespace MM
@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+
+#include "Debayer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename T>
+std::vector<T> Mosaic(int width, int height, int bitDepth)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, (1 << bitDepth) - 1);
+    std::vector<T> pixels(static_cast<size_t>(width) * height);
+    for (auto& p : pixels)
+        p = static_cast<T>(dist(rng));
+    return pixels;
+}
+
+const char* SetName(Debayer::InstructionSet set)
+{
+    switch (set) {
+        case Debayer::Scalar: return "scalar";
+        case Debayer::SSE2: return "SSE2";
+        default: return "AVX2";
+    }
+}
+
+template <typename T>
+void BenchmarkSize(int width, int height, int bitDepth)
+{
+    auto in = Mosaic<T>(width, height, bitDepth);
+    ImgBuffer out(width, height, 4);
+    Debayer debayer;
+    const std::string size = std::to_string(width) + "x" + std::to_string(height) +
+        " " + std::to_string(bitDepth) + "-bit";
+
+    for (int algorithm : { 0, 1, 2, 4 }) {
+        debayer.SetAlgorithmIndex(algorithm);
+        const std::string name = size + " " + debayer.GetAlgorithms()[algorithm];
+        if (algorithm == 0 || algorithm == 1) {
+            for (auto set : { Debayer::Scalar, Debayer::SSE2, Debayer::AVX2 }) {
+                if (set > Debayer::GetCpuInstructionSet())
+                    continue;
+                debayer.SetMaxInstructionSet(set);
+                debayer.SetThreadCount(1);
+                BENCHMARK(name + ", " + SetName(set) + ", 1 thread") {
+                    return debayer.Process(out, in.data(), width, height, bitDepth);
+                };
+            }
+            debayer.SetMaxInstructionSet(Debayer::AVX2);
+        }
+        debayer.SetThreadCount(0);
+        BENCHMARK(name + ", all threads") {
+            return debayer.Process(out, in.data(), width, height, bitDepth);
+        };
+    }
+}
+
+} // namespace
+
+TEST_CASE("Debayer 2048x2048", "[Debayer][benchmark]")
+{
+    BenchmarkSize<unsigned char>(2048, 2048, 8);
+    BenchmarkSize<unsigned short>(2048, 2048, 12);
+    BenchmarkSize<unsigned short>(2048, 2048, 16);
+}
+
+TEST_CASE("Debayer 4096x3000", "[Debayer][benchmark]")
+{
+    BenchmarkSize<unsigned char>(4096, 3000, 8);
+    BenchmarkSize<unsigned short>(4096, 3000, 16);
+}
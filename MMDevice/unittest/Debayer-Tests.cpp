@@ -0,0 +1,226 @@
+#include <catch2/catch_all.hpp>
+
+#include "Debayer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kReplication = 0;
+const int kBilinear = 1;
+const int kSmoothHue = 2;
+const int kEdgeAware = 4;
+
+template <typename T>
+std::vector<T> RandomMosaic(int width, int height, int bitDepth, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, (1 << bitDepth) - 1);
+    std::vector<T> pixels(static_cast<size_t>(width) * height);
+    for (auto& p : pixels)
+        p = static_cast<T>(dist(rng));
+    return pixels;
+}
+
+// Mosaic of a uniform color; red, green, blue at their sites for the order
+std::vector<unsigned char> FlatMosaic(int width, int height, int order,
+    unsigned char red, unsigned char green, unsigned char blue)
+{
+    // Sites of red and blue within the 2x2 tile, by order: (y, x)
+    const int redSite[4][2] = { {0, 0}, {1, 1}, {0, 1}, {1, 0} };
+    const int blueSite[4][2] = { {1, 1}, {0, 0}, {1, 0}, {0, 1} };
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char v = green;
+            if ((y & 1) == redSite[order][0] && (x & 1) == redSite[order][1])
+                v = red;
+            else if ((y & 1) == blueSite[order][0] && (x & 1) == blueSite[order][1])
+                v = blue;
+            pixels[static_cast<size_t>(y) * width + x] = v;
+        }
+    }
+    return pixels;
+}
+
+template <typename T>
+std::vector<unsigned char> Run(Debayer& debayer, const std::vector<T>& in,
+    int width, int height, int bitDepth)
+{
+    ImgBuffer out;
+    REQUIRE(debayer.Process(out, in.data(), width, height, bitDepth) == DEVICE_OK);
+    REQUIRE(out.Depth() == 4);
+    const unsigned char* p = out.GetPixels();
+    return std::vector<unsigned char>(p, p + static_cast<size_t>(width) * height * 4);
+}
+
+} // namespace
+
+TEST_CASE("Debayer lists Edge-Aware after the legacy algorithms", "[Debayer]")
+{
+    Debayer debayer;
+    auto algorithms = debayer.GetAlgorithms();
+    REQUIRE(algorithms.size() == 5);
+    CHECK(algorithms[kReplication] == "Replication");
+    CHECK(algorithms[kBilinear] == "Bilinear");
+    CHECK(algorithms[kSmoothHue] == "Smooth-Hue");
+    CHECK(algorithms[kEdgeAware] == "Edge-Aware");
+}
+
+TEST_CASE("Debayer vector kernels match the scalar kernel", "[Debayer]")
+{
+    const int algorithm = GENERATE(kReplication, kBilinear);
+    const int order = GENERATE(0, 1, 2, 3);
+    const int width = GENERATE(1, 2, 7, 8, 33, 64);
+    const int height = GENERATE(1, 2, 5, 16);
+    CAPTURE(algorithm, order, width, height);
+
+    Debayer debayer;
+    debayer.SetAlgorithmIndex(algorithm);
+    debayer.SetOrderIndex(order);
+    debayer.SetThreadCount(1);
+
+    auto in8 = RandomMosaic<unsigned char>(width, height, 8, 1);
+    auto in12 = RandomMosaic<unsigned short>(width, height, 12, 2);
+    auto in16 = RandomMosaic<unsigned short>(width, height, 16, 3);
+
+    debayer.SetMaxInstructionSet(Debayer::Scalar);
+    auto scalar8 = Run(debayer, in8, width, height, 8);
+    auto scalar12 = Run(debayer, in12, width, height, 12);
+    auto scalar16 = Run(debayer, in16, width, height, 16);
+
+    for (auto set : { Debayer::SSE2, Debayer::AVX2 }) {
+        CAPTURE(set);
+        debayer.SetMaxInstructionSet(set);
+        CHECK(Run(debayer, in8, width, height, 8) == scalar8);
+        CHECK(Run(debayer, in12, width, height, 12) == scalar12);
+        CHECK(Run(debayer, in16, width, height, 16) == scalar16);
+    }
+}
+
+TEST_CASE("Debayer reproduces a flat field", "[Debayer]")
+{
+    const int algorithm = GENERATE(kReplication, kBilinear, kEdgeAware);
+    const int order = GENERATE(0, 1, 2, 3);
+    CAPTURE(algorithm, order);
+
+    const int width = 37;
+    const int height = 21;
+    auto in = FlatMosaic(width, height, order, 200, 120, 40);
+
+    Debayer debayer;
+    debayer.SetAlgorithmIndex(algorithm);
+    debayer.SetOrderIndex(order);
+    auto out = Run(debayer, in, width, height, 8);
+
+    // Orders 2 and 3 have always written red and blue to each other's byte
+    const bool swapped = order == 2 || order == 3;
+    for (size_t i = 0; i < out.size(); i += 4) {
+        CAPTURE(i / 4);
+        REQUIRE(out[i + 0] == (swapped ? 200 : 40));
+        REQUIRE(out[i + 1] == 120);
+        REQUIRE(out[i + 2] == (swapped ? 40 : 200));
+        REQUIRE(out[i + 3] == 0);
+    }
+}
+
+TEST_CASE("Debayer bilinear averages neighbors", "[Debayer]")
+{
+    // B-G-B-G: blue at (even, even), red at (odd, odd)
+    const int width = 4;
+    const int height = 4;
+    std::vector<unsigned char> in = {
+        10, 20, 30, 40,
+        50, 60, 70, 80,
+        90, 100, 110, 120,
+        130, 140, 150, 160,
+    };
+    Debayer debayer;
+    debayer.SetAlgorithmIndex(kBilinear);
+    debayer.SetOrderIndex(1);
+    auto out = Run(debayer, in, width, height, 8);
+
+    // Pixel (1, 1) is a red site; green from 4 neighbors, blue from diagonals
+    const unsigned char* p = &out[(1 * width + 1) * 4];
+    CHECK(p[2] == 60);
+    CHECK(p[1] == ((((50 + 70 + 1) / 2) + ((20 + 100 + 1) / 2) + 1) / 2));
+    CHECK(p[0] == ((((10 + 30 + 1) / 2) + ((90 + 110 + 1) / 2) + 1) / 2));
+}
+
+TEST_CASE("Debayer scales and saturates high bit depths", "[Debayer]")
+{
+    const int algorithm = GENERATE(kReplication, kBilinear, kEdgeAware);
+    CAPTURE(algorithm);
+    std::vector<unsigned short> in(16 * 4, 0x0FFF);
+    in[0] = 0x0800;
+
+    Debayer debayer;
+    debayer.SetAlgorithmIndex(algorithm);
+    auto out12 = Run(debayer, in, 16, 4, 12);
+    CHECK(out12[4 * 5 + 1] == 255);
+
+    // Values above the declared bit depth saturate instead of wrapping
+    std::vector<unsigned short> bright(16 * 4, 0xFFFF);
+    auto out8 = Run(debayer, bright, 16, 4, 8);
+    for (size_t i = 0; i < out8.size(); i += 4)
+        REQUIRE(out8[i + 1] == 255);
+}
+
+TEST_CASE("Debayer output does not depend on thread count", "[Debayer]")
+{
+    const int algorithm = GENERATE(kReplication, kBilinear, kEdgeAware);
+    CAPTURE(algorithm);
+    const int width = 203;
+    const int height = 517;
+    auto in = RandomMosaic<unsigned short>(width, height, 14, 4);
+
+    Debayer debayer;
+    debayer.SetAlgorithmIndex(algorithm);
+    debayer.SetOrderIndex(3);
+    debayer.SetThreadCount(1);
+    auto single = Run(debayer, in, width, height, 14);
+    debayer.SetThreadCount(5);
+    CHECK(Run(debayer, in, width, height, 14) == single);
+}
+
+TEST_CASE("Debayer edge-aware interpolates along edges", "[Debayer]")
+{
+    // Vertical stripes two columns wide on an R-G-R-G mosaic: green at red
+    // and blue sites must come from the same column, not across the edge
+    const int width = 16;
+    const int height = 16;
+    std::vector<unsigned char> in(width * height);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            in[y * width + x] = ((x / 2) & 1) ? 200 : 40;
+
+    Debayer debayer;
+    debayer.SetOrderIndex(0);
+    debayer.SetAlgorithmIndex(kEdgeAware);
+    auto edgeAware = Run(debayer, in, width, height, 8);
+    debayer.SetAlgorithmIndex(kBilinear);
+    auto bilinear = Run(debayer, in, width, height, 8);
+
+    for (int y = 2; y < height - 2; ++y) {
+        for (int x = 2; x < width - 2; ++x) {
+            CAPTURE(x, y);
+            unsigned char expected = in[y * width + x];
+            REQUIRE(edgeAware[(y * width + x) * 4 + 1] == expected);
+        }
+    }
+    // Bilinear blurs the green plane across the stripe edges
+    CHECK(bilinear != edgeAware);
+}
+
+TEST_CASE("Debayer accepts empty images and rejects bad orders", "[Debayer]")
+{
+    Debayer debayer;
+    std::vector<unsigned char> in(4, 0);
+    ImgBuffer out;
+    CHECK(debayer.Process(out, in.data(), 0, 0, 8) == DEVICE_OK);
+    debayer.SetOrderIndex(4);
+    CHECK(debayer.Process(out, in.data(), 2, 2, 8) == DEVICE_INVALID_INPUT_PARAM);
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_all.hpp>
+
+#include "PixelFormatConverter.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* SetName(PixelFormatConverter::InstructionSet set)
+{
+    switch (set) {
+        case PixelFormatConverter::Scalar: return "scalar";
+        case PixelFormatConverter::SSE2: return "SSE2";
+        case PixelFormatConverter::SSSE3: return "SSSE3";
+        default: return "AVX2";
+    }
+}
+
+std::vector<unsigned char> RandomBytes(size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<unsigned char> bytes(count);
+    for (auto& b : bytes)
+        b = static_cast<unsigned char>(dist(rng));
+    return bytes;
+}
+
+// Benchmarks conversion of a frame with each instruction set the CPU has
+template <typename Out, typename Convert>
+void BenchmarkConversion(const std::string& name, size_t pixels,
+    double inBytesPerPixel, size_t outPerPixel, Convert convert)
+{
+    const auto in = RandomBytes(static_cast<size_t>(pixels * inBytesPerPixel) + 1);
+    std::vector<Out> out(pixels * outPerPixel);
+    PixelFormatConverter converter;
+    for (auto set : { PixelFormatConverter::Scalar, PixelFormatConverter::SSE2,
+            PixelFormatConverter::SSSE3, PixelFormatConverter::AVX2 }) {
+        if (set > PixelFormatConverter::GetCpuInstructionSet())
+            continue;
+        converter.SetMaxInstructionSet(set);
+        BENCHMARK(name + ", " + SetName(set)) {
+            convert(converter, out.data(), in.data(), pixels);
+            return out[0];
+        };
+    }
+}
+
+} // namespace
+
+TEST_CASE("Pixel format conversion 1920x1080", "[PixelFormatConverter][benchmark]")
+{
+    const size_t pixels = 1920 * 1080;
+    BenchmarkConversion<unsigned char>("YUYV to BGRA", pixels, 2, 4,
+        [](const PixelFormatConverter& c, unsigned char* out, const unsigned char* in, size_t n) {
+            c.YUYVToBGRA(out, in, n);
+        });
+    BenchmarkConversion<unsigned char>("UYVY to BGRA", pixels, 2, 4,
+        [](const PixelFormatConverter& c, unsigned char* out, const unsigned char* in, size_t n) {
+            c.UYVYToBGRA(out, in, n);
+        });
+    BenchmarkConversion<unsigned char>("YUYV to Y", pixels, 2, 1,
+        [](const PixelFormatConverter& c, unsigned char* out, const unsigned char* in, size_t n) {
+            c.YUYVToY(out, in, n);
+        });
+    BenchmarkConversion<unsigned char>("RGB8 to BGRA", pixels, 3, 4,
+        [](const PixelFormatConverter& c, unsigned char* out, const unsigned char* in, size_t n) {
+            c.RGB8ToBGRA(out, in, n);
+        });
+}
+
+TEST_CASE("Mono unpacking 4096x3000", "[PixelFormatConverter][benchmark]")
+{
+    const size_t pixels = 4096 * 3000;
+    BenchmarkConversion<unsigned short>("Mono10p", pixels, 1.25, 1,
+        [](const PixelFormatConverter& c, unsigned short* out, const unsigned char* in, size_t n) {
+            c.UnpackMono10p(out, in, n);
+        });
+    BenchmarkConversion<unsigned short>("Mono12p", pixels, 1.5, 1,
+        [](const PixelFormatConverter& c, unsigned short* out, const unsigned char* in, size_t n) {
+            c.UnpackMono12p(out, in, n);
+        });
+}
@@ -0,0 +1,181 @@
+#include <catch2/catch_all.hpp>
+
+#include "PixelFormatConverter.h"
+
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> RandomBytes(size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<unsigned char> bytes(count);
+    for (auto& b : bytes)
+        b = static_cast<unsigned char>(dist(rng));
+    return bytes;
+}
+
+unsigned char Clip(int v)
+{
+    return static_cast<unsigned char>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Reference conversion, pixel by pixel
+std::vector<unsigned char> ReferenceYCbCrToBGRA(const std::vector<unsigned char>& in,
+    bool uyvy)
+{
+    const size_t pixels = in.size() / 2;
+    std::vector<unsigned char> out(4 * pixels);
+    for (size_t x = 0; x < pixels; ++x) {
+        const unsigned char* pair = &in[4 * (x / 2)];
+        int y = uyvy ? pair[1 + 2 * (x % 2)] : pair[2 * (x % 2)];
+        int cb = uyvy ? pair[0] : pair[1];
+        int cr = uyvy ? pair[2] : pair[3];
+        int c = y - 16, d = cb - 128, e = cr - 128;
+        out[4 * x] = Clip((298 * c + 516 * d + 128) >> 8);
+        out[4 * x + 1] = Clip((298 * c - 100 * d - 208 * e + 128) >> 8);
+        out[4 * x + 2] = Clip((298 * c + 409 * e + 128) >> 8);
+        out[4 * x + 3] = 0;
+    }
+    return out;
+}
+
+// Packs values least significant bit first
+std::vector<unsigned char> PackBits(const std::vector<unsigned short>& values, int bits)
+{
+    std::vector<unsigned char> packed((values.size() * bits + 7) / 8);
+    size_t bit = 0;
+    for (unsigned short v : values) {
+        for (int i = 0; i < bits; ++i, ++bit) {
+            if (v & (1 << i))
+                packed[bit / 8] |= static_cast<unsigned char>(1 << (bit % 8));
+        }
+    }
+    return packed;
+}
+
+std::vector<PixelFormatConverter::InstructionSet> SupportedSets()
+{
+    std::vector<PixelFormatConverter::InstructionSet> sets;
+    for (auto set : { PixelFormatConverter::Scalar, PixelFormatConverter::SSE2,
+            PixelFormatConverter::SSSE3, PixelFormatConverter::AVX2 }) {
+        if (set <= PixelFormatConverter::GetCpuInstructionSet())
+            sets.push_back(set);
+    }
+    return sets;
+}
+
+} // namespace
+
+TEST_CASE("YUYV and UYVY convert to BGRA", "[PixelFormatConverter]")
+{
+    // Sizes exercising the vector loops and their scalar tails
+    const size_t pixels = GENERATE(2, 14, 16, 30, 1000, 1026);
+    const bool uyvy = GENERATE(false, true);
+    const auto in = RandomBytes(2 * pixels, 7);
+    const auto expected = ReferenceYCbCrToBGRA(in, uyvy);
+
+    PixelFormatConverter converter;
+    for (auto set : SupportedSets()) {
+        CAPTURE(set);
+        converter.SetMaxInstructionSet(set);
+        std::vector<unsigned char> out(4 * pixels, 0xAA);
+        if (uyvy)
+            converter.UYVYToBGRA(out.data(), in.data(), pixels);
+        else
+            converter.YUYVToBGRA(out.data(), in.data(), pixels);
+        CHECK(out == expected);
+    }
+}
+
+TEST_CASE("YUYV gray levels convert to gray", "[PixelFormatConverter]")
+{
+    // Y 16 is black, 235 white; neutral chroma
+    const unsigned char in[] = { 16, 128, 235, 128, 126, 128, 126, 128 };
+    unsigned char out[16];
+    PixelFormatConverter().YUYVToBGRA(out, in, 4);
+    const unsigned char expected[] = { 0, 0, 0, 0, 255, 255, 255, 0,
+        128, 128, 128, 0, 128, 128, 128, 0 };
+    CHECK(std::vector<unsigned char>(out, out + 16) ==
+        std::vector<unsigned char>(expected, expected + 16));
+}
+
+TEST_CASE("Y plane is extracted from YUYV and UYVY", "[PixelFormatConverter]")
+{
+    const size_t pixels = GENERATE(2, 16, 34, 1000);
+    const auto in = RandomBytes(2 * pixels, 11);
+
+    PixelFormatConverter converter;
+    for (auto set : SupportedSets()) {
+        CAPTURE(set);
+        converter.SetMaxInstructionSet(set);
+        std::vector<unsigned char> yuyv(pixels), uyvy(pixels);
+        converter.YUYVToY(yuyv.data(), in.data(), pixels);
+        converter.UYVYToY(uyvy.data(), in.data(), pixels);
+        for (size_t x = 0; x < pixels; ++x) {
+            CHECK(yuyv[x] == in[2 * x]);
+            CHECK(uyvy[x] == in[2 * x + 1]);
+        }
+    }
+}
+
+TEST_CASE("RGB8 and BGR8 convert to BGRA", "[PixelFormatConverter]")
+{
+    const size_t pixels = GENERATE(1, 15, 16, 17, 1000);
+    const auto in = RandomBytes(3 * pixels, 3);
+
+    PixelFormatConverter converter;
+    for (auto set : SupportedSets()) {
+        CAPTURE(set);
+        converter.SetMaxInstructionSet(set);
+        std::vector<unsigned char> fromRGB(4 * pixels, 0xAA), fromBGR(4 * pixels, 0xAA);
+        converter.RGB8ToBGRA(fromRGB.data(), in.data(), pixels);
+        converter.BGR8ToBGRA(fromBGR.data(), in.data(), pixels);
+        for (size_t x = 0; x < pixels; ++x) {
+            CHECK(fromRGB[4 * x] == in[3 * x + 2]);
+            CHECK(fromRGB[4 * x + 1] == in[3 * x + 1]);
+            CHECK(fromRGB[4 * x + 2] == in[3 * x]);
+            CHECK(fromRGB[4 * x + 3] == 0);
+            CHECK(fromBGR[4 * x] == in[3 * x]);
+            CHECK(fromBGR[4 * x + 1] == in[3 * x + 1]);
+            CHECK(fromBGR[4 * x + 2] == in[3 * x + 2]);
+            CHECK(fromBGR[4 * x + 3] == 0);
+        }
+    }
+}
+
+TEST_CASE("Mono10p and Mono12p unpack to 16 bits", "[PixelFormatConverter]")
+{
+    const int bits = GENERATE(10, 12);
+    const size_t pixels = GENERATE(1, 7, 8, 9, 24, 1001);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(0, (1 << bits) - 1);
+    std::vector<unsigned short> values(pixels);
+    for (auto& v : values)
+        v = static_cast<unsigned short>(dist(rng));
+    const auto packed = PackBits(values, bits);
+
+    PixelFormatConverter converter;
+    for (auto set : SupportedSets()) {
+        CAPTURE(bits, pixels, set);
+        converter.SetMaxInstructionSet(set);
+        std::vector<unsigned short> out(pixels, 0xFFFF);
+        if (bits == 10)
+            converter.UnpackMono10p(out.data(), packed.data(), pixels);
+        else
+            converter.UnpackMono12p(out.data(), packed.data(), pixels);
+        CHECK(out == values);
+    }
+}
+
+TEST_CASE("Mono12p follows the GenICam bit order", "[PixelFormatConverter]")
+{
+    // Pixels 0x321 and 0xABC
+    const unsigned char in[] = { 0x21, 0xC3, 0xAB };
+    unsigned short out[2];
+    PixelFormatConverter().UnpackMono12p(out, in, 2);
+    CHECK(out[0] == 0x321);
+    CHECK(out[1] == 0xABC);
+}